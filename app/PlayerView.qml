@@ -16,6 +16,8 @@ Item {
 
     signal askNext(string areaId)
     signal onStop()
+    //next item is put on screen, c++ takes latency at the first frame rendered after it
+    signal transitionDone(string areaId, bool prerolled)
 
 
     property bool isPlaying: false
@@ -28,6 +30,22 @@ Item {
 
     property bool browserVisible: false
     property bool isStandartMode: false
+    property bool transitionStarted: false
+    //item end is driven by PlaybackClock from c++, timers below only track current item
+    property bool externalClock: false
+
+    function startTransition()
+    {
+        transitionStarted = true
+    }
+
+    function finishTransition(prerolled)
+    {
+        if (!transitionStarted)
+            return
+        transitionStarted = false
+        transitionDone(areaID, prerolled)
+    }
 
     function prepare(name, campaignWidth, campaignHeight, x, y, w, h, _rotation, screenWidth, screenHeight, _opacity)
     {
@@ -70,6 +88,15 @@ Item {
         vp2.muted = isMuted
     }
 
+    function finishCurrentItem(){
+        if (currentType === "video")
+            videoPlayerTimer.forceTriggered()
+        else if (currentType === "image")
+            imageOffTimer.forceTriggered()
+        else if (currentType === "browser")
+            turnOffTimer.forceTriggered()
+    }
+
     function skipCurrentItem(){
         if (videoPlayerTimer.isActivated)
             videoPlayerTimer.forceTriggered()
@@ -421,7 +448,8 @@ Item {
 
             function startTimer(){
                 videoPlayerTimer.isActivated = true
-                videoPlayerTimer.start()
+                if (!externalClock)
+                    videoPlayerTimer.start()
             }
             function stopTimer(){
                 videoPlayerTimer.isActivated = false
@@ -436,6 +464,7 @@ Item {
             onTriggered: {
                 console.log("VPT::onTriggered")
                 videoPlayerTimer.isActivated = false
+                startTransition()
 
 
                 /*if (isStandartMode)
@@ -491,12 +520,14 @@ Item {
                 else if (nextItemType === "browser"){
                     console.log("VPT:browser")
                     browser.showPreloaded()
+                    finishTransition(sideBrowser1.loadProgress === 100)
                     currentType = "browser"
                     videoPlayer.reset()
                 }
                 else if (nextItemType === "image"){
                     console.log("VPT:image")
                     imageContent.showPreloaded()
+                    finishTransition(contentImage1.status === Image.Ready)
                     currentType = "image"
                     videoPlayer.reset()
                 }
@@ -586,21 +617,27 @@ Item {
 
         Timer {
 
-            function activateTimer(isFirstVideo){
+            //prerolled player already has first frame decoded, so it needs only a couple of frames to start
+            function activateTimer(isFirstVideo, isPrerolled){
                 showFirstVideo = isFirstVideo
+                prerolled = isPrerolled
+                antiFlickTimerVideo.interval = isPrerolled ? 80 : 300
                 antiFlickTimerVideo.restart()
             }
 
             property bool showFirstVideo: true
+            property bool prerolled: false
 
             id: antiFlickTimerVideo
             repeat: false
             interval: 300
             onTriggered: {
+                 //previous player is stopped only after it was hidden, so there is no black frame between items
                  if (showFirstVideo){
 
                      vp2.opacity = 0.0
                      vp1.opacity = 1.0
+                     vp2.stop()
 
                      if(vp1.isAudio)
                          audioIcon.visible = true
@@ -610,11 +647,13 @@ Item {
                  else{
                      vp1.opacity = 0.0
                      vp2.opacity = 1.0
+                     vp1.stop()
                      if(vp2.isAudio)
                          audioIcon.visible = true
                      else
                          audioIcon.visible = false
                  }
+                 finishTransition(prerolled)
             }
         }
 
@@ -626,6 +665,19 @@ Item {
             property int durationMsecs: 0
             property int seekMsecs: 0
             property bool isAudio: false
+            property bool prerolled: false
+
+            onSourceChanged: prerolled = false
+            //pause idle player as soon as media is loaded to get first frame decoded before it is shown
+            onStatusChanged: {
+                if (status === MediaPlayer.Loaded && playbackState === MediaPlayer.StoppedState && !isAudio && source != "")
+                {
+                    vp1.pause()
+                    if (vp1.seekMsecs > 0)
+                        vp1.seek(vp1.seekMsecs)
+                    prerolled = true
+                }
+            }
             
             x: -videoPlayer.x
             y: -videoPlayer.y
@@ -636,19 +688,15 @@ Item {
             
             onPlaying:{
                 console.log("vp1::onPlay " + vp1.source + " " + volume)
-                antiFlickTimerVideo.activateTimer(true)
+                antiFlickTimerVideo.activateTimer(true, vp1.prerolled)
                 var dur = Math.max(vp1.durationMsecs, 5000) - 250 + delay
                 videoPlayerTimer.interval = dur
                 videoPlayerTimer.startTimer()
                 if (delay != 0)
                     delayManager.run(dur)
-                if (vp1.seekMsecs > 0)
+                if (vp1.seekMsecs > 0 && !vp1.prerolled)
                     vp1.seek(vp1.seekMsecs)
-                if(isAudio)
-                    audioIcon.visible = true
-                else
-                    audioIcon.visible = false
-                vp2.stop()
+                vp1.prerolled = false
             }
             function setFillMode(fill_mode){
                 if (fill_mode === "stretch")
@@ -669,6 +717,19 @@ Item {
             property int durationMsecs: 0
             property int seekMsecs: 0
             property bool isAudio: false
+            property bool prerolled: false
+
+            onSourceChanged: prerolled = false
+            //pause idle player as soon as media is loaded to get first frame decoded before it is shown
+            onStatusChanged: {
+                if (status === MediaPlayer.Loaded && playbackState === MediaPlayer.StoppedState && !isAudio && source != "")
+                {
+                    vp2.pause()
+                    if (vp2.seekMsecs > 0)
+                        vp2.seek(vp2.seekMsecs)
+                    prerolled = true
+                }
+            }
 
             x: -videoPlayer.x
             y: -videoPlayer.y
@@ -687,7 +748,7 @@ Item {
             }
             onPlaying: {
                 console.log("vp2::onPlay " + vp2.source)
-                antiFlickTimerVideo.activateTimer(false)
+                antiFlickTimerVideo.activateTimer(false, vp2.prerolled)
 
 
                 var dur = Math.max(vp2.durationMsecs, 5000) - 250 + delay
@@ -696,13 +757,9 @@ Item {
                 if (delay != 0)
                     delayManager.run(dur)
 
-                if (vp2.seekMsecs > 0)
+                if (vp2.seekMsecs > 0 && !vp2.prerolled)
                     vp2.seek(vp2.seekMsecs)
-                if(isAudio)
-                    audioIcon.visible = true
-                else
-                    audioIcon.visible = false
-                vp1.stop()
+                vp2.prerolled = false
             }
             volume: volumeValue
         }
@@ -760,7 +817,8 @@ Item {
 
             function startTimer(){
                 imageOffTimer.isActivated = true
-                imageOffTimer.start()
+                if (!externalClock)
+                    imageOffTimer.start()
             }
 
             function stopTimer(){
@@ -770,7 +828,10 @@ Item {
 
             function restartTimer(){
                 imageOffTimer.isActivated = true
-                imageOffTimer.restart()
+                if (externalClock)
+                    imageOffTimer.stop()
+                else
+                    imageOffTimer.restart()
             }
 
             function forceTriggered(){
@@ -780,6 +841,7 @@ Item {
 
             onTriggered: {
                 console.log("image off timer")
+                startTransition()
                 if (stopAfterPlaying)
                 {
                     console.log("STOP AFTER PLAYING!")
@@ -799,10 +861,12 @@ Item {
                     if (contentImage1.visible){
                         contentImage1.visible = false
                         contentImage2.showPreloaded()
+                        finishTransition(contentImage2.status === Image.Ready)
                     }
                     else {
                         contentImage2.visible = false
                         contentImage1.showPreloaded()
+                        finishTransition(contentImage1.status === Image.Ready)
                     }
                 }
                 else if (nextItemType === "video"){
@@ -816,6 +880,7 @@ Item {
                     console.log("next item is browser")
                     imageContent.stop()
                     browser.showPreloaded()
+                    finishTransition(sideBrowser1.loadProgress === 100)
                     currentType = "browser"
                 }
                 askNextAntiFlick.restart()
@@ -1207,7 +1272,8 @@ Item {
 
             function startTimer(){
                 isActivated = true
-                turnOffTimer.start()
+                if (!externalClock)
+                    turnOffTimer.start()
             }
             function stopTimer(){
                 isActivated = false
@@ -1215,7 +1281,10 @@ Item {
             }
             function restartTimer(){
                 isActivated = true
-                turnOffTimer.restart()
+                if (externalClock)
+                    turnOffTimer.stop()
+                else
+                    turnOffTimer.restart()
             }
             function forceTriggered(){
                 turnOffTimer.interval = 1
@@ -1224,6 +1293,7 @@ Item {
 
             onTriggered: {
                 console.log("browser::onStop")
+                startTransition()
 
                 if (stopAfterPlaying)
                 {
@@ -1246,10 +1316,12 @@ Item {
                     if (browser.checkBrowserVisible(true)){
                         browser.showBrowser1(false)
                         sideBrowser2.showPreloaded()
+                        finishTransition(sideBrowser2.loadProgress === 100)
                     }
                     else {
                         browser.showBrowser2(false)
                         sideBrowser1.showPreloaded()
+                        finishTransition(sideBrowser1.loadProgress === 100)
                     }
 
                     /*
@@ -1272,6 +1344,7 @@ Item {
                     console.log("next item is image")
                     browser.hideBrowser()
                     imageContent.showPreloaded()
+                    finishTransition(contentImage1.status === Image.Ready)
                     currentType = "image"
                 }
                 askNextAntiFlick.restart()
@@ -14,6 +14,7 @@
 #include <QHash>
 #include <QString>
 #include "sslencoder.h"
+#include "logger.h"
 
 
 int main(int argc, char *argv[])
@@ -21,6 +22,7 @@ int main(int argc, char *argv[])
     QGuiApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
     QGuiApplication app(argc, argv);
     QDir().setCurrent(qApp->applicationDirPath());
+    LoggerInstance.start();
     app.setOverrideCursor( QCursor( Qt::BlankCursor ) );
     //QApplication a(argc, argv);
     //MainWindow w;
@@ -121,6 +121,7 @@ Item {
     signal gpsChanged(double lat, double lgt)
     signal setRestoreModeTrue()
     signal setRestoreModeFalse()
+    signal itemTransition(string areaID, bool prerolled)
 
     focus: true
 
@@ -502,6 +503,28 @@ Item {
             console.log("playNextItem::ERROR! Area " + areaId + " not found!")
     }
 
+    function setExternalClock(enabled)
+    {
+        fullscreenView.externalClock = enabled
+        fullscreenView2.externalClock = enabled
+        fullscreenView3.externalClock = enabled
+        fullscreenView4.externalClock = enabled
+    }
+
+    function finishAreaItem(areaId)
+    {
+        if (fullscreenView.areaID === areaId)
+            fullscreenView.finishCurrentItem()
+        else if (fullscreenView2.areaID === areaId)
+            fullscreenView2.finishCurrentItem()
+        else if (fullscreenView3.areaID === areaId)
+            fullscreenView3.finishCurrentItem()
+        else if (fullscreenView4.areaID === areaId)
+            fullscreenView4.finishCurrentItem()
+        else
+            console.log("finishAreaItem::ERROR! Area " + areaId + " not found!")
+    }
+
     function toggleMenu()
     {
         menu.visible = !menu.visible
@@ -1155,6 +1178,9 @@ Item {
             console.log("askNext?")
             nextItem(areaId)
         }
+        onTransitionDone: {
+            itemTransition(areaId, prerolled)
+        }
         Keys.onReleased:{
             console.log("KEy pressed")
             if (event.key === Qt.Key_Back || event.key === Qt.Key_Q) {
@@ -1186,6 +1212,9 @@ Item {
             console.log("askNext?")
             nextItem(areaId)
         }
+        onTransitionDone: {
+            itemTransition(areaId, prerolled)
+        }
         Keys.onReleased:{
             console.log("KEy pressed")
             if (event.key === Qt.Key_Back || event.key === Qt.Key_Q) {
@@ -1217,6 +1246,9 @@ Item {
             console.log("askNext?")
             nextItem(areaId)
         }
+        onTransitionDone: {
+            itemTransition(areaId, prerolled)
+        }
         Keys.onReleased:{
             console.log("KEy pressed")
             if (event.key === Qt.Key_Back || event.key === Qt.Key_Q) {
@@ -1247,6 +1279,9 @@ Item {
             console.log("askNext?")
             nextItem(areaId)
         }
+        onTransitionDone: {
+            itemTransition(areaId, prerolled)
+        }
         Keys.onReleased:{
             console.log("KEy pressed")
             if (event.key === Qt.Key_Back || event.key === Qt.Key_Q) {
@@ -1,3 +0,0 @@
-#!/bin/sh
-zip -9 ziplg log*
-
@@ -11,8 +11,14 @@ CONFIG -= app_bundle
 TEMPLATE = app
 
 SOURCES += main.cpp \
-    notherfilesystem.cpp
+    notherfilesystem.cpp \
+    lfsrencoder.cpp \
+    teledspatch.cpp
 
 HEADERS += \
-    notherfilesystem.h
+    notherfilesystem.h \
+    lfsrencoder.h \
+    teledspatch.h
+
+LIBS += -lz
 
@@ -5,6 +5,7 @@
 #include <QDebug>
 #include <QDateTime>
 #include "notherfilesystem.h"
+#include "teledspatch.h"
 
 int main(int argc, char *argv[])
 {
@@ -42,27 +43,43 @@ int main(int argc, char *argv[])
 
     qDebug() << "working with " << updateBatchFile;
 
+    if (TeleDSPatchFile::isPatch(updateBatchFile))
+    {
+        //delta against installed files, they are replaced only if all of them were patched and verified
+        TeleDSPatchFile patch;
+        if (patch.load(updateBatchFile) && patch.apply(QDir::currentPath()))
+            qDebug() << "delta update applied";
+        else
+        {
+            qDebug() << "ERROR! delta update cannot be applied, full update will be requested";
+            QFile marker(TELEDS_PATCH_FAILED_MARKER);
+            marker.open(QFile::WriteOnly);
+            marker.close();
+        }
+        QFile::remove(updateBatchFile);
+        return 0;
+    }
+
     NotherFileSystem nfs;
-    nfs.load(QString(updateBatchFile));
+    if (!nfs.load(QString(updateBatchFile)))
+    {
+        qDebug() << "ERROR! Cant load update batch";
+        return 0;
+    }
+    QFile::Permissions permissions = QFile::ExeGroup | QFile::ExeOwner | QFile::ExeOther | QFile::ExeUser |
+                                     QFile::ReadOwner| QFile::ReadUser | QFile::ReadOther | QFile::ReadGroup |
+                                     QFile::WriteGroup | QFile::WriteOwner | QFile::WriteOther | QFile::WriteUser;
     foreach (const QString &d, nfs.dirs())
         QDir().mkpath(d);
     if (nfs.fileExists("system::player"))
     {
-        QByteArray data = nfs.getFile("system::player");
-        if (data.length() > 1000000)
+        //entries are unpacked directly to disk, old player is replaced only if new one is complete
+        if (nfs.fileSize("system::player") > 1000000)
         {
-            QFile::remove("TeleDSPlayer");
-            QFile f("TeleDSPlayer");
-            if (f.open(QFile::WriteOnly))
-            {
-                f.write(data);
-                f.flush();
-
-                f.setPermissions(QFile::ExeGroup | QFile::ExeOwner | QFile::ExeOther | QFile::ExeUser |
-                                 QFile::ReadOwner| QFile::ReadUser | QFile::ReadOther | QFile::ReadGroup |
-                                 QFile::WriteGroup | QFile::WriteOwner | QFile::WriteOther | QFile::WriteUser);
-                f.close();
-            }
+            if (nfs.extractFile("system::player", QString("TeleDSPlayer")))
+                QFile::setPermissions("TeleDSPlayer", permissions);
+            else
+                qDebug() << "ERROR! player update is corrupted";
         }
     }
     else
@@ -76,23 +93,13 @@ int main(int argc, char *argv[])
             filename != "system::updater")
         {
             qDebug () << "unpacking " << filename;
-            QByteArray data = nfs.getFile(filename);
-            if (data.length() > 0)
+            if (nfs.fileSize(filename) > 0)
             {
-                QFile f(filename);
-                if (f.open(QFile::WriteOnly))
-                {
-                    f.write(data);
-                    f.flush();
-
-                    f.setPermissions(QFile::ExeGroup | QFile::ExeOwner | QFile::ExeOther | QFile::ExeUser |
-                                     QFile::ReadOwner| QFile::ReadUser | QFile::ReadOther | QFile::ReadGroup |
-                                     QFile::WriteGroup | QFile::WriteOwner | QFile::WriteOther | QFile::WriteUser);
-                    f.close();
-                }
+                if (nfs.extractFile(filename, filename))
+                    QFile::setPermissions(filename, permissions);
                 else
                 {
-                    qDebug() << "file " << filename << "cannot be opened";
+                    qDebug() << "file " << filename << "cannot be unpacked";
                 }
             }
         }
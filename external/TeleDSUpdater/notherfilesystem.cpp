@@ -1,73 +1,225 @@
 #include "notherfilesystem.h"
 
+
 #include <QCryptographicHash>
 #include <QDataStream>
 #include <QFile>
 #include <QFileInfo>
+#include <QBuffer>
+#include <QtEndian>
+#include <QDebug>
+#include <zlib.h>
 
-void LFSR::Encoder::encode(QByteArray &data, QString pass)
+static void putUInt32(QByteArray &out, quint32 value)
 {
-    QByteArray hashArray = QCryptographicHash::hash(pass.toLocal8Bit(),QCryptographicHash::Md5);
-    hashArray = hashArray.mid(0,4);
-    QDataStream ds(hashArray);
+    uchar buffer[4];
+    qToLittleEndian<quint32>(value, buffer);
+    out.append((const char*)buffer, 4);
+}
 
-    int seed;
-    ds >> seed;
+static void putUInt64(QByteArray &out, quint64 value)
+{
+    uchar buffer[8];
+    qToLittleEndian<quint64>(value, buffer);
+    out.append((const char*)buffer, 8);
+}
 
-    for (int i = 0; i<data.count(); ++i)
+NotherFileSystem::NotherFileSystem() :
+    map(0), index(0), version(0), containerSize(0), dataOffset(0), entryCount(0), bucketCount(0), namesSize(0)
+{
+    header.magic = NFS_MAGIC;
+}
+
+NotherFileSystem::~NotherFileSystem()
+{
+    close();
+}
+
+bool NotherFileSystem::load(QString fileName)
+{
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QFile::ReadOnly))
     {
-        char currentByte = 0;
-        for (int bitIndex = 0; bitIndex < 8; ++bitIndex)
+        qDebug() << "NotherFileSystem::load cannot open " + fileName;
+        return false;
+    }
+    containerSize = file.size();
+    //mapped pages are not counted as used memory and are dropped by kernel when needed
+    map = file.map(0, containerSize);
+
+    uchar magic[4];
+    if (readAt(0, (char*)magic, 4) && qFromLittleEndian<quint32>(magic) == NFS_MAGIC_V2)
+    {
+        if (loadV2())
+        {
+            version = 2;
+            return true;
+        }
+    }
+    else if (file.seek(0))
+    {
+        QDataStream s(&file);
+        NFSHeader h = NFSHeader::load(s);
+        quint32 dataSize = 0;
+        s >> dataSize;
+        if (h.magic == NFS_MAGIC && s.status() == QDataStream::Ok)
         {
-            if (seed & 0x00000001)
+            dataOffset = file.pos();
+            //null QByteArray is stored as 0xFFFFFFFF
+            if (dataSize == 0xFFFFFFFF)
+                dataSize = 0;
+            if (dataOffset + dataSize <= containerSize)
             {
-                seed = (seed ^ 0x80000057 >> 1) | 0x80000000;
-                currentByte |= (1 << bitIndex);
+                foreach (const FileDescriptor &fd, h.files)
+                {
+                    Entry entry;
+                    entry.offset = dataOffset + fd.pointer;
+                    entry.storedSize = fd.stored_size;
+                    entry.size = -1;
+                    entry.crc = 0;
+                    entry.hasCrc = false;
+                    entries[fd.name] = entry;
+                }
+                header = h;
+                version = 1;
+                return true;
             }
-            else
-                seed >>= 1;
         }
-        data[i] = data[i] ^ currentByte;
     }
+    qDebug() << "NotherFileSystem::load " + fileName + " is not valid update file";
+    close();
+    return false;
 }
 
-NotherFileSystem::NotherFileSystem()
+bool NotherFileSystem::loadV2()
 {
-    header.magic = NFS_MAGIC;
+    uchar h[NFS_V2_HEADER_SIZE];
+    if (!readAt(0, (char*)h, NFS_V2_HEADER_SIZE))
+        return false;
+    entryCount = qFromLittleEndian<quint32>(h + 4);
+    bucketCount = qFromLittleEndian<quint32>(h + 8);
+    namesSize = qFromLittleEndian<quint32>(h + 12);
+    dataOffset = qFromLittleEndian<quint64>(h + 16);
+    qint64 indexSize = NFS_V2_HEADER_SIZE + qint64(bucketCount) * 4 + qint64(entryCount) * NFS_V2_ENTRY_SIZE + namesSize;
+    if (bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0 ||
+        indexSize > dataOffset || dataOffset > containerSize)
+        return false;
+    if (map)
+        index = map;
+    else
+    {
+        indexData.resize(indexSize);
+        if (!readAt(0, indexData.data(), indexSize))
+            return false;
+        index = (const uchar*)indexData.constData();
+    }
+    return true;
 }
 
-void NotherFileSystem::load(QString file)
+void NotherFileSystem::close()
 {
-    QFile f(file);
-    if (f.open(QFile::ReadOnly))
+    if (map)
+        file.unmap(map);
+    map = 0;
+    index = 0;
+    indexData.clear();
+    entries.clear();
+    if (version != 0)
     {
-        QDataStream s(&f);
-        NFSHeader h = NFSHeader::load(s);
-        if (h.magic == NFS_MAGIC)
+        header.dirs.clear();
+        header.files.clear();
+    }
+    version = 0;
+    containerSize = dataOffset = 0;
+    entryCount = bucketCount = namesSize = 0;
+    file.close();
+}
+
+bool NotherFileSystem::readAt(qint64 pos, char *buffer, qint64 size)
+{
+    if (pos < 0 || size < 0 || pos + size > containerSize)
+        return false;
+    if (map)
+    {
+        memcpy(buffer, map + pos, size);
+        return true;
+    }
+    return file.seek(pos) && file.read(buffer, size) == size;
+}
+
+bool NotherFileSystem::findEntry(const QString &name, Entry &entry)
+{
+    if (version == 1)
+    {
+        auto it = entries.find(name);
+        if (it == entries.end())
+            return false;
+        entry = it.value();
+        return true;
+    }
+    if (version != 2)
+        return false;
+
+    QByteArray key = name.toUtf8();
+    quint32 hash = nameHash(key);
+    const uchar * buckets = index + NFS_V2_HEADER_SIZE;
+    const uchar * table = buckets + bucketCount * 4;
+    const uchar * names = table + entryCount * NFS_V2_ENTRY_SIZE;
+    quint32 i = qFromLittleEndian<quint32>(buckets + (hash & (bucketCount - 1)) * 4);
+    //chain length is limited by entry count, so broken file cannot loop forever
+    for (quint32 steps = 0; i != 0 && i <= entryCount && steps < entryCount; steps++)
+    {
+        const uchar * e = table + (i - 1) * NFS_V2_ENTRY_SIZE;
+        quint32 nameOffset = qFromLittleEndian<quint32>(e + 8);
+        quint32 nameLength = qFromLittleEndian<quint32>(e + 12);
+        if (qFromLittleEndian<quint32>(e) == hash && nameLength == quint32(key.size()) &&
+            quint64(nameOffset) + nameLength <= namesSize &&
+            memcmp(names + nameOffset, key.constData(), nameLength) == 0)
         {
-            QByteArray newData;
-            s >> newData;
-            data = newData;
-            header = h;
+            entry.offset = dataOffset + qFromLittleEndian<quint64>(e + 16);
+            entry.storedSize = qFromLittleEndian<quint64>(e + 24);
+            entry.size = qFromLittleEndian<quint64>(e + 32);
+            entry.crc = qFromLittleEndian<quint32>(e + 40);
+            entry.hasCrc = true;
+            return entry.offset + entry.storedSize <= containerSize;
         }
-        f.close();
+        i = qFromLittleEndian<quint32>(e + 4);
+    }
+    return false;
+}
+
+quint32 NotherFileSystem::nameHash(const QByteArray &name)
+{
+    //fnv-1a
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < name.size(); i++)
+    {
+        hash ^= uchar(name[i]);
+        hash *= 16777619u;
     }
+    return hash;
 }
 
-void NotherFileSystem::save(QString file)
+void NotherFileSystem::save(QString file, int format)
 {
     QFile f(file);
     if (f.open(QFile::WriteOnly))
     {
-        f.write(build());
+        f.write(build(format));
         f.flush();
         f.close();
     }
 }
 
-QByteArray NotherFileSystem::build()
+QByteArray NotherFileSystem::build(int format)
 {
     QByteArray out;
+    if (format == 2)
+    {
+        buildV2(out);
+        return out;
+    }
     QDataStream s(&out, QIODevice::WriteOnly);
     header.buildDirsFromFiles();
     header.save(s);
@@ -75,23 +227,69 @@ QByteArray NotherFileSystem::build()
     return out;
 }
 
+void NotherFileSystem::buildV2(QByteArray &out)
+{
+    quint32 count = header.files.count();
+    quint32 buckets = 1;
+    while (buckets < count * 2)
+        buckets <<= 1;
+
+    QVector<quint32> heads(buckets, 0), next(count, 0), hashes(count, 0), nameOffsets(count, 0), nameLengths(count, 0);
+    QByteArray names;
+    for (quint32 i = 0; i < count; i++)
+    {
+        QByteArray name = header.files[i].name.toUtf8();
+        hashes[i] = nameHash(name);
+        quint32 bucket = hashes[i] & (buckets - 1);
+        next[i] = heads[bucket];
+        heads[bucket] = i + 1;
+        nameOffsets[i] = names.size();
+        nameLengths[i] = name.size();
+        names.append(name);
+    }
+
+    quint64 offset = NFS_V2_HEADER_SIZE + buckets * 4 + count * NFS_V2_ENTRY_SIZE + names.size();
+    out.reserve(offset + data.size());
+    putUInt32(out, NFS_MAGIC_V2);
+    putUInt32(out, count);
+    putUInt32(out, buckets);
+    putUInt32(out, names.size());
+    putUInt64(out, offset);
+    foreach (quint32 head, heads)
+        putUInt32(out, head);
+    for (quint32 i = 0; i < count; i++)
+    {
+        const FileDescriptor &fd = header.files[i];
+        putUInt32(out, hashes[i]);
+        putUInt32(out, next[i]);
+        putUInt32(out, nameOffsets[i]);
+        putUInt32(out, nameLengths[i]);
+        putUInt64(out, fd.pointer);
+        putUInt64(out, fd.stored_size);
+        putUInt64(out, fd.size);
+        putUInt32(out, fd.crc);
+        putUInt32(out, 0);
+    }
+    out.append(names);
+    out.append(data);
+}
+
 void NotherFileSystem::addFile(QString fileName, QString name)
 {
     QFile f(fileName);
     if (f.open(QFile::ReadOnly))
     {
         QByteArray fileData = f.readAll();
+        FileDescriptor desc;
+        desc.size = fileData.size();
+        desc.crc = crc32(0, (const Bytef*)fileData.constData(), fileData.size());
         fileData = qCompress(fileData,9);
         LFSR::Encoder::encode(fileData,name);
 
-        int storedSize = fileData.count();
-        int filePointer = data.size();
-        data.append(fileData);
-
-        FileDescriptor desc;
         desc.name = name;
-        desc.pointer = filePointer;
-        desc.stored_size = storedSize;
+        desc.pointer = data.size();
+        desc.stored_size = fileData.count();
+        data.append(fileData);
         header.files.append(desc);
         f.close();
     }
@@ -99,30 +297,168 @@ void NotherFileSystem::addFile(QString fileName, QString name)
 
 QByteArray NotherFileSystem::getFile(QString name)
 {
-    foreach (const FileDescriptor &f, header.files)
-        if (f.name == name)
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (extractFile(name, &buffer))
+        return buffer.data();
+    return QByteArray();
+}
+
+bool NotherFileSystem::extractFile(QString name, QIODevice *out)
+{
+    Entry entry;
+    if (!findEntry(name, entry))
+        return false;
+
+    //qCompress format: expected size (big endian) followed by zlib stream
+    LFSR::Stream key(name);
+    uchar prefix[4];
+    if (entry.storedSize < 4 || !readAt(entry.offset, (char*)prefix, 4))
+        return false;
+    key.process((char*)prefix, 4);
+    qint64 expected = qFromBigEndian<quint32>(prefix);
+    if (entry.size >= 0 && entry.size != expected)
+    {
+        qDebug() << "NotherFileSystem::extractFile " + name + " size mismatch";
+        return false;
+    }
+
+    quint32 crc = crc32(0, Z_NULL, 0);
+    qint64 written = 0;
+    bool ok = true;
+    //qCompress stores only size for empty data
+    if (expected > 0)
+    {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit(&zs) != Z_OK)
+            return false;
+        QByteArray in(NFS_CHUNK_SIZE, Qt::Uninitialized), buffer(NFS_CHUNK_SIZE, Qt::Uninitialized);
+        qint64 pos = 4;
+        int ret = Z_OK;
+        while (ok && ret != Z_STREAM_END && pos < entry.storedSize)
         {
-            QByteArray fileData = data.mid(f.pointer, f.stored_size);
-            LFSR::Encoder::encode(fileData, name);
-            fileData = qUncompress(fileData);
-            return fileData;
+            qint64 chunk = qMin<qint64>(NFS_CHUNK_SIZE, entry.storedSize - pos);
+            if (!readAt(entry.offset + pos, in.data(), chunk))
+            {
+                ok = false;
+                break;
+            }
+            key.process(in.data(), chunk);
+            pos += chunk;
+            zs.next_in = (Bytef*)in.data();
+            zs.avail_in = chunk;
+            do
+            {
+                zs.next_out = (Bytef*)buffer.data();
+                zs.avail_out = NFS_CHUNK_SIZE;
+                ret = inflate(&zs, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+                {
+                    ok = false;
+                    break;
+                }
+                qint64 have = NFS_CHUNK_SIZE - zs.avail_out;
+                if (have > 0)
+                {
+                    crc = crc32(crc, (const Bytef*)buffer.constData(), have);
+                    written += have;
+                    if (written > expected || out->write(buffer.constData(), have) != have)
+                    {
+                        ok = false;
+                        break;
+                    }
+                }
+            } while (zs.avail_out == 0 && ret != Z_STREAM_END);
         }
-    return QByteArray();
+        inflateEnd(&zs);
+        ok = ok && ret == Z_STREAM_END;
+    }
+    if (!ok || written != expected || (entry.hasCrc && crc != entry.crc))
+    {
+        qDebug() << "NotherFileSystem::extractFile " + name + " is corrupted";
+        return false;
+    }
+    return true;
+}
+
+bool NotherFileSystem::extractFile(QString name, QString fileName)
+{
+    QFile f(fileName + ".part");
+    if (!f.open(QFile::WriteOnly))
+    {
+        qDebug() << "NotherFileSystem::extractFile cannot open " + f.fileName();
+        return false;
+    }
+    bool ok = extractFile(name, &f) && f.flush();
+    f.close();
+    if (!ok)
+    {
+        f.remove();
+        return false;
+    }
+    QFile::remove(fileName);
+    return f.rename(fileName);
+}
+
+qint64 NotherFileSystem::fileSize(QString name)
+{
+    Entry entry;
+    if (!findEntry(name, entry))
+        return -1;
+    if (entry.size >= 0)
+        return entry.size;
+    uchar prefix[4];
+    if (entry.storedSize < 4 || !readAt(entry.offset, (char*)prefix, 4))
+        return -1;
+    LFSR::Stream(name).process((char*)prefix, 4);
+    return qFromBigEndian<quint32>(prefix);
 }
 
 bool NotherFileSystem::fileExists(QString name)
 {
-    return files().contains(name);
+    Entry entry;
+    return findEntry(name, entry);
 }
 
 QStringList NotherFileSystem::files()
 {
     QStringList result;
+    if (version == 2)
+    {
+        const uchar * table = index + NFS_V2_HEADER_SIZE + bucketCount * 4;
+        const char * names = (const char*)table + entryCount * NFS_V2_ENTRY_SIZE;
+        for (quint32 i = 0; i < entryCount; i++)
+        {
+            const uchar * e = table + i * NFS_V2_ENTRY_SIZE;
+            quint32 nameOffset = qFromLittleEndian<quint32>(e + 8);
+            quint32 nameLength = qFromLittleEndian<quint32>(e + 12);
+            if (quint64(nameOffset) + nameLength <= namesSize)
+                result.append(QString::fromUtf8(names + nameOffset, nameLength));
+        }
+        return result;
+    }
     foreach (const FileDescriptor &fd, header.files)
         result.append(fd.name);
     return result;
 }
 
+QStringList NotherFileSystem::dirs()
+{
+    if (version != 2)
+        return header.dirs;
+    NFSHeader h;
+    foreach (const QString &name, files())
+    {
+        FileDescriptor fd;
+        fd.name = name;
+        h.files.append(fd);
+    }
+    h.buildDirsFromFiles();
+    return h.dirs;
+}
+
+
 FileDescriptor FileDescriptor::load(QDataStream &s)
 {
     FileDescriptor result;
@@ -184,3 +520,4 @@ void NFSHeader::buildDirsFromFiles()
             dirs.append(path);
     }
 }
+
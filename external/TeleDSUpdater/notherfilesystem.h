@@ -1,27 +1,35 @@
 #ifndef NOTHERFILESYSTEM_H
 #define NOTHERFILESYSTEM_H
 
+
 #include <QByteArray>
 #include <QStringList>
 #include <QList>
+#include <QVector>
+#include <QHash>
 #include <QString>
 #include <QDataStream>
+#include <QFile>
+#include "lfsrencoder.h"
 #define NFS_MAGIC 0x54445355
-
-namespace LFSR{
-
-class Encoder{
-public:
-    static void encode(QByteArray &data, QString pass);
-};
-
-}
+//"TDS2"
+#define NFS_MAGIC_V2 0x32534454
+//v2 header: magic, entry count, bucket count, names size (u32), data offset (u64), all little endian
+#define NFS_V2_HEADER_SIZE 24
+//v2 entry: hash, next (index + 1), name offset, name length (u32), offset, stored size, size (u64), crc, reserved (u32)
+#define NFS_V2_ENTRY_SIZE 48
+//entries are decoded by chunks, so memory usage does not depend on file size
+#define NFS_CHUNK_SIZE 65536
 
 struct FileDescriptor
 {
+    FileDescriptor() : stored_size(0), pointer(0), size(-1), crc(0) {}
     QString name;
     int stored_size;
     int pointer;
+    //v2 only, -1 if unknown
+    qint64 size;
+    quint32 crc;
 
     static FileDescriptor load(QDataStream &s);
     void save(QDataStream &s) const;
@@ -38,22 +46,64 @@ struct NFSHeader
     void buildDirsFromFiles();
 };
 
+//tdsu update container
+//v1: QDataStream header with file list followed by all data, has to be read to memory entirely
+//v2: hash table of names, entries with offset/size/crc and data, file is mapped and read directly
+//entry data in both versions is qCompress output encoded with LFSR (name is the key)
+//load() accepts both versions and does not read the data, use extractFile() to unpack it to disk
 class NotherFileSystem
 {
 public:
     NotherFileSystem();
-    ~NotherFileSystem(){;}
-    void load(QString file);
-    void save(QString file);
-    QByteArray build();
+    ~NotherFileSystem();
+    bool load(QString file);
+    void save(QString file, int format = 2);
+    QByteArray build(int format = 2);
     void addFile(QString fileName, QString name);
+    //whole file in memory, for small entries only
     QByteArray getFile(QString name);
+    //decodes entry to device by chunks, checks size and crc (v2)
+    bool extractFile(QString name, QIODevice * out);
+    //writes to temporary file and replaces fileName on success
+    bool extractFile(QString name, QString fileName);
+    //uncompressed size, -1 if there is no such entry
+    qint64 fileSize(QString name);
     bool fileExists(QString name);
     QStringList files();
-    QStringList dirs(){return header.dirs;}
+    QStringList dirs();
 private:
+    struct Entry
+    {
+        qint64 offset;
+        qint64 storedSize;
+        qint64 size;
+        quint32 crc;
+        bool hasCrc;
+    };
+    bool findEntry(const QString &name, Entry &entry);
+    bool readAt(qint64 pos, char * buffer, qint64 size);
+    bool loadV2();
+    void buildV2(QByteArray &out);
+    void close();
+    static quint32 nameHash(const QByteArray &name);
+
+    //writer side
     QByteArray data;
     NFSHeader header;
+
+    //reader side
+    QFile file;
+    uchar * map;
+    QByteArray indexData;
+    const uchar * index;
+    int version;
+    qint64 containerSize;
+    qint64 dataOffset;
+    quint32 entryCount;
+    quint32 bucketCount;
+    quint32 namesSize;
+    //v1 entries by name
+    QHash<QString, Entry> entries;
 };
 
 #endif // NOTHERFILESYSTEM_H
@@ -0,0 +1,250 @@
+#include <QDataStream>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+#include <stdio.h>
+#include "teledspatch.h"
+
+TeleDSPatchFile::TeleDSPatchFile() : patchVersion(0), playerVersion(0)
+{
+
+}
+
+bool TeleDSPatchFile::isPatch(QString fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QFile::ReadOnly))
+        return false;
+    QDataStream s(&f);
+    int magic = 0;
+    s >> magic;
+    return magic == TELEDS_PATCH_MAGIC;
+}
+
+bool TeleDSPatchFile::load(QString fileName)
+{
+    this->fileName = fileName;
+    sourceHashes.clear();
+    files.clear();
+    QFile f(fileName);
+    if (!f.open(QFile::ReadOnly))
+    {
+        qDebug() << "TeleDSPatchFile::load cannot open " + fileName;
+        return false;
+    }
+    QDataStream s(&f);
+    int magic, totalFileCount, updateFileCount, count;
+    QVector<QString> fileNames, fileHashes;
+    s >> magic >> patchVersion >> playerVersion;
+    s >> totalFileCount >> updateFileCount;
+    s >> fileNames >> fileHashes;
+    s >> count;
+    if (magic != TELEDS_PATCH_MAGIC || s.status() != QDataStream::Ok || fileNames.count() != fileHashes.count())
+    {
+        qDebug() << "TeleDSPatchFile::load " + fileName + " is not valid patch";
+        return false;
+    }
+    for (int i = 0; i < fileNames.count(); i++)
+        sourceHashes[fileNames[i]] = fileHashes[i];
+
+    for (int i = 0; i < count; i++)
+    {
+        FileInfo info;
+        int fileMagic;
+        s >> fileMagic >> info.patchHash >> info.resultHash >> info.filePath;
+        //patch itself is skipped, only its position is stored
+        s >> info.size;
+        info.offset = f.pos();
+        if (fileMagic != TELEDS_FILE_PATCH_MAGIC || s.status() != QDataStream::Ok ||
+            info.size == 0xFFFFFFFF || s.skipRawData(info.size) != int(info.size))
+        {
+            qDebug() << "TeleDSPatchFile::load " + fileName + " is broken";
+            files.clear();
+            return false;
+        }
+        files.append(info);
+    }
+    return true;
+}
+
+bool TeleDSPatchFile::verifySources(QString rootDir)
+{
+    foreach (const FileInfo &info, files)
+    {
+        QString target = localPath(rootDir, info.filePath);
+        //file which was not in previous version is created from empty source
+        if (!sourceHashes.contains(info.filePath))
+            continue;
+        if (fileHash(target) != sourceHashes[info.filePath])
+        {
+            qDebug() << "TeleDSPatchFile::verifySources " + target + " differs from patch source";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TeleDSPatchFile::apply(QString rootDir)
+{
+    if (!verifySources(rootDir))
+        return false;
+
+    QStringList ready;
+    bool ok = true;
+    foreach (const FileInfo &info, files)
+    {
+        QString target = localPath(rootDir, info.filePath);
+        QFileInfo(target).dir().mkpath(".");
+        if (!applyFile(info, target, target + ".patch"))
+        {
+            ok = false;
+            break;
+        }
+        ready.append(target);
+    }
+    if (!ok)
+    {
+        foreach (const QString &target, ready)
+            QFile::remove(target + ".patch");
+        return false;
+    }
+
+    //rename replaces file atomically, running binaries keep old inode
+    //originals are copied to .orig first, so files replaced before a failed rename get them back
+    QStringList replaced;
+    foreach (const QString &target, ready)
+    {
+        bool existed = QFile::exists(target);
+        QFile::remove(target + ".orig");
+        if ((existed && !QFile::copy(target, target + ".orig")) ||
+            ::rename(QFile::encodeName(target + ".patch").constData(), QFile::encodeName(target).constData()) != 0)
+        {
+            qDebug() << "TeleDSPatchFile::apply cannot replace " + target;
+            ok = false;
+            break;
+        }
+        replaced.append(target);
+    }
+
+    for (int i = 0; i < ready.count(); i++)
+    {
+        QString target = ready[i];
+        if (ok)
+            QFile::remove(target + ".orig");
+        else if (i >= replaced.count())
+        {
+            QFile::remove(target + ".patch");
+            QFile::remove(target + ".orig");
+        }
+        else if (!QFile::exists(target + ".orig"))
+            //file was created by patch
+            QFile::remove(target);
+        else if (::rename(QFile::encodeName(target + ".orig").constData(), QFile::encodeName(target).constData()) != 0)
+            qDebug() << "TeleDSPatchFile::apply cannot restore " + target + ", original is left in .orig";
+    }
+    return ok;
+}
+
+bool TeleDSPatchFile::applyFile(const FileInfo &info, QString target, QString temp)
+{
+    QFile patchFile(fileName);
+    if (!patchFile.open(QFile::ReadOnly) || !patchFile.seek(info.offset))
+        return false;
+    QByteArray patchData = patchFile.read(info.size);
+    patchFile.close();
+    if (QString(QCryptographicHash::hash(patchData, QCryptographicHash::Md5).toHex()) != info.patchHash)
+    {
+        qDebug() << "TeleDSPatchFile::applyFile patch for " + info.filePath + " is corrupted";
+        return false;
+    }
+
+    QFile src(target);
+    bool sourceExists = src.exists();
+    if (sourceExists && !src.open(QFile::ReadOnly))
+        return false;
+    QFile out(temp);
+    if (!out.open(QFile::WriteOnly))
+    {
+        qDebug() << "TeleDSPatchFile::applyFile cannot open " + temp;
+        return false;
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    bool ok = applyPatch(&src, patchData, &out, &hash) && out.flush();
+    out.close();
+    if (ok && QString(hash.result().toHex()) != info.resultHash)
+    {
+        qDebug() << "TeleDSPatchFile::applyFile result of " + info.filePath + " has wrong hash";
+        ok = false;
+    }
+    if (!ok)
+    {
+        out.remove();
+        return false;
+    }
+    out.setPermissions(sourceExists ? src.permissions() :
+                                      QFile::ExeGroup | QFile::ExeOwner | QFile::ExeOther | QFile::ExeUser |
+                                      QFile::ReadOwner| QFile::ReadUser | QFile::ReadOther | QFile::ReadGroup |
+                                      QFile::WriteGroup | QFile::WriteOwner | QFile::WriteOther | QFile::WriteUser);
+    return true;
+}
+
+bool TeleDSPatchFile::applyPatch(QIODevice *src, const QByteArray &patchData, QIODevice *out, QCryptographicHash *hash)
+{
+    QByteArray unpackedPatchData = qUncompress(patchData);
+    QDataStream ds(unpackedPatchData);
+    int deltaCount = 0;
+    ds >> deltaCount;
+    qint64 srcSize = src->isOpen() ? src->size() : 0;
+    QByteArray buffer;
+
+    for (int i = 0; i < deltaCount; i++)
+    {
+        int type, offset, size;
+        QByteArray data;
+        ds >> type >> offset >> size >> data;
+        if (ds.status() != QDataStream::Ok)
+            return false;
+        if (type == TELEDS_PATCH_PART_SOURCE)
+        {
+            if (offset < 0 || size < 0 || qint64(offset) + size > srcSize || !src->seek(offset))
+                return false;
+            buffer.resize(qMin(size, TELEDS_PATCH_COPY_CHUNK));
+            for (int left = size; left > 0;)
+            {
+                int chunk = qMin(left, TELEDS_PATCH_COPY_CHUNK);
+                if (src->read(buffer.data(), chunk) != chunk || out->write(buffer.constData(), chunk) != chunk)
+                    return false;
+                if (hash)
+                    hash->addData(buffer.constData(), chunk);
+                left -= chunk;
+            }
+        }
+        else if (type == TELEDS_PATCH_PART_DATA)
+        {
+            if (out->write(data) != data.size())
+                return false;
+            if (hash)
+                hash->addData(data);
+        }
+        else
+            return false;
+    }
+    return ds.status() == QDataStream::Ok;
+}
+
+QString TeleDSPatchFile::fileHash(QString fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QFile::ReadOnly))
+        return QString();
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(&f);
+    return QString(hash.result().toHex());
+}
+
+QString TeleDSPatchFile::localPath(QString rootDir, QString filePath)
+{
+    while (filePath.startsWith("/"))
+        filePath.remove(0, 1);
+    return QDir(rootDir).filePath(filePath);
+}
@@ -0,0 +1,110 @@
+#include "checksum.h"
+
+#include <QtEndian>
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__linux__)
+#define CHECKSUM_ARM_CRC32
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#if defined(__clang__)
+#define CHECKSUM_ARM_CRC32_TARGET __attribute__((target("crc")))
+#else
+#define CHECKSUM_ARM_CRC32_TARGET __attribute__((target("+crc")))
+#endif
+#endif
+
+namespace {
+
+typedef quint32 (*Crc32Function)(quint32 crc, const uchar * p, qint64 size);
+
+//table[0] is usual byte table, table[k][i] is crc of byte i followed by k zero bytes
+//so 8 bytes are folded by 8 independent lookups
+struct Crc32Table
+{
+    quint32 items[8][256];
+    Crc32Table()
+    {
+        for (quint32 i = 0; i < 256; i++)
+        {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            items[0][i] = c;
+        }
+        for (int k = 1; k < 8; k++)
+            for (int i = 0; i < 256; i++)
+                items[k][i] = (items[k - 1][i] >> 8) ^ items[0][items[k - 1][i] & 0xFF];
+    }
+};
+
+const Crc32Table &crc32Table()
+{
+    static Crc32Table table;
+    return table;
+}
+
+quint32 crc32Slicing(quint32 crc, const uchar * p, qint64 size)
+{
+    const quint32 (*t)[256] = crc32Table().items;
+    for (; size > 0 && (quintptr(p) & 7); size--)
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        quint32 one = qFromLittleEndian<quint32>(p) ^ crc;
+        quint32 two = qFromLittleEndian<quint32>(p + 4);
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+              t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    }
+    for (; size > 0; size--)
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef CHECKSUM_ARM_CRC32
+CHECKSUM_ARM_CRC32_TARGET quint32 crc32Arm(quint32 crc, const uchar * p, qint64 size)
+{
+    for (; size > 0 && (quintptr(p) & 7); size--)
+        crc = __crc32b(crc, *p++);
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        quint64 word;
+        memcpy(&word, p, 8);
+        crc = __crc32d(crc, word);
+    }
+    for (; size > 0; size--)
+        crc = __crc32b(crc, *p++);
+    return crc;
+}
+#endif
+
+//chosen once, crc instructions are optional in ARMv8.0
+Crc32Function selectCrc32()
+{
+#ifdef CHECKSUM_ARM_CRC32
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+        return crc32Arm;
+#endif
+    return crc32Slicing;
+}
+
+Crc32Function crc32Function()
+{
+    static Crc32Function function = selectCrc32();
+    return function;
+}
+
+}
+
+quint32 Checksum::crc32(quint32 crc, const void *data, qint64 size)
+{
+    if (!data)
+        return 0;
+    return ~crc32Function()(~crc, static_cast<const uchar*>(data), size);
+}
+
+const char *Checksum::crc32Implementation()
+{
+    return crc32Function() == crc32Slicing ? "slicing-by-8" : "armv8";
+}
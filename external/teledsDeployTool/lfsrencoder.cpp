@@ -2,29 +2,122 @@
 
 #include <QCryptographicHash>
 #include <QDataStream>
+#include <QtEndian>
+#include <string.h>
+
+namespace {
+
+struct KeyTableItem
+{
+    quint32 mask;
+    quint8 key;
+    quint8 shift;
+};
+
+//state below is seed without top bit (it is always set)
+//step with bit 0 set: state ^= 0x4000002B, else: state = (state >> 1) ^ 0x40000000 (top bit shifted in)
+//8 steps are affine, so state after them is (state >> shift) ^ mask
+struct KeyTable
+{
+    KeyTableItem items[256];
+    KeyTable()
+    {
+        for (quint32 low = 0; low < 256; low++)
+        {
+            quint32 state = low;
+            quint8 key = 0, shift = 0;
+            for (int bitIndex = 0; bitIndex < 8; ++bitIndex)
+            {
+                if (state & 0x00000001)
+                {
+                    state ^= 0x4000002B;
+                    key |= (1 << bitIndex);
+                }
+                else
+                {
+                    state = (state >> 1) ^ 0x40000000;
+                    shift++;
+                }
+            }
+            items[low].key = key;
+            items[low].shift = shift;
+            items[low].mask = state ^ (low >> shift);
+        }
+    }
+};
+
+const KeyTable &keyTable()
+{
+    static KeyTable table;
+    return table;
+}
+
+}
 
 void LFSR::Encoder::encode(QByteArray &data, QString pass)
+{
+    Stream(pass).process(data.data(), data.size());
+}
+
+LFSR::Stream::Stream(QString pass)
 {
     QByteArray hashArray = QCryptographicHash::hash(pass.toLocal8Bit(),QCryptographicHash::Md5);
     hashArray = hashArray.mid(0,4);
     QDataStream ds(hashArray);
-
-    int seed;
     ds >> seed;
+}
 
-    for (int i = 0; i<data.count(); ++i)
+char LFSR::Stream::slowByte()
+{
+    char currentByte = 0;
+    for (int bitIndex = 0; bitIndex < 8; ++bitIndex)
     {
-        char currentByte = 0;
-        for (int bitIndex = 0; bitIndex < 8; ++bitIndex)
+        if (seed & 0x00000001)
         {
-            if (seed & 0x00000001)
-            {
-                seed = (seed ^ 0x80000057 >> 1) | 0x80000000;
-                currentByte |= (1 << bitIndex);
-            }
-            else
-                seed >>= 1;
+            seed = (seed ^ 0x80000057 >> 1) | 0x80000000;
+            currentByte |= (1 << bitIndex);
+        }
+        else
+            seed >>= 1;
+    }
+    return currentByte;
+}
+
+void LFSR::Stream::process(char *data, qint64 size)
+{
+    qint64 i = 0;
+    //positive seed is shifted without feedback, it takes at most 4 bytes, zero seed gives zero key
+    for (; i < size && seed >= 0; i++)
+    {
+        if (seed == 0)
+            return;
+        data[i] ^= slowByte();
+    }
+    if (i == size)
+        return;
+
+    const KeyTableItem * table = keyTable().items;
+    quint32 state = quint32(seed) & 0x7FFFFFFF;
+    //key is collected to 64 bit word and applied to 8 bytes at once
+    for (; size - i >= 8; i += 8)
+    {
+        quint64 key = 0;
+        for (int k = 0; k < 8; k++)
+        {
+            const KeyTableItem &item = table[state & 0xFF];
+            key |= quint64(item.key) << (k * 8);
+            state = (state >> item.shift) ^ item.mask;
         }
-        data[i] = data[i] ^ currentByte;
+        quint64 word;
+        memcpy(&word, data + i, 8);
+        word ^= qFromLittleEndian<quint64>(key);
+        memcpy(data + i, &word, 8);
+    }
+    for (; i < size; i++)
+    {
+        const KeyTableItem &item = table[state & 0xFF];
+        data[i] ^= item.key;
+        state = (state >> item.shift) ^ item.mask;
     }
+    seed = int(state | 0x80000000);
 }
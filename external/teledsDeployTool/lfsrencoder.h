@@ -5,11 +5,27 @@
 #include <QString>
 namespace LFSR{
 
+//key stream: seed is first 4 bytes of md5(pass), 8 register steps per byte starting from lowest bit
+//step: if lowest bit is set, seed = (seed ^ 0x4000002B) | 0x80000000 and key bit is 1, else seed >>= 1 (arithmetic)
 class Encoder{
 public:
     static void encode(QByteArray &data, QString pass);
 };
 
+//the same key stream as Encoder, but data can be processed by parts
+//once top bit of seed is set it stays set, and next 8 steps depend only on low 8 bits of seed,
+//so whole byte (key, shift and xor mask) is taken from 256 items table instead of 8 branches
+class Stream{
+public:
+    explicit Stream(QString pass);
+    //register as is, without md5 of pass
+    explicit Stream(int seed) : seed(seed) {}
+    void process(char * data, qint64 size);
+private:
+    char slowByte();
+    int seed;
+};
+
 }
 
 #endif // LFSRENCODER_H
@@ -2,6 +2,8 @@
 #include "ui_mainwindow.h"
 
 #define DT_PASS QString("randomPass123123")
+//tdsu format: updateReady and updater of field players read only v1, keep it until v2 reader ships
+#define DT_NFS_FORMAT 1
 
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -403,7 +405,7 @@ void MainWindow::on_deploy_clicked()
 
         nfs.addFile(tokens.first(), tokens.last());
     }
-    QByteArray data = nfs.build();
+    QByteArray data = nfs.build(DT_NFS_FORMAT);
 
     //sending to server
     QString authString = ui->login->text() + ":" + ui->password->text();
@@ -504,20 +506,8 @@ void MainWindow::on_pushButton_8_clicked()
 
     qDebug() << patch.magic;
 
-    QByteArray out;
-    QDataStream ds(&out, QIODevice::WriteOnly);
-
     qDebug() << "Serialization Start" << QDateTime::currentDateTime();
-    ds << patch.magic << patch.patchVersion << patch.playerVersion;
-    ds << patch.totalFileCount << patch.updateFileCount;
-    ds << patch.fileNames << patch.fileHashes;
-    ds << patch.updateFiles.count();
-    for (int i = 0; i < patch.updateFiles.count(); i++)
-    {
-        FilePatchInfo info = patch.updateFiles[i];
-        ds << info.magic << info.patchHash << info.originalFileHash << info.filePath;
-        ds << TeleDSPatcher::serializePatch(info.patch);
-    }
+    QByteArray out = patch.serialize();
 
     QFile f("/home/nother/1945patch.patch");
     if (f.open(QFile::WriteOnly))
@@ -1,7 +1,23 @@
 #include <QFile>
 #include <QFileInfo>
+#include <QtEndian>
 #include "notherfilesystem.h"
 #include "lfsrencoder.h"
+#include "checksum.h"
+
+static void putUInt32(QByteArray &out, quint32 value)
+{
+    uchar buffer[4];
+    qToLittleEndian<quint32>(value, buffer);
+    out.append((const char*)buffer, 4);
+}
+
+static void putUInt64(QByteArray &out, quint64 value)
+{
+    uchar buffer[8];
+    qToLittleEndian<quint64>(value, buffer);
+    out.append((const char*)buffer, 8);
+}
 
 NotherFileSystem::NotherFileSystem()
 {
@@ -26,20 +42,25 @@ void NotherFileSystem::load(QString file)
     }
 }
 
-void NotherFileSystem::save(QString file)
+void NotherFileSystem::save(QString file, int format)
 {
     QFile f(file);
     if (f.open(QFile::WriteOnly))
     {
-        f.write(build());
+        f.write(build(format));
         f.flush();
         f.close();
     }
 }
 
-QByteArray NotherFileSystem::build()
+QByteArray NotherFileSystem::build(int format)
 {
     QByteArray out;
+    if (format == 2)
+    {
+        buildV2(out);
+        return out;
+    }
     QDataStream s(&out, QIODevice::WriteOnly);
     header.buildDirsFromFiles();
     header.save(s);
@@ -53,6 +74,9 @@ void NotherFileSystem::addFile(QString fileName, QString name)
     if (f.open(QFile::ReadOnly))
     {
         QByteArray fileData = f.readAll();
+        FileDescriptor desc;
+        desc.size = fileData.size();
+        desc.crc = Checksum::crc32(fileData);
         fileData = qCompress(fileData,9);
         LFSR::Encoder::encode(fileData,name);
 
@@ -60,7 +84,6 @@ void NotherFileSystem::addFile(QString fileName, QString name)
         int filePointer = data.size();
         data.append(fileData);
 
-        FileDescriptor desc;
         desc.name = name;
         desc.pointer = filePointer;
         desc.stored_size = storedSize;
@@ -69,6 +92,65 @@ void NotherFileSystem::addFile(QString fileName, QString name)
     }
 }
 
+void NotherFileSystem::buildV2(QByteArray &out)
+{
+    quint32 count = header.files.count();
+    quint32 buckets = 1;
+    while (buckets < count * 2)
+        buckets <<= 1;
+
+    QVector<quint32> heads(buckets, 0), next(count, 0), hashes(count, 0), nameOffsets(count, 0), nameLengths(count, 0);
+    QByteArray names;
+    for (quint32 i = 0; i < count; i++)
+    {
+        QByteArray name = header.files[i].name.toUtf8();
+        hashes[i] = nameHash(name);
+        quint32 bucket = hashes[i] & (buckets - 1);
+        next[i] = heads[bucket];
+        heads[bucket] = i + 1;
+        nameOffsets[i] = names.size();
+        nameLengths[i] = name.size();
+        names.append(name);
+    }
+
+    quint64 offset = NFS_V2_HEADER_SIZE + buckets * 4 + count * NFS_V2_ENTRY_SIZE + names.size();
+    out.reserve(offset + data.size());
+    putUInt32(out, NFS_MAGIC_V2);
+    putUInt32(out, count);
+    putUInt32(out, buckets);
+    putUInt32(out, names.size());
+    putUInt64(out, offset);
+    foreach (quint32 head, heads)
+        putUInt32(out, head);
+    for (quint32 i = 0; i < count; i++)
+    {
+        const FileDescriptor &fd = header.files[i];
+        putUInt32(out, hashes[i]);
+        putUInt32(out, next[i]);
+        putUInt32(out, nameOffsets[i]);
+        putUInt32(out, nameLengths[i]);
+        putUInt64(out, fd.pointer);
+        putUInt64(out, fd.stored_size);
+        putUInt64(out, fd.size);
+        putUInt32(out, fd.crc);
+        putUInt32(out, 0);
+    }
+    out.append(names);
+    out.append(data);
+}
+
+quint32 NotherFileSystem::nameHash(const QByteArray &name)
+{
+    //fnv-1a
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < name.size(); i++)
+    {
+        hash ^= uchar(name[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 QByteArray NotherFileSystem::getFile(QString name)
 {
     foreach (const FileDescriptor &f, header.files)
@@ -3,16 +3,25 @@
 
 #include <QStringList>
 #include <QList>
+#include <QVector>
 #include <QString>
 #include <QDataStream>
 
 #define NFS_MAGIC 0x54445355
+//"TDS2", indexed format which player maps and unpacks by chunks (see player's notherfilesystem.h)
+#define NFS_MAGIC_V2 0x32534454
+#define NFS_V2_HEADER_SIZE 24
+#define NFS_V2_ENTRY_SIZE 48
 
 struct FileDescriptor
 {
+    FileDescriptor() : stored_size(0), pointer(0), size(-1), crc(0) {}
     QString name;
     int stored_size;
     int pointer;
+    //v2 only
+    qint64 size;
+    quint32 crc;
 
     static FileDescriptor load(QDataStream &s);
     void save(QDataStream &s) const;
@@ -35,14 +44,17 @@ public:
     NotherFileSystem();
     ~NotherFileSystem(){;}
     void load(QString file);
-    void save(QString file);
-    QByteArray build();
+    //players before v2 support can read only format 1
+    void save(QString file, int format = 2);
+    QByteArray build(int format = 2);
     void addFile(QString fileName, QString name);
     QByteArray getFile(QString name);
     bool fileExists(QString name);
     QStringList files();
     QStringList dirs(){return header.dirs;}
 private:
+    void buildV2(QByteArray &out);
+    static quint32 nameHash(const QByteArray &name);
     QByteArray data;
     NFSHeader header;
 };
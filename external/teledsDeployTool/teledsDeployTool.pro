@@ -16,11 +16,13 @@ SOURCES += main.cpp\
         mainwindow.cpp \
     lfsrencoder.cpp \
     notherfilesystem.cpp \
-    teledsencoder.cpp
+    teledsencoder.cpp \
+    checksum.cpp
 
 HEADERS  += mainwindow.h \
     lfsrencoder.h \
     notherfilesystem.h \
-    teledsencoder.h
+    teledsencoder.h \
+    checksum.h
 
 FORMS    += mainwindow.ui
@@ -1,10 +1,12 @@
 #include <QFile>
 #include <QByteArray>
-#include <QFileDialog>
 #include <QDateTime>
 #include <QVector>
 #include <QCryptographicHash>
+#include <QDataStream>
 #include <QHash>
+#include <algorithm>
+#include <string.h>
 
 #include "teledsencoder.h"
 
@@ -23,64 +25,178 @@ QByteArray TeleDSPatcher::readFile(QString filename)
     return result;
 }
 
-QVector<DeltaPart> TeleDSPatcher::createFilePatch(QByteArray srcData, QByteArray destData, int window, int minPartSize)
+//rsync style weak checksum, can be moved by one byte in O(1)
+struct RollingHash
+{
+    RollingHash() : a(0), b(0), size(0) {}
+    void reset(const uchar * data, int blockSize)
+    {
+        a = b = 0;
+        size = blockSize;
+        for (int i = 0; i < blockSize; i++)
+        {
+            a += data[i];
+            b += quint32(blockSize - i) * data[i];
+        }
+    }
+    void roll(uchar out, uchar in)
+    {
+        a += in - out;
+        b += a - quint32(size) * out;
+    }
+    quint32 value() const {return (a & 0xFFFF) | (b << 16);}
+    quint32 a, b;
+    int size;
+};
+
+#define PATCH_MAX_CANDIDATES 128
+
+QVector<DeltaPart> TeleDSPatcher::createFilePatch(QByteArray srcData, QByteArray destData, int blockSize, int minPartSize)
 {
     qDebug() << QDateTime::currentDateTimeUtc();
     QVector<DeltaPart> patch;
 
-    DeltaPart dataPart;
-    dataPart.type = DeltaPart::DELTA_PART_DATA;
-    dataPart.offset = 0;
-    dataPart.size = 0;
-
-    int destDataCount = destData.count();
+    const uchar * src = (const uchar*)srcData.constData();
+    const uchar * dest = (const uchar*)destData.constData();
     int srcDataCount = srcData.count();
+    int destDataCount = destData.count();
+    blockSize = qMax(blockSize, 1);
+    //match of blockSize + step - 1 bytes always covers one indexed block
+    int step = qMax(1, minPartSize + 2 - blockSize);
+
+    //block index: blocks of every bucket are stored together in source order
+    int blockCount = srcDataCount >= blockSize ? (srcDataCount - blockSize) / step + 1 : 0;
+    int bits = 1;
+    while ((1 << bits) < blockCount * 2 && bits < 30)
+        bits++;
+    auto bucket = [bits](quint32 hash) {return int((hash * 2654435761u) >> (32 - bits));};
+    QVector<int> bucketStart((1 << bits) + 1, 0), blocks(blockCount), blockBuckets(blockCount);
+    RollingHash hash;
+    for (int block = 0; block < blockCount; block++)
+    {
+        hash.reset(src + block * step, blockSize);
+        blockBuckets[block] = bucket(hash.value());
+        bucketStart[blockBuckets[block] + 1]++;
+    }
+    for (int b = 0; b < (1 << bits); b++)
+        bucketStart[b + 1] += bucketStart[b];
+    QVector<int> bucketFill = bucketStart;
+    for (int block = 0; block < blockCount; block++)
+        blocks[bucketFill[blockBuckets[block]]++] = block;
 
-    for (int destIndex = 0; destIndex < destDataCount; destIndex++)
+    //destination bytes in [literalStart, destIndex) are not matched yet
+    int literalStart = 0;
+    int destIndex = 0;
+    int lastSrcEnd = 0;
+    //hashes of destination blocks at [destIndex, hashEnd), block at position p is kept in hashes[p % step]
+    QVector<quint32> hashes(step);
+    int hashEnd = 0;
+    int bestSrc, bestSize;
+    auto tryMatch = [&](int srcIndex)
     {
-        int bestMatchIndex = -1, bestMatchSize = -1;
-        for (int srcIndex = std::max(0, destIndex - window); srcIndex < destDataCount && srcIndex < srcDataCount && srcIndex < destIndex + window; srcIndex++)
+        if (srcIndex < 0 || srcIndex + blockSize > srcDataCount || memcmp(src + srcIndex, dest + destIndex, blockSize) != 0)
+            return;
+        int size = blockSize;
+        while (srcIndex + size < srcDataCount && destIndex + size < destDataCount &&
+               src[srcIndex + size] == dest[destIndex + size])
+            size++;
+        if (size > bestSize)
+        {
+            bestSrc = srcIndex;
+            bestSize = size;
+        }
+    };
+    //longest match starting exactly at destIndex: source offset s covers indexed block at s + k (k < step),
+    //so block hashes at destIndex + k are looked up, candidates nearest to previous match diagonal go first
+    auto findMatch = [&]()
+    {
+        if (hashEnd <= destIndex)
+        {
+            hash.reset(dest + destIndex, blockSize);
+            hashes[destIndex % step] = hash.value();
+            hashEnd = destIndex + 1;
+        }
+        while (hashEnd < destIndex + step && hashEnd + blockSize <= destDataCount)
+        {
+            hash.roll(dest[hashEnd - 1], dest[hashEnd + blockSize - 1]);
+            hashes[hashEnd % step] = hash.value();
+            hashEnd++;
+        }
+
+        bestSrc = -1;
+        bestSize = 0;
+        //changed binary mostly keeps the layout, so continuation of previous match is checked first
+        int diagonal = lastSrcEnd + (destIndex - literalStart);
+        tryMatch(diagonal);
+        for (int k = 0; k < step && destIndex + k < hashEnd; k++)
         {
-            int currentMatchIndex = -1, currentMatchSize = -1;
-            for (int i = 0; i < destDataCount - destIndex && i < srcDataCount - srcIndex; i++)
+            int b = bucket(hashes[(destIndex + k) % step]);
+            const int * first = blocks.constData() + bucketStart[b];
+            const int * last = blocks.constData() + bucketStart[b + 1];
+            int target = diagonal + k;
+            const int * low = std::lower_bound(first, last, target / step);
+            const int * high = low;
+            for (int candidates = 0; candidates < PATCH_MAX_CANDIDATES && (low > first || high < last); candidates++)
             {
-                if (destData[destIndex + i] == srcData[srcIndex + i])
-                {
-                    currentMatchIndex = srcIndex;
-                    currentMatchSize = i + 1;
-                }
+                if (high < last && (low == first || *high * step - target < target - low[-1] * step))
+                    tryMatch(*high++ * step - k);
                 else
-                    break;
-            }
-            if (currentMatchSize > minPartSize && currentMatchSize > bestMatchSize)
-            {
-                bestMatchIndex = currentMatchIndex;
-                bestMatchSize = currentMatchSize;
+                    tryMatch(*--low * step - k);
             }
         }
-        //Adding patch data
+    };
 
-        if (bestMatchSize > minPartSize)
+    while (blockCount > 0 && destIndex + blockSize <= destDataCount)
+    {
+        findMatch();
+        //lazy matching: if match from the next byte is longer, this byte goes to data part
+        if (bestSize > minPartSize && destIndex + 1 + blockSize <= destDataCount)
         {
-            if (dataPart.data.count())
+            int matchSrc = bestSrc, matchSize = bestSize;
+            destIndex++;
+            findMatch();
+            if (bestSize > matchSize + 1)
+                continue;
+            destIndex--;
+            bestSrc = matchSrc;
+            bestSize = matchSize;
+        }
+
+        if (bestSize > minPartSize)
+        {
+            if (destIndex > literalStart)
             {
+                DeltaPart dataPart;
+                dataPart.type = DeltaPart::DELTA_PART_DATA;
+                dataPart.offset = 0;
+                dataPart.size = 0;
+                dataPart.data = destData.mid(literalStart, destIndex - literalStart);
                 patch.append(dataPart);
-                dataPart.data.clear();
             }
             DeltaPart matchPart;
             matchPart.type = DeltaPart::DELTA_PART_SOURCE;
-            matchPart.offset = bestMatchIndex;
-            matchPart.size = bestMatchSize;
+            matchPart.offset = bestSrc;
+            matchPart.size = bestSize;
             patch.append(matchPart);
-            destIndex += bestMatchSize - 1;
+            destIndex = literalStart = destIndex + bestSize;
+            lastSrcEnd = bestSrc + bestSize;
+            hashEnd = 0;
         }
         else
-            dataPart.data.append(destData[destIndex]);
+            destIndex++;
     }
 
-    if (dataPart.data.count())
+    if (literalStart < destDataCount)
+    {
+        DeltaPart dataPart;
+        dataPart.type = DeltaPart::DELTA_PART_DATA;
+        dataPart.offset = 0;
+        dataPart.size = 0;
+        dataPart.data = destData.mid(literalStart);
         patch.append(dataPart);
+    }
 
+    qDebug() << QDateTime::currentDateTimeUtc() << patch.count() << "parts";
     return patch;
 }
 
@@ -104,22 +220,31 @@ QByteArray TeleDSPatcher::applyPatch(QByteArray srcData, QByteArray patchData)
     int deltaCount;
     ds >> deltaCount;
 
-    for (int i = 0; i < deltaCount; i++)
+    QVector<DeltaPart> parts;
+    parts.reserve(qMax(deltaCount, 0));
+    int resultSize = 0;
+    for (int i = 0; i < deltaCount && ds.status() == QDataStream::Ok; i++)
     {
         DeltaPart p;
         ds >> p.type >> p.offset >> p.size >> p.data;
+        resultSize += p.type == DeltaPart::DELTA_PART_SOURCE ? p.size : p.data.count();
+        parts.append(p);
+    }
+    result.reserve(resultSize);
+
+    foreach (const DeltaPart &p, parts)
+    {
         if (p.type == DeltaPart::DELTA_PART_SOURCE)
         {
-            for (int j = p.offset; j < p.offset + p.size; j++)
+            if (p.offset < 0 || p.size < 0 || p.offset + p.size > srcData.count())
             {
-                result.append(srcData[j]);
+                qDebug() << "TeleDSPatcher::applyPatch source range is out of file";
+                return QByteArray();
             }
+            result.append(srcData.constData() + p.offset, p.size);
         }
         else if (p.type == DeltaPart::DELTA_PART_DATA)
-        {
-            for (int i = 0; i < p.data.count(); i++)
-                result.append(p.data[i]);
-        }
+            result.append(p.data);
     }
     qDebug() << QDateTime::currentDateTimeUtc();
 
@@ -203,10 +328,10 @@ TeleDSPatch TeleDSPatcher::createPatch(QStringList allFileList, QStringList upda
     return result;
 }
 
-QVector<DeltaPart> TeleDSPatcher::createFilePatch(QString srcFileName, QString destFileName, int window, int minPartSize)
+QVector<DeltaPart> TeleDSPatcher::createFilePatch(QString srcFileName, QString destFileName, int blockSize, int minPartSize)
 {
     qDebug() << "Creating patch between " << srcFileName << " and " << destFileName;
-    return createFilePatch(readFile(srcFileName), readFile(destFileName), window, minPartSize);
+    return createFilePatch(readFile(srcFileName), readFile(destFileName), blockSize, minPartSize);
 }
 
 TeleDSImage TeleDSImage::deserialize(QByteArray &data)
@@ -258,6 +383,23 @@ TeleDSImage TeleDSImage::createImage(int playerVersion, int patchVersion,QString
     return result;
 }
 
+QByteArray TeleDSPatch::serialize()
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << magic << patchVersion << playerVersion;
+    ds << totalFileCount << updateFileCount;
+    ds << fileNames << fileHashes;
+    ds << updateFiles.count();
+    for (int i = 0; i < updateFiles.count(); i++)
+    {
+        FilePatchInfo &info = updateFiles[i];
+        ds << info.magic << info.patchHash << info.originalFileHash << info.filePath;
+        ds << TeleDSPatcher::serializePatch(info.patch);
+    }
+    return out;
+}
+
 QByteArray TeleDSImage::serialize()
 {
     QByteArray out;
@@ -34,6 +34,8 @@ struct TeleDSPatch
     QVector<QString> fileNames;
     QVector<QString> fileHashes;
     QVector<FilePatchInfo> updateFiles;
+    //layout read by TeleDSPatchFile in updater: header, file index, then magic, hashes, path and patch of every file
+    QByteArray serialize();
 };
 
 struct TeleDSImage
@@ -68,8 +70,10 @@ class TeleDSPatcher
 {
 public:
     static QByteArray readFile(QString filename);
-    static QVector<DeltaPart> createFilePatch(QByteArray srcData, QByteArray destData, int window = 16000, int minPartSize = 8);
-    static QVector<DeltaPart> createFilePatch(QString srcFileName, QString destFileName, int window = 16000, int minPartSize = 8);
+    //source blocks are indexed by rolling hash (every minPartSize + 2 - blockSize bytes), destination is scanned byte by byte,
+    //at every byte the longest match in whole source is taken (lazily, one byte ahead), like window search did in +-16000 bytes
+    static QVector<DeltaPart> createFilePatch(QByteArray srcData, QByteArray destData, int blockSize = 8, int minPartSize = 8);
+    static QVector<DeltaPart> createFilePatch(QString srcFileName, QString destFileName, int blockSize = 8, int minPartSize = 8);
     static QByteArray serializePatch(QVector<DeltaPart> &patch);
     static QByteArray applyPatch(QByteArray srcData, QByteArray patchData);
     static TeleDSPatch createPatch(QStringList allFileList, QStringList updateFileList, QStringList prevFileList, QString prevRootDir, QString nextRootDir, int productVersion, int updateVersion);
@@ -0,0 +1,49 @@
+#include "areaclock.h"
+
+bool AreaClock::queue(const QString &item, int duration)
+{
+    queuedItems.clear();
+    queuedItems.enqueue(qMakePair(item, duration));
+    return isRunning();
+}
+
+void AreaClock::startNow(PlaybackClock *clock)
+{
+    deadline = clock->now();
+}
+
+void AreaClock::endNow(PlaybackClock *clock)
+{
+    cancel(clock);
+    deadline = clock->now() + PLAYBACK_TRANSITION_LEAD;
+}
+
+bool AreaClock::advance(PlaybackClock *clock, std::function<void()> onEnd)
+{
+    deadlineId = 0;
+    if (queuedItems.isEmpty())
+    {
+        currentItem = "";
+        return false;
+    }
+    QPair<QString, int> item = queuedItems.dequeue();
+    currentItem = item.first;
+    start = deadline;
+    deadline += item.second;
+    deadlineId = clock->schedule(deadline - PLAYBACK_TRANSITION_LEAD, onEnd);
+    return true;
+}
+
+void AreaClock::moveDeadline(PlaybackClock *clock, qint64 newDeadline, std::function<void()> onEnd)
+{
+    cancel(clock);
+    deadline = newDeadline;
+    deadlineId = clock->schedule(deadline - PLAYBACK_TRANSITION_LEAD, onEnd);
+}
+
+void AreaClock::cancel(PlaybackClock *clock)
+{
+    if (deadlineId)
+        clock->cancel(deadlineId);
+    deadlineId = 0;
+}
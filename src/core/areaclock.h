@@ -0,0 +1,43 @@
+#ifndef AREACLOCK_H
+#define AREACLOCK_H
+
+#include <QString>
+#include <QQueue>
+#include <QPair>
+#include <functional>
+#include "playbackclock.h"
+
+//area transition starts this time before item end, it is time needed to show prerolled item
+#define PLAYBACK_TRANSITION_LEAD 80
+
+//absolute start/end time of current item in area and item already preloaded by qml
+//next item starts at deadline of current one, so qml/load latency never moves next deadlines
+//clock is passed in, so tests can run areas on fake time (tests/playbackclock)
+struct AreaClock
+{
+    AreaClock() : start(-1), deadline(-1), deadlineId(0) {}
+
+    bool isRunning() const {return deadlineId != 0;}
+    //qml has only one idle slot, so new item replaces preloaded one
+    //returns false if area is idle and item has to be started with startNow()
+    bool queue(const QString &item, int duration);
+    //idle area: queued item starts right now
+    void startNow(PlaybackClock * clock);
+    //current item ends right now (skip), next one is counted from this moment
+    void endNow(PlaybackClock * clock);
+    //queued item starts at current deadline, onEnd is called PLAYBACK_TRANSITION_LEAD before its end
+    //returns false if nothing is queued, area is idle then
+    bool advance(PlaybackClock * clock, std::function<void()> onEnd);
+    //current item ends at another moment (sync leader deadline)
+    void moveDeadline(PlaybackClock * clock, qint64 newDeadline, std::function<void()> onEnd);
+    void cancel(PlaybackClock * clock);
+
+    QString currentItem;
+    qint64 start;
+    qint64 deadline;
+    int deadlineId;
+    //content id and play duration
+    QQueue<QPair<QString, int> > queuedItems;
+};
+
+#endif // AREACLOCK_H
@@ -7,7 +7,11 @@ SOURCES += \
     $$PWD/platformspecific.cpp \
     $$PWD/statictext.cpp \
     $$PWD/systeminfoprovider.cpp \
-    $$PWD/gpiobuttonservice.cpp
+    $$PWD/gpiobuttonservice.cpp \
+    $$PWD/playbackclock.cpp \
+    $$PWD/areaclock.cpp \
+    $$PWD/widgetdatastore.cpp \
+    $$PWD/zipcontentserver.cpp
 HEADERS += \
     $$PWD/teledscore.h \
     $$PWD/singleton.h \
@@ -18,7 +22,11 @@ HEADERS += \
     $$PWD/platformspecific.h \
     $$PWD/statictext.h \
     $$PWD/systeminfoprovider.h \
-    $$PWD/gpiobuttonservice.h
+    $$PWD/gpiobuttonservice.h \
+    $$PWD/playbackclock.h \
+    $$PWD/areaclock.h \
+    $$PWD/widgetdatastore.h \
+    $$PWD/zipcontentserver.h
 
 FORMS += \
     $$PWD/mainwindow.ui
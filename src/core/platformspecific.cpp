@@ -16,13 +16,13 @@
 #include "singleton.h"
 #include "globalstats.h"
 #include "platformspecific.h"
+#include "lfsrencoder.h"
 
 #ifdef PLATFORM_DEFINE_ANDROID
 #include <QAndroidJniEnvironment>
 #include <QAndroidJniObject>
 #include "sys/system_properties.h"
 #include "sys/sysinfo.h"
-#include "JlCompress.h"
 #include "unistd.h"
 #include "linux/reboot.h"
 
@@ -631,28 +631,6 @@ void Platform::PlatformSpecificWorker::getBatteryInfo()
 #endif
 }
 
-void Platform::PlatformSpecificWorker::extractFile(QString file, QString id)
-{
-    QDir dir(VIDEO_FOLDER + id);
-    dir.removeRecursively();
-    QDir().mkdir(VIDEO_FOLDER + id);
-    QFile::rename(VIDEO_FOLDER + file + "_", VIDEO_FOLDER + file);
-#ifdef PLATFORM_DEFINE_ANDROID
-    QFile * zipContentFile = new QFile(VIDEO_FOLDER + file);
-    zipContentFile->open(QFile::ReadOnly);
-    JlCompress::extractDir(zipContentFile,VIDEO_FOLDER + id + "/");
-    zipContentFile->close();
-    delete zipContentFile;
-#endif
-
-#if defined(PLATFORM_DEFINE_RPI) || defined(PLATFORM_DEFINE_LINUX)
-    QProcess unzipProc;
-    unzipProc.start("unzip -o " + VIDEO_FOLDER + file + " -d " + VIDEO_FOLDER + id);
-    unzipProc.waitForFinished();
-    unzipProc.close();
-#endif
-}
-
 void Platform::PlatformSpecificWorker::writeToFile(QByteArray data, QString filename)
 {
     QFile f(filename);
@@ -734,11 +712,6 @@ void Platform::PlatformSpecificThread::turnOffSecondReley()
     emit turnOffSecondReleySignal();
 }
 
-void Platform::PlatformSpecificThread::extractFile(QString file, QString id)
-{
-    emit extractFileSignal(file, id);
-}
-
 void Platform::PlatformSpecificThread::writeToFile(QByteArray data, QString filename)
 {
     emit writeToFileSignal(data, filename);
@@ -758,7 +731,6 @@ void Platform::PlatformSpecificThread::run()
     connect (this, SIGNAL(turnOffSecondReleySignal()), worker, SLOT(turnOffSecondReley()));
     connect (this, SIGNAL(turnOnFirstReleySignal()), worker, SLOT(turnOnFirstReley()));
     connect (this, SIGNAL(turnOnSecondReleySignal()), worker, SLOT(turnOnSecondReley()));
-    connect (this, SIGNAL(extractFileSignal(QString,QString)), worker, SLOT(extractFile(QString,QString)));
     connect (this, SIGNAL(writeToFileSignal(QByteArray,QString)), worker, SLOT(writeToFile(QByteArray,QString)));
 
     exec();
@@ -951,11 +923,6 @@ void Platform::PlatformSpecific::turnOffSecondReley()
     thread->turnOffSecondReley();
 }
 
-void Platform::PlatformSpecific::extractFile(QString file, QString id)
-{
-    thread->extractFile(file, id);
-}
-
 void Platform::PlatformSpecific::writeToFile(QByteArray data, QString filename)
 {
     thread->writeToFile(data, filename);
@@ -963,26 +930,6 @@ void Platform::PlatformSpecific::writeToFile(QByteArray data, QString filename)
 
 QByteArray Platform::lfsrEncode(QByteArray data, QString pass)
 {
-    QByteArray hash = QCryptographicHash::hash(pass.toLocal8Bit(),QCryptographicHash::Md5);
-    hash = hash.mid(0,4);
-    QDataStream ds(hash);
-    int seed;
-    ds >> seed;
-    QByteArray result;
-    for (int i = 0; i< data.count(); ++i)
-    {
-        char b = 0;
-        for (int bIndex = 0; bIndex < 8; ++bIndex)
-        {
-            if (seed & 0x00000001)
-            {
-                seed = (seed ^ 0x80000057 >> 1) | 0x80000000;
-                b |= (1 << bIndex);
-            }
-            else
-                seed >>= 1;
-        }
-        result.append(data[i] ^ b);
-    }
-    return result;
+    LFSR::Encoder::encode(data, pass);
+    return data;
 }
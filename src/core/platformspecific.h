@@ -112,14 +112,10 @@ public slots:
 
     void getBatteryInfo();
 
-    //method for extracting zip-file content using zip file name and content-id
-    void extractFile(QString file, QString id);
-
     //helper method used to flush data to file
     void writeToFile(QByteArray data, QString filename);
 protected:
     static QString getRpiDeviceNameById(QString id);
-
 };
 
 class PlatformSpecificThread : public QThread
@@ -136,7 +132,6 @@ public:
     void turnOffFirstReley();
     void turnOnSecondReley();
     void turnOffSecondReley();
-    void extractFile(QString file, QString id);
     void writeToFile(QByteArray data, QString filename);
 
 signals:
@@ -154,7 +149,6 @@ signals:
     void turnOnSecondReleySignal();
     void turnOffSecondReleySignal();
 
-    void extractFileSignal(QString file, QString id);
     void writeToFileSignal(QByteArray data, QString filename);
 
 public slots:
@@ -190,7 +184,6 @@ public slots:
     void turnOnSecondReley();
     void turnOffSecondReley();
 
-    void extractFile(QString file, QString id);
     void writeToFile(QByteArray data, QString filename);
 
 signals:
@@ -0,0 +1,124 @@
+#include <QDebug>
+#include <QQuickWindow>
+#include "playbackclock.h"
+
+PlaybackClock::PlaybackClock(QObject *parent) : QObject(parent)
+{
+    clock.start();
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, SIGNAL(timeout()), this, SLOT(processDeadlines()));
+    lastFrameTime = -1;
+    frameInterval = PLAYBACK_DEFAULT_FRAME_INTERVAL;
+    lastId = 0;
+}
+
+qint64 PlaybackClock::now() const
+{
+    return clock.elapsed();
+}
+
+int PlaybackClock::schedule(qint64 deadline, std::function<void()> callback)
+{
+    Deadline d;
+    d.id = ++lastId;
+    d.time = deadline;
+    d.callback = callback;
+
+    int index = deadlines.count();
+    while (index > 0 && deadlines[index - 1].time > deadline)
+        index--;
+    deadlines.insert(index, d);
+    if (index == 0)
+        rearm();
+    return d.id;
+}
+
+void PlaybackClock::cancel(int id)
+{
+    for (int i = 0; i < deadlines.count(); ++i)
+        if (deadlines[i].id == id)
+        {
+            deadlines.remove(i);
+            if (i == 0)
+                rearm();
+            return;
+        }
+}
+
+bool PlaybackClock::isScheduled(int id) const
+{
+    foreach (const Deadline &d, deadlines)
+        if (d.id == id)
+            return true;
+    return false;
+}
+
+void PlaybackClock::setFrameSource(QQuickWindow *window)
+{
+    if (frameSource)
+        disconnect(frameSource, SIGNAL(frameSwapped()), this, SLOT(frameSwapped()));
+    frameSource = window;
+    lastFrameTime = -1;
+    if (frameSource)
+        connect(frameSource, SIGNAL(frameSwapped()), this, SLOT(frameSwapped()));
+}
+
+bool PlaybackClock::isVsyncAligned() const
+{
+    return frameSource && lastFrameTime >= 0 && now() - lastFrameTime < PLAYBACK_VSYNC_TIMEOUT;
+}
+
+void PlaybackClock::frameSwapped()
+{
+    //with threaded render loop this slot is queued from render thread
+    qint64 current = now();
+    if (lastFrameTime >= 0)
+    {
+        int interval = int(current - lastFrameTime);
+        if (interval > 0 && interval < PLAYBACK_VSYNC_TIMEOUT)
+            frameInterval = (frameInterval * 7 + interval) / 8;
+    }
+    lastFrameTime = current;
+    emit frameRendered(current);
+    if (!deadlines.isEmpty() && deadlines.first().time <= current + frameInterval / 2)
+        processDeadlines();
+}
+
+void PlaybackClock::processDeadlines()
+{
+    //deadline inside current frame is fired at this frame swap, not at the next one
+    qint64 tolerance = isVsyncAligned() ? frameInterval / 2 : 0;
+
+    //deadlines are taken one by one, so callback can cancel or add other deadlines
+    while (!deadlines.isEmpty() && deadlines.first().time <= now() + tolerance)
+    {
+        Deadline d = deadlines.first();
+        deadlines.remove(0);
+        d.callback();
+    }
+    rearm();
+}
+
+void PlaybackClock::rearm()
+{
+    if (deadlines.isEmpty())
+    {
+        armTimer(-1);
+        return;
+    }
+    qint64 wait = deadlines.first().time - now();
+    //with vsync frame swap fires deadline, timer is only a fallback if nothing is rendered
+    if (isVsyncAligned())
+        wait += frameInterval;
+    armTimer(qMax<qint64>(0, wait));
+}
+
+void PlaybackClock::armTimer(qint64 wait)
+{
+    if (wait < 0)
+        timer->stop();
+    else
+        timer->start(int(wait));
+}
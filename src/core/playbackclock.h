@@ -0,0 +1,78 @@
+#ifndef PLAYBACKCLOCK_H
+#define PLAYBACKCLOCK_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <functional>
+#include "singleton.h"
+
+#define PlaybackClockInstance Singleton<PlaybackClock>::instance()
+
+//frame interval used until real vsync interval is measured
+#define PLAYBACK_DEFAULT_FRAME_INTERVAL 16
+//if there were no frames for this time vsync alignment is turned off
+#define PLAYBACK_VSYNC_TIMEOUT 250
+
+class QQuickWindow;
+
+//playback time source for item transitions and campaign switches
+//all deadlines are absolute (msecs of monotonic clock), so next deadline is always
+//previous deadline + duration and timer/qml latency never accumulates
+//if frame source is set deadlines are fired right after the nearest frame swap
+//now() and armTimer() are virtual, so tests can run clock on fake time (tests/playbackclock)
+class PlaybackClock : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlaybackClock(QObject *parent = 0);
+    virtual ~PlaybackClock(){;}
+
+    //msecs since clock creation, never goes backwards
+    virtual qint64 now() const;
+
+    //returns deadline id, callback is called once when deadline is reached
+    int schedule(qint64 deadline, std::function<void()> callback);
+    void cancel(int id);
+    bool isScheduled(int id) const;
+
+    void setFrameSource(QQuickWindow * window);
+    bool isVsyncAligned() const;
+
+signals:
+    //time (now()) of every frame swap of frame source
+    void frameRendered(qint64 time);
+
+public slots:
+    //fires all deadlines which are due at now() (+ half frame with vsync)
+    void processDeadlines();
+
+protected slots:
+    void frameSwapped();
+
+protected:
+    //processDeadlines() should be called after wait msecs, wait < 0 - nothing to wait for
+    virtual void armTimer(qint64 wait);
+
+private:
+    void rearm();
+
+    struct Deadline
+    {
+        int id;
+        qint64 time;
+        std::function<void()> callback;
+    };
+    //sorted by time
+    QVector<Deadline> deadlines;
+    QElapsedTimer clock;
+    QTimer * timer;
+    QPointer<QQuickWindow> frameSource;
+    qint64 lastFrameTime;
+    int frameInterval;
+    int lastId;
+};
+
+#endif // PLAYBACKCLOCK_H
@@ -28,7 +28,11 @@
 #include "qhttpresponse.h"
 #include "statictext.h"
 #include "notherfilesystem.h"
+#include "teledspatch.h"
 #include "version.h"
+#include "syncservice.h"
+#include "metrics.h"
+#include "logger.h"
 
 TeleDSCore::TeleDSCore(QObject *parent) : QObject(parent)
 {
@@ -82,6 +86,10 @@ TeleDSCore::TeleDSCore(QObject *parent) : QObject(parent)
     connect(videoService,SIGNAL(getPlaylistResult(PlayerConfigAPI)),this,SLOT(playlistResult(PlayerConfigAPI)));
     connect(videoService,SIGNAL(getUpdatesResult(UpdateInfoResult)),this,SLOT(updateInfoReady(UpdateInfoResult)));
 
+    connect(videoService,SIGNAL(settingsChanged()),this,SLOT(getPlaylistTimerSlot()));
+    connect(videoService,SIGNAL(playlistChanged()),this,SLOT(playlistChangedSlot()));
+    connect(videoService,SIGNAL(changeChannelStateChanged(bool)),this,SLOT(changeChannelStateChanged(bool)));
+
     connect (&sheduler,SIGNAL(getPlaylist()), this, SLOT(getPlaylistTimerSlot()));
     connect (teledsPlayer, SIGNAL(refreshNeeded()), this, SLOT(getPlaylistTimerSlot()));
     connect (teledsPlayer, SIGNAL(readyToUpdate()), this, SLOT(playlistUpdateReady()));
@@ -153,6 +161,7 @@ TeleDSCore::TeleDSCore(QObject *parent) : QObject(parent)
 
     downloader = 0;
     setupHttpServer();
+    videoService->subscribeChanges();
     qDebug() << "TELEDS initialization done";
 
     qDebug() << "Init gps Receiver";
@@ -259,21 +268,9 @@ void TeleDSCore::reconnectToGpsServer()
 
 QByteArray TeleDSCore::createZip()
 {
-    QProcess p;
-    p.start("bash build_log.sh");
-    p.waitForStarted();
-    p.waitForFinished();
-    qDebug() << "zip result";
-    qDebug() << p.readAll();
-    QFile f("/home/pi/teleds/ziplg.zip");
-    if (f.open(QFile::ReadOnly))
-    {
-        QByteArray data = f.readAll();
-        qDebug() << "ZIP SIZE" << data.count();
-        f.close();
-        return data;
-    }
-    return QByteArray();
+    QByteArray data = LoggerInstance.exportArchive();
+    qDebug() << "ZIP SIZE" << data.count();
+    return data;
 }
 
 void TeleDSCore::sendLogs()
@@ -474,63 +471,44 @@ void TeleDSCore::hardwareInfoReady(Platform::HardwareInfo info)
 
 void TeleDSCore::handleNewRequest(QHttpRequest *request, QHttpResponse *response)
 {
+    static MetricCounter * requestCount = MetricsInstance.counter("teleds_http_requests_total", "Requests to local http server");
+    requestCount->add();
     QString path = request->path();
-    if (request->method() == QHttpRequest::HTTP_GET)
+    if (request->method() == QHttpRequest::HTTP_GET && path == "/metrics")
     {
-        QStringList tokens = path.split("/");
-        if (tokens.count() == 3)
+        QByteArray text = MetricsInstance.exportText();
+        response->setHeader("Content-Type", "text/plain; version=0.0.4");
+        response->setHeader("Content-Length", QString::number(text.size()));
+        response->writeHead(200);
+        response->end(text);
+        request->deleteLater();
+    }
+    else if (request->method() == QHttpRequest::HTTP_GET && path.startsWith(ZIP_CONTENT_PATH))
+    {
+        zipContent.serve(request, response);
+        request->deleteLater();
+    }
+    else if (request->method() == QHttpRequest::HTTP_GET)
+    {
+        //path is /<widget>/<content> or /subscribe/<widget>
+        int slash = path.indexOf('/', 1);
+        if (path.startsWith('/') && slash > 1 && path.indexOf('/', slash + 1) == -1)
         {
-            QString widgetId = tokens[1];
-            QString contentId = tokens[2];
+            QString widgetId = path.mid(1, slash - 1);
+            QString contentId = path.mid(slash + 1);
             if (widgetId == "system" && contentId == "list")
             {
                 qDebug() << "SYSTEM::LIST";
-                QString dataStr;
-                foreach (const QString &key, storedData.keys())
-                {
-                    dataStr+=key + ":";
-                    foreach (const QString &cKey, storedData[key].keys())
-                    {
-                        dataStr+=cKey + ",";
-                    }
-                    dataStr += "\n";
-                }
-                QByteArray data = dataStr.toLocal8Bit();
-                response->writeHead(200);
-                response->setHeader("Content-Type","text/plain");
-                response->setHeader("Content-Length", QString::number(data.size()));
-                response->end(data);
-                request->deleteLater();
-            }
-            if (storedData.contains(widgetId)){
-                if (storedData[widgetId].contains(contentId))
-                {
-                    QByteArray data = storedData[widgetId][contentId];
-
-                    response->writeHead(200);
-                    response->setHeader("Content-Type","text/plain");
-                    response->setHeader("Content-Length", QString::number(data.size()));
-                    response->end(data);
-                    request->deleteLater();
-                }
+                WidgetDataStore::sendText(response, 200, widgetData.getList());
             }
+            else if (widgetId == "subscribe")
+                widgetData.subscribe(response, contentId);
             else
-            {
-                QString notFound = "Not Found";
-                response->writeHead(404);
-                response->setHeader("Content-Type","text/plain");
-                response->setHeader("Content-Length", QString::number(notFound.toLocal8Bit().size()));
-                response->end(notFound.toLocal8Bit());
-            }
+                widgetData.serve(request, response, widgetId, contentId);
         }
         else
-        {
-            QString wrongRequest = "Bad Request: cant recognize tokens";
-            response->writeHead(400);
-            response->setHeader("Content-Type","text/plain");
-            response->setHeader("Content-Length", QString::number(wrongRequest.toLocal8Bit().size()));
-            response->end(wrongRequest.toLocal8Bit());
-        }
+            WidgetDataStore::sendText(response, 400, "Bad Request: cant recognize tokens");
+        request->deleteLater();
     }
     else if (request->method() == QHttpRequest::HTTP_PUT)
     {
@@ -542,21 +520,11 @@ void TeleDSCore::handleNewRequest(QHttpRequest *request, QHttpResponse *response
             new HTTPServerDataReceiver(this,request,response,widgetId, contentId);
         }
         else
-        {
-            QString wrongRequest = "Bad Request: cant recognize tokens";
-            response->writeHead(400);
-            response->setHeader("Content-Type","text/plain");
-            response->setHeader("Content-Length", QString::number(wrongRequest.toLocal8Bit().size()));
-            response->end(wrongRequest.toLocal8Bit());
-        }
+            WidgetDataStore::sendText(response, 400, "Bad Request: cant recognize tokens");
     }
     else
     {
-        QByteArray unsupported = QString("Unsupported method").toLocal8Bit();
-        response->writeHead(405);
-        response->setHeader("Content-Type","text/plain");
-        response->setHeader("Content-Length", QString::number(unsupported.size()));
-        response->end(unsupported);
+        WidgetDataStore::sendText(response, 405, "Unsupported method");
     }
 }
 
@@ -652,6 +620,8 @@ void TeleDSCore::playerSettingsResult(SettingsRequestResult result)
             GlobalConfigInstance.setStatsInverval(result.stats_interval);
             GlobalConfigInstance.setVolume(result.volume);
             GlobalConfigInstance.setMetaProperty("settings_hash", result.hash);
+            SyncServiceInstance.start(SyncService::modeFromString(result.sync_mode), result.sync_group);
+            widgetData.setLimits(qint64(result.widget_data_max_size) * 1024, qint64(result.widget_data_spill_size) * 1024);
 
             quint32 crc32id = SSLEncoder::CRC32(result.player_id.toLocal8Bit());
             QString crcHex = QString("%1").arg(crc32id, 8, 16, QLatin1Char( '0' )).toUpper();
@@ -779,16 +749,20 @@ void TeleDSCore::updateInfoReady(UpdateInfoResult result)
         if (TeleDSVersion::compareVersion(result.version_major, result.version_minor, result.version_release, result.version_build) == 1) //upcoming version is newer
         {
             qDebug() << "NEW Version Found! Trying to download!";
-            QString genName =   "TDSU_" +
+            //delta is a few percent of full bundle, it is used until it fails once
+            bool useDelta = !result.delta_url.isEmpty() && !QFile::exists(TELEDS_PATCH_FAILED_MARKER);
+            QString genName =   QString(useDelta ? "TDSP_" : "TDSU_") +
                                 QString::number(result.version_major) + "." +
                                 QString::number(result.version_minor) + "." +
                                 QString::number(result.version_release) + "." +
                                 QString::number(result.version_build) + ".dat";
-            if (PlatformSpecificService.getFileHash(genName) != result.file_hash)
+            QString fileUrl = useDelta ? result.delta_url : result.file_url;
+            QString fileHash = useDelta ? result.delta_hash : result.file_hash;
+            if (PlatformSpecificService.getFileHash(genName) != fileHash)
             {
-                qDebug() << "need to download update";
+                qDebug() << "need to download update" << (useDelta ? "delta" : "bundle");
                 if (downloader)
-                    downloader->startUpdateTask(result.file_url, result.file_hash, genName);
+                    downloader->startUpdateTask(fileUrl, fileHash, genName);
             }
             else
             {
@@ -806,22 +780,31 @@ void TeleDSCore::updateInfoReady(UpdateInfoResult result)
 void TeleDSCore::updateReady(QString filename)
 {
     qDebug() << "TeleDSCore::updateReady";
-    NotherFileSystem nfs;
-    nfs.load(filename);
-    if (nfs.fileExists("system::updater"))
+    if (TeleDSPatchFile::isPatch(filename))
     {
-        QByteArray updaterData = nfs.getFile("system::updater");
-        QFile f("updater");
-        if (f.open(QFile::WriteOnly))
+        //updater applies delta, but installed files are checked here, so player is not restarted for nothing
+        TeleDSPatchFile patch;
+        if (!patch.load(filename) || !patch.verifySources(QDir::currentPath()))
         {
-            f.write(updaterData);
-            f.flush();
-            f.setPermissions(QFile::ExeGroup | QFile::ExeOwner | QFile::ExeOther | QFile::ExeUser |
-                             QFile::ReadOwner| QFile::ReadUser | QFile::ReadOther | QFile::ReadGroup |
-                             QFile::WriteGroup | QFile::WriteOwner | QFile::WriteOther | QFile::WriteUser);
-            f.close();
+            qDebug() << "TeleDSCore::updateReady delta does not match installed files, full update will be requested";
+            QFile marker(TELEDS_PATCH_FAILED_MARKER);
+            marker.open(QFile::WriteOnly);
+            marker.close();
+            QFile::remove(filename);
+            return;
         }
     }
+    else
+    {
+        QFile::remove(TELEDS_PATCH_FAILED_MARKER);
+        NotherFileSystem nfs;
+        nfs.load(filename);
+        //unpacked by chunks, update file is never read to memory
+        if (nfs.fileExists("system::updater") && nfs.extractFile("system::updater", QString("updater")))
+            QFile::setPermissions("updater", QFile::ExeGroup | QFile::ExeOwner | QFile::ExeOther | QFile::ExeUser |
+                                             QFile::ReadOwner| QFile::ReadUser | QFile::ReadOther | QFile::ReadGroup |
+                                             QFile::WriteGroup | QFile::WriteOwner | QFile::WriteOther | QFile::WriteUser);
+    }
     teledsPlayer->invokeUpdateState();
     QFile infoFile("update_info");
     if (infoFile.open(QFile::WriteOnly))
@@ -872,6 +855,21 @@ void TeleDSCore::getPlaylistTimerSlot()
     sheduler.restart(TeleDSSheduler::GET_PLAYLIST);
 }
 
+void TeleDSCore::changeChannelStateChanged(bool active)
+{
+    qDebug() << "TeleDSCore::changeChannelStateChanged" << active;
+    sheduler.setPushChannelActive(active);
+    //we could miss events while channel was down
+    if (active && GlobalConfigInstance.isConfigured())
+        getPlaylistTimerSlot();
+}
+
+void TeleDSCore::playlistChangedSlot()
+{
+    qDebug() << "TeleDSCore::playlistChangedSlot";
+    videoService->getPlaylist();
+}
+
 void TeleDSCore::downloaded(int index)
 {
     if (index != 0)
@@ -1069,7 +1067,7 @@ void TeleDSCore::gpsRead()
 void TeleDSCore::nextCampaign()
 {
     teledsPlayer->invokeStop();
-    int duration = teledsPlayer->nextCampaign();
+    teledsPlayer->nextCampaign();
 
     int currentCampaignIndex = teledsPlayer->getCurrentCampaignIndex();
     if (currentCampaignIndex >= currentConfig.campaigns.count())
@@ -1086,10 +1084,6 @@ void TeleDSCore::nextCampaign()
     prepareAreas(campaign);
 
     teledsPlayer->play();
-
-    QTimer::singleShot(duration, this, [this](){
-        nextCampaign();
-    });
 }
 
 void TeleDSCore::prepareAreas(PlayerConfigAPI::Campaign &campaign)
@@ -1404,31 +1398,125 @@ HTTPServerDataReceiver::HTTPServerDataReceiver(TeleDSCore *core, QHttpRequest *r
     res(response)
 {
     connect(request, SIGNAL(data(const QByteArray&)), this, SLOT(accumulate(const QByteArray&)));
+    //end is emitted on message complete and on disconnect, request must live until then
     connect(request, SIGNAL(end()), this, SLOT(reply()));
-    connect(res, SIGNAL(done()), this, SLOT(deleteLater()));
     this->core = core;
     this->widgetId = widgetId;
     this->contentId = contentId;
+    file = 0;
+    size = 0;
+    rejected = false;
+
+    qint64 contentLength = request->rawHeader("content-length").toLongLong();
+    if (contentLength > core->widgetData.getMaxSize())
+        reject(413, "Request Entity Too Large");
+    else if (contentLength > core->widgetData.getSpillSize())
+        openSpillFile();
+    else if (contentLength > 0)
+        data.reserve(int(contentLength));
+}
+
+HTTPServerDataReceiver::~HTTPServerDataReceiver()
+{
+    if (file)
+    {
+        //upload was not finished
+        file->remove();
+        delete file;
+    }
+}
+
+bool HTTPServerDataReceiver::openSpillFile()
+{
+    file = new QFile(core->widgetData.createSpillFileName(widgetId, contentId));
+    if (!file->open(QFile::WriteOnly))
+    {
+        qDebug() << "HTTPServerDataReceiver: cant open spill file " << file->fileName();
+        delete file;
+        file = 0;
+        reject(507, "Insufficient Storage");
+        return false;
+    }
+    return true;
+}
+
+void HTTPServerDataReceiver::reject(int status, const QByteArray &text)
+{
+    qDebug() << "HTTPServerDataReceiver: rejected " + widgetId + " " + contentId << status << "size" << size;
+    rejected = true;
+    data = QByteArray();
+    //rest of body is not read, so connection cant be reused
+    res->setHeader("Connection", "close");
+    WidgetDataStore::sendText(res, status, text);
 }
 
 void HTTPServerDataReceiver::accumulate(const QByteArray &data)
 {
-    this->data.append(data);
+    if (rejected)
+        return;
+    size += data.size();
+    if (size > core->widgetData.getMaxSize())
+    {
+        reject(413, "Request Entity Too Large");
+        return;
+    }
+    if (!file && size > core->widgetData.getSpillSize())
+    {
+        if (!openSpillFile())
+            return;
+        bool written = file->write(this->data) == this->data.size();
+        this->data = QByteArray();
+        if (!written)
+        {
+            rejectSpillFile();
+            return;
+        }
+    }
+    if (file)
+    {
+        //disk is full - partial file must not become widget data
+        if (file->write(data) != data.size())
+            rejectSpillFile();
+    }
+    else
+        this->data.append(data);
 }
 
-void HTTPServerDataReceiver::reply()
+void HTTPServerDataReceiver::rejectSpillFile()
 {
-    qDebug() << "TeleDSCore::HTTPServerDataReceiver::reply() << " << data;
-    if (!core->storedData.contains(widgetId))
-        core->storedData[widgetId] = QHash<QString, QByteArray>();
-    core->storedData[widgetId][contentId] = data;
-    if (widgetId == "system")
-        GlobalStatsInstance.setSystemData(contentId, data);
-    qDebug() << "TeleDSCore::SERVER-> " + widgetId + " " + contentId << data;
-    QByteArray successResponse = QString("Success").toLocal8Bit();
-    res->writeHead(201);
-    res->setHeader("Content-Type","text/plain");
-    res->setHeader("Content-Length", QString::number(successResponse.size()));
-    res->end(successResponse);
+    qDebug() << "HTTPServerDataReceiver: cant write spill file " << file->fileName() << file->errorString();
+    file->remove();
+    delete file;
+    file = 0;
+    reject(507, "Insufficient Storage");
+}
 
+void HTTPServerDataReceiver::reply()
+{
+    deleteLater();
+    if (rejected)
+        return;
+    if (!req->successful())
+        return;
+    if (file)
+    {
+        file->close();
+        //buffered tail is written on close
+        if (file->error() != QFile::NoError || file->size() != size)
+        {
+            rejectSpillFile();
+            return;
+        }
+        core->widgetData.setFileData(widgetId, contentId, file->fileName(), size);
+        delete file;
+        file = 0;
+    }
+    else
+    {
+        core->widgetData.setData(widgetId, contentId, data);
+        if (widgetId == "system")
+            GlobalStatsInstance.setSystemData(contentId, data);
+    }
+    TLOG(LOG_DEBUG, LOG_HTTP) << "TeleDSCore::SERVER-> " + widgetId + " " + contentId << size << "bytes";
+    WidgetDataStore::sendText(res, 201, "Success");
 }
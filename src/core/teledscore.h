@@ -18,6 +18,8 @@
 #include "qhttpserver.h"
 #include "qhttprequest.h"
 #include "qhttpresponse.h"
+#include "widgetdatastore.h"
+#include "zipcontentserver.h"
 
 #include "gpiobuttonservice.h"
 
@@ -96,6 +98,10 @@ public slots:
     //slot is called when we need to update playlist
     void getPlaylistTimerSlot();
 
+    //slots are called by server push channel
+    void changeChannelStateChanged(bool active);
+    void playlistChangedSlot();
+
     //slot is called when every item got downloaded and we need to show items
     void downloaded(int index);
     void playWithoutDownload(int count);
@@ -179,7 +185,8 @@ protected:
     bool shouldShowPlayer;
 
     QHttpServer * httpserver;
-    QHash<QString, QHash<QString, QByteArray> > storedData;
+    WidgetDataStore widgetData;
+    ZipContentServer zipContent;
     QHash<int, int> storedKeys;
     QList<int> settingsCombo, resetCombo, menuCombo, passCombo, ifconfigCombo, hidePlayerCodeCombo, skipItemCombo, rebootCombo;
 
@@ -197,16 +204,24 @@ class HTTPServerDataReceiver : public QObject
     Q_OBJECT
 public:
     HTTPServerDataReceiver(TeleDSCore * core, QHttpRequest * request, QHttpResponse * response, QString widgetId, QString contentId);
-    ~HTTPServerDataReceiver(){;}
+    ~HTTPServerDataReceiver();
 signals:
     void ready();
 private slots:
     void accumulate(const QByteArray &data);
     void reply();
 private:
+    bool openSpillFile();
+    void rejectSpillFile();
+    void reject(int status, const QByteArray &text);
+
     QScopedPointer<QHttpRequest> req;
     QHttpResponse * res;
     QByteArray data;
+    //value bigger than spill size is written here instead of data
+    QFile * file;
+    qint64 size;
+    bool rejected;
     TeleDSCore * core;
     QString widgetId, contentId;
 };
@@ -3,15 +3,18 @@
 #include "globalconfig.h"
 #include <QDebug>
 
+#define PUSH_CHANNEL_FALLBACK_TIME 3600000
+
 TeleDSSheduler::TeleDSSheduler(QObject *parent) : QObject(parent)
 {
+    pushChannelActive = false;
     getPlaylistTimer = new QTimer();
     resourceCounterTimer = new QTimer();
 
     connect(getPlaylistTimer, SIGNAL(timeout()),this,SIGNAL(getPlaylist()));
     connect(resourceCounterTimer, SIGNAL(timeout()), this, SIGNAL(resourceCounter()));
 
-    getPlaylistTimer->start(GlobalConfigInstance.getGetPlaylistTimerTime());
+    getPlaylistTimer->start(getPlaylistInterval());
 }
 
 TeleDSSheduler::~TeleDSSheduler()
@@ -26,10 +29,10 @@ void TeleDSSheduler::start(TeleDSSheduler::Task t)
     switch(t)
     {
     case GET_PLAYLIST:
-        getPlaylistTimer->start(GlobalConfigInstance.getGetPlaylistTimerTime());
+        getPlaylistTimer->start(getPlaylistInterval());
         break;
     default:
-        getPlaylistTimer->start(GlobalConfigInstance.getGetPlaylistTimerTime());
+        getPlaylistTimer->start(getPlaylistInterval());
 
         break;
     }
@@ -55,3 +58,21 @@ void TeleDSSheduler::restart(TeleDSSheduler::Task t)
     start(t);
 }
 
+
+void TeleDSSheduler::setPushChannelActive(bool active)
+{
+    if (pushChannelActive == active)
+        return;
+    qDebug() << "TeleDSSheduler::setPushChannelActive " << active;
+    pushChannelActive = active;
+    if (getPlaylistTimer->isActive())
+        restart(GET_PLAYLIST);
+}
+
+int TeleDSSheduler::getPlaylistInterval()
+{
+    int interval = GlobalConfigInstance.getGetPlaylistTimerTime();
+    if (pushChannelActive)
+        return qMax(interval, PUSH_CHANNEL_FALLBACK_TIME);
+    return interval;
+}
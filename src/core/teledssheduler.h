@@ -19,14 +19,20 @@ public:
     void stop(Task t);
     void restart(Task t);
 
+    //while server push channel is alive playlist timer is only a safety net
+    void setPushChannelActive(bool active);
+
 signals:
     void getPlaylist();
     void resourceCounter();
 public slots:
 
 private:
+    int getPlaylistInterval();
+
     QTimer * getPlaylistTimer;
     QTimer * resourceCounterTimer;
+    bool pushChannelActive;
 };
 
 #endif // TELEDSSHEDULER_H
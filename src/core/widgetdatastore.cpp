@@ -0,0 +1,388 @@
+#include <QDebug>
+#include <QUrlQuery>
+#include <QDir>
+#include <QCryptographicHash>
+#include "widgetdatastore.h"
+#include "platformdefines.h"
+
+WidgetDataStore::WidgetDataStore(QObject *parent) : QObject(parent)
+{
+    //etags from previous run must not match new values with same version
+    sessionTag = QByteArray::number(QDateTime::currentMSecsSinceEpoch(), 16);
+    lastVersion = 0;
+    maxSize = WIDGET_DATA_DEFAULT_MAX_SIZE;
+    spillSize = WIDGET_DATA_DEFAULT_SPILL_SIZE;
+    spillIndex = 0;
+    //spilled values are not kept between runs
+    QDir(CONFIG_FOLDER + WIDGET_DATA_FOLDER).removeRecursively();
+    QDir().mkpath(CONFIG_FOLDER + WIDGET_DATA_FOLDER);
+    connect(&waitTimer, SIGNAL(timeout()), this, SLOT(checkWaiters()));
+    connect(&heartbeatTimer, SIGNAL(timeout()), this, SLOT(sendHeartbeat()));
+}
+
+bool WidgetDataStore::setData(const QString &widgetId, const QString &contentId, const QByteArray &data)
+{
+    Entry &entry = this->data[widgetId][contentId];
+    if (entry.version && !entry.isFile() && entry.data == data)
+        return false;
+    if (entry.isFile())
+        QFile::remove(entry.fileName);
+    entry.fileName = QString();
+    entry.data = data;
+    entry.size = data.size();
+    updateEntry(widgetId, contentId, entry);
+    return true;
+}
+
+void WidgetDataStore::setFileData(const QString &widgetId, const QString &contentId, const QString &fileName, qint64 size)
+{
+    Entry &entry = this->data[widgetId][contentId];
+    if (entry.isFile() && entry.fileName != fileName)
+        QFile::remove(entry.fileName);
+    entry.data = QByteArray();
+    entry.fileName = fileName;
+    entry.size = size;
+    updateEntry(widgetId, contentId, entry);
+}
+
+QString WidgetDataStore::createSpillFileName(const QString &widgetId, const QString &contentId)
+{
+    //ids come from url, so they are not used as file name directly
+    QByteArray key = QCryptographicHash::hash((widgetId + "/" + contentId).toUtf8(), QCryptographicHash::Md5).toHex();
+    return CONFIG_FOLDER + WIDGET_DATA_FOLDER + QString::fromLatin1(key) + "_" + QString::number(++spillIndex);
+}
+
+void WidgetDataStore::setLimits(qint64 maxSize, qint64 spillSize)
+{
+    this->maxSize = maxSize > 0 ? maxSize : WIDGET_DATA_DEFAULT_MAX_SIZE;
+    this->spillSize = spillSize > 0 ? spillSize : WIDGET_DATA_DEFAULT_SPILL_SIZE;
+}
+
+void WidgetDataStore::updateEntry(const QString &widgetId, const QString &contentId, Entry &entry)
+{
+    entry.version = ++lastVersion;
+    entry.etag = "\"" + sessionTag + "-" + QByteArray::number(entry.version) + "\"";
+    wakeWaiters(widgetId, contentId);
+    publish(widgetId, contentId, entry);
+    emit dataChanged(widgetId, contentId);
+}
+
+bool WidgetDataStore::contains(const QString &widgetId, const QString &contentId) const
+{
+    auto widget = data.constFind(widgetId);
+    return widget != data.constEnd() && widget->contains(contentId);
+}
+
+WidgetDataStore::Entry WidgetDataStore::getEntry(const QString &widgetId, const QString &contentId) const
+{
+    return data.value(widgetId).value(contentId);
+}
+
+QByteArray WidgetDataStore::getList() const
+{
+    QByteArray result;
+    for (auto widget = data.constBegin(); widget != data.constEnd(); ++widget)
+    {
+        result += widget.key().toUtf8() + ":";
+        for (auto content = widget->constBegin(); content != widget->constEnd(); ++content)
+            result += content.key().toUtf8() + ",";
+        result += "\n";
+    }
+    return result;
+}
+
+void WidgetDataStore::serve(QHttpRequest *request, QHttpResponse *response, const QString &widgetId, const QString &contentId)
+{
+    QByteArray etag = request->rawHeader("if-none-match");
+    int wait = qBound(0, QUrlQuery(request->url()).queryItemValue("wait").toInt(), WIDGET_DATA_MAX_WAIT);
+    bool exists = contains(widgetId, contentId);
+    Entry entry;
+    if (exists)
+        entry = getEntry(widgetId, contentId);
+
+    if (exists && (etag.isEmpty() || etag != entry.etag))
+    {
+        sendEntry(response, entry);
+        return;
+    }
+    if (wait == 0)
+    {
+        if (exists)
+            sendNotModified(response, entry.etag);
+        else
+            sendText(response, 404, "Not Found");
+        return;
+    }
+
+    //long-poll: value is not set yet or client already has it
+    Waiter waiter;
+    waiter.response = response;
+    waiter.widgetId = widgetId;
+    waiter.contentId = contentId;
+    waiter.etag = etag;
+    waiter.deadline = QDateTime::currentDateTimeUtc().addSecs(wait);
+    waiters.append(waiter);
+    connect(response, SIGNAL(done()), this, SLOT(waiterDone()));
+    if (!waitTimer.isActive())
+        waitTimer.start(WIDGET_DATA_WAIT_CHECK_TIME);
+}
+
+void WidgetDataStore::sendText(QHttpResponse *response, int status, const QByteArray &text)
+{
+    response->setHeader("Content-Type", "text/plain");
+    response->setHeader("Content-Length", QString::number(text.size()));
+    response->writeHead(status);
+    response->end(text);
+}
+
+void WidgetDataStore::sendEntry(QHttpResponse *response, const Entry &entry)
+{
+    WidgetDataFileSender * sender = 0;
+    if (entry.isFile())
+    {
+        //spill file is checked before headers, lost file gets error status instead of cut body
+        sender = new WidgetDataFileSender(response, entry.fileName, entry.size);
+        if (!sender->isReady())
+        {
+            delete sender;
+            sendText(response, 500, "Internal Server Error");
+            return;
+        }
+    }
+    response->setHeader("Content-Type", "text/plain");
+    response->setHeader("Content-Length", QString::number(entry.size));
+    response->setHeader("ETag", QString::fromLatin1(entry.etag));
+    response->setHeader("Cache-Control", "no-cache");
+    response->writeHead(200);
+    if (sender)
+        sender->start();
+    else
+        response->end(entry.data);
+}
+
+void WidgetDataStore::sendNotModified(QHttpResponse *response, const QByteArray &etag)
+{
+    response->setHeader("Content-Length", "0");
+    response->setHeader("ETag", QString::fromLatin1(etag));
+    response->setHeader("Cache-Control", "no-cache");
+    response->writeHead(304);
+    response->end();
+}
+
+void WidgetDataStore::wakeWaiters(const QString &widgetId, const QString &contentId)
+{
+    if (waiters.isEmpty())
+        return;
+    Entry entry = getEntry(widgetId, contentId);
+    QList<Waiter> rest;
+    QList<QPointer<QHttpResponse> > ready;
+    foreach (const Waiter &waiter, waiters)
+    {
+        if (waiter.response.isNull())
+            continue;
+        if (waiter.widgetId == widgetId && waiter.contentId == contentId)
+            ready.append(waiter.response);
+        else
+            rest.append(waiter);
+    }
+    waiters = rest;
+    foreach (const QPointer<QHttpResponse> &response, ready)
+        if (response)
+            sendEntry(response, entry);
+    if (waiters.isEmpty())
+        waitTimer.stop();
+}
+
+void WidgetDataStore::checkWaiters()
+{
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    QList<Waiter> rest;
+    QList<Waiter> expired;
+    foreach (const Waiter &waiter, waiters)
+    {
+        if (waiter.response.isNull())
+            continue;
+        if (waiter.deadline <= now)
+            expired.append(waiter);
+        else
+            rest.append(waiter);
+    }
+    waiters = rest;
+    foreach (const Waiter &waiter, expired)
+    {
+        if (!waiter.response)
+            continue;
+        if (contains(waiter.widgetId, waiter.contentId))
+            sendNotModified(waiter.response, getEntry(waiter.widgetId, waiter.contentId).etag);
+        else
+            sendText(waiter.response, 404, "Not Found");
+    }
+    if (waiters.isEmpty())
+        waitTimer.stop();
+}
+
+void WidgetDataStore::waiterDone()
+{
+    //connection was closed by client while waiting
+    QObject * response = sender();
+    for (int i = 0; i < waiters.count(); i++)
+        if (waiters[i].response.data() == response)
+        {
+            waiters.removeAt(i);
+            break;
+        }
+}
+
+void WidgetDataStore::subscribe(QHttpResponse *response, const QString &widgetId)
+{
+    //no content length - stream lasts until client closes connection
+    response->setHeader("Content-Type", "text/event-stream");
+    response->setHeader("Cache-Control", "no-cache");
+    response->writeHead(200);
+
+    //current state first, then changes
+    QByteArray snapshot = "retry: " + QByteArray::number(WIDGET_DATA_RETRY_TIME) + "\n\n";
+    QHash<QString, Entry> widget = data.value(widgetId);
+    for (auto it = widget.constBegin(); it != widget.constEnd(); ++it)
+        snapshot += formatEvent(it.key(), it.value());
+    response->write(snapshot);
+    response->flush();
+
+    subscribers[widgetId].append(response);
+    connect(response, SIGNAL(done()), this, SLOT(subscriberDone()));
+    if (!heartbeatTimer.isActive())
+        heartbeatTimer.start(WIDGET_DATA_HEARTBEAT_TIME);
+    qDebug() << "WidgetDataStore::subscribe" << widgetId << "subscribers:" << getSubscribersCount();
+}
+
+int WidgetDataStore::getSubscribersCount() const
+{
+    int result = 0;
+    foreach (const QList<QPointer<QHttpResponse> > &list, subscribers)
+        result += list.count();
+    return result;
+}
+
+QByteArray WidgetDataStore::formatEvent(const QString &contentId, const Entry &entry)
+{
+    QByteArray event;
+    event.reserve(entry.data.size() + contentId.size() + 64);
+    event += "id: " + QByteArray::number(entry.version) + "\n";
+    event += "event: " + contentId.toUtf8() + "\n";
+    //big values are not pushed, client gets them with GET
+    if (entry.isFile())
+    {
+        event += "data: \n\n";
+        return event;
+    }
+    //every line of value is separate data field, client joins them with \n
+    int pos = 0;
+    do
+    {
+        int end = entry.data.indexOf('\n', pos);
+        if (end == -1)
+            end = entry.data.size();
+        event += "data: ";
+        event.append(entry.data.constData() + pos, end - pos);
+        event += "\n";
+        pos = end + 1;
+    } while (pos <= entry.data.size());
+    event += "\n";
+    return event;
+}
+
+void WidgetDataStore::publish(const QString &widgetId, const QString &contentId, const Entry &entry)
+{
+    auto it = subscribers.find(widgetId);
+    if (it == subscribers.end() || it->isEmpty())
+        return;
+    QByteArray event = formatEvent(contentId, entry);
+    QList<QPointer<QHttpResponse> > list = *it;
+    foreach (const QPointer<QHttpResponse> &response, list)
+        if (response)
+            response->write(event);
+}
+
+void WidgetDataStore::sendHeartbeat()
+{
+    static const QByteArray heartbeat(":\n\n");
+    QList<QList<QPointer<QHttpResponse> > > lists = subscribers.values();
+    foreach (const QList<QPointer<QHttpResponse> > &list, lists)
+        foreach (const QPointer<QHttpResponse> &response, list)
+            if (response)
+                response->write(heartbeat);
+}
+
+void WidgetDataStore::subscriberDone()
+{
+    QObject * response = sender();
+    for (auto it = subscribers.begin(); it != subscribers.end();)
+    {
+        for (int i = 0; i < it->count(); i++)
+            if (it->at(i).data() == response)
+            {
+                it->removeAt(i);
+                break;
+            }
+        if (it->isEmpty())
+            it = subscribers.erase(it);
+        else
+            ++it;
+    }
+    if (subscribers.isEmpty())
+        heartbeatTimer.stop();
+}
+
+WidgetDataFileSender::WidgetDataFileSender(QHttpResponse *response, const QString &fileName, qint64 size) :
+    QObject(response),
+    response(response),
+    file(fileName),
+    remaining(size)
+{
+    //file can be replaced and removed while sending, opened file is still readable
+    if (!file.open(QFile::ReadOnly))
+        qDebug() << "WidgetDataFileSender: cant open " << fileName;
+    else if (file.size() < size)
+    {
+        qDebug() << "WidgetDataFileSender: file is shorter than entry " << fileName << file.size() << size;
+        file.close();
+    }
+}
+
+void WidgetDataFileSender::start()
+{
+    connect(response, SIGNAL(allBytesWritten()), this, SLOT(sendChunk()));
+    connect(response, SIGNAL(done()), this, SLOT(responseDone()));
+    sendChunk();
+}
+
+void WidgetDataFileSender::sendChunk()
+{
+    if (!response)
+        return;
+    QByteArray chunk;
+    if (remaining > 0)
+        chunk = file.read(qMin(remaining, qint64(WIDGET_DATA_FILE_CHUNK)));
+    if (chunk.isEmpty())
+    {
+        QHttpResponse * r = response;
+        response = 0;
+        //Content-Length is sent already, short body must not look like complete one
+        if (remaining > 0)
+        {
+            qDebug() << "WidgetDataFileSender: file is cut " << file.fileName() << remaining << "bytes left";
+            r->abort();
+        }
+        else
+            r->end();
+        return;
+    }
+    remaining -= chunk.size();
+    response->write(chunk);
+}
+
+void WidgetDataFileSender::responseDone()
+{
+    response = 0;
+    file.close();
+}
@@ -0,0 +1,128 @@
+#ifndef WIDGETDATASTORE_H
+#define WIDGETDATASTORE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+#include <QDateTime>
+#include <QFile>
+#include "qhttprequest.h"
+#include "qhttpresponse.h"
+
+//max time for long-poll request (?wait=<secs>)
+#define WIDGET_DATA_MAX_WAIT 60
+#define WIDGET_DATA_WAIT_CHECK_TIME 1000
+//comment line sent to event stream subscribers, so dead connections are detected
+#define WIDGET_DATA_HEARTBEAT_TIME 15000
+#define WIDGET_DATA_RETRY_TIME 3000
+//bigger PUT is rejected with 413
+#define WIDGET_DATA_DEFAULT_MAX_SIZE 16777216
+//bigger values are kept in file instead of memory
+#define WIDGET_DATA_DEFAULT_SPILL_SIZE 262144
+#define WIDGET_DATA_FOLDER "widgetdata/"
+#define WIDGET_DATA_FILE_CHUNK 65536
+
+//data which html5 widgets put to local http server and read back
+//values are implicitly shared QByteArrays, so responses are sent without copying
+//every value has etag, so widgets can use If-None-Match and get 304
+//GET with If-None-Match and ?wait=<secs> is long-poll: reply is sent when value changes or on timeout
+//GET /subscribe/<widget> is text/event-stream with all values of widget, event name is content id
+//every change is formatted once and the same buffer is written to all subscribers
+//large values are stored in files and sent back in chunks, event stream only notifies about them
+class WidgetDataStore : public QObject
+{
+    Q_OBJECT
+public:
+    struct Entry
+    {
+        Entry() : version(0), size(0) {}
+        bool isFile() const {return !fileName.isEmpty();}
+        QByteArray data;
+        //set for values spilled to file, data is empty then
+        QString fileName;
+        QByteArray etag;
+        quint64 version;
+        qint64 size;
+    };
+
+    explicit WidgetDataStore(QObject *parent = 0);
+
+    //returns false if value is the same, waiters are not woken up in this case
+    bool setData(const QString &widgetId, const QString &contentId, const QByteArray &data);
+    //takes ownership of file, it is removed when value is replaced
+    void setFileData(const QString &widgetId, const QString &contentId, const QString &fileName, qint64 size);
+    //file to write incoming value which is bigger than spill size
+    QString createSpillFileName(const QString &widgetId, const QString &contentId);
+
+    //0 - default value
+    void setLimits(qint64 maxSize, qint64 spillSize);
+    qint64 getMaxSize() const {return maxSize;}
+    qint64 getSpillSize() const {return spillSize;}
+    bool contains(const QString &widgetId, const QString &contentId) const;
+    Entry getEntry(const QString &widgetId, const QString &contentId) const;
+    QByteArray getList() const;
+
+    void serve(QHttpRequest *request, QHttpResponse *response, const QString &widgetId, const QString &contentId);
+    void subscribe(QHttpResponse *response, const QString &widgetId);
+    int getSubscribersCount() const;
+
+    static void sendText(QHttpResponse *response, int status, const QByteArray &text);
+    static void sendEntry(QHttpResponse *response, const Entry &entry);
+    static void sendNotModified(QHttpResponse *response, const QByteArray &etag);
+
+signals:
+    void dataChanged(QString widgetId, QString contentId);
+
+private slots:
+    void checkWaiters();
+    void waiterDone();
+    void subscriberDone();
+    void sendHeartbeat();
+
+private:
+    struct Waiter
+    {
+        QPointer<QHttpResponse> response;
+        QString widgetId;
+        QString contentId;
+        QByteArray etag;
+        QDateTime deadline;
+    };
+    void updateEntry(const QString &widgetId, const QString &contentId, Entry &entry);
+    void wakeWaiters(const QString &widgetId, const QString &contentId);
+    void publish(const QString &widgetId, const QString &contentId, const Entry &entry);
+    static QByteArray formatEvent(const QString &contentId, const Entry &entry);
+
+    QHash<QString, QHash<QString, Entry> > data;
+    QList<Waiter> waiters;
+    QTimer waitTimer;
+    QHash<QString, QList<QPointer<QHttpResponse> > > subscribers;
+    QTimer heartbeatTimer;
+    QByteArray sessionTag;
+    quint64 lastVersion;
+    qint64 maxSize;
+    qint64 spillSize;
+    quint32 spillIndex;
+};
+
+//writes file to response by chunks, next chunk is written when socket buffer is empty
+class WidgetDataFileSender : public QObject
+{
+    Q_OBJECT
+public:
+    //opens file at once, body is sent after start()
+    WidgetDataFileSender(QHttpResponse *response, const QString &fileName, qint64 size);
+    bool isReady() const {return file.isOpen();}
+    void start();
+private slots:
+    void sendChunk();
+    void responseDone();
+private:
+    QHttpResponse * response;
+    QFile file;
+    qint64 remaining;
+};
+
+#endif // WIDGETDATASTORE_H
@@ -0,0 +1,135 @@
+#include <QUrl>
+#include <QDebug>
+#include "platformdefines.h"
+#include "widgetdatastore.h"
+#include "zipcontentserver.h"
+
+ZipContentServer::ZipContentServer(QObject *parent) : QObject(parent)
+{
+    entryCache.setMaxCost(ZIP_CONTENT_CACHE_SIZE);
+}
+
+QString ZipContentServer::contentUrl(const QString &archiveName, const QString &path)
+{
+    return ZIP_CONTENT_URL + QString::fromLatin1(QUrl::toPercentEncoding(archiveName)) + "/" +
+           QString::fromLatin1(QUrl::toPercentEncoding(path, "/"));
+}
+
+void ZipContentServer::serve(QHttpRequest *request, QHttpResponse *response)
+{
+    QString path = request->url().path(QUrl::FullyDecoded).mid(QString(ZIP_CONTENT_PATH).length());
+    int slash = path.indexOf('/');
+    QString archiveName = path.left(slash);
+    QString name = slash == -1 ? QString() : path.mid(slash + 1);
+    if (name.isEmpty() || name.endsWith("/"))
+        name += "index.html";
+    if (archiveName.isEmpty() || archiveName.startsWith("."))
+    {
+        WidgetDataStore::sendText(response, 400, "Bad Request: wrong archive name");
+        return;
+    }
+
+    QSharedPointer<ZipArchive> archive = getArchive(archiveName);
+    ZipArchive::Entry entry;
+    if (!archive || !archive->getEntry(name, entry))
+    {
+        WidgetDataStore::sendText(response, 404, "Not Found");
+        return;
+    }
+
+    //crc of entry is good enough etag inside one archive
+    QString etag = "\"" + QString::number(entry.crc, 16) + "-" + QString::number(entry.size) + "\"";
+    if (request->rawHeader("if-none-match") == etag.toLatin1())
+    {
+        response->setHeader("Content-Length", "0");
+        response->setHeader("ETag", etag);
+        response->writeHead(304);
+        response->end();
+        return;
+    }
+    response->setHeader("Content-Type", mimeDatabase.mimeTypeForFile(name, QMimeDatabase::MatchExtension).name());
+    response->setHeader("Content-Length", QString::number(entry.size));
+    response->setHeader("ETag", etag);
+    response->setHeader("Cache-Control", "max-age=31536000");
+
+    if (entry.size > ZIP_CONTENT_CACHE_ENTRY_SIZE)
+    {
+        response->writeHead(200);
+        new ZipEntrySender(response, archive, entry);
+        return;
+    }
+    QString cacheKey = archiveName + "/" + name;
+    QByteArray * data = entryCache.object(cacheKey);
+    if (!data)
+    {
+        data = new QByteArray(archive->read(entry));
+        if (data->size() != entry.size)
+        {
+            delete data;
+            WidgetDataStore::sendText(response, 500, "Internal Server Error: archive is corrupted");
+            return;
+        }
+        entryCache.insert(cacheKey, data, qMax(data->size(), 1));
+    }
+    response->writeHead(200);
+    response->end(*data);
+}
+
+QSharedPointer<ZipArchive> ZipContentServer::getArchive(const QString &archiveName)
+{
+    archiveOrder.removeOne(archiveName);
+    if (archives.contains(archiveName))
+    {
+        archiveOrder.append(archiveName);
+        return archives[archiveName];
+    }
+    QSharedPointer<ZipArchive> archive(new ZipArchive());
+    if (archiveName.contains("/") || !archive->open(VIDEO_FOLDER + archiveName))
+        return QSharedPointer<ZipArchive>();
+    //senders keep their archive until response is done
+    if (archiveOrder.count() >= ZIP_CONTENT_MAX_ARCHIVES)
+        archives.remove(archiveOrder.takeFirst());
+    archives[archiveName] = archive;
+    archiveOrder.append(archiveName);
+    qDebug() << "ZipContentServer: opened " + archiveName << archive->count() << "entries";
+    return archive;
+}
+
+ZipEntrySender::ZipEntrySender(QHttpResponse *response, QSharedPointer<ZipArchive> archive, const ZipArchive::Entry &entry) :
+    QObject(response),
+    response(response),
+    archive(archive),
+    reader(archive.data(), entry)
+{
+    connect(response, SIGNAL(allBytesWritten()), this, SLOT(sendChunk()));
+    connect(response, SIGNAL(done()), this, SLOT(responseDone()));
+    sendChunk();
+}
+
+void ZipEntrySender::sendChunk()
+{
+    if (!response)
+        return;
+    QByteArray chunk = reader.readChunk();
+    QHttpResponse * r = response;
+    //crc and size are checked when last chunk is read, so broken chunk is never written
+    if (reader.hasError())
+    {
+        //content length is already sent, so broken entry can only be reported by closing connection
+        qDebug() << "ZipEntrySender: cant inflate entry of " + archive->getFileName();
+        response = 0;
+        r->abort();
+    }
+    else if (reader.atEnd())
+    {
+        response = 0;
+        r->end(chunk);
+    }
+    else
+        response->write(chunk);
+}
+
+void ZipEntrySender::responseDone()
+{
+    response = 0;
+}
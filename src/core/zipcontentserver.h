@@ -0,0 +1,57 @@
+#ifndef ZIPCONTENTSERVER_H
+#define ZIPCONTENTSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QCache>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QMimeDatabase>
+#include "qhttprequest.h"
+#include "qhttpresponse.h"
+#include "ziparchive.h"
+
+#define ZIP_CONTENT_PATH "/zip/"
+#define ZIP_CONTENT_URL "http://127.0.0.1:16080/zip/"
+//opened archives with their indexes
+#define ZIP_CONTENT_MAX_ARCHIVES 4
+//entries up to this size are kept inflated in memory, bigger ones are streamed by chunks
+#define ZIP_CONTENT_CACHE_ENTRY_SIZE 262144
+#define ZIP_CONTENT_CACHE_SIZE 4194304
+
+//serves html5_zip content straight from downloaded archive: GET /zip/<archive file>/<file in archive>
+//archive name contains content hash, so responses never change and are cached by web view
+class ZipContentServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ZipContentServer(QObject *parent = 0);
+    static QString contentUrl(const QString &archiveName, const QString &path = "index.html");
+    void serve(QHttpRequest *request, QHttpResponse *response);
+
+private:
+    QSharedPointer<ZipArchive> getArchive(const QString &archiveName);
+
+    QHash<QString, QSharedPointer<ZipArchive> > archives;
+    //least recently used archive first
+    QStringList archiveOrder;
+    QCache<QString, QByteArray> entryCache;
+    QMimeDatabase mimeDatabase;
+};
+
+//inflates entry by chunks, next chunk is written when socket buffer is empty
+class ZipEntrySender : public QObject
+{
+    Q_OBJECT
+public:
+    ZipEntrySender(QHttpResponse *response, QSharedPointer<ZipArchive> archive, const ZipArchive::Entry &entry);
+private slots:
+    void sendChunk();
+    void responseDone();
+private:
+    QHttpResponse * response;
+    QSharedPointer<ZipArchive> archive;
+    ZipEntryReader reader;
+};
+
+#endif // ZIPCONTENTSERVER_H
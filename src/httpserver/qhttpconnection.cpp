@@ -24,6 +24,7 @@
 
 #include <QTcpSocket>
 #include <QHostAddress>
+#include <QDebug>
 
 #include "http_parser.h"
 #include "qhttprequest.h"
@@ -37,26 +38,37 @@ QHttpConnection::QHttpConnection(QTcpSocket *socket, QObject *parent)
       m_parser(0),
       m_parserSettings(0),
       m_request(0),
+      m_headerCount(0),
+      m_headerValueStarted(false),
+      m_headerSkipped(false),
       m_transmitLen(0),
       m_transmitPos(0)
 {
     m_parser = (http_parser *)malloc(sizeof(http_parser));
     http_parser_init(m_parser, HTTP_REQUEST);
 
-    m_parserSettings = new http_parser_settings();
-    m_parserSettings->on_message_begin = MessageBegin;
-    m_parserSettings->on_url = Url;
-    m_parserSettings->on_header_field = HeaderField;
-    m_parserSettings->on_header_value = HeaderValue;
-    m_parserSettings->on_headers_complete = HeadersComplete;
-    m_parserSettings->on_body = Body;
-    m_parserSettings->on_message_complete = MessageComplete;
+    // Callbacks are the same for all connections.
+    static http_parser_settings settings;
+    if (!settings.on_message_begin) {
+        settings.on_message_begin = MessageBegin;
+        settings.on_url = Url;
+        settings.on_header_field = HeaderField;
+        settings.on_header_value = HeaderValue;
+        settings.on_headers_complete = HeadersComplete;
+        settings.on_body = Body;
+        settings.on_message_complete = MessageComplete;
+    }
+    m_parserSettings = &settings;
 
     m_parser->data = this;
 
     connect(socket, SIGNAL(readyRead()), this, SLOT(parseRequest()));
     connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
     connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(updateWriteCount(qint64)));
+
+    m_idleTimer.setSingleShot(true);
+    connect(&m_idleTimer, SIGNAL(timeout()), this, SLOT(idleTimeout()));
+    m_idleTimer.start(QHTTP_KEEP_ALIVE_TIMEOUT);
 }
 
 QHttpConnection::~QHttpConnection()
@@ -67,7 +79,6 @@ QHttpConnection::~QHttpConnection()
     free(m_parser);
     m_parser = 0;
 
-    delete m_parserSettings;
     m_parserSettings = 0;
 }
 
@@ -86,6 +97,20 @@ void QHttpConnection::invalidateRequest()
     m_request = NULL;
 }
 
+void QHttpConnection::requestDestroyed(QObject *request)
+{
+    // With pipelining an older request can be deleted while the next one is parsed.
+    if (request == m_request)
+        m_request = NULL;
+}
+
+void QHttpConnection::idleTimeout()
+{
+    // Long-poll responses keep the connection busy, only idle ones are closed.
+    if (m_responses.isEmpty())
+        m_socket->disconnectFromHost();
+}
+
 void QHttpConnection::updateWriteCount(qint64 count)
 {
     Q_ASSERT(m_transmitPos + count <= m_transmitLen);
@@ -105,10 +130,19 @@ void QHttpConnection::parseRequest()
 {
     Q_ASSERT(m_parser);
 
+    m_idleTimer.stop();
     while (m_socket->bytesAvailable()) {
         QByteArray arr = m_socket->readAll();
-        http_parser_execute(m_parser, m_parserSettings, arr.constData(), arr.size());
+        size_t parsed = http_parser_execute(m_parser, m_parserSettings, arr.constData(), arr.size());
+        if (HTTP_PARSER_ERRNO(m_parser) != HPE_OK || parsed != size_t(arr.size())) {
+            qWarning() << "QHttpConnection::parseRequest() parse error"
+                       << http_errno_name(HTTP_PARSER_ERRNO(m_parser));
+            m_socket->disconnectFromHost();
+            return;
+        }
     }
+    if (m_responses.isEmpty())
+        m_idleTimer.start(QHTTP_KEEP_ALIVE_TIMEOUT);
 }
 
 void QHttpConnection::write(const QByteArray &data)
@@ -117,6 +151,21 @@ void QHttpConnection::write(const QByteArray &data)
     m_transmitLen += data.size();
 }
 
+void QHttpConnection::write(QHttpResponse *response, const QByteArray &data)
+{
+    for (int i = 0; i < m_responses.count(); ++i) {
+        if (m_responses[i].response != response)
+            continue;
+        if (i == 0)
+            write(data);
+        else
+            m_responses[i].chunks.append(data);
+        return;
+    }
+    // Not queued (e.g. connection is closing), write as is.
+    write(data);
+}
+
 void QHttpConnection::flush()
 {
     m_socket->flush();
@@ -129,9 +178,38 @@ void QHttpConnection::waitForBytesWritten()
 
 void QHttpConnection::responseDone()
 {
+    // Pending responses report done() while the connection is being destroyed.
+    if (!m_socket)
+        return;
+
     QHttpResponse *response = qobject_cast<QHttpResponse *>(QObject::sender());
-    if (response->m_last)
-        m_socket->disconnectFromHost();
+    for (int i = 0; i < m_responses.count(); ++i) {
+        if (m_responses[i].response == response) {
+            m_responses[i].finished = true;
+            m_responses[i].last = response->m_last;
+            break;
+        }
+    }
+    drainResponses();
+}
+
+void QHttpConnection::drainResponses()
+{
+    while (!m_responses.isEmpty()) {
+        PendingResponse &head = m_responses.first();
+        foreach (const QByteArray &chunk, head.chunks)
+            write(chunk);
+        head.chunks.clear();
+        if (!head.finished)
+            return;
+        if (head.last) {
+            m_responses.clear();
+            m_socket->disconnectFromHost();
+            return;
+        }
+        m_responses.removeFirst();
+    }
+    m_idleTimer.start(QHTTP_KEEP_ALIVE_TIMEOUT);
 }
 
 /* URL Utilities */
@@ -178,17 +256,29 @@ QUrl createUrl(const char *urlData, const http_parser_url &urlInfo)
 int QHttpConnection::MessageBegin(http_parser *parser)
 {
     QHttpConnection *theConnection = static_cast<QHttpConnection *>(parser->data);
-    theConnection->m_currentHeaders.clear();
-    theConnection->m_currentUrl.clear();
-    theConnection->m_currentUrl.reserve(128);
+    // Header buffer is recycled once the previous request is deleted (usual keep-alive case),
+    // while the request is alive (pipelining, long-poll) it still shares the bytes.
+    if (theConnection->m_headerBuffer.isDetached()) {
+        theConnection->m_headerBuffer.resize(0);
+    } else {
+        theConnection->m_headerBuffer = QByteArray();
+        theConnection->m_headerBuffer.reserve(QHTTP_HEADER_BUFFER_SIZE);
+    }
+    theConnection->m_headerCount = 0;
+    theConnection->m_headerValueStarted = false;
+    theConnection->m_headerSkipped = false;
+    theConnection->m_currentUrl.resize(0);
 
     // The QHttpRequest should not be parented to this, since it's memory
     // management is the responsibility of the user of the library.
+    // It is not taken from a pool either: handlers delete requests with deleteLater()
+    // at any time (long-poll ones after seconds) and a QObject can not be taken back
+    // from deletion, pooling would need a release API in every handler.
     theConnection->m_request = new QHttpRequest(theConnection);
 
     // Invalidate the request when it is deleted to prevent keep-alive requests
     // from calling a signal on a deleted object.
-    connect(theConnection->m_request, SIGNAL(destroyed(QObject*)), theConnection, SLOT(invalidateRequest()));
+    connect(theConnection->m_request, SIGNAL(destroyed(QObject*)), theConnection, SLOT(requestDestroyed(QObject*)));
 
     return 0;
 }
@@ -215,19 +305,25 @@ int QHttpConnection::HeadersComplete(http_parser *parser)
 
     theConnection->m_request->setUrl(createUrl(theConnection->m_currentUrl.constData(), urlInfo));
 
-    // Insert last remaining header
-    theConnection->m_currentHeaders[theConnection->m_currentHeaderField.toLower()] =
-        theConnection->m_currentHeaderValue;
-    theConnection->m_request->setHeaders(theConnection->m_currentHeaders);
+    theConnection->m_request->setRawHeaders(theConnection->m_headerBuffer,
+                                            theConnection->m_headerSlices,
+                                            theConnection->m_headerCount);
 
     /** set client information **/
     theConnection->m_request->m_remoteAddress = theConnection->m_socket->peerAddress().toString();
     theConnection->m_request->m_remotePort = theConnection->m_socket->peerPort();
 
     QHttpResponse *response = new QHttpResponse(theConnection);
-    if (parser->http_major < 1 || parser->http_minor < 1)
+    // HTTP/1.0 without keep-alive or "Connection: close" from client
+    if (!http_should_keep_alive(parser))
         response->m_keepAlive = false;
 
+    PendingResponse pending;
+    pending.response = response;
+    pending.finished = false;
+    pending.last = false;
+    theConnection->m_responses.append(pending);
+
     connect(theConnection, SIGNAL(destroyed()), response, SLOT(connectionClosed()));
     connect(response, SIGNAL(done()), theConnection, SLOT(responseDone()));
 
@@ -261,22 +357,31 @@ int QHttpConnection::HeaderField(http_parser *parser, const char *at, size_t len
     QHttpConnection *theConnection = static_cast<QHttpConnection *>(parser->data);
     Q_ASSERT(theConnection->m_request);
 
-    // insert the header we parsed previously
-    // into the header map
-    if (!theConnection->m_currentHeaderField.isEmpty() &&
-        !theConnection->m_currentHeaderValue.isEmpty()) {
-        // header names are always lower-cased
-        theConnection->m_currentHeaders[theConnection->m_currentHeaderField.toLower()] =
-            theConnection->m_currentHeaderValue;
-        // clear header value. this sets up a nice
-        // feedback loop where the next time
-        // HeaderValue is called, it can simply append
-        theConnection->m_currentHeaderField = QString();
-        theConnection->m_currentHeaderValue = QString();
+    // Field can come in several pieces, new header starts after a value.
+    if (theConnection->m_headerValueStarted || theConnection->m_headerCount == 0) {
+        theConnection->m_headerSkipped = theConnection->m_headerCount == QHTTP_MAX_HEADERS;
+        if (theConnection->m_headerSkipped)
+            return 0;
+        QHttpHeaderSlice &slice = theConnection->m_headerSlices[theConnection->m_headerCount++];
+        slice.fieldPos = theConnection->m_headerBuffer.size();
+        slice.fieldLength = 0;
+        slice.valuePos = 0;
+        slice.valueLength = 0;
+        theConnection->m_headerValueStarted = false;
+    } else if (theConnection->m_headerSkipped) {
+        return 0;
     }
 
-    QString fieldSuffix = QString::fromLatin1(at, length);
-    theConnection->m_currentHeaderField += fieldSuffix;
+    QHttpHeaderSlice &slice = theConnection->m_headerSlices[theConnection->m_headerCount - 1];
+    QByteArray &buffer = theConnection->m_headerBuffer;
+    int pos = buffer.size();
+    buffer.append(at, int(length));
+    // header names are always lower-cased
+    char *data = buffer.data();
+    for (int i = pos; i < buffer.size(); ++i)
+        if (data[i] >= 'A' && data[i] <= 'Z')
+            data[i] += 'a' - 'A';
+    slice.fieldLength += int(length);
     return 0;
 }
 
@@ -285,8 +390,15 @@ int QHttpConnection::HeaderValue(http_parser *parser, const char *at, size_t len
     QHttpConnection *theConnection = static_cast<QHttpConnection *>(parser->data);
     Q_ASSERT(theConnection->m_request);
 
-    QString valueSuffix = QString::fromLatin1(at, length);
-    theConnection->m_currentHeaderValue += valueSuffix;
+    if (theConnection->m_headerCount == 0 || theConnection->m_headerSkipped)
+        return 0;
+    QHttpHeaderSlice &slice = theConnection->m_headerSlices[theConnection->m_headerCount - 1];
+    if (!theConnection->m_headerValueStarted) {
+        slice.valuePos = theConnection->m_headerBuffer.size();
+        theConnection->m_headerValueStarted = true;
+    }
+    theConnection->m_headerBuffer.append(at, int(length));
+    slice.valueLength += int(length);
     return 0;
 }
 
@@ -27,6 +27,13 @@
 #include "qhttpserverfwd.h"
 
 #include <QObject>
+#include <QList>
+#include <QTimer>
+
+/// Idle keep-alive connections are closed after this time (msecs).
+#define QHTTP_KEEP_ALIVE_TIMEOUT 30000
+/// Initial capacity of the per-request header buffer.
+#define QHTTP_HEADER_BUFFER_SIZE 512
 
 class QHTTPSERVER_API QHttpConnection : public QObject
 {
@@ -37,6 +44,10 @@ public:
     virtual ~QHttpConnection();
 
     void write(const QByteArray &data);
+    /// Writes response data in request order.
+    /** Data of pipelined responses which are not first in queue is kept
+        (implicitly shared, not copied) until all previous responses are done. */
+    void write(QHttpResponse *response, const QByteArray &data);
     void flush();
     void waitForBytesWritten();
 
@@ -49,6 +60,8 @@ private Q_SLOTS:
     void responseDone();
     void socketDisconnected();
     void invalidateRequest();
+    void requestDestroyed(QObject *request);
+    void idleTimeout();
     void updateWriteCount(qint64);
 
 private:
@@ -60,6 +73,16 @@ private:
     static int Body(http_parser *parser, const char *at, size_t length);
     static int MessageComplete(http_parser *parser);
 
+    void drainResponses();
+
+    struct PendingResponse
+    {
+        QHttpResponse *response;
+        QList<QByteArray> chunks;
+        bool finished;
+        bool last;
+    };
+
 private:
     QTcpSocket *m_socket;
     http_parser *m_parser;
@@ -67,12 +90,18 @@ private:
 
     // Since there can only be one request at any time even with pipelining.
     QHttpRequest *m_request;
+    // Responses in request order, only the first one writes to the socket.
+    QList<PendingResponse> m_responses;
+    QTimer m_idleTimer;
 
     QByteArray m_currentUrl;
-    // The ones we are reading in from the parser
-    HeaderHash m_currentHeaders;
-    QString m_currentHeaderField;
-    QString m_currentHeaderValue;
+    // Raw header bytes of the current request and slices into them,
+    // strings are only built if the request asks for them.
+    QByteArray m_headerBuffer;
+    QHttpHeaderSlice m_headerSlices[QHTTP_MAX_HEADERS];
+    int m_headerCount;
+    bool m_headerValueStarted;
+    bool m_headerSkipped;
 
     // Keep track of transmit buffer status
     qint64 m_transmitLen;
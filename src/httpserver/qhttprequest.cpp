@@ -22,10 +22,13 @@
 
 #include "qhttprequest.h"
 
+#include <string.h>
+
 #include "qhttpconnection.h"
 
 QHttpRequest::QHttpRequest(QHttpConnection *connection, QObject *parent)
-    : QObject(parent), m_connection(connection), m_url("http://localhost/"), m_success(false)
+    : QObject(parent), m_connection(connection), m_headersParsed(true), m_headerCount(0),
+      m_url("http://localhost/"), m_success(false)
 {
 }
 
@@ -35,14 +38,46 @@ QHttpRequest::~QHttpRequest()
 
 QString QHttpRequest::header(const QString &field)
 {
-    return m_headers.value(field.toLower(), "");
+    return QString::fromLatin1(rawHeader(field.toLower().toLatin1().constData()));
 }
 
 const HeaderHash &QHttpRequest::headers() const
 {
+    if (!m_headersParsed) {
+        m_headersParsed = true;
+        m_headers.reserve(m_headerCount);
+        const char *data = m_rawHeaders.constData();
+        for (int i = 0; i < m_headerCount; ++i) {
+            const QHttpHeaderSlice &slice = m_headerSlices[i];
+            m_headers[QString::fromLatin1(data + slice.fieldPos, slice.fieldLength)] =
+                QString::fromLatin1(data + slice.valuePos, slice.valueLength);
+        }
+    }
     return m_headers;
 }
 
+QByteArray QHttpRequest::rawHeader(const char *field) const
+{
+    int length = int(qstrlen(field));
+    const char *data = m_rawHeaders.constData();
+    // Last one wins, like in the hash.
+    for (int i = m_headerCount - 1; i >= 0; --i) {
+        const QHttpHeaderSlice &slice = m_headerSlices[i];
+        if (slice.fieldLength == length && memcmp(data + slice.fieldPos, field, length) == 0)
+            return m_rawHeaders.mid(slice.valuePos, slice.valueLength);
+    }
+    return QByteArray();
+}
+
+void QHttpRequest::setRawHeaders(const QByteArray &buffer, const QHttpHeaderSlice *slices, int count)
+{
+    m_rawHeaders = buffer;
+    m_headerCount = count;
+    memcpy(m_headerSlices, slices, sizeof(QHttpHeaderSlice) * count);
+    m_headers.clear();
+    m_headersParsed = false;
+}
+
 const QString &QHttpRequest::httpVersion() const
 {
     return m_version;
@@ -121,9 +121,15 @@ public:
         somewhere else, where the request may be deleted,
         make sure you store them as a copy.
         @note All header names are <b>lowercase</b>
-        so that Content-Length becomes content-length etc. */
+        so that Content-Length becomes content-length etc.
+        @note The hash is built on first call, use rawHeader() for single lookups. */
     const HeaderHash &headers() const;
 
+    /// Get the raw value of a header without building the header hash.
+    /** @param field Lowercase name of the header field
+        @return Value of the header or empty array if not found. */
+    QByteArray rawHeader(const char *field) const;
+
     /// Get the value of a header.
     /** Headers are stored as lowercase so the input @c field will be lowercased.
         @param field Name of the header field
@@ -185,11 +191,16 @@ private:
     void setMethod(HttpMethod method) { m_method = method; }
     void setVersion(const QString &version) { m_version = version; }
     void setUrl(const QUrl &url) { m_url = url; }
-    void setHeaders(const HeaderHash headers) { m_headers = headers; }
+    void setRawHeaders(const QByteArray &buffer, const QHttpHeaderSlice *slices, int count);
     void setSuccessful(bool success) { m_success = success; }
 
     QHttpConnection *m_connection;
-    HeaderHash m_headers;
+    // Filled from raw headers on first headers() call.
+    mutable HeaderHash m_headers;
+    mutable bool m_headersParsed;
+    QByteArray m_rawHeaders;
+    QHttpHeaderSlice m_headerSlices[QHTTP_MAX_HEADERS];
+    int m_headerCount;
     HttpMethod m_method;
     QUrl m_url;
     QString m_version;
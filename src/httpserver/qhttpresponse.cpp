@@ -57,19 +57,19 @@ void QHttpResponse::setHeader(const QString &field, const QString &value)
         qWarning() << "QHttpResponse::setHeader() Cannot set headers after response has finished.";
 }
 
-void QHttpResponse::writeHeader(const char *field, const QString &value)
+void QHttpResponse::writeHeader(QByteArray &out, const char *field, const QString &value)
 {
     if (!m_finished) {
-        m_connection->write(field);
-        m_connection->write(": ");
-        m_connection->write(value.toUtf8());
-        m_connection->write("\r\n");
+        out.append(field);
+        out.append(": ");
+        out.append(value.toUtf8());
+        out.append("\r\n");
     } else
         qWarning()
             << "QHttpResponse::writeHeader() Cannot write headers after response has finished.";
 }
 
-void QHttpResponse::writeHeaders()
+void QHttpResponse::writeHeaders(QByteArray &out)
 {
     if (m_finished)
         return;
@@ -93,21 +93,21 @@ void QHttpResponse::writeHeaders()
 
         /// @todo Expect case (??)
 
-        writeHeader(name.toLatin1(), value.toLatin1());
+        writeHeader(out, name.toLatin1(), value.toLatin1());
     }
 
     if (!m_sentConnectionHeader) {
         if (m_keepAlive && (m_sentContentLengthHeader || m_useChunkedEncoding)) {
-            writeHeader("Connection", "keep-alive");
+            writeHeader(out, "Connection", "keep-alive");
         } else {
             m_last = true;
-            writeHeader("Connection", "close");
+            writeHeader(out, "Connection", "close");
         }
     }
 
     if (!m_sentContentLengthHeader && !m_sentTransferEncodingHeader) {
         if (m_useChunkedEncoding)
-            writeHeader("Transfer-Encoding", "chunked");
+            writeHeader(out, "Transfer-Encoding", "chunked");
         else
             m_last = true;
     }
@@ -115,7 +115,7 @@ void QHttpResponse::writeHeaders()
     // Sun, 06 Nov 1994 08:49:37 GMT - RFC 822. Use QLocale::c() so english is used for month and
     // day.
     if (!m_sentDate)
-        writeHeader("Date",
+        writeHeader(out, "Date",
                     QLocale::c().toString(QDateTime::currentDateTimeUtc(),
                                           "ddd, dd MMM yyyy hh:mm:ss") + " GMT");
 }
@@ -133,10 +133,17 @@ void QHttpResponse::writeHead(int status)
         return;
     }
 
-    m_connection->write(
-        QString("HTTP/1.1 %1 %2\r\n").arg(status).arg(STATUS_CODES[status]).toLatin1());
-    writeHeaders();
-    m_connection->write("\r\n");
+    // Status line and headers go to the socket as one block.
+    QByteArray head;
+    head.reserve(256);
+    head.append("HTTP/1.1 ");
+    head.append(QByteArray::number(status));
+    head.append(' ');
+    head.append(STATUS_CODES[status].toLatin1());
+    head.append("\r\n");
+    writeHeaders(head);
+    head.append("\r\n");
+    m_connection->write(this, head);
 
     m_headerWritten = true;
 }
@@ -158,7 +165,7 @@ void QHttpResponse::write(const QByteArray &data)
         return;
     }
 
-    m_connection->write(data);
+    m_connection->write(this, data);
 }
 
 void QHttpResponse::flush()
@@ -188,6 +195,18 @@ void QHttpResponse::end(const QByteArray &data)
     deleteLater();
 }
 
+void QHttpResponse::abort()
+{
+    if (m_finished) {
+        qWarning() << "QHttpResponse::abort() Cannot abort after response has finished.";
+        return;
+    }
+
+    // Connection is closed once this response is drained.
+    m_last = true;
+    end();
+}
+
 void QHttpResponse::connectionClosed()
 {
     m_finished = true;
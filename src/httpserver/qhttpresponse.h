@@ -131,6 +131,13 @@ public Q_SLOTS:
         @param data Optional data to be written before finishing. */
     void end(const QByteArray &data = "");
 
+    /// Abort the response and close the connection.
+    /** Use it when the body can not be completed after
+    headers with Content-Length were sent, so the client
+    sees a short body instead of a valid response.
+    Data written before is still flushed. */
+    void abort();
+
 Q_SIGNALS:
     /// Emitted when all the data has been sent
     /** This signal indicates that the underlaying socket has transmitted all
@@ -148,8 +155,8 @@ Q_SIGNALS:
 private:
     QHttpResponse(QHttpConnection *connection);
 
-    void writeHeaders();
-    void writeHeader(const char *field, const QString &value);
+    void writeHeaders(QByteArray &out);
+    void writeHeader(QByteArray &out, const char *field, const QString &value);
 
     QHttpConnection *m_connection;
 
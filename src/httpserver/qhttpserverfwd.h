@@ -31,6 +31,21 @@
  */
 typedef QHash<QString, QString> HeaderHash;
 
+/*!
+ * Position of one header in raw header buffer of request.
+ * Field names are stored lowercased.
+ */
+struct QHttpHeaderSlice
+{
+    int fieldPos;
+    int fieldLength;
+    int valuePos;
+    int valueLength;
+};
+
+/// Headers after this count are ignored.
+#define QHTTP_MAX_HEADERS 32
+
 // QHttpServer
 class QHttpServer;
 class QHttpConnection;
@@ -0,0 +1,72 @@
+#include <QDateTime>
+#include <QDebug>
+#include <math.h>
+#include <algorithm>
+#include "brightnesscontroller.h"
+#include "sunposition.h"
+#include "globalstats.h"
+#include "globalconfig.h"
+#include "singleton.h"
+
+BrightnessController::BrightnessController(QObject *parent) : QObject(parent)
+{
+    curveLat = curveLon = 0.;
+    curveOffset = 0;
+    current = 1.;
+    hasValue = false;
+    wasAuto = false;
+    connect(&timer, SIGNAL(timeout()), this, SLOT(update()));
+}
+
+void BrightnessController::start()
+{
+    update();
+    timer.start(BRIGHTNESS_UPDATE_INTERVAL);
+}
+
+void BrightnessController::update()
+{
+    bool autoBrightness = GlobalConfigInstance.isAutoBrightnessActive();
+    double target = targetBrightness();
+    //switching auto mode is applied at once, sun changes go smoothly
+    if (!hasValue || autoBrightness != wasAuto)
+        current = target;
+    else if (BrightnessCurve::step(current, target) == current)
+        return;
+    else
+        current = BrightnessCurve::step(current, target);
+    hasValue = true;
+    wasAuto = autoBrightness;
+    qDebug() << "BRIGHTNESS = " << current;
+    emit brightnessChanged(current);
+}
+
+double BrightnessController::targetBrightness()
+{
+    if (!GlobalConfigInstance.isAutoBrightnessActive())
+        return 1.;
+
+    int utcOffset = GlobalStatsInstance.getUTCOffset();
+    QDateTime local = QDateTime::currentDateTimeUtc().addSecs(utcOffset);
+    double lat = GlobalStatsInstance.getLatitude();
+    double lon = GlobalStatsInstance.getLongitude();
+    if (curve.isEmpty() || local.date() != curveDate || utcOffset != curveOffset ||
+        fabs(lat - curveLat) > BRIGHTNESS_LOCATION_THRESHOLD || fabs(lon - curveLon) > BRIGHTNESS_LOCATION_THRESHOLD)
+        buildCurve(local.date(), lat, lon, utcOffset);
+
+    return curve.brightness(local.time(), GlobalConfigInstance.getMinBrightness(), GlobalConfigInstance.getMaxBrightness());
+}
+
+void BrightnessController::buildCurve(QDate date, double lat, double lon, int utcOffset)
+{
+    curveDate = date;
+    curveLat = lat;
+    curveLon = lon;
+    curveOffset = utcOffset;
+
+    SunsetSystem sunSystem;
+    QTime sunRise, sunSet;
+    sunSystem.getDaylightWindow(sunRise, sunSet);
+    curve.build(sunRise, sunSet);
+    qDebug() << "BrightnessController: curve for" << date << lat << lon;
+}
@@ -0,0 +1,46 @@
+#ifndef BRIGHTNESSCONTROLLER_H
+#define BRIGHTNESSCONTROLLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <QDate>
+#include "brightnesscurve.h"
+
+#define BRIGHTNESS_UPDATE_INTERVAL 20000
+//curve is rebuilt when player moves farther than this (degrees)
+#define BRIGHTNESS_LOCATION_THRESHOLD 0.1
+
+//auto brightness by sun position, independent from item changes
+//daylight curve (BrightnessCurve) is sampled once per day/location/utc offset,
+//timer takes current sample, scales it by min/max brightness from config and moves brightness towards it
+class BrightnessController : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BrightnessController(QObject *parent = 0);
+    void start();
+    double getBrightness() const {return current;}
+
+signals:
+    void brightnessChanged(double value);
+
+public slots:
+    void update();
+
+private:
+    double targetBrightness();
+    void buildCurve(QDate date, double lat, double lon, int utcOffset);
+
+    QTimer timer;
+    BrightnessCurve curve;
+    QDate curveDate;
+    double curveLat;
+    double curveLon;
+    int curveOffset;
+    double current;
+    bool hasValue;
+    bool wasAuto;
+};
+
+#endif // BRIGHTNESSCONTROLLER_H
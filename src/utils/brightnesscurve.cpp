@@ -0,0 +1,47 @@
+#include <math.h>
+#include <algorithm>
+#include "brightnesscurve.h"
+
+void BrightnessCurve::build(QTime sunRise, QTime sunSet)
+{
+    samples.resize(BRIGHTNESS_CURVE_SIZE);
+    for (int i = 0; i < BRIGHTNESS_CURVE_SIZE; i++)
+        samples[i] = float(std::min(sinPercent(QTime(0, 0).addSecs(i * 60), sunRise, sunSet) * 4.0, 1.0));
+}
+
+double BrightnessCurve::sample(QTime localTime) const
+{
+    if (samples.isEmpty())
+        return 0.;
+    return samples[qBound(0, localTime.msecsSinceStartOfDay() / 60000, BRIGHTNESS_CURVE_SIZE - 1)];
+}
+
+double BrightnessCurve::brightness(QTime localTime, double minBrightness, double maxBrightness) const
+{
+    double low = std::min(minBrightness, maxBrightness);
+    double high = std::max(minBrightness, maxBrightness);
+    double value = sample(localTime) * (high - low) + low;
+    value = std::max(std::min(value, high), low);
+    if (value/100. < 0)
+        return 1.;
+    return value/100.;
+}
+
+double BrightnessCurve::step(double current, double target)
+{
+    if (fabs(target - current) < BRIGHTNESS_HYSTERESIS)
+        return current;
+    return current + qBound(-BRIGHTNESS_MAX_STEP, target - current, BRIGHTNESS_MAX_STEP);
+}
+
+double BrightnessCurve::sinPercent(QTime time, QTime sunRise, QTime sunSet)
+{
+    if (time < sunRise || time > sunSet)
+        return 0.;
+
+    int dayLong = sunRise.secsTo(sunSet);
+    if (dayLong <= 0)
+        return 0.;
+    int secsToSunset = time.secsTo(sunSet);
+    return sin(double(secsToSunset)/double(dayLong)*M_PI);
+}
@@ -0,0 +1,36 @@
+#ifndef BRIGHTNESSCURVE_H
+#define BRIGHTNESSCURVE_H
+
+#include <QVector>
+#include <QTime>
+
+//one sample per minute of local day
+#define BRIGHTNESS_CURVE_SIZE 1440
+//brightness is [0; 1], smaller difference from target is not applied
+#define BRIGHTNESS_HYSTERESIS 0.02
+//max change per update, so screen does not jump
+#define BRIGHTNESS_MAX_STEP 0.05
+
+//daylight curve of one local day and brightness steps towards it
+//no config or stats here, BrightnessController feeds it (tests/brightnesscurve)
+class BrightnessCurve
+{
+public:
+    //full brightness is reached at quarter of sin curve
+    void build(QTime sunRise, QTime sunSet);
+    bool isEmpty() const {return samples.isEmpty();}
+    //[0; 1] sample of the minute of local time
+    double sample(QTime localTime) const;
+    //sample scaled into [min; max] percents, result is [0; 1]
+    double brightness(QTime localTime, double minBrightness, double maxBrightness) const;
+
+    //next value on the way from current to target: unchanged inside hysteresis, at most BRIGHTNESS_MAX_STEP at once
+    static double step(double current, double target);
+    //[0; 1] - sin of day part passed, 0 outside of window
+    static double sinPercent(QTime time, QTime sunRise, QTime sunSet);
+
+private:
+    QVector<float> samples;
+};
+
+#endif // BRIGHTNESSCURVE_H
@@ -0,0 +1,174 @@
+#include <QDebug>
+#include "changechannel.h"
+
+ChangeChannel::ChangeChannel(RequestBuilder builder, QObject *parent) : QObject(parent), builder(builder)
+{
+    manager = new QNetworkAccessManager(this);
+    reply = 0;
+    reconnectTimer = new QTimer(this);
+    reconnectTimer->setSingleShot(true);
+    watchdogTimer = new QTimer(this);
+    watchdogTimer->setSingleShot(true);
+    connect(reconnectTimer, SIGNAL(timeout()), this, SLOT(connectToServer()));
+    connect(watchdogTimer, SIGNAL(timeout()), this, SLOT(watchdogTimeout()));
+    reconnectDelay = CHANNEL_MIN_RECONNECT_DELAY;
+    replyStarted = false;
+    enabled = false;
+    active = false;
+}
+
+void ChangeChannel::start()
+{
+    enabled = true;
+    reconnectDelay = CHANNEL_MIN_RECONNECT_DELAY;
+    if (!reply)
+        connectToServer();
+}
+
+void ChangeChannel::stop()
+{
+    enabled = false;
+    reconnectTimer->stop();
+    watchdogTimer->stop();
+    if (reply)
+    {
+        QNetworkReply * r = reply;
+        reply = 0;
+        r->disconnect(this);
+        r->abort();
+        r->deleteLater();
+    }
+    setActive(false);
+}
+
+void ChangeChannel::connectToServer()
+{
+    if (!enabled || reply)
+        return;
+    QNetworkRequest request;
+    if (!builder(request))
+    {
+        qDebug() << "ChangeChannel::connect: player is not configurated yet";
+        scheduleReconnect();
+        return;
+    }
+    qDebug() << "ChangeChannel::connect";
+    //explicit header turns off qt transparent decompression, otherwise qt inflates body
+    //but leaves Content-Encoding in reply and decoder would inflate it second time
+    request.setRawHeader("Accept-Encoding", "gzip, deflate");
+    parser.reset(ChangeEventParser::SSE);
+    replyStarted = false;
+    connectTime.start();
+    reply = manager->get(request);
+    connect(reply, SIGNAL(metaDataChanged()), this, SLOT(metaDataChanged()));
+    connect(reply, SIGNAL(readyRead()), this, SLOT(readyRead()));
+    connect(reply, SIGNAL(finished()), this, SLOT(finished()));
+    watchdogTimer->start(CHANNEL_WATCHDOG_TIME);
+}
+
+void ChangeChannel::metaDataChanged()
+{
+    if (!reply || replyStarted)
+        return;
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 200)
+        return;
+    //headers are here - channel is established even if server keeps silence till first event
+    replyStarted = true;
+    decoder.reset(reply->rawHeader("Content-Encoding"));
+    parser.reset(reply->header(QNetworkRequest::ContentTypeHeader).toString());
+    setActive(true);
+    watchdogTimer->start(CHANNEL_WATCHDOG_TIME);
+}
+
+void ChangeChannel::readyRead()
+{
+    if (!reply)
+        return;
+    metaDataChanged();
+    if (!replyStarted)
+        return;
+    //any data (including ":" heartbeat comments) means channel is alive
+    watchdogTimer->start(CHANNEL_WATCHDOG_TIME);
+
+    QByteArray decoded;
+    if (!decoder.decode(reply->readAll(), decoded))
+        qDebug() << "ChangeChannel::broken compressed channel data";
+    processEvents(parser.feed(decoded));
+}
+
+void ChangeChannel::finished()
+{
+    if (!reply)
+        return;
+    readyRead();
+    QNetworkReply * r = reply;
+    reply = 0;
+    watchdogTimer->stop();
+    int status = r->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool failed = r->error() != QNetworkReply::NoError || status != 200 || !replyStarted;
+
+    if (!failed)
+    {
+        QByteArray decoded;
+        if (!decoder.finish(decoded))
+            qDebug() << "ChangeChannel::broken compressed channel data";
+        QStringList events = parser.feed(decoded);
+        events += parser.finish();
+        processEvents(events);
+    }
+    else
+        qDebug() << "ChangeChannel::channel is down:" << status << r->errorString();
+    r->deleteLater();
+    parser.reset(ChangeEventParser::SSE);
+    replyStarted = false;
+
+    //event handler may stop channel
+    if (!enabled)
+        return;
+    //poll that lived long enough proves server is healthy, backoff starts over
+    bool longPoll = connectTime.elapsed() >= CHANNEL_MIN_POLL_TIME;
+    if (longPoll)
+        reconnectDelay = CHANNEL_MIN_RECONNECT_DELAY;
+    if (failed)
+    {
+        setActive(false);
+        scheduleReconnect();
+    }
+    else if (longPoll)
+        connectToServer();
+    else
+    {
+        //server answers polls at once (e.g. empty 200) - do not spin, back off as on errors
+        scheduleReconnect();
+    }
+}
+
+void ChangeChannel::watchdogTimeout()
+{
+    qDebug() << "ChangeChannel::watchdog timeout";
+    if (reply)
+        reply->abort();
+}
+
+void ChangeChannel::setActive(bool active)
+{
+    if (this->active == active)
+        return;
+    this->active = active;
+    qDebug() << "ChangeChannel::active =" << active;
+    emit activeChanged(active);
+}
+
+void ChangeChannel::scheduleReconnect()
+{
+    qDebug() << "ChangeChannel::reconnect in" << reconnectDelay;
+    reconnectTimer->start(reconnectDelay);
+    reconnectDelay = qMin(reconnectDelay * 2, CHANNEL_MAX_RECONNECT_DELAY);
+}
+
+void ChangeChannel::processEvents(const QStringList &events)
+{
+    foreach (const QString &event, events)
+        emit eventReceived(event);
+}
@@ -0,0 +1,66 @@
+#ifndef CHANGECHANNEL_H
+#define CHANGECHANNEL_H
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <functional>
+#include "httpcompression.h"
+#include "changeeventparser.h"
+
+#define CHANNEL_MIN_RECONNECT_DELAY 1000
+#define CHANNEL_MAX_RECONNECT_DELAY 300000
+#define CHANNEL_WATCHDOG_TIME 90000
+//graceful poll shorter than this is reconnected with backoff
+#define CHANNEL_MIN_POLL_TIME 5000
+
+//change channel - server pushes "settings"/"playlist" events (SSE or long-poll)
+//keeps one GET open, reconnects with backoff when it fails or server answers polls at once
+//while it is down (active is false) player should rely on sheduler timer
+class ChangeChannel : public QObject
+{
+    Q_OBJECT
+public:
+    //fills request for every new connection, false - player is not ready yet (reconnect later)
+    typedef std::function<bool(QNetworkRequest &request)> RequestBuilder;
+
+    explicit ChangeChannel(RequestBuilder builder, QObject *parent = 0);
+    void start();
+    void stop();
+    bool isActive() const {return active;}
+    int getReconnectDelay() const {return reconnectDelay;}
+
+signals:
+    void eventReceived(QString event);
+    void activeChanged(bool active);
+
+private slots:
+    void metaDataChanged();
+    void readyRead();
+    void finished();
+    void connectToServer();
+    void watchdogTimeout();
+
+private:
+    void setActive(bool active);
+    void scheduleReconnect();
+    void processEvents(const QStringList &events);
+
+    RequestBuilder builder;
+    QNetworkAccessManager * manager;
+    QNetworkReply * reply;
+    QTimer * reconnectTimer;
+    QTimer * watchdogTimer;
+    HTTPBodyDecoder decoder;
+    ChangeEventParser parser;
+    QElapsedTimer connectTime;
+    bool replyStarted;
+    int reconnectDelay;
+    bool enabled;
+    bool active;
+};
+
+#endif // CHANGECHANNEL_H
@@ -0,0 +1,83 @@
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "changeeventparser.h"
+
+ChangeEventParser::ChangeEventParser()
+{
+    mode = SSE;
+}
+
+void ChangeEventParser::reset(Mode mode)
+{
+    this->mode = mode;
+    buffer.clear();
+    event.clear();
+}
+
+void ChangeEventParser::reset(const QString &contentType)
+{
+    reset(contentType.startsWith("application/json") ? JSON : SSE);
+}
+
+QStringList ChangeEventParser::feed(const QByteArray &chunk)
+{
+    QStringList events;
+    buffer.append(chunk);
+    //json body is parsed as a whole in finish()
+    if (mode == JSON)
+        return events;
+
+    int lineStart = 0, lineEnd;
+    while ((lineEnd = buffer.indexOf('\n', lineStart)) >= 0)
+    {
+        events += processLine(buffer.mid(lineStart, lineEnd - lineStart));
+        lineStart = lineEnd + 1;
+    }
+    buffer.remove(0, lineStart);
+    return events;
+}
+
+QStringList ChangeEventParser::finish()
+{
+    QStringList events;
+    if (mode == JSON)
+    {
+        QJsonObject json = QJsonDocument::fromJson(buffer).object();
+        foreach (const QJsonValue &value, json["events"].toArray())
+            events.append(value.toString());
+        if (json.contains("event"))
+            events.append(json["event"].toString());
+    }
+    else
+    {
+        //stream closed without trailing blank line
+        if (!buffer.isEmpty())
+            events += processLine(buffer);
+        if (!event.isEmpty())
+            events.append(event);
+    }
+    buffer.clear();
+    event.clear();
+    return events;
+}
+
+QStringList ChangeEventParser::processLine(QByteArray line)
+{
+    QStringList events;
+    if (line.endsWith('\r'))
+        line.chop(1);
+
+    if (line.isEmpty())
+    {
+        //blank line dispatches event
+        if (!event.isEmpty())
+            events.append(event);
+        event.clear();
+    }
+    else if (line.startsWith("event:"))
+        event = QString(line.mid(6)).trimmed();
+    else if (line.startsWith("data:") && event.isEmpty())
+        event = QString(line.mid(5)).trimmed();
+    return events;
+}
@@ -0,0 +1,33 @@
+#ifndef CHANGEEVENTPARSER_H
+#define CHANGEEVENTPARSER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+//splits change channel body into event names
+//SSE mode - "event:"/"data:" lines, blank line dispatches event
+//JSON mode - long-poll body {"events":["playlist","settings"]} or {"event":"playlist"}, parsed when reply is finished
+class ChangeEventParser
+{
+public:
+    enum Mode {SSE, JSON};
+
+    ChangeEventParser();
+    void reset(Mode mode);
+    //picks mode by Content-Type of reply
+    void reset(const QString &contentType);
+    Mode getMode() const {return mode;}
+
+    QStringList feed(const QByteArray &chunk);
+    QStringList finish();
+
+private:
+    QStringList processLine(QByteArray line);
+
+    Mode mode;
+    QByteArray buffer;
+    QString event;
+};
+
+#endif // CHANGEEVENTPARSER_H
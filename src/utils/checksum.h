@@ -0,0 +1,18 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <QByteArray>
+
+namespace Checksum{
+
+//crc32 of gzip/zip/zlib (polynomial 0xEDB88320), the same result as zlib crc32(crc, data, size)
+//ARMv8 crc32 instructions are used on aarch64 cpus which have them, slicing-by-8 tables otherwise (32-bit arm too)
+//code which already links zlib keeps its crc32, it is faster than these tables
+quint32 crc32(quint32 crc, const void * data, qint64 size);
+inline quint32 crc32(const QByteArray &data) {return crc32(0, data.constData(), data.size());}
+//"armv8" or "slicing-by-8"
+const char * crc32Implementation();
+
+}
+
+#endif // CHECKSUM_H
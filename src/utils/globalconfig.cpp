@@ -139,8 +139,24 @@ void GlobalConfig::setPlaylist(QJsonObject json)
     save();
 }
 
+void GlobalConfig::setPlaylistFile(QString fileName)
+{
+    QString playlistFileName = CONFIG_FOLDER + "playlist.json";
+    QFile::remove(playlistFileName);
+    if (!QFile::rename(fileName, playlistFileName))
+        qDebug() << "GlobalConfig::setPlaylistFile: cant store playlist" << fileName;
+    playlist = QJsonObject();
+    save();
+}
+
 QJsonObject GlobalConfig::getPlaylist()
 {
+    if (playlist.isEmpty())
+    {
+        QFile playlistFile(CONFIG_FOLDER + "playlist.json");
+        if (playlistFile.open(QFile::ReadOnly))
+            return QJsonDocument::fromJson(playlistFile.readAll()).object();
+    }
     QJsonDocument doc(playlist);
     qDebug() << "PLAYLIST ON RETURN: " << doc.toJson();
     return playlist;
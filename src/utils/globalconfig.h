@@ -42,6 +42,8 @@ public:
     QJsonObject getSettings();
     SettingsRequestResult& getSettingsObject();
     void setPlaylist(QJsonObject json);
+    //raw playlist is kept in separate file, so config.dat doesnt grow with playlist
+    void setPlaylistFile(QString fileName);
     QJsonObject getPlaylist();
     void setAreas(QJsonArray json);
     QJsonArray getAreas();
@@ -1,8 +1,9 @@
 #include <QDebug>
 #include <QFile>
-#include <QTimeZone>
 #include <QProcess>
 #include "globalstats.h"
+#include "idregistry.h"
+#include "metrics.h"
 #include "platformspecific.h"
 
 GlobalStats::GlobalStats(QObject *parent) : QObject(parent)
@@ -24,31 +25,9 @@ GlobalStats::GlobalStats(QObject *parent) : QObject(parent)
     connectionDropped = false;
     latitude = longitude = 0.0;
     hdmiGPIO = true;
+    MetricsInstance.addCollector([this](QByteArray &out) {exportMetrics(out);});
 
-    QFile f("/usr/share/zoneinfo/zone.tab");
-    f.open(QFile::ReadOnly);
-    QStringList lines = QString(f.readAll()).split("\n");
-    foreach (const QString &s, lines)
-    {
-        if (s.simplified() == "" || s[0] == QChar('#'))
-            continue;
-        QStringList tokens = s.split("\t");
-        if (tokens.count() > 2)
-        {
-            TimeZoneEntry newItem;
-            newItem.shortName = tokens[0];
-            QString coordsString = tokens[1];
-            coordsString = coordsString.replace("+", " +").replace("-", " -");
-            coordsString = coordsString.mid(1, coordsString.length()-1);
-            QString latStr = coordsString.split(" ")[0];
-            QString lonStr = coordsString.split(" ")[1];
-            newItem.lat = latStr.toDouble()/(latStr.length() > 6 ? 10000. : 100.);
-            newItem.lon = lonStr.toDouble()/(lonStr.length() > 6 ? 10000. : 100.);
-            newItem.longName = tokens[2];
-            tzDatabase.append(newItem);
-        }
-    }
-    f.close();
+    timeZones.load();
 }
 
 void GlobalStats::registryDownload()
@@ -144,60 +123,11 @@ int GlobalStats::getUTCOffset()
 {
     if (PlatformSpecificService.isAndroid())
         return 0;
-    bool shouldUpdateUTC = false;
-    QDateTime currentTimeUTC = QDateTime::currentDateTimeUtc();
-    if (!lastTzCheck.isValid())
-    {
-        lastTzCheck = currentTimeUTC;
-        shouldUpdateUTC = true;
-    }
-    if (lastTzCheck.secsTo(currentTimeUTC) > 300)
-    {
-        shouldUpdateUTC = true;
-        lastTzCheck = currentTimeUTC;
-    }
-    if (shouldUpdateUTC)
-    {
-        //qDebug() << "GlobalStats::getUTCOffset";
-        int foundIndex = 0;
-        double distance = 10000000.;
-        double lat = latitude;
-        double lon = longitude;
-        if (lat == 0.0 && lon == 0.0)
-        {
-            cachedTzValue = 0;
-            return 0;
-        }
-        int currentIndex = 0;
-        foreach (const TimeZoneEntry &tz, tzDatabase)
-        {
-            double theta = lon - tz.lon;
-            double cdistance = sin(lat/180.*M_PI) * sin(tz.lat/180.*M_PI) + cos(lat/180.*M_PI)*cos(tz.lat/180.*M_PI) * cos(theta/180.*M_PI);
-            cdistance = acos(cdistance);
-            cdistance = fabs(cdistance/M_PI*180.0);
-            if (distance > cdistance)
-            {
-                foundIndex = currentIndex;
-                distance = cdistance;
-            }
-            currentIndex++;
-        }
-        QTimeZone tz(tzDatabase[foundIndex].longName.toLocal8Bit());
-        if (tz.isValid())
-        {
-            auto newTz = tz.offsetFromUtc(QDateTime::currentDateTime());
-            if (newTz != 0)
-                cachedTzValue = tz.offsetFromUtc(QDateTime::currentDateTime());
-            return cachedTzValue;
-        }
-        else
-        {
-            return cachedTzValue;
-         //   cachedTzValue = 0;
-          //  return 0;
-        }
-    }
-    else return cachedTzValue;
+    if (latitude == 0.0 && longitude == 0.0)
+        return 0;
+    //zone is taken from grid, offset is cached till next dst transition
+    int zone = timeZones.findZone(latitude, longitude);
+    return timeZones.offsetFromUtc(zone, QDateTime::currentMSecsSinceEpoch() / 1000);
 }
 
 void GlobalStats::setSunset(QTime sunset)
@@ -228,6 +158,33 @@ GlobalStats::Report GlobalStats::generateReport()
     return result;
 }
 
+void GlobalStats::exportMetrics(QByteArray &out)
+{
+    //report counters are reset on every report, so they are gauges
+    MetricsRegistry::writeHeader(out, "teleds_report_download_count", "Downloads since last report", "gauge");
+    MetricsRegistry::writeValue(out, "teleds_report_download_count", downloadCount);
+    MetricsRegistry::writeHeader(out, "teleds_report_connection_error_count", "Connection errors since last report", "gauge");
+    MetricsRegistry::writeValue(out, "teleds_report_connection_error_count", connectionErrorCount);
+    MetricsRegistry::writeHeader(out, "teleds_report_playlist_error_count", "Playlist errors since last report", "gauge");
+    MetricsRegistry::writeValue(out, "teleds_report_playlist_error_count", playlistErrorCount);
+    MetricsRegistry::writeHeader(out, "teleds_content_play_count", "Items in current playlist", "gauge");
+    MetricsRegistry::writeValue(out, "teleds_content_play_count", contentPlayCount);
+    MetricsRegistry::writeHeader(out, "teleds_content_total_count", "Items known to player", "gauge");
+    MetricsRegistry::writeValue(out, "teleds_content_total_count", contentTotalCount);
+
+    if (transitionStats.isEmpty())
+        return;
+    MetricsRegistry::writeHeader(out, "teleds_area_transitions_total", "Item transitions per area", "counter");
+    for (auto it = transitionStats.constBegin(); it != transitionStats.constEnd(); ++it)
+        MetricsRegistry::writeValue(out, "teleds_area_transitions_total", it.value().count, "area=\"" + MetricsRegistry::escapeLabel(it.key()) + "\"");
+    MetricsRegistry::writeHeader(out, "teleds_area_transition_gaps_total", "Transitions longer than gap threshold per area", "counter");
+    for (auto it = transitionStats.constBegin(); it != transitionStats.constEnd(); ++it)
+        MetricsRegistry::writeValue(out, "teleds_area_transition_gaps_total", it.value().gapCount, "area=\"" + MetricsRegistry::escapeLabel(it.key()) + "\"");
+    MetricsRegistry::writeHeader(out, "teleds_area_transition_max_latency_ms", "Longest transition per area", "gauge");
+    for (auto it = transitionStats.constBegin(); it != transitionStats.constEnd(); ++it)
+        MetricsRegistry::writeValue(out, "teleds_area_transition_max_latency_ms", it.value().maxLatency, "area=\"" + MetricsRegistry::escapeLabel(it.key()) + "\"");
+}
+
 GlobalStats::SystemInfo GlobalStats::generateSystemInfo()
 {
     SystemInfo result;
@@ -277,106 +234,138 @@ bool GlobalStats::shouldUpdateSunrise()
     return updateValue;
 }
 
-void GlobalStats::itemPlayed(QString areaId, QString contentId, QDateTime date)
+void GlobalStats::itemPlayed(quint32 areaId, quint32 contentId, QDateTime date)
 {
     qDebug() << "GlobalStats::itemPlayed" << contentId << " " << date;
-    if (!lastTimePlayed.contains(areaId))
-        lastTimePlayed[areaId] = QHash<QString, QDateTime>();
-    lastTimePlayed[areaId][contentId] = date;
+    if (lastTimePlayed.count() <= int(areaId))
+        lastTimePlayed.resize(areaId + 1);
+    QVector<QDateTime> &areaPlays = lastTimePlayed[areaId];
+    if (areaPlays.count() <= int(contentId))
+        areaPlays.resize(contentId + 1);
+    areaPlays[contentId] = date;
 }
 
-bool GlobalStats::checkDelayPass(const QString &areaId, const QString &contentId, const QDateTime &realCurrentTime)
+bool GlobalStats::checkDelayPass(quint32 areaId, quint32 contentId, const QDateTime &realCurrentTime)
 {
-    //qDebug() << "GlobalStats::checkDelayPass " << QDateTime::currentDateTime();
-   /* if (!lastTimePlayed.contains(areaId))
-    {
-        qDebug() << "no such area -> return true";
-        return true;
-    }
-    if (!lastTimePlayed[areaId].contains(contentId))
-    {
-        qDebug() << "item was never played -> return true";
-        return true;
-    }*/
-    //int getutcoffset = getUTCOffset();
-    //qDebug() << "GET UTC OFFSET" << getutcoffset;
-    //QDateTime currentTime = QDateTime::currentDateTimeUtc().addSecs(getutcoffset);
-    //qDebug() << currentTime.time() << "prevPL" << lastTimePlayed[areaId][contentId].addSecs(getItemPlayTimeout(contentId)).time();
-    //qDebug() << "GlobalStats::checkDelayPass before return" << QDateTime::currentDateTime();
-    return realCurrentTime > lastTimePlayed[areaId][contentId].addSecs(getItemPlayTimeout(contentId));
+    QDateTime lastPlayed;
+    if (int(areaId) < lastTimePlayed.count() && int(contentId) < lastTimePlayed[areaId].count())
+        lastPlayed = lastTimePlayed[areaId][contentId];
+    return realCurrentTime > lastPlayed.addSecs(getItemPlayTimeout(contentId));
 }
 
-QDateTime GlobalStats::getItemLastPlayDate(QString areaId, QString contentId)
+QDateTime GlobalStats::getItemLastPlayDate(quint32 areaId, quint32 contentId)
 {
-    //qDebug() << "GlobalStats::itemLastPlayDate";
-    if (!lastTimePlayed.contains(areaId))
-        return QDateTime::currentDateTimeUtc().addSecs(getUTCOffset());
-    if (!lastTimePlayed[areaId].contains(contentId))
+    if (!itemWasPlayed(areaId, contentId))
         return QDateTime::currentDateTimeUtc().addSecs(getUTCOffset());
     return lastTimePlayed[areaId][contentId].addSecs(getItemPlayTimeout(contentId));
 }
 
-bool GlobalStats::itemWasPlayed(QString areaId, QString contentId)
+bool GlobalStats::itemWasPlayed(quint32 areaId, quint32 contentId)
 {
-    if (!lastTimePlayed.contains(areaId))
+    if (int(areaId) >= lastTimePlayed.count() || int(contentId) >= lastTimePlayed[areaId].count())
         return false;
-    return lastTimePlayed[areaId].contains(contentId);
+    return lastTimePlayed[areaId][contentId].isValid();
 }
 
 void GlobalStats::itemWasSkipped(int duration)
 {
-    foreach (const QString &areaId, lastTimePlayed.keys())
-        foreach (const QString &contentId, lastTimePlayed[areaId].keys())
-        {
-            auto time = lastTimePlayed[areaId][contentId];
-            time = time.addSecs(-duration);
-            lastTimePlayed[areaId][contentId] = time;
-        }
+    for (int areaId = 0; areaId < lastTimePlayed.count(); areaId++)
+    {
+        QVector<QDateTime> &areaPlays = lastTimePlayed[areaId];
+        for (int contentId = 0; contentId < areaPlays.count(); contentId++)
+            if (areaPlays[contentId].isValid())
+                areaPlays[contentId] = areaPlays[contentId].addSecs(-duration);
+    }
+}
+
+void GlobalStats::setItemActivated(quint32 item, bool isActive)
+{
+    if (itemActivated.size() <= int(item))
+        itemActivated.resize(item + 1);
+    itemActivated.setBit(item, isActive);
+}
+
+bool GlobalStats::isItemActivated(quint32 item)
+{
+    if (int(item) >= itemActivated.size())
+        return false;
+    return itemActivated.testBit(item);
 }
 
 void GlobalStats::setItemActivated(const QString &item, bool isActive)
 {
-    itemActivated[item] = isActive;
+    setItemActivated(IdRegistryInstance.intern(item), isActive);
 }
 
 bool GlobalStats::isItemActivated(const QString &item)
 {
-    if (itemActivated.contains(item))
-        return itemActivated[item];
-    return false;
+    return isItemActivated(IdRegistryInstance.find(item));
+}
+
+void GlobalStats::setItemDecodable(quint32 item, bool isDecodable)
+{
+    if (itemUndecodable.size() <= int(item))
+        itemUndecodable.resize(item + 1);
+    itemUndecodable.setBit(item, !isDecodable);
+}
+
+void GlobalStats::setItemDecodable(const QString &item, bool isDecodable)
+{
+    setItemDecodable(IdRegistryInstance.intern(item), isDecodable);
+}
+
+bool GlobalStats::isItemDecodable(quint32 item)
+{
+    if (int(item) >= itemUndecodable.size())
+        return true;
+    return !itemUndecodable.testBit(item);
 }
 
 void GlobalStats::addPriorityItem(const QString &contentId)
 {
-    if (!priorityItems.contains(contentId))
-        priorityItems.append(contentId);
+    quint32 handle = IdRegistryInstance.intern(contentId);
+    if (priorityItems.size() <= int(handle))
+        priorityItems.resize(handle + 1);
+    priorityItems.setBit(handle);
+}
+
+bool GlobalStats::isItemHighPriority(quint32 contentId)
+{
+    if (int(contentId) >= priorityItems.size())
+        return false;
+    return priorityItems.testBit(contentId);
 }
 
 bool GlobalStats::isItemHighPriority(const QString &contentId)
 {
-    return priorityItems.contains(contentId);
+    return isItemHighPriority(IdRegistryInstance.find(contentId));
 }
 
-void GlobalStats::setItemPlayTimeout(QString contentId, int timeout)
+void GlobalStats::setItemPlayTimeout(quint32 contentId, int timeout)
 {
+    while (itemTimeout.count() <= int(contentId))
+        itemTimeout.append(-1);
     itemTimeout[contentId] = timeout;
 }
 
-int GlobalStats::getItemPlayTimeout(const QString &contentId)
+int GlobalStats::getItemPlayTimeout(quint32 contentId)
 {
-    if (!itemTimeout.contains(contentId))
+    if (int(contentId) >= itemTimeout.count())
     {
-        qDebug() << "Error: Trying to find item timeout where contentId wasnt found " << contentId;
+        qDebug() << "Error: Trying to find item timeout where contentId wasnt found " << IdRegistryInstance.name(contentId);
         return -1;
     }
     return itemTimeout[contentId];
 }
 
-bool GlobalStats::wasAnyItemPlayed(QString areaId)
+bool GlobalStats::wasAnyItemPlayed(quint32 areaId)
 {
-    if (!lastTimePlayed.contains(areaId))
+    if (int(areaId) >= lastTimePlayed.count())
         return false;
-    return (lastTimePlayed[areaId].count() > 0);
+    foreach (const QDateTime &date, lastTimePlayed[areaId])
+        if (date.isValid())
+            return true;
+    return false;
 }
 
 void GlobalStats::setSystemData(QString tag, QByteArray data)
@@ -417,3 +406,23 @@ void GlobalStats::clearCachedItemData()
 {
     cachedSentData.clear();
 }
+
+void GlobalStats::registryTransition(const QString &areaId, int latency, bool prerolled)
+{
+    static MetricHistogram * transitionTime = MetricsInstance.histogram("teleds_transition_latency_ms", "Time between item end and next item first frame",
+                                                                        {16, 33, 50, 80, 120, 200, 300, 500, 1000});
+    transitionTime->observe(latency);
+    TransitionStats &stats = transitionStats[areaId];
+    stats.count++;
+    stats.lastLatency = latency;
+    stats.totalLatency += latency;
+    if (latency > stats.maxLatency)
+        stats.maxLatency = latency;
+    if (!prerolled)
+        stats.notPrerolledCount++;
+    if (latency > TRANSITION_GAP_THRESHOLD)
+    {
+        stats.gapCount++;
+        qDebug() << "GlobalStats::transition gap in area" << areaId << latency << "ms, prerolled =" << prerolled;
+    }
+}
@@ -6,15 +6,14 @@
 #include <QList>
 #include <QDebug>
 #include <QDateTime>
+#include <QVector>
+#include <QBitArray>
+#include <QHash>
+#include "timezoneresolver.h"
 
 #define GlobalStatsInstance Singleton<GlobalStats>::instance()
-
-struct TimeZoneEntry{
-    QString shortName;
-    double lat;
-    double lon;
-    QString longName;
-};
+//transition longer than two frames at 25 fps is visible as a black frame
+#define TRANSITION_GAP_THRESHOLD 80
 
 //this class is for storing current device stats
 //unlike globalconfig it does not store info in file
@@ -59,21 +58,30 @@ public:
     bool shouldUpdateSunrise();
 
 
-    void itemPlayed(QString areaId, QString contentId, QDateTime date);
-    bool checkDelayPass(const QString &areaId, const QString &contentId, const QDateTime &realCurrentTime);
-    QDateTime getItemLastPlayDate(QString areaId, QString contentId);
-    bool itemWasPlayed(QString areaId, QString contentId);
+    //item stats are stored in flat arrays indexed by IdRegistry handles
+    //QString versions are kept for callers outside of scheduling path
+    void itemPlayed(quint32 areaId, quint32 contentId, QDateTime date);
+    bool checkDelayPass(quint32 areaId, quint32 contentId, const QDateTime &realCurrentTime);
+    QDateTime getItemLastPlayDate(quint32 areaId, quint32 contentId);
+    bool itemWasPlayed(quint32 areaId, quint32 contentId);
     void itemWasSkipped(int duration);
 
+    void setItemActivated(quint32 item, bool isActive);
+    bool isItemActivated(quint32 item);
     void setItemActivated(const QString &item, bool isActive);
     bool isItemActivated(const QString &item);
+    //set by MediaProbe after download, items are decodable until probe says otherwise
+    void setItemDecodable(quint32 item, bool isDecodable);
+    void setItemDecodable(const QString &item, bool isDecodable);
+    bool isItemDecodable(quint32 item);
 
     void addPriorityItem(const QString &contentId);
+    bool isItemHighPriority(quint32 contentId);
     bool isItemHighPriority(const QString &contentId);
 
-    void setItemPlayTimeout(QString contentId, int timeout);
-    int getItemPlayTimeout(const QString &contentId);
-    bool wasAnyItemPlayed(QString areaId);
+    void setItemPlayTimeout(quint32 contentId, int timeout);
+    int getItemPlayTimeout(quint32 contentId);
+    bool wasAnyItemPlayed(quint32 areaId);
 
     void setSystemData(QString tag, QByteArray data);
     QByteArray getSystemData(QString tag);
@@ -93,6 +101,21 @@ public:
     bool cacheItemData(QString id);
     void clearCachedItemData();
 
+    //per area latency between end of item and first frame of next one
+    struct TransitionStats
+    {
+        TransitionStats() : count(0), gapCount(0), notPrerolledCount(0), lastLatency(0), maxLatency(0), totalLatency(0) {}
+        int count;
+        int gapCount;
+        int notPrerolledCount;
+        int lastLatency;
+        int maxLatency;
+        qint64 totalLatency;
+        int averageLatency() const {return count ? int(totalLatency / count) : 0;}
+    };
+    void registryTransition(const QString &areaId, int latency, bool prerolled);
+    QHash<QString, TransitionStats> getTransitionStats() {return transitionStats;}
+
     struct Report
     {
         int downloadCount;
@@ -110,6 +133,8 @@ public:
     };
 
     Report generateReport();
+    //called by MetricsRegistry on /metrics request
+    void exportMetrics(QByteArray &out);
     SystemInfo generateSystemInfo();
 
 signals:
@@ -139,14 +164,15 @@ private:
     QTime measureSunrise, measureSunset;
     QHash<QString, QByteArray> systemData;
 
-    QList<TimeZoneEntry> tzDatabase;
-    QDateTime lastTzCheck;
-    int cachedTzValue;
-    QHash<QString, QHash<QString, QDateTime> > lastTimePlayed;
-    QHash<QString, int> itemTimeout;
-    QHash<QString, bool> itemActivated;
-    QList<QString> priorityItems;
+    TimeZoneResolver timeZones;
+    //[area handle][content handle], invalid date - item was never played
+    QVector<QVector<QDateTime> > lastTimePlayed;
+    QVector<int> itemTimeout;
+    QBitArray itemActivated;
+    QBitArray itemUndecodable;
+    QBitArray priorityItems;
     QList<QString> cachedSentData;
+    QHash<QString, TransitionStats> transitionStats;
 
     QDateTime campaignEndDate;
     QString hdmiCEC;
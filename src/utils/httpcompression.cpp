@@ -0,0 +1,215 @@
+#include <QDebug>
+#include <QtEndian>
+#include "httpcompression.h"
+
+#define HTTP_COMPRESSION_CHUNK 16384
+
+HTTPBodyDecoder::HTTPBodyDecoder()
+{
+    initialized = false;
+    compressed = false;
+    rawRetry = false;
+    failed = false;
+    finished = false;
+}
+
+HTTPBodyDecoder::~HTTPBodyDecoder()
+{
+    release();
+}
+
+void HTTPBodyDecoder::reset(const QByteArray &contentEncoding)
+{
+    release();
+    failed = false;
+    finished = false;
+    rawRetry = false;
+    QByteArray encoding = contentEncoding.trimmed().toLower();
+    compressed = (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate");
+    if (!compressed)
+        return;
+
+    memset(&stream, 0, sizeof(stream));
+    //32 - zlib detects gzip or zlib wrapper by itself
+    if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK)
+    {
+        qDebug() << "HTTPBodyDecoder::inflateInit failed";
+        failed = true;
+        return;
+    }
+    //some servers send raw deflate without zlib wrapper
+    rawRetry = (encoding == "deflate");
+    initialized = true;
+}
+
+bool HTTPBodyDecoder::decode(const QByteArray &chunk, QByteArray &out, bool last)
+{
+    if (failed)
+        return false;
+    if (!compressed)
+    {
+        out.append(chunk);
+        return true;
+    }
+    if (finished)
+        return true;
+
+    char buffer[HTTP_COMPRESSION_CHUNK];
+    stream.next_in = (Bytef*)chunk.constData();
+    stream.avail_in = chunk.size();
+    //empty chunk still runs inflate, it drains output zlib could not fit last time
+    forever
+    {
+        stream.next_out = (Bytef*)buffer;
+        stream.avail_out = sizeof(buffer);
+        int status = inflate(&stream, Z_NO_FLUSH);
+        if (status == Z_DATA_ERROR && rawRetry && stream.total_out == 0)
+        {
+            rawRetry = false;
+            inflateEnd(&stream);
+            memset(&stream, 0, sizeof(stream));
+            if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+            {
+                initialized = false;
+                failed = true;
+                return false;
+            }
+            stream.next_in = (Bytef*)chunk.constData();
+            stream.avail_in = chunk.size();
+            continue;
+        }
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+        {
+            qDebug() << "HTTPBodyDecoder::inflate error" << status;
+            failed = true;
+            return false;
+        }
+        rawRetry = false;
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+        if (status == Z_STREAM_END)
+        {
+            finished = true;
+            break;
+        }
+        //buffer is not full - input is used up and nothing is pending inside zlib
+        if (stream.avail_out != 0)
+            break;
+    }
+    if (last && !finished)
+    {
+        qDebug() << "HTTPBodyDecoder::compressed body is truncated";
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+void HTTPBodyDecoder::release()
+{
+    if (initialized)
+        inflateEnd(&stream);
+    initialized = false;
+}
+//---------------------------------------------------------------------
+
+HTTPBodyEncoder::HTTPBodyEncoder(int level, QIODevice *sink) : sink(sink), crc(0), inputSize(0), failed(false)
+{
+    memset(&stream, 0, sizeof(stream));
+    //raw deflate, crc is counted by Checksum while input goes through
+    initialized = deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    if (!initialized)
+    {
+        qDebug() << "HTTPBodyEncoder::deflateInit failed";
+        failed = true;
+        return;
+    }
+    //magic, deflate, no flags, no mtime, no extra flags, unknown os
+    static const char header[10] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff'};
+    put(header, sizeof(header));
+}
+
+HTTPBodyEncoder::~HTTPBodyEncoder()
+{
+    if (initialized)
+        deflateEnd(&stream);
+}
+
+void HTTPBodyEncoder::write(const char *data, int size)
+{
+    if (!initialized || size <= 0)
+        return;
+    crc = ::crc32(crc, reinterpret_cast<const Bytef*>(data), uInt(size));
+    inputSize += quint32(size);
+    deflateChunk(data, size, Z_NO_FLUSH);
+}
+
+QByteArray HTTPBodyEncoder::finish()
+{
+    if (!initialized)
+        return QByteArray();
+    deflateChunk(0, 0, Z_FINISH);
+    deflateEnd(&stream);
+    initialized = false;
+    //crc and size of input modulo 2^32, little endian
+    char footer[8];
+    qToLittleEndian(crc, reinterpret_cast<uchar*>(footer));
+    qToLittleEndian(inputSize, reinterpret_cast<uchar*>(footer + 4));
+    put(footer, sizeof(footer));
+    if (failed || sink)
+        return QByteArray();
+    QByteArray result = output;
+    output.clear();
+    return result;
+}
+
+QByteArray HTTPBodyEncoder::gzip(const QByteArray &data, int level)
+{
+    HTTPBodyEncoder encoder(level);
+    //text compresses several times, buffer grows if it is not enough
+    encoder.output.reserve(data.size() / 4 + HTTP_COMPRESSION_CHUNK);
+    encoder.write(data);
+    return encoder.finish();
+}
+
+void HTTPBodyEncoder::deflateChunk(const char *data, int size, int flush)
+{
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = size;
+    int status;
+    do
+    {
+        if (sink)
+        {
+            //one chunk buffer is reused for all writes to sink
+            output.resize(HTTP_COMPRESSION_CHUNK);
+            stream.next_out = (Bytef*)output.data();
+            stream.avail_out = HTTP_COMPRESSION_CHUNK;
+            status = deflate(&stream, flush);
+            put(output.constData(), HTTP_COMPRESSION_CHUNK - stream.avail_out);
+            continue;
+        }
+        if (output.capacity() - output.size() < HTTP_COMPRESSION_CHUNK)
+            output.reserve(output.size() + qMax(output.size() / 2, HTTP_COMPRESSION_CHUNK));
+        int offset = output.size();
+        output.resize(offset + HTTP_COMPRESSION_CHUNK);
+        stream.next_out = (Bytef*)output.data() + offset;
+        stream.avail_out = HTTP_COMPRESSION_CHUNK;
+        status = deflate(&stream, flush);
+        output.resize(offset + HTTP_COMPRESSION_CHUNK - stream.avail_out);
+    } while (stream.avail_out == 0 || (flush == Z_FINISH && status == Z_OK));
+    if (status == Z_STREAM_ERROR)
+        failed = true;
+}
+
+void HTTPBodyEncoder::put(const char *data, int size)
+{
+    if (size <= 0)
+        return;
+    if (!sink)
+        output.append(data, size);
+    else if (sink->write(data, size) != size)
+    {
+        qDebug() << "HTTPBodyEncoder: sink write failed";
+        failed = true;
+    }
+}
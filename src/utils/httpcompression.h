@@ -0,0 +1,68 @@
+#ifndef HTTPCOMPRESSION_H
+#define HTTPCOMPRESSION_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <zlib.h>
+
+//level 9 costs several times more cpu on ARM for few percent of size
+#define HTTP_GZIP_DEFAULT_LEVEL 6
+
+//incremental decoder for "Content-Encoding: gzip/deflate" response bodies
+//chunks from readyRead are inflated as they come, so compressed body is never kept whole
+class HTTPBodyDecoder
+{
+public:
+    HTTPBodyDecoder();
+    ~HTTPBodyDecoder();
+
+    //content encoding is taken from response header, empty/identity means passthrough
+    void reset(const QByteArray &contentEncoding);
+    //appends decoded data to out, returns false on broken stream
+    //last - body is over, compressed stream must be complete
+    bool decode(const QByteArray &chunk, QByteArray &out, bool last = false);
+    bool finish(QByteArray &out) {return decode(QByteArray(), out, true);}
+    bool isCompressed() const {return compressed;}
+    bool hasError() const {return failed;}
+private:
+    void release();
+
+    z_stream stream;
+    bool initialized;
+    bool compressed;
+    bool rawRetry;
+    bool failed;
+    bool finished;
+};
+
+//streaming gzip encoder for request bodies
+//input is deflated (raw) and crc'ed in the same pass, gzip header and footer are written by encoder
+//without sink data is deflated chunk by chunk into single growing buffer returned by finish()
+//with sink every filled chunk is written to it and finish() returns empty array
+class HTTPBodyEncoder
+{
+public:
+    explicit HTTPBodyEncoder(int level = HTTP_GZIP_DEFAULT_LEVEL, QIODevice * sink = 0);
+    ~HTTPBodyEncoder();
+
+    void write(const char * data, int size);
+    void write(const QByteArray &data) {write(data.constData(), data.size());}
+    QByteArray finish();
+    //sink did not accept data or deflate failed
+    bool hasError() const {return failed;}
+
+    static QByteArray gzip(const QByteArray &data, int level = HTTP_GZIP_DEFAULT_LEVEL);
+private:
+    void deflateChunk(const char * data, int size, int flush);
+    void put(const char * data, int size);
+
+    z_stream stream;
+    QByteArray output;
+    QIODevice * sink;
+    quint32 crc;
+    quint32 inputSize;
+    bool initialized;
+    bool failed;
+};
+
+#endif // HTTPCOMPRESSION_H
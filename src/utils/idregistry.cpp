@@ -0,0 +1,47 @@
+#include "idregistry.h"
+
+IdRegistry::IdRegistry(QObject *parent) : QObject(parent)
+{
+    names.append(QString());
+}
+
+quint32 IdRegistry::intern(const QString &id)
+{
+    if (id.isEmpty())
+        return EMPTY_ID_HANDLE;
+    {
+        QReadLocker locker(&lock);
+        auto it = handles.constFind(id);
+        if (it != handles.constEnd())
+            return it.value();
+    }
+    //downloader thread may intern ids too
+    QWriteLocker locker(&lock);
+    auto it = handles.constFind(id);
+    if (it != handles.constEnd())
+        return it.value();
+    quint32 handle = names.count();
+    names.append(id);
+    handles[id] = handle;
+    return handle;
+}
+
+quint32 IdRegistry::find(const QString &id) const
+{
+    QReadLocker locker(&lock);
+    return handles.value(id, EMPTY_ID_HANDLE);
+}
+
+QString IdRegistry::name(quint32 handle) const
+{
+    QReadLocker locker(&lock);
+    if (handle >= quint32(names.count()))
+        return QString();
+    return names[handle];
+}
+
+int IdRegistry::count() const
+{
+    QReadLocker locker(&lock);
+    return names.count();
+}
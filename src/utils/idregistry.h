@@ -0,0 +1,38 @@
+#ifndef IDREGISTRY_H
+#define IDREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QReadWriteLock>
+#include "singleton.h"
+
+#define IdRegistryInstance Singleton<IdRegistry>::instance()
+
+//handle 0 is reserved for empty id
+#define EMPTY_ID_HANDLE 0
+
+//global interning table for content/area/campaign ids
+//every id gets dense 32-bit handle once (at playlist parse time)
+//so runtime structures can be flat arrays indexed by handle instead of string hashes
+//handles are never released, so they stay valid for the whole process lifetime
+class IdRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IdRegistry(QObject *parent = 0);
+
+    quint32 intern(const QString &id);
+    //returns EMPTY_ID_HANDLE if id was never interned
+    quint32 find(const QString &id) const;
+    QString name(quint32 handle) const;
+    int count() const;
+
+private:
+    QHash<QString, quint32> handles;
+    QVector<QString> names;
+    mutable QReadWriteLock lock;
+};
+
+#endif // IDREGISTRY_H
@@ -0,0 +1,422 @@
+#include <QDateTime>
+#include <QDir>
+#include <QBuffer>
+#include <QDataStream>
+#include <QPair>
+#include <stdio.h>
+#include <stdlib.h>
+#include <zlib.h>
+#include "logger.h"
+#include "metrics.h"
+#include "platformdefines.h"
+
+namespace
+{
+    void loggerMessageHandler(QtMsgType type, const QMessageLogContext &, const QString &message)
+    {
+        LogLevel level = LOG_DEBUG;
+        if (type == QtWarningMsg)
+            level = LOG_WARNING;
+        else if (type == QtCriticalMsg || type == QtFatalMsg)
+            level = LOG_ERROR;
+        if (LoggerInstance.isEnabled(level, LOG_GENERAL))
+            LoggerInstance.log(level, LOG_GENERAL, message);
+        if (type == QtFatalMsg)
+        {
+            LoggerInstance.stop();
+            abort();
+        }
+    }
+
+    void writeVarint(QByteArray &out, quint64 value)
+    {
+        while (value >= 0x80)
+        {
+            out.append(char((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.append(char(value));
+    }
+
+    bool readVarint(const QByteArray &data, int &pos, quint64 &value)
+    {
+        value = 0;
+        int shift = 0;
+        while (pos < data.size() && shift < 64)
+        {
+            quint8 b = quint8(data[pos++]);
+            value |= quint64(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return true;
+            shift += 7;
+        }
+        return false;
+    }
+}
+
+LogRateLimiter::LogRateLimiter(int maxPerSecond) :
+    maxPerSecond(maxPerSecond), windowStart(0), count(0)
+{
+
+}
+
+bool LogRateLimiter::allow()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 start = windowStart.load();
+    if (now - start >= 1000 && windowStart.testAndSetRelaxed(start, now))
+        count.store(0);
+    if (count.fetchAndAddRelaxed(1) < maxPerSecond)
+        return true;
+    LoggerInstance.addSuppressed();
+    return false;
+}
+
+LogLine::~LogLine()
+{
+    //QDebug leaves space after last item
+    if (text.endsWith(' '))
+        text.chop(1);
+    LoggerInstance.log(level, category, text);
+}
+
+LogRing::LogRing() : head(0), tail(0)
+{
+    for (quint32 i = 0; i < LOG_RING_SIZE; i++)
+        cells[i].sequence.store(i);
+}
+
+bool LogRing::push(const LogRecord &record)
+{
+    quint32 pos = head.load();
+    Slot * slot;
+    forever
+    {
+        slot = &cells[pos & (LOG_RING_SIZE - 1)];
+        qint32 diff = qint32(slot->sequence.loadAcquire() - pos);
+        if (diff == 0)
+        {
+            //slot is free, try to take it
+            if (head.testAndSetRelaxed(pos, pos + 1))
+                break;
+            pos = head.load();
+        }
+        else if (diff < 0)
+            return false;
+        else
+            pos = head.load();
+    }
+    slot->record = record;
+    slot->sequence.storeRelease(pos + 1);
+    return true;
+}
+
+bool LogRing::pop(LogRecord &record)
+{
+    Slot &slot = cells[tail & (LOG_RING_SIZE - 1)];
+    if (qint32(slot.sequence.loadAcquire() - (tail + 1)) < 0)
+        return false;
+    record = slot.record;
+    slot.record.message = QByteArray();
+    slot.sequence.storeRelease(tail + LOG_RING_SIZE);
+    tail++;
+    return true;
+}
+
+void LogWriter::run()
+{
+    logger->openFile();
+    while (!stopped.load())
+    {
+        logger->flush();
+        msleep(LOG_FLUSH_TIME);
+    }
+    logger->flush();
+    logger->file.close();
+}
+
+Logger::Logger(QObject *parent) : QObject(parent), dropped(0), suppressed(0)
+{
+    for (int i = 0; i < LOG_CATEGORY_COUNT; i++)
+        levels[i].store(LOG_INFO);
+    //existing qDebug output is kept, hot path categories are info and above by default
+    levels[LOG_GENERAL].store(LOG_DEBUG);
+    echoToStdout = !qgetenv("TELEDS_LOG_STDOUT").isEmpty();
+    started = false;
+    writer = 0;
+    lastTime = 0;
+}
+
+Logger::~Logger()
+{
+    stop();
+}
+
+void Logger::start()
+{
+    if (started)
+        return;
+    QByteArray envLevel = qgetenv("TELEDS_LOG_LEVEL");
+    if (!envLevel.isEmpty())
+        setLevel(LogLevel(qBound(0, envLevel.toInt(), int(LOG_ERROR))));
+    started = true;
+    writer = new LogWriter(this);
+    writer->start(QThread::LowPriority);
+    qInstallMessageHandler(loggerMessageHandler);
+    MetricsInstance.addCollector([this](QByteArray &out) {
+        MetricsRegistry::writeHeader(out, "teleds_log_dropped_total", "Log lines dropped because ring buffer was full", "counter");
+        MetricsRegistry::writeValue(out, "teleds_log_dropped_total", dropped.load());
+        MetricsRegistry::writeHeader(out, "teleds_log_suppressed_total", "Log lines suppressed by rate limit", "counter");
+        MetricsRegistry::writeValue(out, "teleds_log_suppressed_total", suppressed.load());
+    });
+}
+
+void Logger::stop()
+{
+    if (!started)
+        return;
+    qInstallMessageHandler(0);
+    started = false;
+    writer->stop();
+    writer->wait();
+    delete writer;
+    writer = 0;
+}
+
+void Logger::setLevel(LogCategory category, LogLevel level)
+{
+    levels[category].store(level);
+}
+
+void Logger::setLevel(LogLevel level)
+{
+    for (int i = 0; i < LOG_CATEGORY_COUNT; i++)
+        levels[i].store(level);
+}
+
+void Logger::log(LogLevel level, LogCategory category, const QString &message)
+{
+    LogRecord record;
+    record.time = QDateTime::currentMSecsSinceEpoch();
+    record.level = quint8(level);
+    record.category = quint8(category);
+    record.message = message.toUtf8();
+    if (!started)
+    {
+        fprintf(stderr, "%s\n", record.message.constData());
+        return;
+    }
+    if (!ring.push(record))
+        dropped.fetchAndAddRelaxed(1);
+}
+
+QString Logger::levelName(int level)
+{
+    static const char * names[] = {"D", "I", "W", "E"};
+    return level >= 0 && level <= LOG_ERROR ? names[level] : "?";
+}
+
+QString Logger::categoryName(int category)
+{
+    static const char * names[] = {"general", "player", "playlist", "download", "http", "stats", "sync"};
+    return category >= 0 && category < LOG_CATEGORY_COUNT ? names[category] : "unknown";
+}
+
+QString Logger::fileName(int index)
+{
+    return CONFIG_FOLDER + LOG_FOLDER + "teleds." + QString::number(index) + ".tdl";
+}
+
+void Logger::openFile()
+{
+    QDir().mkpath(CONFIG_FOLDER + LOG_FOLDER);
+    //every run starts new file
+    rotate();
+}
+
+void Logger::rotate()
+{
+    if (file.isOpen())
+        file.close();
+    QFile::remove(fileName(LOG_FILE_COUNT - 1));
+    for (int i = LOG_FILE_COUNT - 2; i >= 0; i--)
+        QFile::rename(fileName(i), fileName(i + 1));
+
+    file.setFileName(fileName(0));
+    if (!file.open(QFile::WriteOnly))
+    {
+        fprintf(stderr, "Logger: cant open %s\n", qPrintable(file.fileName()));
+        return;
+    }
+    lastTime = QDateTime::currentMSecsSinceEpoch();
+    file.write(encodeHeader(lastTime));
+}
+
+void Logger::flush()
+{
+    LogRecord record;
+    bool written = false;
+    while (ring.pop(record))
+    {
+        writeRecord(record);
+        if (echoToStdout)
+            fprintf(stdout, "%s\n", record.message.constData());
+        written = true;
+    }
+    if (written)
+    {
+        file.flush();
+        if (echoToStdout)
+            fflush(stdout);
+    }
+}
+
+void Logger::writeRecord(const LogRecord &record)
+{
+    if (file.isOpen() && file.size() >= LOG_FILE_SIZE)
+        rotate();
+    if (!file.isOpen())
+        return;
+    QByteArray out;
+    encodeRecord(out, record, lastTime);
+    file.write(out);
+    lastTime = record.time;
+}
+
+QByteArray Logger::encodeHeader(qint64 baseTime)
+{
+    QByteArray header(LOG_FILE_MAGIC);
+    header.append(char(LOG_FILE_VERSION));
+    for (int i = 0; i < 8; i++)
+        header.append(char((quint64(baseTime) >> (i * 8)) & 0xFF));
+    return header;
+}
+
+void Logger::encodeRecord(QByteArray &out, const LogRecord &record, qint64 previousTime)
+{
+    out.reserve(out.size() + record.message.size() + 16);
+    //zigzag, time can go back when player clock is set
+    qint64 delta = record.time - previousTime;
+    writeVarint(out, quint64((delta << 1) ^ (delta >> 63)));
+    out.append(char((record.level << 5) | (record.category & 0x1F)));
+    writeVarint(out, quint64(record.message.size()));
+    out.append(record.message);
+}
+
+QByteArray Logger::decodeFile(const QByteArray &data)
+{
+    QByteArray result;
+    int headerSize = 4 + 1 + 8;
+    if (data.size() < headerSize || !data.startsWith(LOG_FILE_MAGIC))
+        return result;
+    qint64 time = 0;
+    for (int i = 0; i < 8; i++)
+        time |= qint64(quint8(data[5 + i])) << (i * 8);
+
+    int pos = headerSize;
+    while (pos < data.size())
+    {
+        quint64 zigzag, size;
+        if (!readVarint(data, pos, zigzag) || pos >= data.size())
+            break;
+        quint8 tag = quint8(data[pos++]);
+        if (!readVarint(data, pos, size) || pos + qint64(size) > data.size())
+            break;
+        time += qint64(zigzag >> 1) ^ -qint64(zigzag & 1);
+        result += QDateTime::fromMSecsSinceEpoch(time).toString("yyyy-MM-dd hh:mm:ss.zzz ").toLatin1();
+        result += levelName(tag >> 5).toLatin1() + " " + categoryName(tag & 0x1F).toLatin1() + ": ";
+        result.append(data.constData() + pos, int(size));
+        result += "\n";
+        pos += int(size);
+    }
+    return result;
+}
+
+QByteArray Logger::exportArchive()
+{
+    //zip with deflated entries, oldest file first
+    QByteArray archive;
+    QByteArray centralDirectory;
+    QBuffer archiveBuffer(&archive), centralBuffer(&centralDirectory);
+    archiveBuffer.open(QIODevice::WriteOnly);
+    centralBuffer.open(QIODevice::WriteOnly);
+    QDataStream out(&archiveBuffer), central(&centralBuffer);
+    out.setByteOrder(QDataStream::LittleEndian);
+    central.setByteOrder(QDataStream::LittleEndian);
+
+    QDateTime now = QDateTime::currentDateTime();
+    quint16 dosTime = quint16((now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2));
+    quint16 dosDate = quint16(((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day());
+    quint16 entries = 0;
+
+    //name and text of every entry, oldest first
+    QList<QPair<QByteArray, QByteArray> > files;
+    for (int i = LOG_FILE_COUNT - 1; i >= 0; i--)
+    {
+        QFile f(fileName(i));
+        if (!f.open(QFile::ReadOnly))
+            continue;
+        files.append(qMakePair("teleds." + QByteArray::number(i) + ".log", decodeFile(f.readAll())));
+        f.close();
+    }
+    //stderr of player.sh runs: log.txt of current run, log.backup.* of previous ones
+    //they keep output before logger is started and crash output, only their tails are taken
+    QFileInfoList captures = QDir().entryInfoList(QStringList() << LOG_STDERR_CAPTURE_FILTER, QDir::Files, QDir::Time);
+    for (int i = qMin(captures.count(), LOG_STDERR_CAPTURE_COUNT) - 1; i >= 0; i--)
+    {
+        QFile f(captures[i].filePath());
+        if (!f.open(QFile::ReadOnly))
+            continue;
+        if (f.size() > LOG_STDERR_CAPTURE_SIZE)
+            f.seek(f.size() - LOG_STDERR_CAPTURE_SIZE);
+        files.append(qMakePair(captures[i].fileName().toUtf8(), f.readAll()));
+        f.close();
+    }
+
+    for (int i = 0; i < files.count(); i++)
+    {
+        const QByteArray &name = files[i].first;
+        const QByteArray &text = files[i].second;
+        if (text.isEmpty())
+            continue;
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, 9, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            continue;
+        QByteArray compressed;
+        compressed.resize(int(deflateBound(&stream, uLong(text.size()))));
+        stream.next_in = (Bytef*)text.constData();
+        stream.avail_in = uInt(text.size());
+        stream.next_out = (Bytef*)compressed.data();
+        stream.avail_out = uInt(compressed.size());
+        int result = deflate(&stream, Z_FINISH);
+        compressed.resize(int(stream.total_out));
+        deflateEnd(&stream);
+        if (result != Z_STREAM_END)
+            continue;
+
+        quint32 crc = quint32(crc32(0L, (const Bytef*)text.constData(), uInt(text.size())));
+        quint32 offset = quint32(archive.size());
+
+        out << quint32(0x04034b50) << quint16(20) << quint16(0) << quint16(8) << dosTime << dosDate
+            << crc << quint32(compressed.size()) << quint32(text.size()) << quint16(name.size()) << quint16(0);
+        out.writeRawData(name.constData(), name.size());
+        out.writeRawData(compressed.constData(), compressed.size());
+
+        central << quint32(0x02014b50) << quint16(20) << quint16(20) << quint16(0) << quint16(8) << dosTime << dosDate
+                << crc << quint32(compressed.size()) << quint32(text.size()) << quint16(name.size())
+                << quint16(0) << quint16(0) << quint16(0) << quint16(0) << quint32(0) << offset;
+        central.writeRawData(name.constData(), name.size());
+        entries++;
+    }
+    if (entries == 0)
+        return QByteArray();
+
+    quint32 centralOffset = quint32(archive.size());
+    out.writeRawData(centralDirectory.constData(), centralDirectory.size());
+    out << quint32(0x06054b50) << quint16(0) << quint16(0) << entries << entries
+        << quint32(centralDirectory.size()) << centralOffset << quint16(0);
+    archiveBuffer.close();
+    return archive;
+}
@@ -0,0 +1,168 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QObject>
+#include <QThread>
+#include <QAtomicInteger>
+#include <QDebug>
+#include <QFile>
+#include "singleton.h"
+
+#define LoggerInstance Singleton<Logger>::instance()
+
+enum LogLevel {LOG_DEBUG = 0, LOG_INFO, LOG_WARNING, LOG_ERROR};
+enum LogCategory {LOG_GENERAL = 0, LOG_PLAYER, LOG_PLAYLIST, LOG_DOWNLOAD, LOG_HTTP, LOG_STATS, LOG_SYNC, LOG_CATEGORY_COUNT};
+
+//lines below this level are removed by compiler, can be set from .pro: DEFINES += TELEDS_LOG_MIN_LEVEL=1
+#ifndef TELEDS_LOG_MIN_LEVEL
+#define TELEDS_LOG_MIN_LEVEL LOG_DEBUG
+#endif
+
+//power of two
+#define LOG_RING_SIZE 4096
+#define LOG_FLUSH_TIME 200
+#define LOG_FILE_SIZE 1048576
+#define LOG_FILE_COUNT 5
+#define LOG_FOLDER "logs/"
+#define LOG_FILE_MAGIC "TDLG"
+#define LOG_FILE_VERSION 1
+//stderr captures of player.sh (log.txt, log.backup.*) added to log upload, newest ones, tail of each
+#define LOG_STDERR_CAPTURE_FILTER "log*"
+#define LOG_STDERR_CAPTURE_COUNT 5
+#define LOG_STDERR_CAPTURE_SIZE 1048576
+
+//usage: TLOG(LOG_DEBUG, LOG_PLAYLIST) << "next item" << name;
+//arguments are not evaluated if level or category is filtered out
+#define TLOG(level, category) \
+    if (level < TELEDS_LOG_MIN_LEVEL || !LoggerInstance.isEnabled(level, category)) ; \
+    else LogLine(level, category).stream()
+
+//same, but not more than maxPerSecond lines from this call site, rest are counted as suppressed
+#define TLOG_LIMITED(level, category, maxPerSecond) \
+    if (level < TELEDS_LOG_MIN_LEVEL || !LoggerInstance.isEnabled(level, category) || \
+        !([]() -> bool {static LogRateLimiter limiter(maxPerSecond); return limiter.allow();})()) ; \
+    else LogLine(level, category).stream()
+
+class LogRateLimiter
+{
+public:
+    explicit LogRateLimiter(int maxPerSecond);
+    bool allow();
+private:
+    int maxPerSecond;
+    QAtomicInteger<qint64> windowStart;
+    QAtomicInteger<int> count;
+};
+
+//collects one line and sends it to logger when statement ends
+class LogLine
+{
+public:
+    LogLine(LogLevel level, LogCategory category) : level(level), category(category) {}
+    ~LogLine();
+    //returned QDebug is destroyed before LogLine, so text is complete in destructor
+    QDebug stream() {return QDebug(&text);}
+private:
+    LogLevel level;
+    LogCategory category;
+    QString text;
+};
+
+struct LogRecord
+{
+    qint64 time;
+    quint8 level;
+    quint8 category;
+    QByteArray message;
+};
+
+//bounded multi producer / single consumer queue, push never blocks and never locks
+//(sequence number per slot), if queue is full record is dropped and counted
+class LogRing
+{
+public:
+    LogRing();
+    bool push(const LogRecord &record);
+    bool pop(LogRecord &record);
+private:
+    struct Slot
+    {
+        QAtomicInteger<quint32> sequence;
+        LogRecord record;
+    };
+    Slot cells[LOG_RING_SIZE];
+    QAtomicInteger<quint32> head;
+    quint32 tail;
+};
+
+class Logger;
+class LogWriter : public QThread
+{
+    Q_OBJECT
+public:
+    explicit LogWriter(Logger * logger) : logger(logger), stopped(0) {}
+    void stop() {stopped.store(1);}
+protected:
+    void run();
+private:
+    Logger * logger;
+    QAtomicInteger<int> stopped;
+};
+
+//async logger: callers put records to ring buffer, writer thread stores them to rotating files
+//file format: magic, version, base time (msecs since epoch, int64 le), then records:
+//varint time delta from previous record, byte (level << 5 | category), varint size, utf8 text
+//qDebug/qWarning output is routed here too (LOG_GENERAL category)
+class Logger : public QObject
+{
+    Q_OBJECT
+    friend class LogWriter;
+public:
+    explicit Logger(QObject *parent = 0);
+    ~Logger();
+
+    //installs qt message handler and starts writer thread
+    void start();
+    void stop();
+
+    bool isEnabled(LogLevel level, LogCategory category) const {return int(level) >= levels[category].load();}
+    void setLevel(LogCategory category, LogLevel level);
+    void setLevel(LogLevel level);
+    void setEchoToStdout(bool echo) {echoToStdout = echo;}
+    void log(LogLevel level, LogCategory category, const QString &message);
+
+    //zip archive with all log files converted to text, for log upload
+    QByteArray exportArchive();
+    qint64 getDroppedCount() const {return dropped.load();}
+    qint64 getSuppressedCount() const {return suppressed.load();}
+    void addSuppressed() {suppressed.fetchAndAddRelaxed(1);}
+
+    static QString levelName(int level);
+    static QString categoryName(int category);
+    //converts binary log file to text lines, truncated last record is skipped
+    static QByteArray decodeFile(const QByteArray &data);
+    //file header and one record appended to out, time is stored as delta from previous record
+    static QByteArray encodeHeader(qint64 baseTime);
+    static void encodeRecord(QByteArray &out, const LogRecord &record, qint64 previousTime);
+
+private:
+    void flush();
+    void writeRecord(const LogRecord &record);
+    void openFile();
+    void rotate();
+    static QString fileName(int index);
+
+    LogRing ring;
+    LogWriter * writer;
+    QAtomicInteger<int> levels[LOG_CATEGORY_COUNT];
+    QAtomicInteger<qint64> dropped;
+    QAtomicInteger<qint64> suppressed;
+    bool echoToStdout;
+    bool started;
+
+    //writer thread only
+    QFile file;
+    qint64 lastTime;
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,397 @@
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+#include "mediaprobe.h"
+#include "platformdefines.h"
+
+#define MEDIA_PROBE_CACHE_FILE "mediaprobe.dat"
+//biggest leaf box (stts) we read into memory
+#define MEDIA_PROBE_MAX_BOX_SIZE 1048576
+#define MEDIA_PROBE_MAX_DEPTH 8
+
+struct MediaCapability
+{
+    const char * codec;
+    bool hardware;
+    int maxWidth;
+    int maxHeight;
+    int maxFrameRate;
+    //0 - level is not checked
+    int maxLevel;
+    int maxBitDepth;
+};
+
+//first entry which fits decides the class, so hardware entries go first
+static const MediaCapability capabilityTable[] = {
+#if defined(PLATFORM_DEFINE_RPI)
+    //VideoCore IV: h264 high@4.2 1080p60 and mpeg4 in hardware, no hevc/vp9/av1 decoder
+    {"avc1", true, 1920, 1080, 60, 42, 8},
+    {"mp4v", true, 1920, 1080, 30, 0, 8},
+    {"hvc1", false, 1280, 720, 30, 0, 8},
+    {"vp09", false, 1280, 720, 30, 0, 8},
+#elif defined(PLATFORM_DEFINE_ANDROID)
+    {"avc1", true, 3840, 2160, 30, 51, 8},
+    {"hvc1", true, 3840, 2160, 60, 153, 10},
+    {"vp09", true, 3840, 2160, 30, 0, 8},
+    {"mp4v", true, 1920, 1080, 30, 0, 8},
+    {"avc1", false, 1920, 1080, 30, 0, 8},
+    {"av01", false, 1920, 1080, 30, 0, 8},
+#else
+    {"avc1", false, 3840, 2160, 60, 0, 10},
+    {"hvc1", false, 3840, 2160, 60, 0, 10},
+    {"vp09", false, 3840, 2160, 60, 0, 10},
+    {"av01", false, 3840, 2160, 60, 0, 10},
+    {"mp4v", false, 1920, 1080, 60, 0, 8},
+#endif
+};
+
+MediaInfo::MediaInfo()
+{
+    profile = level = 0;
+    bitDepth = 8;
+    width = height = 0;
+    frameRate = 0.;
+    duration = 0;
+    support = UNKNOWN;
+}
+
+QString MediaInfo::supportName() const
+{
+    switch (support)
+    {
+    case HARDWARE: return "hardware";
+    case SOFTWARE: return "software";
+    case UNSUPPORTED: return "unsupported";
+    default: return "unknown";
+    }
+}
+
+namespace
+{
+    struct TrackInfo
+    {
+        TrackInfo() : timescale(0), duration(0), sampleCount(0), sampleDelta(0) {}
+        QByteArray handler;
+        quint32 timescale;
+        quint64 duration;
+        quint64 sampleCount;
+        quint64 sampleDelta;
+        MediaInfo media;
+    };
+
+    quint16 readU16(const QByteArray &data, int pos)
+    {
+        return pos + 2 <= data.size() ? qFromBigEndian<quint16>((const uchar*)data.constData() + pos) : 0;
+    }
+
+    quint32 readU32(const QByteArray &data, int pos)
+    {
+        return pos + 4 <= data.size() ? qFromBigEndian<quint32>((const uchar*)data.constData() + pos) : 0;
+    }
+
+    quint64 readU64(const QByteArray &data, int pos)
+    {
+        return pos + 8 <= data.size() ? qFromBigEndian<quint64>((const uchar*)data.constData() + pos) : 0;
+    }
+
+    quint8 readU8(const QByteArray &data, int pos)
+    {
+        return pos < data.size() ? quint8(data[pos]) : 0;
+    }
+
+    QString normalizeCodec(const QByteArray &type)
+    {
+        if (type == "hev1")
+            return "hvc1";
+        if (type == "avc3")
+            return "avc1";
+        return QString::fromLatin1(type);
+    }
+
+    //codec config boxes (avcC/hvcC/vpcC/av1C) inside visual sample entry
+    void parseCodecConfig(const QByteArray &type, const QByteArray &data, MediaInfo &media)
+    {
+        if (type == "avcC")
+        {
+            media.profile = readU8(data, 1);
+            media.level = readU8(data, 3);
+            //high 10 and above
+            if (media.profile >= 110)
+                media.bitDepth = 10;
+        }
+        else if (type == "hvcC")
+        {
+            media.profile = readU8(data, 1) & 0x1F;
+            media.level = readU8(data, 12);
+            media.bitDepth = (readU8(data, 17) & 0x07) + 8;
+        }
+        else if (type == "vpcC")
+        {
+            media.profile = readU8(data, 4);
+            media.level = readU8(data, 5);
+            media.bitDepth = readU8(data, 6) >> 4;
+        }
+        else if (type == "av1C")
+        {
+            media.profile = readU8(data, 1) >> 5;
+            media.level = readU8(data, 1) & 0x1F;
+            media.bitDepth = (readU8(data, 2) & 0x40) ? 10 : 8;
+        }
+    }
+
+    void parseSampleDescription(const QByteArray &data, TrackInfo &track)
+    {
+        //full box header + entry count, then first sample entry
+        int pos = 8;
+        quint32 entrySize = readU32(data, pos);
+        QByteArray entryType = data.mid(pos + 4, 4);
+        if (entrySize < 8 || pos + int(entrySize) > data.size())
+            return;
+        track.media.codec = normalizeCodec(entryType);
+        if (track.handler != "vide")
+            return;
+
+        //visual sample entry: 8 header + 24 bytes before width/height, 78 bytes before child boxes
+        track.media.width = readU16(data, pos + 8 + 24);
+        track.media.height = readU16(data, pos + 8 + 26);
+        int childPos = pos + 8 + 78;
+        int entryEnd = pos + int(entrySize);
+        while (childPos + 8 <= entryEnd)
+        {
+            quint32 childSize = readU32(data, childPos);
+            if (childSize < 8 || childPos + int(childSize) > entryEnd)
+                break;
+            parseCodecConfig(data.mid(childPos + 4, 4), data.mid(childPos + 8, int(childSize) - 8), track.media);
+            childPos += int(childSize);
+        }
+    }
+
+    void parseLeafBox(const QByteArray &type, const QByteArray &data, TrackInfo &track)
+    {
+        if (type == "hdlr")
+            track.handler = data.mid(8, 4);
+        else if (type == "mdhd")
+        {
+            if (readU8(data, 0) == 1)
+            {
+                track.timescale = readU32(data, 20);
+                track.duration = readU64(data, 24);
+            }
+            else
+            {
+                track.timescale = readU32(data, 12);
+                track.duration = readU32(data, 16);
+            }
+        }
+        else if (type == "stsd")
+            parseSampleDescription(data, track);
+        else if (type == "stts")
+        {
+            quint32 count = readU32(data, 4);
+            for (quint32 i = 0; i < count && 8 + int(i) * 8 + 8 <= data.size(); ++i)
+            {
+                quint64 samples = readU32(data, 8 + i * 8);
+                track.sampleCount += samples;
+                track.sampleDelta += samples * readU32(data, 12 + i * 8);
+            }
+        }
+    }
+
+    bool isContainerBox(const QByteArray &type)
+    {
+        return type == "moov" || type == "trak" || type == "mdia" || type == "minf" || type == "stbl";
+    }
+
+    bool isLeafBoxNeeded(const QByteArray &type)
+    {
+        return type == "hdlr" || type == "mdhd" || type == "stsd" || type == "stts";
+    }
+
+    void finishTrack(const TrackInfo &track, MediaInfo &result, bool &hasVideo)
+    {
+        if (track.handler != "vide" || hasVideo)
+            return;
+        hasVideo = true;
+        QString container = result.container;
+        result = track.media;
+        result.container = container;
+        if (track.timescale)
+            result.duration = qint64(track.duration * 1000 / track.timescale);
+        if (track.sampleDelta)
+            result.frameRate = double(track.sampleCount) * track.timescale / double(track.sampleDelta);
+    }
+
+    bool parseBoxes(QFile &file, qint64 start, qint64 end, int depth, TrackInfo &track, MediaInfo &result, bool &hasVideo)
+    {
+        if (depth > MEDIA_PROBE_MAX_DEPTH)
+            return false;
+        qint64 pos = start;
+        bool moovFound = false;
+        while (pos + 8 <= end)
+        {
+            if (!file.seek(pos))
+                return moovFound;
+            QByteArray header = file.read(16);
+            if (header.size() < 8)
+                return moovFound;
+            quint64 size = readU32(header, 0);
+            QByteArray type = header.mid(4, 4);
+            int headerSize = 8;
+            if (size == 1)
+            {
+                size = readU64(header, 8);
+                headerSize = 16;
+            }
+            else if (size == 0)
+                size = end - pos;
+            //compared unsigned: 64-bit size above INT64_MAX would turn negative and never move pos
+            if (size < quint64(headerSize) || size > quint64(end - pos))
+                return moovFound;
+
+            if (depth == 0 && type == "ftyp")
+                result.container = "mp4";
+            if (isContainerBox(type))
+            {
+                TrackInfo trak;
+                TrackInfo &current = type == "trak" ? trak : track;
+                parseBoxes(file, pos + headerSize, pos + qint64(size), depth + 1, current, result, hasVideo);
+                if (type == "trak")
+                    finishTrack(trak, result, hasVideo);
+                if (type == "moov")
+                    moovFound = true;
+            }
+            else if (isLeafBoxNeeded(type) && size - headerSize <= MEDIA_PROBE_MAX_BOX_SIZE)
+            {
+                file.seek(pos + headerSize);
+                parseLeafBox(type, file.read(qint64(size) - headerSize), track);
+            }
+            pos += qint64(size);
+            //moov is all we need, mdat after it is never read
+            if (depth == 0 && moovFound)
+                break;
+        }
+        return moovFound;
+    }
+}
+
+MediaProbe::MediaProbe(QObject *parent) : QObject(parent)
+{
+    load();
+}
+
+MediaInfo MediaProbe::probe(const QString &fileName, const QString &fileHash)
+{
+    {
+        QReadLocker locker(&lock);
+        if (!fileHash.isEmpty() && cache.contains(fileHash))
+            return cache[fileHash];
+    }
+    MediaInfo info = probeFile(fileName);
+    qDebug() << "MediaProbe::probe" << fileName << info.container << info.codec << info.width << "x" << info.height
+             << "@" << info.frameRate << "level" << info.level << "->" << info.supportName();
+    if (!fileHash.isEmpty())
+    {
+        QWriteLocker locker(&lock);
+        cache[fileHash] = info;
+        save();
+    }
+    return info;
+}
+
+bool MediaProbe::isCached(const QString &fileHash) const
+{
+    QReadLocker locker(&lock);
+    return cache.contains(fileHash);
+}
+
+MediaInfo MediaProbe::probeFile(const QString &fileName)
+{
+    MediaInfo result;
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return result;
+
+    TrackInfo rootTrack;
+    bool hasVideo = false;
+    if (!parseBoxes(file, 0, file.size(), 0, rootTrack, result, hasVideo) || result.container.isEmpty())
+    {
+        //not mp4 (or broken one) - nothing is known, decoder will decide
+        result = MediaInfo();
+        return result;
+    }
+    //audio only file
+    if (!hasVideo)
+        result.codec = "";
+    result.support = classify(result);
+    return result;
+}
+
+MediaInfo::Support MediaProbe::classify(const MediaInfo &info)
+{
+    if (info.codec.isEmpty())
+        return MediaInfo::UNKNOWN;
+    //rotated video has width/height swapped in decoder terms
+    int longSide = qMax(info.width, info.height);
+    int shortSide = qMin(info.width, info.height);
+    for (size_t i = 0; i < sizeof(capabilityTable) / sizeof(capabilityTable[0]); ++i)
+    {
+        const MediaCapability &c = capabilityTable[i];
+        if (info.codec != QLatin1String(c.codec))
+            continue;
+        if (longSide <= c.maxWidth && shortSide <= c.maxHeight &&
+            info.frameRate <= c.maxFrameRate + 0.5 &&
+            (c.maxLevel == 0 || info.level <= c.maxLevel) &&
+            info.bitDepth <= c.maxBitDepth)
+            return c.hardware ? MediaInfo::HARDWARE : MediaInfo::SOFTWARE;
+    }
+    return MediaInfo::UNSUPPORTED;
+}
+
+void MediaProbe::load()
+{
+    QFile f(CONFIG_FOLDER + MEDIA_PROBE_CACHE_FILE);
+    if (!f.open(QFile::ReadOnly))
+        return;
+    QJsonObject root = QJsonDocument::fromJson(f.readAll()).object();
+    foreach (const QString &hash, root.keys())
+    {
+        QJsonObject o = root[hash].toObject();
+        MediaInfo info;
+        info.container = o["container"].toString();
+        info.codec = o["codec"].toString();
+        info.profile = o["profile"].toInt();
+        info.level = o["level"].toInt();
+        info.bitDepth = o["bit_depth"].toInt();
+        info.width = o["width"].toInt();
+        info.height = o["height"].toInt();
+        info.frameRate = o["frame_rate"].toDouble();
+        info.duration = qint64(o["duration"].toDouble());
+        //capability table can change with new build, so class is not stored
+        info.support = info.container.isEmpty() ? MediaInfo::UNKNOWN : classify(info);
+        cache[hash] = info;
+    }
+}
+
+void MediaProbe::save()
+{
+    QJsonObject root;
+    for (auto it = cache.constBegin(); it != cache.constEnd(); ++it)
+    {
+        QJsonObject o;
+        o["container"] = it.value().container;
+        o["codec"] = it.value().codec;
+        o["profile"] = it.value().profile;
+        o["level"] = it.value().level;
+        o["bit_depth"] = it.value().bitDepth;
+        o["width"] = it.value().width;
+        o["height"] = it.value().height;
+        o["frame_rate"] = it.value().frameRate;
+        o["duration"] = double(it.value().duration);
+        root[it.key()] = o;
+    }
+    QFile f(CONFIG_FOLDER + MEDIA_PROBE_CACHE_FILE);
+    if (f.open(QFile::WriteOnly))
+        f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
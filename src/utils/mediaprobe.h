@@ -0,0 +1,60 @@
+#ifndef MEDIAPROBE_H
+#define MEDIAPROBE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QReadWriteLock>
+#include "singleton.h"
+
+#define MediaProbeInstance Singleton<MediaProbe>::instance()
+
+//result of container/codec header parsing
+struct MediaInfo
+{
+    MediaInfo();
+    enum Support {UNKNOWN, HARDWARE, SOFTWARE, UNSUPPORTED};
+
+    QString container;
+    //normalized sample entry fourcc: avc1, hvc1, vp09, av01, mp4v
+    QString codec;
+    int profile;
+    //as stored in codec config (h264: 42 = 4.2, hevc: 30 * level)
+    int level;
+    int bitDepth;
+    int width;
+    int height;
+    double frameRate;
+    qint64 duration;
+    Support support;
+
+    bool canPlay() const {return support != UNSUPPORTED;}
+    QString supportName() const;
+};
+
+//native mp4 box parser + device capability table
+//probing reads only box headers and codec configs, mdat is skipped
+//results are cached per file hash in CONFIG_FOLDER, so every file is probed once
+//can be called from downloader thread
+class MediaProbe : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MediaProbe(QObject *parent = 0);
+
+    //uses cached result if file with this hash was probed already
+    MediaInfo probe(const QString &fileName, const QString &fileHash);
+    bool isCached(const QString &fileHash) const;
+
+    static MediaInfo probeFile(const QString &fileName);
+    static MediaInfo::Support classify(const MediaInfo &info);
+
+private:
+    void load();
+    void save();
+
+    QHash<QString, MediaInfo> cache;
+    mutable QReadWriteLock lock;
+};
+
+#endif // MEDIAPROBE_H
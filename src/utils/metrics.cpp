@@ -0,0 +1,170 @@
+#include <QMutexLocker>
+#include "metrics.h"
+
+MetricHistogram::MetricHistogram(const QVector<qint64> &bounds) :
+    bounds(bounds), count(0), sum(0)
+{
+    buckets = new QAtomicInteger<qint64>[bounds.count() + 1];
+    for (int i = 0; i <= bounds.count(); i++)
+        buckets[i].store(0);
+}
+
+MetricHistogram::~MetricHistogram()
+{
+    delete [] buckets;
+}
+
+void MetricHistogram::observe(qint64 value)
+{
+    int index = 0;
+    //few buckets, linear search is faster than binary one here
+    while (index < bounds.count() && value > bounds[index])
+        index++;
+    buckets[index].fetchAndAddRelaxed(1);
+    count.fetchAndAddRelaxed(1);
+    sum.fetchAndAddRelaxed(value);
+}
+
+MetricsRegistry::MetricsRegistry(QObject *parent) : QObject(parent)
+{
+
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+    foreach (const Metric &m, metrics)
+    {
+        if (m.type == COUNTER)
+            delete static_cast<MetricCounter*>(m.metric);
+        else if (m.type == GAUGE)
+            delete static_cast<MetricGauge*>(m.metric);
+        else
+            delete static_cast<MetricHistogram*>(m.metric);
+    }
+}
+
+MetricsRegistry::Metric * MetricsRegistry::find(const QString &name)
+{
+    for (int i = 0; i < metrics.count(); i++)
+        if (metrics[i].name == name)
+            return &metrics[i];
+    return 0;
+}
+
+MetricCounter * MetricsRegistry::counter(const QString &name, const QString &help)
+{
+    QMutexLocker locker(&lock);
+    Metric * existing = find(name);
+    if (existing)
+        return existing->type == COUNTER ? static_cast<MetricCounter*>(existing->metric) : 0;
+    Metric m;
+    m.name = name;
+    m.help = help;
+    m.type = COUNTER;
+    m.metric = new MetricCounter();
+    metrics.append(m);
+    return static_cast<MetricCounter*>(m.metric);
+}
+
+MetricGauge * MetricsRegistry::gauge(const QString &name, const QString &help)
+{
+    QMutexLocker locker(&lock);
+    Metric * existing = find(name);
+    if (existing)
+        return existing->type == GAUGE ? static_cast<MetricGauge*>(existing->metric) : 0;
+    Metric m;
+    m.name = name;
+    m.help = help;
+    m.type = GAUGE;
+    m.metric = new MetricGauge();
+    metrics.append(m);
+    return static_cast<MetricGauge*>(m.metric);
+}
+
+MetricHistogram * MetricsRegistry::histogram(const QString &name, const QString &help, const QVector<qint64> &bounds)
+{
+    QMutexLocker locker(&lock);
+    Metric * existing = find(name);
+    if (existing)
+        return existing->type == HISTOGRAM ? static_cast<MetricHistogram*>(existing->metric) : 0;
+    Metric m;
+    m.name = name;
+    m.help = help;
+    m.type = HISTOGRAM;
+    m.metric = new MetricHistogram(bounds);
+    metrics.append(m);
+    return static_cast<MetricHistogram*>(m.metric);
+}
+
+void MetricsRegistry::addCollector(std::function<void (QByteArray &)> collector)
+{
+    QMutexLocker locker(&lock);
+    collectors.append(collector);
+}
+
+QByteArray MetricsRegistry::exportText()
+{
+    QList<Metric> metrics;
+    QList<std::function<void(QByteArray &)> > collectors;
+    {
+        QMutexLocker locker(&lock);
+        metrics = this->metrics;
+        collectors = this->collectors;
+    }
+
+    QByteArray out;
+    out.reserve(4096);
+    foreach (const Metric &m, metrics)
+    {
+        if (m.type == COUNTER)
+        {
+            writeHeader(out, m.name, m.help, "counter");
+            writeValue(out, m.name, static_cast<MetricCounter*>(m.metric)->get());
+        }
+        else if (m.type == GAUGE)
+        {
+            writeHeader(out, m.name, m.help, "gauge");
+            writeValue(out, m.name, static_cast<MetricGauge*>(m.metric)->get());
+        }
+        else
+        {
+            MetricHistogram * h = static_cast<MetricHistogram*>(m.metric);
+            writeHeader(out, m.name, m.help, "histogram");
+            qint64 cumulative = 0;
+            for (int i = 0; i < h->getBounds().count(); i++)
+            {
+                cumulative += h->getBucket(i);
+                writeValue(out, m.name + "_bucket", cumulative, "le=\"" + QString::number(h->getBounds()[i]) + "\"");
+            }
+            cumulative += h->getBucket(h->getBounds().count());
+            writeValue(out, m.name + "_bucket", cumulative, "le=\"+Inf\"");
+            writeValue(out, m.name + "_sum", h->getSum());
+            //count is read separately, so it is taken from buckets to keep them consistent
+            writeValue(out, m.name + "_count", cumulative);
+        }
+    }
+    foreach (const std::function<void(QByteArray &)> &collector, collectors)
+        collector(out);
+    return out;
+}
+
+void MetricsRegistry::writeHeader(QByteArray &out, const QString &name, const QString &help, const char *type)
+{
+    out += "# HELP " + name.toLatin1() + " " + help.toUtf8() + "\n";
+    out += "# TYPE " + name.toLatin1() + " " + type + "\n";
+}
+
+void MetricsRegistry::writeValue(QByteArray &out, const QString &name, qint64 value, const QString &labels)
+{
+    out += name.toLatin1();
+    if (!labels.isEmpty())
+        out += "{" + labels.toUtf8() + "}";
+    out += " " + QByteArray::number(value) + "\n";
+}
+
+QString MetricsRegistry::escapeLabel(const QString &value)
+{
+    QString result = value;
+    result.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n");
+    return result;
+}
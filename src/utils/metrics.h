@@ -0,0 +1,114 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
+#include <QList>
+#include <functional>
+#include "singleton.h"
+
+#define MetricsInstance Singleton<MetricsRegistry>::instance()
+
+//default buckets for durations in msecs
+#define METRICS_DURATION_BUCKETS {1, 5, 10, 25, 50, 100, 250, 500, 1000, 5000}
+
+//metric values are plain atomics, so hot paths never lock and never allocate
+//metrics are created once (under lock) and live until exit, so callers keep pointers:
+//    static MetricCounter * bytes = MetricsInstance.counter("teleds_download_bytes_total", "...");
+//    bytes->add(size);
+//text is built only when /metrics is requested
+class MetricCounter
+{
+public:
+    MetricCounter() : value(0) {}
+    void add(qint64 delta = 1) {value.fetchAndAddRelaxed(delta);}
+    qint64 get() const {return value.load();}
+private:
+    QAtomicInteger<qint64> value;
+};
+
+class MetricGauge
+{
+public:
+    MetricGauge() : value(0) {}
+    void set(qint64 v) {value.store(v);}
+    void add(qint64 delta) {value.fetchAndAddRelaxed(delta);}
+    qint64 get() const {return value.load();}
+private:
+    QAtomicInteger<qint64> value;
+};
+
+class MetricHistogram
+{
+public:
+    //bounds are upper limits of buckets, +Inf bucket is added
+    explicit MetricHistogram(const QVector<qint64> &bounds);
+    ~MetricHistogram();
+    void observe(qint64 value);
+
+    const QVector<qint64> &getBounds() const {return bounds;}
+    qint64 getBucket(int index) const {return buckets[index].load();}
+    qint64 getCount() const {return count.load();}
+    qint64 getSum() const {return sum.load();}
+private:
+    QVector<qint64> bounds;
+    //not cumulative, bounds.count() + 1 items
+    QAtomicInteger<qint64> * buckets;
+    QAtomicInteger<qint64> count;
+    QAtomicInteger<qint64> sum;
+};
+
+//observes elapsed msecs on destruction
+class MetricTimer
+{
+public:
+    explicit MetricTimer(MetricHistogram * histogram) : histogram(histogram) {timer.start();}
+    ~MetricTimer() {histogram->observe(timer.elapsed());}
+private:
+    MetricHistogram * histogram;
+    QElapsedTimer timer;
+};
+
+class MetricsRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsRegistry(QObject *parent = 0);
+    ~MetricsRegistry();
+
+    //returns existing metric if name is already registered
+    MetricCounter * counter(const QString &name, const QString &help);
+    MetricGauge * gauge(const QString &name, const QString &help);
+    MetricHistogram * histogram(const QString &name, const QString &help, const QVector<qint64> &bounds = METRICS_DURATION_BUCKETS);
+
+    //collector appends its own lines in exposition format, called on every scrape
+    //use it for values which already live somewhere else (GlobalStats report etc)
+    void addCollector(std::function<void(QByteArray &out)> collector);
+
+    //prometheus text exposition format 0.0.4
+    QByteArray exportText();
+
+    static void writeHeader(QByteArray &out, const QString &name, const QString &help, const char * type);
+    static void writeValue(QByteArray &out, const QString &name, qint64 value, const QString &labels = QString());
+    static QString escapeLabel(const QString &value);
+
+private:
+    enum Type {COUNTER, GAUGE, HISTOGRAM};
+    struct Metric
+    {
+        QString name;
+        QString help;
+        Type type;
+        void * metric;
+    };
+    Metric * find(const QString &name);
+
+    QMutex lock;
+    QList<Metric> metrics;
+    QList<std::function<void(QByteArray &)> > collectors;
+};
+
+#endif // METRICS_H
@@ -1,6 +1,9 @@
 #include "globalstats.h"
 #include "singleton.h"
 #include "playlist.h"
+#include "idregistry.h"
+#include "metrics.h"
+#include "logger.h"
 
 AbstractPlaylist::AbstractPlaylist(QObject *parent) : QObject(parent)
 {
@@ -12,6 +15,7 @@ SuperPlaylist::SuperPlaylist(QObject *parent) : AbstractPlaylist(parent)
     magic = 1;
     currentItemIndex = -1;
     lastFreeFloatingItemPlayedIndex = -1;
+    lastPlayed = EMPTY_ID_HANDLE;
 }
 
 void SuperPlaylist::updatePlaylist(const PlayerConfigAPI::Campaign::Area &playlist)
@@ -24,15 +28,22 @@ void SuperPlaylist::updatePlaylist(const PlayerConfigAPI::Campaign::Area &playli
     minPlayTime = QDateTime::currentDateTimeUtc();
     //calculating total play time
     items.clear();
+    itemIndex.fill(-1, IdRegistryInstance.count());
     int maxTimeout = 0;
 
     foreach (const PlayerConfigAPI::Campaign::Area::Content &item, playlist.content)
     {
         allLength += item.duration;
-        items[item.content_id] = item;
+        if (itemIndex[item.content_handle] < 0)
+        {
+            itemIndex[item.content_handle] = items.count();
+            items.append(item);
+        }
+        else
+            items[itemIndex[item.content_handle]] = item;
         if (item.play_timeout > maxTimeout)
             maxTimeout = item.play_timeout;
-        GlobalStatsInstance.setItemPlayTimeout(item.content_id, item.play_timeout);
+        GlobalStatsInstance.setItemPlayTimeout(item.content_handle, item.play_timeout);
     }
 
     minPlayTime = minPlayTime.addMSecs(-allLength);
@@ -50,12 +61,12 @@ void SuperPlaylist::updatePlaylist(const PlayerConfigAPI::Campaign::Area &playli
     }
     foreach (const PlayerConfigAPI::Campaign::Area::Content &item, shuffledPlaylist)
     {
-        if (!GlobalStatsInstance.itemWasPlayed(item.area_id, item.content_id))
+        if (!GlobalStatsInstance.itemWasPlayed(item.area_handle, item.content_handle))
         {
             QDateTime itemFakePlayTime = QDateTime::currentDateTimeUtc().addSecs(GlobalStatsInstance.getUTCOffset());
-            qDebug() << "itemFakePlayTime" << itemFakePlayTime << "| "<< QDateTime::currentDateTimeUtc();
+            TLOG(LOG_DEBUG, LOG_PLAYLIST) << "itemFakePlayTime" << itemFakePlayTime << "| "<< QDateTime::currentDateTimeUtc();
             itemFakePlayTime = itemFakePlayTime.addMSecs(-qrand()%(item.play_timeout*1000+1) - item.play_timeout*400);
-            GlobalStatsInstance.itemPlayed(item.area_id,item.content_id,itemFakePlayTime);
+            GlobalStatsInstance.itemPlayed(item.area_handle,item.content_handle,itemFakePlayTime);
             tempTime += item.duration;
         }
     }
@@ -65,22 +76,22 @@ void SuperPlaylist::updatePlaylist(const PlayerConfigAPI::Campaign::Area &playli
 
 QString SuperPlaylist::next()
 {
-    qDebug() << "SuperPlaylist::next";
-    qDebug() << "forceItemscount = " <<forceItems.count();
+    static MetricHistogram * nextTime = MetricsInstance.histogram("teleds_playlist_next_duration_ms", "Time of next item selection in SuperPlaylist");
+    MetricTimer timer(nextTime);
+    TLOG(LOG_DEBUG, LOG_PLAYLIST) << "SuperPlaylist::next forceItemscount = " << forceItems.count();
     if (forceItems.count())
     {
         QString itemName = forceItems.first();
         forceItems.removeFirst();
-        foreach (const QString &k, items.keys())
+        quint32 handle = IdRegistryInstance.find(itemName);
+        //undecodable forced item is replaced by regular selection
+        if (handle != EMPTY_ID_HANDLE && int(handle) < itemIndex.count() && itemIndex[handle] >= 0 &&
+            GlobalStatsInstance.isItemDecodable(handle))
         {
-            auto item = items[k];
-            if (item.content_id == itemName)
-            {
-                if (GlobalStatsInstance.isItemActivated(item.content_id))
-                    return item.content_id;
-                else
-                    return "";
-            }
+            if (GlobalStatsInstance.isItemActivated(handle))
+                return itemName;
+            else
+                return "";
         }
     }
 
@@ -100,13 +111,12 @@ QString SuperPlaylist::next()
 
     currentItemIndex = 0;
     auto realCurrentTime = QDateTime::currentDateTimeUtc().addSecs(GlobalStatsInstance.getUTCOffset());
-    qDebug() << "start next: " << QDateTime::currentDateTimeUtc().time();
     //shuffle(true, false);
     std::sort(normalFloatingItems.begin(), normalFloatingItems.end(),
               [&, this](const PlayerConfigAPI::Campaign::Area::Content &a, const PlayerConfigAPI::Campaign::Area::Content &b)
               {
-                  int aLastPlayed = std::ceil(minPlayTime.secsTo(GlobalStatsInstance.getItemLastPlayDate(a.area_id, a.content_id)) / magic);
-                  int bLastPlayed = std::ceil(minPlayTime.secsTo(GlobalStatsInstance.getItemLastPlayDate(b.area_id, b.content_id)) / magic);
+                  int aLastPlayed = std::ceil(minPlayTime.secsTo(GlobalStatsInstance.getItemLastPlayDate(a.area_handle, a.content_handle)) / magic);
+                  int bLastPlayed = std::ceil(minPlayTime.secsTo(GlobalStatsInstance.getItemLastPlayDate(b.area_handle, b.content_handle)) / magic);
                   if (aLastPlayed == bLastPlayed)
                       return a.play_timeout > b.play_timeout;
                   else
@@ -118,20 +128,21 @@ QString SuperPlaylist::next()
     for (int i = 0; i < normalFloatingItems.count(); i++)
     {
         PlayerConfigAPI::Campaign::Area::Content item = normalFloatingItems[i];
-        if (GlobalStatsInstance.checkDelayPass(playlist.area_id, item.content_id, realCurrentTime) && item.checkTimeTargeting() && item.checkDateRange() &&
-            item.checkGeoTargeting(currentGps) && GlobalStatsInstance.isItemActivated(item.content_id))
+        if (GlobalStatsInstance.checkDelayPass(playlist.area_handle, item.content_handle, realCurrentTime) && item.checkTimeTargeting() && item.checkDateRange() &&
+            item.checkGeoTargeting(currentGps) && GlobalStatsInstance.isItemActivated(item.content_handle) &&
+            GlobalStatsInstance.isItemDecodable(item.content_handle))
         {
-            qDebug() << "Next Item is " << item.name;
+            TLOG(LOG_INFO, LOG_PLAYLIST) << "Next Item is " << item.name;
             QDateTime delayPassTime = QDateTime::currentDateTimeUtc().addSecs(GlobalStatsInstance.getUTCOffset() - 7);
-            GlobalStatsInstance.itemPlayed(playlist.area_id,item.content_id,delayPassTime);
+            GlobalStatsInstance.itemPlayed(playlist.area_handle,item.content_handle,delayPassTime);
 
             bool dontPlayItem = false;
             QDateTime d = GlobalStatsInstance.getCampaignEndDate();
             if (d.isValid())
             {
                 QDateTime cd = QDateTime::currentDateTimeUtc();
-                if (lastPlayed != "")
-                    cd = cd.addMSecs(findItemById(lastPlayed).duration);
+                if (lastPlayed != EMPTY_ID_HANDLE)
+                    cd = cd.addMSecs(findItemByHandle(lastPlayed).duration);
                 cd = cd.addMSecs(item.duration);
                 if (cd > d)
                     dontPlayItem = true;
@@ -140,33 +151,27 @@ QString SuperPlaylist::next()
             dontPlayItem = false;
             if (!dontPlayItem)
             {
-                lastPlayed = item.content_id;
+                lastPlayed = item.content_handle;
                 return item.content_id;
             }
             else
             {
-                qDebug() << "item cannot be played. Returning nothing! ";
-
-                qDebug() << QDateTime::currentDateTime().time();
+                TLOG(LOG_DEBUG, LOG_PLAYLIST) << "item cannot be played. Returning nothing! ";
                 return "";
             }
         }
     }
 
-    qDebug() << "SuperPlaylist::cant find proper item with normal/floating type. Trying to search in floating-free list("
+    TLOG(LOG_DEBUG, LOG_PLAYLIST) << "SuperPlaylist::cant find proper item with normal/floating type. Trying to search in floating-free list("
                 + QString::number(floatingFreeItems.count()) + ")";
     QString freeItemResult = nextFreeItem();
     if (freeItemResult.isEmpty())
     {
-        lastPlayed = "";
-
-        qDebug() << QDateTime::currentDateTime().time();
+        lastPlayed = EMPTY_ID_HANDLE;
         return "";
     }
     else
     {
-
-        qDebug() << QDateTime::currentDateTime().time();
         return freeItemResult;
     }
 }
@@ -179,9 +184,13 @@ bool SuperPlaylist::haveNext()
 
 PlayerConfigAPI::Campaign::Area::Content SuperPlaylist::findItemById(QString id)
 {
-    foreach (const PlayerConfigAPI::Campaign::Area::Content &content, items)
-        if (content.content_id == id)
-            return content;
+    return findItemByHandle(IdRegistryInstance.find(id));
+}
+
+PlayerConfigAPI::Campaign::Area::Content SuperPlaylist::findItemByHandle(quint32 handle)
+{
+    if (handle != EMPTY_ID_HANDLE && int(handle) < itemIndex.count() && itemIndex[handle] >= 0)
+        return items[itemIndex[handle]];
     PlayerConfigAPI::Campaign::Area::Content emptyItem;
     return emptyItem;
 }
@@ -191,7 +200,7 @@ void SuperPlaylist::resetCurrentItemIndex()
     qDebug() << this->playlist.area_id;
     currentItemIndex = -1;
     lastFreeFloatingItemPlayedIndex = -1;
-    lastPlayed = "";
+    lastPlayed = EMPTY_ID_HANDLE;
 }
 
 void SuperPlaylist::splitItems()
@@ -234,12 +243,12 @@ QString SuperPlaylist::nextFreeItem()
     for (int i = lastFreeFloatingItemPlayedIndex; i < floatingFreeItems.count(); i++)
     {
         auto item = floatingFreeItems[i];
-        if (GlobalStatsInstance.isItemActivated(item.content_id) && item.checkTimeTargeting() && item.checkDateRange() && (indexReseted ? true : lastPlayed != item.content_id) &&
+        if (GlobalStatsInstance.isItemActivated(item.content_handle) && GlobalStatsInstance.isItemDecodable(item.content_handle) && item.checkTimeTargeting() && item.checkDateRange() && (indexReseted ? true : lastPlayed != item.content_handle) &&
             item.checkGeoTargeting(currentGps))
         {
             qDebug() << "Next Item is " << item.name;
             QDateTime delayPassTime = QDateTime::currentDateTimeUtc().addSecs(GlobalStatsInstance.getUTCOffset() - 7);
-            GlobalStatsInstance.itemPlayed(playlist.area_id,item.content_id,delayPassTime);
+            GlobalStatsInstance.itemPlayed(playlist.area_handle,item.content_handle,delayPassTime);
 
             lastFreeFloatingItemPlayedIndex = i;
 
@@ -248,8 +257,8 @@ QString SuperPlaylist::nextFreeItem()
             if (d.isValid())
             {
                 QDateTime cd = QDateTime::currentDateTimeUtc();
-                if (lastPlayed != "")
-                    cd = cd.addMSecs(findItemById(lastPlayed).duration);
+                if (lastPlayed != EMPTY_ID_HANDLE)
+                    cd = cd.addMSecs(findItemByHandle(lastPlayed).duration);
                 cd = cd.addMSecs(item.duration);
                 if (cd > d.addMSecs(5000))
                     dontPlayItem = true;
@@ -258,7 +267,7 @@ QString SuperPlaylist::nextFreeItem()
             dontPlayItem = false;
             if (!dontPlayItem)
             {
-                lastPlayed = item.content_id;
+                lastPlayed = item.content_handle;
                 return item.content_id;
             }
             else
@@ -24,6 +24,7 @@ public:
     virtual void updatePlaylist(const PlayerConfigAPI::Campaign::Area &playlist)=0;
     virtual QString getType()=0;
     virtual PlayerConfigAPI::Campaign::Area::Content findItemById(QString iid)=0;
+    virtual PlayerConfigAPI::Campaign::Area::Content findItemByHandle(quint32 handle)=0;
     QStringList forceItems;
 public slots:
     virtual QString next()=0;
@@ -44,6 +45,7 @@ public:
 
     virtual bool haveNext();
     virtual PlayerConfigAPI::Campaign::Area::Content findItemById(QString id);
+    virtual PlayerConfigAPI::Campaign::Area::Content findItemByHandle(quint32 handle);
     virtual QString getType() {return "random";}
     virtual QString getStoredItem() {return storedNextItem;}
     void resetCurrentItemIndex();
@@ -63,9 +65,11 @@ protected:
 
     QList<PlayerConfigAPI::Campaign::Area::Content> normalFloatingItems;
     QList<PlayerConfigAPI::Campaign::Area::Content> floatingFreeItems;
-    QHash<QString,PlayerConfigAPI::Campaign::Area::Content> items;
+    QVector<PlayerConfigAPI::Campaign::Area::Content> items;
+    //content handle -> index in items, -1 if item is not in this playlist
+    QVector<int> itemIndex;
     QHash<QString,QDateTime> lastTimeShowed;
-    QString lastPlayed; int lastFreeFloatingItemPlayedIndex;
+    quint32 lastPlayed; int lastFreeFloatingItemPlayedIndex;
 };
 
 #endif // RANDOMPLAYLIST_H
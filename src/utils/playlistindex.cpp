@@ -0,0 +1,24 @@
+#include "playlistindex.h"
+#include "idregistry.h"
+
+void PlaylistIndex::clear()
+{
+    areas.clear();
+    playlists.fill(0, IdRegistryInstance.count());
+}
+
+void PlaylistIndex::addArea(const PlayerConfigAPI::Campaign::Area &area, AbstractPlaylist *playlist)
+{
+    areas[area.area_id] = area;
+    foreach (const PlayerConfigAPI::Campaign::Area::Content &item, area.content)
+    {
+        if (int(item.content_handle) >= playlists.count())
+            playlists.resize(item.content_handle + 1);
+        playlists[item.content_handle] = playlist;
+    }
+}
+
+AbstractPlaylist *PlaylistIndex::playlist(quint32 contentHandle) const
+{
+    return int(contentHandle) < playlists.count() ? playlists[contentHandle] : 0;
+}
@@ -0,0 +1,29 @@
+#ifndef PLAYLISTINDEX_H
+#define PLAYLISTINDEX_H
+
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include "videoserviceresult.h"
+
+class AbstractPlaylist;
+
+//player lookup indexes: area id -> area, content handle -> owning playlist
+//rebuilt together with playlists, so every lookup is one hash or array access
+class PlaylistIndex
+{
+public:
+    PlaylistIndex(){;}
+    void clear();
+    void addArea(const PlayerConfigAPI::Campaign::Area &area, AbstractPlaylist * playlist);
+    //empty area if id is unknown
+    PlayerConfigAPI::Campaign::Area area(const QString &id) const {return areas.value(id);}
+    //0 if no area contains item
+    AbstractPlaylist * playlist(quint32 contentHandle) const;
+
+private:
+    QHash<QString, PlayerConfigAPI::Campaign::Area> areas;
+    QVector<AbstractPlaylist*> playlists;
+};
+
+#endif // PLAYLISTINDEX_H
@@ -1,5 +1,6 @@
 #include "playlistmanager.h"
 #include "platformdefines.h"
+#include "zipcontentserver.h"
 #include <QFileInfo>
 
 PlaylistManager::PlaylistManager(QObject *parent) : QObject(parent)
@@ -82,10 +83,7 @@ QString PlaylistItem::getFullPath()
     else if (content.type == "html5_online")
         return content.file_url;
     else if (content.type == "html5_zip")
-    {
-        QFileInfo info(VIDEO_FOLDER + content.content_id + "/index.html");
-        return QUrl::fromLocalFile(info.absoluteFilePath()).toString();
-    }
+        return ZipContentServer::contentUrl(content.content_id + content.file_hash + content.file_extension);
     //unknown content type
     return "";
     /*
@@ -0,0 +1,553 @@
+#include <QDebug>
+#include "playliststreamparser.h"
+#include "globalconfig.h"
+#include "globalstats.h"
+#include "singleton.h"
+#include "idregistry.h"
+
+static QString jsonString(const QVariant &v)
+{
+    return v.type() == QVariant::String ? v.toString() : QString();
+}
+
+static int jsonInt(const QVariant &v)
+{
+    return v.type() == QVariant::Double ? int(v.toDouble()) : 0;
+}
+
+static double jsonDouble(const QVariant &v)
+{
+    return v.type() == QVariant::Double ? v.toDouble() : 0.;
+}
+
+static bool jsonBool(const QVariant &v)
+{
+    return v.type() == QVariant::Bool ? v.toBool() : false;
+}
+
+static QDateTime jsonTime(const QVariant &v)
+{
+    if (!v.isValid())
+        return QDateTime();
+    return QDateTime::fromString(jsonString(v), "yyyy-MM-dd HH:mm:ss");
+}
+
+JsonStreamReader::JsonStreamReader(JsonStreamHandler *handler)
+{
+    this->handler = handler;
+    reset();
+}
+
+void JsonStreamReader::reset()
+{
+    state = NORMAL;
+    token.clear();
+    unicodeDigits.clear();
+    highSurrogate = 0;
+    containers.clear();
+    expectKey = false;
+    finished = false;
+    error.clear();
+}
+
+bool JsonStreamReader::feed(const QByteArray &chunk)
+{
+    const char * data = chunk.constData();
+    int size = chunk.size();
+    for (int i = 0; i < size && error.isEmpty(); ++i)
+        processChar(data[i]);
+    return error.isEmpty();
+}
+
+void JsonStreamReader::processChar(char c)
+{
+    switch (state)
+    {
+    case STRING:
+        if (c == '"')
+            finishString();
+        else if (c == '\\')
+            state = STRING_ESCAPE;
+        else
+            token.append(c);
+        return;
+    case STRING_ESCAPE:
+        state = STRING;
+        switch (c)
+        {
+        case 'n': token.append('\n'); break;
+        case 't': token.append('\t'); break;
+        case 'r': token.append('\r'); break;
+        case 'b': token.append('\b'); break;
+        case 'f': token.append('\f'); break;
+        case 'u':
+            unicodeDigits.clear();
+            state = STRING_UNICODE;
+            break;
+        default: token.append(c); break;
+        }
+        return;
+    case STRING_UNICODE:
+        unicodeDigits.append(c);
+        if (unicodeDigits.size() == 4)
+        {
+            bool ok;
+            ushort code = unicodeDigits.toUShort(&ok, 16);
+            if (!ok)
+                setError("invalid unicode escape");
+            else
+                appendUnicode(code);
+            state = STRING;
+        }
+        return;
+    case NUMBER:
+        if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')
+        {
+            token.append(c);
+            return;
+        }
+        finishNumber();
+        break;
+    case LITERAL:
+        if (c >= 'a' && c <= 'z')
+        {
+            token.append(c);
+            return;
+        }
+        finishLiteral();
+        break;
+    default:
+        break;
+    }
+
+    if (!error.isEmpty())
+        return;
+    if (finished)
+    {
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            setError("unexpected data after document end");
+        return;
+    }
+
+    switch (c)
+    {
+    case ' ': case '\n': case '\r': case '\t':
+        break;
+    case '{':
+        containers.append('o');
+        expectKey = true;
+        handler->startObject();
+        break;
+    case '[':
+        containers.append('a');
+        expectKey = false;
+        handler->startArray();
+        break;
+    case '}':
+    case ']':
+        if (containers.isEmpty() || containers.at(containers.size() - 1) != (c == '}' ? 'o' : 'a'))
+        {
+            setError("unbalanced brackets");
+            return;
+        }
+        containers.chop(1);
+        expectKey = false;
+        if (c == '}')
+            handler->endObject();
+        else
+            handler->endArray();
+        if (containers.isEmpty())
+            finished = true;
+        break;
+    case ',':
+        expectKey = !containers.isEmpty() && containers.at(containers.size() - 1) == 'o';
+        break;
+    case ':':
+        expectKey = false;
+        break;
+    case '"':
+        token.clear();
+        state = STRING;
+        break;
+    case 't': case 'f': case 'n':
+        token = QByteArray(1, c);
+        state = LITERAL;
+        break;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            token = QByteArray(1, c);
+            state = NUMBER;
+        }
+        else
+            setError(QString("unexpected character '%1'").arg(c));
+        break;
+    }
+}
+
+void JsonStreamReader::finishString()
+{
+    state = NORMAL;
+    //utf-8 sequences may be split between chunks so we decode only complete token
+    QString text = QString::fromUtf8(token);
+    token.clear();
+    if (expectKey)
+    {
+        expectKey = false;
+        handler->key(text);
+    }
+    else
+        handler->value(text);
+}
+
+void JsonStreamReader::finishNumber()
+{
+    state = NORMAL;
+    bool ok;
+    double number = token.toDouble(&ok);
+    token.clear();
+    if (!ok)
+        setError("invalid number");
+    else
+        handler->value(number);
+}
+
+void JsonStreamReader::finishLiteral()
+{
+    state = NORMAL;
+    if (token == "true")
+        handler->value(true);
+    else if (token == "false")
+        handler->value(false);
+    else if (token == "null")
+        handler->value(QVariant());
+    else
+        setError("invalid literal " + QString(token));
+    token.clear();
+}
+
+void JsonStreamReader::appendUnicode(ushort code)
+{
+    if (QChar::isHighSurrogate(code))
+    {
+        highSurrogate = code;
+        return;
+    }
+    QString text;
+    if (QChar::isLowSurrogate(code) && highSurrogate)
+        text.append(QChar(highSurrogate));
+    highSurrogate = 0;
+    text.append(QChar(code));
+    token.append(text.toUtf8());
+}
+
+void JsonStreamReader::setError(const QString &text)
+{
+    if (error.isEmpty())
+        error = text;
+}
+//---------------------------------------------------------------------
+
+PlaylistStreamParser::PlaylistStreamParser() : reader(this)
+{
+    config.error_id = 0;
+    config.currentCampaignId = 0;
+    baseRotation = 0;
+}
+
+void PlaylistStreamParser::reset()
+{
+    reader.reset();
+    stack.clear();
+    config = PlayerConfigAPI();
+    config.error_id = 0;
+    config.currentCampaignId = 0;
+    //same value for every campaign, so we do it once instead of per campaign
+    baseRotation = SettingsRequestResult::fromJson(GlobalConfigInstance.getSettings(), false).base_rotation;
+}
+
+bool PlaylistStreamParser::feed(const QByteArray &chunk)
+{
+    return reader.feed(chunk);
+}
+
+void PlaylistStreamParser::push(PlaylistStreamParser::Frame frame)
+{
+    StackItem item;
+    item.frame = frame;
+    stack.append(item);
+}
+
+void PlaylistStreamParser::startObject()
+{
+    if (stack.isEmpty())
+    {
+        push(ROOT);
+        return;
+    }
+    switch (top())
+    {
+    case CAMPAIGNS:
+        campaign = PlayerConfigAPI::Campaign();
+        campaign.play_order = campaign.duration = 0;
+        campaign.screen_width = campaign.screen_height = 0;
+        campaign.rotation = campaign.delay = 0;
+        campaignOrientation.clear();
+        push(CAMPAIGN);
+        break;
+    case AREAS:
+        area = PlayerConfigAPI::Campaign::Area();
+        area.x = area.y = area.width = area.height = 0;
+        area.screen_width = area.screen_height = area.z_index = 0;
+        area.opacity = area.area_volume = 0.;
+        area.sound_enabled = false;
+        push(AREA);
+        break;
+    case CONTENTS:
+        content = PlayerConfigAPI::Campaign::Area::Content();
+        content.play_order = content.play_timeout = content.rotate = 0;
+        content.duration = content.play_start = content.file_size = 0;
+        push(CONTENT);
+        break;
+    case CONTENT:
+        push(currentKey() == "time_targeting" ? TIME_TARGETING : SKIP);
+        break;
+    case GEO_AREA:
+        gpsPoint.latitude = gpsPoint.longitude = 0;
+        push(GEO_POINT);
+        break;
+    default:
+        push(SKIP);
+        break;
+    }
+}
+
+void PlaylistStreamParser::endObject()
+{
+    Frame frame = top();
+    if (!stack.isEmpty())
+        stack.removeLast();
+    switch (frame)
+    {
+    case CAMPAIGN:
+        campaign.campaign_handle = IdRegistryInstance.intern(campaign.campaign_id);
+        if (campaignOrientation == "landscape")
+            campaign.rotation = baseRotation;
+        else
+            campaign.rotation = -90 + baseRotation;
+        if (campaign.checkDateRange())
+            config.campaigns.append(campaign);
+        else
+            qDebug() << "Skipping campaign because of date";
+        campaign = PlayerConfigAPI::Campaign();
+        break;
+    case AREA:
+        area.area_handle = IdRegistryInstance.intern(area.area_id);
+        area.area_volume = area.sound_enabled ? 1.00 : 0.00;
+        qDebug() << "ARCC = " << area.area_id << " " << area.content.count();
+        campaign.areas.append(area);
+        area = PlayerConfigAPI::Campaign::Area();
+        break;
+    case CONTENT:
+        content.content_handle = IdRegistryInstance.intern(content.content_id);
+        content.area_handle = IdRegistryInstance.intern(content.area_id);
+        content.campaign_handle = IdRegistryInstance.intern(content.campaign_id);
+        area.content.append(content);
+        content = PlayerConfigAPI::Campaign::Area::Content();
+        break;
+    case GEO_POINT:
+        geoArea.append(gpsPoint);
+        geoPolygon.append(QPoint(gpsPoint.latitude, gpsPoint.longitude));
+        break;
+    default:
+        break;
+    }
+}
+
+void PlaylistStreamParser::startArray()
+{
+    Frame parent = stack.isEmpty() ? SKIP : top();
+    QString key = currentKey();
+    if (parent == ROOT && key == "campaigns")
+        push(CAMPAIGNS);
+    else if (parent == CAMPAIGN && key == "areas")
+        push(AREAS);
+    else if (parent == AREA && key == "content")
+        push(CONTENTS);
+    else if (parent == AREA && key == "priority_content")
+        push(PRIORITY_CONTENT);
+    else if (parent == TIME_TARGETING)
+    {
+        timeTargetingKey = key;
+        timeTargetingDay.clear();
+        push(TIME_TARGETING_DAY);
+    }
+    else if (parent == CONTENT && key == "geo_targeting")
+        push(GEO_TARGETING);
+    else if (parent == GEO_TARGETING)
+    {
+        geoArea.clear();
+        geoPolygon.clear();
+        push(GEO_AREA);
+    }
+    else
+        push(SKIP);
+}
+
+void PlaylistStreamParser::endArray()
+{
+    Frame frame = top();
+    if (!stack.isEmpty())
+        stack.removeLast();
+    switch (frame)
+    {
+    case TIME_TARGETING_DAY:
+        content.time_targeting[timeTargetingKey] = timeTargetingDay;
+        break;
+    case GEO_AREA:
+        if (!geoPolygon.isEmpty())
+            geoPolygon.append(geoPolygon.at(0));
+        content.geo_targeting.append(geoArea);
+        content.polygons.append(geoPolygon);
+        break;
+    default:
+        break;
+    }
+}
+
+void PlaylistStreamParser::key(const QString &key)
+{
+    if (!stack.isEmpty())
+        stack.last().key = key;
+}
+
+void PlaylistStreamParser::value(const QVariant &value)
+{
+    QString key = currentKey();
+    switch (top())
+    {
+    case ROOT:
+        if (key == "last_modified")
+            config.last_modified = jsonTime(value);
+        else if (key == "hash")
+            config.hash = jsonString(value);
+        else if (key == "error")
+            config.error = jsonString(value);
+        break;
+    case CAMPAIGN:
+        campaignValue(key, value);
+        break;
+    case AREA:
+        areaValue(key, value);
+        break;
+    case CONTENT:
+        contentValue(key, value);
+        break;
+    case PRIORITY_CONTENT:
+        qDebug() << "adding priority item " << jsonString(value);
+        GlobalStatsInstance.addPriorityItem(jsonString(value));
+        area.priority_content.append(jsonString(value));
+        break;
+    case TIME_TARGETING_DAY:
+        timeTargetingDay.append(jsonInt(value));
+        break;
+    case GEO_POINT:
+        if (key == "latitude")
+            gpsPoint.latitude = int(jsonDouble(value)*100000);
+        else if (key == "longitude")
+            gpsPoint.longitude = int(jsonDouble(value)*100000);
+        break;
+    default:
+        break;
+    }
+}
+
+void PlaylistStreamParser::campaignValue(const QString &key, const QVariant &value)
+{
+    if (key == "campaign_id")
+        campaign.campaign_id = jsonString(value);
+    else if (key == "duration")
+        campaign.duration = jsonInt(value);
+    else if (key == "start_timestamp")
+        campaign.start_timestamp = jsonTime(value);
+    else if (key == "end_timestamp")
+        campaign.end_timestamp = jsonTime(value);
+    else if (key == "play_order")
+        campaign.play_order = jsonInt(value);
+    else if (key == "width")
+        campaign.screen_width = jsonInt(value);
+    else if (key == "height")
+        campaign.screen_height = jsonInt(value);
+    else if (key == "content_spacing")
+        campaign.delay = jsonInt(value);
+    else if (key == "orientation")
+        campaignOrientation = jsonString(value);
+}
+
+void PlaylistStreamParser::areaValue(const QString &key, const QVariant &value)
+{
+    if (key == "area_id")
+        area.area_id = jsonString(value);
+    else if (key == "type")
+        area.type = jsonString(value);
+    else if (key == "campaign_height")
+        area.screen_height = jsonInt(value);
+    else if (key == "campaign_width")
+        area.screen_width = jsonInt(value);
+    else if (key == "x")
+        area.x = jsonInt(value);
+    else if (key == "y")
+        area.y = jsonInt(value);
+    else if (key == "width")
+        area.width = jsonInt(value);
+    else if (key == "height")
+        area.height = jsonInt(value);
+    else if (key == "opacity")
+        area.opacity = double(jsonInt(value))/100.;
+    else if (key == "z_index")
+        area.z_index = jsonInt(value);
+    else if (key == "sound_enabled")
+        area.sound_enabled = jsonBool(value);
+}
+
+void PlaylistStreamParser::contentValue(const QString &key, const QVariant &value)
+{
+    if (key == "campaign_id")
+        content.campaign_id = jsonString(value);
+    else if (key == "area_id")
+        content.area_id = jsonString(value);
+    else if (key == "content_id")
+        content.content_id = jsonString(value);
+    else if (key == "payment_type")
+        content.payment_type = jsonString(value);
+    else if (key == "play_order")
+        content.play_order = jsonInt(value);
+    else if (key == "play_type")
+        content.play_type = jsonString(value);
+    else if (key == "play_timeout")
+        content.play_timeout = jsonInt(value);
+    else if (key == "start_timestamp")
+        content.start_timestamp = jsonTime(value);
+    else if (key == "end_timestamp")
+        content.end_timestamp = jsonTime(value);
+    else if (key == "name")
+        content.name = jsonString(value);
+    else if (key == "type")
+        content.type = jsonString(value);
+    else if (key == "rotate")
+        content.rotate = jsonInt(value);
+    else if (key == "duration")
+        content.duration = jsonInt(value);
+    else if (key == "play_start")
+        content.play_start = jsonInt(value);
+    else if (key == "file_url")
+        content.file_url = jsonString(value);
+    else if (key == "file_hash")
+        content.file_hash = jsonString(value);
+    else if (key == "file_extension")
+        content.file_extension = jsonString(value);
+    else if (key == "file_size")
+        content.file_size = jsonInt(value);
+    else if (key == "fill_mode")
+        content.fill_mode = jsonString(value);
+}
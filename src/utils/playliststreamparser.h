@@ -0,0 +1,110 @@
+#ifndef PLAYLISTSTREAMPARSER_H
+#define PLAYLISTSTREAMPARSER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include "videoserviceresult.h"
+
+//sax-style callbacks for JsonStreamReader
+class JsonStreamHandler
+{
+public:
+    virtual ~JsonStreamHandler(){;}
+    virtual void startObject() = 0;
+    virtual void endObject() = 0;
+    virtual void startArray() = 0;
+    virtual void endArray() = 0;
+    virtual void key(const QString &key) = 0;
+    //string, double, bool or invalid QVariant for null
+    virtual void value(const QVariant &value) = 0;
+};
+
+//incremental json tokenizer
+//it keeps only unfinished token between chunks, so whole document is never in memory
+class JsonStreamReader
+{
+public:
+    explicit JsonStreamReader(JsonStreamHandler * handler);
+
+    void reset();
+    bool feed(const QByteArray &chunk);
+    bool isFinished() const {return finished;}
+    bool hasError() const {return !error.isEmpty();}
+    QString errorString() const {return error;}
+
+private:
+    enum State {NORMAL, STRING, STRING_ESCAPE, STRING_UNICODE, NUMBER, LITERAL};
+
+    void processChar(char c);
+    void finishString();
+    void finishNumber();
+    void finishLiteral();
+    void appendUnicode(ushort code);
+    void setError(const QString &text);
+
+    JsonStreamHandler * handler;
+    State state;
+    QByteArray token;
+    QByteArray unicodeDigits;
+    ushort highSurrogate;
+    //'o' - object, 'a' - array
+    QByteArray containers;
+    bool expectKey;
+    bool finished;
+    QString error;
+};
+
+//builds PlayerConfigAPI straight from json events without QJsonDocument
+//mirrors PlayerConfigAPI::fromJson and its nested fromJson methods
+class PlaylistStreamParser : public JsonStreamHandler
+{
+public:
+    PlaylistStreamParser();
+
+    void reset();
+    bool feed(const QByteArray &chunk);
+    bool isValid() const {return reader.isFinished() && !reader.hasError();}
+    QString errorString() const {return reader.errorString();}
+    PlayerConfigAPI result() const {return config;}
+
+    virtual void startObject();
+    virtual void endObject();
+    virtual void startArray();
+    virtual void endArray();
+    virtual void key(const QString &key);
+    virtual void value(const QVariant &value);
+
+private:
+    enum Frame {ROOT, CAMPAIGNS, CAMPAIGN, AREAS, AREA, CONTENTS, CONTENT, PRIORITY_CONTENT,
+                TIME_TARGETING, TIME_TARGETING_DAY, GEO_TARGETING, GEO_AREA, GEO_POINT, SKIP};
+    struct StackItem
+    {
+        Frame frame;
+        QString key;
+    };
+    void push(Frame frame);
+    Frame top() const {return stack.isEmpty() ? SKIP : stack.last().frame;}
+    QString currentKey() const {return stack.isEmpty() ? QString() : stack.last().key;}
+
+    void campaignValue(const QString &key, const QVariant &value);
+    void areaValue(const QString &key, const QVariant &value);
+    void contentValue(const QString &key, const QVariant &value);
+
+    JsonStreamReader reader;
+    QVector<StackItem> stack;
+    PlayerConfigAPI config;
+    PlayerConfigAPI::Campaign campaign;
+    PlayerConfigAPI::Campaign::Area area;
+    PlayerConfigAPI::Campaign::Area::Content content;
+    PlayerConfigAPI::Campaign::Area::Content::gps gpsPoint;
+    QVector<PlayerConfigAPI::Campaign::Area::Content::gps> geoArea;
+    QPolygon geoPolygon;
+    QVector<int> timeTargetingDay;
+    QString timeTargetingKey;
+    QString campaignOrientation;
+    int baseRotation;
+};
+
+#endif // PLAYLISTSTREAMPARSER_H
@@ -40,7 +40,6 @@ protected:
 
     static QByteArray decodeAES(QByteArray data, QString password);
     static QByteArray sha256(const QByteArray &text);
-    static quint32 updateCRC32(unsigned char ch, quint32 crc);
     static int decryptAES256(unsigned char *ciphertext, int ciphertext_len, unsigned char *key, unsigned char *iv, unsigned char *plaintext);
     static int encryptAES256(unsigned char *plaintext, int plaintext_len, unsigned char *key, unsigned char *iv, unsigned char *ciphertext);
 };
@@ -52,9 +51,6 @@ class SSLEncoder : public QObject
 public:
     explicit SSLEncoder(QObject *parent = 0);
     static quint32 CRC32(const QByteArray& data);
-    static QByteArray compressGZIP(const QByteArray &data);
-protected:
-    static quint32 updateCRC32(unsigned char ch, quint32 crc);
 };
 
 #endif // SSLENCODER_H
@@ -6,6 +6,7 @@
 #include "statisticdatabase.h"
 #include "globalconfig.h"
 #include "globalstats.h"
+#include "metrics.h"
 
 /*
  * */
@@ -65,7 +66,11 @@ void DatabaseWorker::executeOneTime(const QString& queryId, const QString& sql)
     // use previously defined db connection
     QSqlQuery query(m_database);
     // execute query, get result
+    static MetricHistogram * queryTime = MetricsInstance.histogram("teleds_db_query_duration_ms", "Time of statistic database query execution");
+    QElapsedTimer timer;
+    timer.start();
     bool ok = query.exec(sql);
+    queryTime->observe(timer.elapsed());
     qDebug() << ok;
     // check for errors
     if (!ok) {
@@ -103,7 +108,11 @@ void DatabaseWorker::executePrepared(const QString& queryId, const QString &resu
     QSqlQuery *query;
     query = m_queries.value(queryId);
     // execute and check query status
+    static MetricHistogram * queryTime = MetricsInstance.histogram("teleds_db_query_duration_ms", "Time of statistic database query execution");
+    QElapsedTimer timer;
+    timer.start();
     bool ok = query->exec();
+    queryTime->observe(timer.elapsed());
 
     if (!ok) {
         qDebug() << QString("execute failed for prepared query id [%1]").arg(queryId) << "error " << query->lastError();
@@ -1,3 +1,4 @@
+#include <utility>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -14,7 +15,8 @@
 #include "globalstats.h"
 #include "globalconfig.h"
 #include "singleton.h"
-#include "sslencoder.h"
+#include "httpcompression.h"
+#include "metrics.h"
 
 StatisticUploader::StatisticUploader(VideoService *videoService, QObject *parent) : QObject(parent)
 {
@@ -40,18 +42,24 @@ void StatisticUploader::eventsReady(QList<StatisticDatabase::PlayEvent> events)
     {
         return;
     }
+    static MetricHistogram * batchSize = MetricsInstance.histogram("teleds_upload_batch_events", "Count of play events in one statistic upload",
+                                                                   {1, 10, 50, 100, 250, 500, 1000, 5000});
+    batchSize->observe(events.count());
     DatabaseInstance.prepareEventsToSend();
     QJsonArray result;
     foreach (const StatisticDatabase::PlayEvent &event, events)
         result.append(event.serialize());
-    QJsonDocument doc(result);
+    //serialized once, the same bytes are dumped and sent
+    QByteArray json = QJsonDocument(result).toJson();
+    result = QJsonArray();
 
     QFile f("/home/pi/teleds/stats.txt");
     f.open(QFile::WriteOnly);
-    f.write(doc.toJson());
+    f.write(json);
     f.flush();
     f.close();
-    sendEvents(doc.toJson());
+    //moved, so sendEvents holds the only reference and can free plain body after compressing
+    sendEvents(std::move(json));
 
   //  QString strToSend = doc.toJson();
 
@@ -98,7 +106,9 @@ void StatisticUploader::sendEvents(QByteArray data)
         manager->deleteLater();
     }
     manager = new QNetworkAccessManager(this);
-    QByteArray compressedData = SSLEncoder::compressGZIP(data);
+    //gzip framing and crc are made in the same pass as deflate
+    QByteArray compressedData = HTTPBodyEncoder::gzip(data, STATISTIC_UPLOAD_GZIP_LEVEL);
+    data.clear();
     QUrl url(videoService->getServerURL());
     url.setPath("/player/event");
     QNetworkRequest networkRequest(url);
@@ -8,6 +8,8 @@
 #include "statisticdatabase.h"
 #include "videoservice.h"
 
+#define STATISTIC_UPLOAD_GZIP_LEVEL HTTP_GZIP_DEFAULT_LEVEL
+
 class StatisticUploader : public QObject
 {
     Q_OBJECT
@@ -2,6 +2,7 @@
 #include "globalconfig.h"
 #include "globalstats.h"
 #include "sunposition.h"
+#include "brightnesscurve.h"
 #include <QDebug>
 
 
@@ -130,8 +131,16 @@ QDateTime SunsetSystem::GetSolarNoon()
 
 double SunsetSystem::getSinPercent()
 {
-    QTime sunRise = GetSunrise().time();
-    QTime sunSet = GetSunset().time();
+    QTime sunRise, sunSet;
+    getDaylightWindow(sunRise, sunSet);
+    QTime currentTime = QDateTime::currentDateTimeUtc().time().addSecs(GlobalStatsInstance.getUTCOffset());
+    return getSinPercent(currentTime, sunRise, sunSet);
+}
+
+void SunsetSystem::getDaylightWindow(QTime &sunRise, QTime &sunSet)
+{
+    sunRise = GetSunrise().time();
+    sunSet = GetSunset().time();
     int sunriseHour = sunRise.hour();
     int sunsetHour = sunSet.hour();
     if (sunriseHour > 0)
@@ -140,17 +149,12 @@ double SunsetSystem::getSinPercent()
         sunsetHour += 1;
     sunRise.setHMS(sunriseHour,sunRise.minute(), sunRise.second());
     sunSet.setHMS(sunsetHour, sunSet.minute(), sunSet.second());
-
     qDebug() << "SUNSET/SUNRISE" << sunRise << sunSet;
-    QTime currentTime = QDateTime::currentDateTimeUtc().time().addSecs(GlobalStatsInstance.getUTCOffset());
-
-    if (currentTime < sunRise || currentTime > sunSet)
-        return 0.;
+}
 
-    int dayLong = sunRise.secsTo(sunSet);
-    qDebug() << dayLong;
-    int secsToSunset = currentTime.secsTo(sunSet);
-    return sin(double(secsToSunset)/double(dayLong)*M_PI);
+double SunsetSystem::getSinPercent(QTime time, QTime sunRise, QTime sunSet)
+{
+    return BrightnessCurve::sinPercent(time, sunRise, sunSet);
 }
 
 double SunsetSystem::getLinPercent()
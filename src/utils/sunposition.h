@@ -13,6 +13,10 @@ public:
     QDateTime GetSunrise();
     QDateTime GetSolarNoon();
     double getSinPercent();
+    //sunrise an hour earlier and sunset an hour later, local time
+    void getDaylightWindow(QTime &sunRise, QTime &sunSet);
+    //[0; 1] - sin of day part passed, 0 outside of window
+    static double getSinPercent(QTime time, QTime sunRise, QTime sunSet);
     double getLinPercent();
 private:
     double dRadToDeg(double dAngleRad)
@@ -0,0 +1,379 @@
+#include <QDebug>
+#include <QDateTime>
+#include "syncservice.h"
+#include "playbackclock.h"
+
+bool SyncService::AreaTimeline::operator ==(const SyncService::AreaTimeline &other) const
+{
+    return itemId == other.itemId && start == other.start &&
+           deadline == other.deadline && nextItemId == other.nextItemId;
+}
+
+SyncService::SyncService(QObject *parent) : QObject(parent)
+{
+    multicastSocket = new QUdpSocket(this);
+    unicastSocket = new QUdpSocket(this);
+    connect(multicastSocket, SIGNAL(readyRead()), this, SLOT(multicastReadyRead()));
+    connect(unicastSocket, SIGNAL(readyRead()), this, SLOT(unicastReadyRead()));
+
+    heartbeatTimer = new QTimer(this);
+    connect(heartbeatTimer, SIGNAL(timeout()), this, SLOT(heartbeat()));
+    probeTimer = new QTimer(this);
+    connect(probeTimer, SIGNAL(timeout()), this, SLOT(probeOffset()));
+
+    clock = &PlaybackClockInstance;
+    mode = SYNC_OFF;
+    port = 0;
+    //several players on one host (test setup) must not take each other messages as own
+    sessionId = quint32(qrand()) ^ quint32(QDateTime::currentMSecsSinceEpoch());
+    campaignIndex = -1;
+    campaignDeadline = -1;
+    leaderPort = 0;
+    leaderSessionId = 0;
+    lastLeaderMessage = -1;
+    requestSequence = 0;
+    requestTime = -1;
+    requestPending = false;
+    offset = 0;
+    roundTrip = 0;
+    offsetValid = false;
+    synchronized = false;
+}
+
+SyncService::Mode SyncService::modeFromString(const QString &mode)
+{
+    if (mode == "leader")
+        return SYNC_LEADER;
+    else if (mode == "follower")
+        return SYNC_FOLLOWER;
+    else
+        return SYNC_OFF;
+}
+
+void SyncService::start(SyncService::Mode mode, int group)
+{
+    quint16 newPort = SYNC_BASE_PORT + group;
+    if (mode == this->mode && (mode == SYNC_OFF || newPort == port))
+        return;
+    stop();
+    this->mode = mode;
+    if (mode == SYNC_OFF)
+        return;
+
+    port = newPort;
+    qDebug() << "SyncService::start" << (mode == SYNC_LEADER ? "leader" : "follower") << "port" << port;
+    if (!multicastSocket->bind(QHostAddress::AnyIPv4, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint))
+        qDebug() << "SyncService: cant bind multicast socket" << multicastSocket->errorString();
+    multicastSocket->setSocketOption(QAbstractSocket::MulticastLoopbackOption, 1);
+    multicastSocket->setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
+    if (!multicastSocket->joinMulticastGroup(QHostAddress(SYNC_MULTICAST_GROUP)))
+        qDebug() << "SyncService: cant join multicast group" << multicastSocket->errorString();
+    if (!unicastSocket->bind(QHostAddress::AnyIPv4, 0))
+        qDebug() << "SyncService: cant bind unicast socket" << unicastSocket->errorString();
+
+    if (mode == SYNC_LEADER)
+        heartbeatTimer->start(SYNC_HEARTBEAT_TIME);
+    else
+        probeTimer->start(SYNC_OFFSET_FAST_PROBE_TIME);
+}
+
+void SyncService::stop()
+{
+    if (mode == SYNC_OFF)
+        return;
+    qDebug() << "SyncService::stop";
+    heartbeatTimer->stop();
+    probeTimer->stop();
+    multicastSocket->leaveMulticastGroup(QHostAddress(SYNC_MULTICAST_GROUP));
+    multicastSocket->close();
+    unicastSocket->close();
+    mode = SYNC_OFF;
+    clearTimeline();
+    leaderAddress.clear();
+    leaderPort = 0;
+    leaderSessionId = 0;
+    lastLeaderMessage = -1;
+    samples.clear();
+    resetRequest();
+    offsetValid = false;
+    setSynchronized(false);
+}
+
+void SyncService::publishCampaign(int campaignIndex, qint64 deadline)
+{
+    if (mode != SYNC_LEADER)
+        return;
+    if (this->campaignIndex != campaignIndex)
+        areas.clear();
+    this->campaignIndex = campaignIndex;
+    this->campaignDeadline = deadline;
+    sendTimeline();
+}
+
+void SyncService::publishArea(int areaIndex, const SyncService::AreaTimeline &timeline)
+{
+    if (mode != SYNC_LEADER || areaIndex < 0)
+        return;
+    if (areas.count() <= areaIndex)
+        areas.resize(areaIndex + 1);
+    if (areas[areaIndex] == timeline)
+        return;
+    areas[areaIndex] = timeline;
+    sendTimeline();
+}
+
+void SyncService::clearTimeline()
+{
+    campaignIndex = -1;
+    campaignDeadline = -1;
+    areas.clear();
+}
+
+bool SyncService::isSynchronized() const
+{
+    return mode == SYNC_FOLLOWER && synchronized;
+}
+
+SyncService::AreaTimeline SyncService::getAreaTimeline(int areaIndex) const
+{
+    AreaTimeline result;
+    if (areaIndex < 0 || areaIndex >= areas.count())
+        return result;
+    result = areas[areaIndex];
+    if (result.start >= 0)
+        result.start -= offset;
+    if (result.deadline >= 0)
+        result.deadline -= offset;
+    return result;
+}
+
+void SyncService::multicastReadyRead()
+{
+    while (multicastSocket->hasPendingDatagrams())
+    {
+        QByteArray datagram;
+        datagram.resize(int(multicastSocket->pendingDatagramSize()));
+        QHostAddress sender;
+        quint16 senderPort;
+        multicastSocket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+
+        QDataStream stream(datagram);
+        quint8 type;
+        if (!readHeader(stream, type))
+            continue;
+        if (type == TIMELINE && mode == SYNC_FOLLOWER)
+            processTimeline(stream, sender);
+    }
+}
+
+void SyncService::unicastReadyRead()
+{
+    while (unicastSocket->hasPendingDatagrams())
+    {
+        QByteArray datagram;
+        datagram.resize(int(unicastSocket->pendingDatagramSize()));
+        QHostAddress sender;
+        quint16 senderPort;
+        unicastSocket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+
+        QDataStream stream(datagram);
+        quint8 type;
+        if (!readHeader(stream, type))
+            continue;
+        if (type == TIME_REQUEST && mode == SYNC_LEADER)
+            processTimeRequest(stream, sender, senderPort);
+        else if (type == TIME_REPLY && mode == SYNC_FOLLOWER)
+            processTimeReply(stream);
+    }
+}
+
+void SyncService::heartbeat()
+{
+    sendTimeline();
+}
+
+void SyncService::probeOffset()
+{
+    if (leaderAddress.isNull())
+        return;
+    if (clock->now() - lastLeaderMessage > SYNC_LEADER_TIMEOUT)
+    {
+        qDebug() << "SyncService: leader is lost";
+        leaderAddress.clear();
+        leaderSessionId = 0;
+        samples.clear();
+        resetRequest();
+        offsetValid = false;
+        setSynchronized(false);
+        probeTimer->setInterval(SYNC_OFFSET_FAST_PROBE_TIME);
+        return;
+    }
+
+    //new request replaces unanswered one, its late reply is dropped
+    requestSequence++;
+    requestTime = clock->now();
+    requestPending = true;
+    QByteArray datagram;
+    QDataStream stream(&datagram, QIODevice::WriteOnly);
+    writeHeader(stream, TIME_REQUEST);
+    stream << sessionId << requestSequence << requestTime;
+    unicastSocket->writeDatagram(datagram, leaderAddress, leaderPort);
+}
+
+void SyncService::writeHeader(QDataStream &stream, SyncService::MessageType type)
+{
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(SYNC_MAGIC) << quint8(SYNC_VERSION) << quint8(type);
+}
+
+bool SyncService::readHeader(QDataStream &stream, quint8 &type)
+{
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic;
+    quint8 version;
+    stream >> magic >> version >> type;
+    return stream.status() == QDataStream::Ok && magic == SYNC_MAGIC && version == SYNC_VERSION;
+}
+
+void SyncService::sendTimeline()
+{
+    if (mode != SYNC_LEADER)
+        return;
+    QByteArray datagram;
+    QDataStream stream(&datagram, QIODevice::WriteOnly);
+    writeHeader(stream, TIMELINE);
+    stream << sessionId << unicastSocket->localPort();
+    stream << qint32(campaignIndex) << campaignDeadline << quint32(areas.count());
+    foreach (const AreaTimeline &area, areas)
+        stream << area.itemId << area.start << area.deadline << area.nextItemId;
+    multicastSocket->writeDatagram(datagram, QHostAddress(SYNC_MULTICAST_GROUP), port);
+}
+
+void SyncService::processTimeline(QDataStream &stream, const QHostAddress &sender)
+{
+    quint32 senderSessionId;
+    quint16 senderPort;
+    qint32 newCampaignIndex;
+    qint64 newCampaignDeadline;
+    quint32 areaCount;
+    stream >> senderSessionId >> senderPort >> newCampaignIndex >> newCampaignDeadline >> areaCount;
+    if (stream.status() != QDataStream::Ok || senderSessionId == sessionId)
+        return;
+
+    QVector<AreaTimeline> newAreas;
+    for (quint32 i = 0; i < areaCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        AreaTimeline area;
+        stream >> area.itemId >> area.start >> area.deadline >> area.nextItemId;
+        newAreas.append(area);
+    }
+    if (stream.status() != QDataStream::Ok)
+        return;
+
+    if (senderSessionId != leaderSessionId)
+    {
+        //new or restarted leader has another clock, so old samples are useless
+        qDebug() << "SyncService: following leader" << sender.toString() << senderPort;
+        leaderSessionId = senderSessionId;
+        samples.clear();
+        resetRequest();
+        offsetValid = false;
+        setSynchronized(false);
+        probeTimer->start(SYNC_OFFSET_FAST_PROBE_TIME);
+    }
+    leaderAddress = sender;
+    leaderPort = senderPort;
+    lastLeaderMessage = clock->now();
+
+    bool campaignChanged = newCampaignIndex != campaignIndex || newCampaignDeadline != campaignDeadline;
+    QVector<AreaTimeline> oldAreas = areas;
+    campaignIndex = newCampaignIndex;
+    campaignDeadline = newCampaignDeadline;
+    areas = newAreas;
+
+    if (!offsetValid)
+        return;
+    if (campaignChanged && campaignDeadline >= 0)
+        emit campaignTimelineChanged(campaignIndex, campaignDeadline - offset);
+    for (int i = 0; i < areas.count(); ++i)
+        if (i >= oldAreas.count() || !(areas[i] == oldAreas[i]))
+            emit areaTimelineChanged(i);
+}
+
+void SyncService::processTimeRequest(QDataStream &stream, const QHostAddress &sender, quint16 senderPort)
+{
+    qint64 receiveTime = clock->now();
+    quint32 senderSessionId;
+    quint32 sequence;
+    qint64 originTime;
+    stream >> senderSessionId >> sequence >> originTime;
+    if (stream.status() != QDataStream::Ok)
+        return;
+
+    QByteArray datagram;
+    QDataStream reply(&datagram, QIODevice::WriteOnly);
+    writeHeader(reply, TIME_REPLY);
+    reply << senderSessionId << sequence << originTime << receiveTime << qint64(clock->now());
+    unicastSocket->writeDatagram(datagram, sender, senderPort);
+}
+
+void SyncService::processTimeReply(QDataStream &stream)
+{
+    qint64 t3 = clock->now();
+    quint32 requesterSessionId;
+    quint32 sequence;
+    qint64 t0, t1, t2;
+    stream >> requesterSessionId >> sequence >> t0 >> t1 >> t2;
+    if (stream.status() != QDataStream::Ok)
+        return;
+    //late, duplicated or foreign reply would give wrong sample
+    if (!requestPending || requesterSessionId != sessionId || sequence != requestSequence || t0 != requestTime)
+    {
+        qDebug() << "SyncService: unexpected time reply" << sequence << "waiting for" << requestSequence;
+        return;
+    }
+    requestPending = false;
+
+    OffsetSample sample;
+    sample.offset = ((t1 - t0) + (t2 - t3)) / 2;
+    sample.delay = (t3 - t0) - (t2 - t1);
+    if (sample.delay < 0)
+        return;
+    samples.append(sample);
+    if (samples.count() > SYNC_OFFSET_SAMPLES)
+        samples.remove(0);
+
+    OffsetSample best = samples.first();
+    foreach (const OffsetSample &s, samples)
+        if (s.delay < best.delay)
+            best = s;
+    offset = best.offset;
+    roundTrip = best.delay;
+    if (samples.count() == SYNC_OFFSET_SAMPLES)
+        probeTimer->setInterval(SYNC_OFFSET_PROBE_TIME);
+
+    if (!offsetValid)
+    {
+        offsetValid = true;
+        qDebug() << "SyncService: clock offset" << offset << "ms, round trip" << roundTrip << "ms";
+        setSynchronized(true);
+        if (campaignDeadline >= 0)
+            emit campaignTimelineChanged(campaignIndex, campaignDeadline - offset);
+        for (int i = 0; i < areas.count(); ++i)
+            emit areaTimelineChanged(i);
+    }
+}
+
+void SyncService::resetRequest()
+{
+    requestTime = -1;
+    requestPending = false;
+}
+
+void SyncService::setSynchronized(bool value)
+{
+    if (synchronized == value)
+        return;
+    synchronized = value;
+    emit synchronizedChanged(value);
+}
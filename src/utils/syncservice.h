@@ -0,0 +1,125 @@
+#ifndef SYNCSERVICE_H
+#define SYNCSERVICE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <QHostAddress>
+#include <QUdpSocket>
+#include <QDataStream>
+#include "singleton.h"
+
+class PlaybackClock;
+
+#define SyncServiceInstance Singleton<SyncService>::instance()
+
+#define SYNC_MULTICAST_GROUP "239.255.84.68"
+//group number from settings is added to base port, so several walls can work in one lan
+#define SYNC_BASE_PORT 45454
+#define SYNC_MAGIC 0x54445359
+#define SYNC_VERSION 2
+#define SYNC_HEARTBEAT_TIME 1000
+#define SYNC_OFFSET_PROBE_TIME 2000
+#define SYNC_OFFSET_FAST_PROBE_TIME 250
+//offset is taken from sample with smallest round trip among last samples (like ntp clock filter)
+#define SYNC_OFFSET_SAMPLES 8
+#define SYNC_LEADER_TIMEOUT 5000
+
+//video wall synchronization over udp multicast
+//leader broadcasts its timeline (current and next item of every area with absolute deadlines)
+//followers estimate offset between leader PlaybackClock and own one with ntp-style request/reply,
+//reply echoes request sequence and only reply to the last sent request is taken
+//and move their area and campaign deadlines to leader ones
+//all times in messages are PlaybackClock msecs of the leader
+class SyncService : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode {SYNC_OFF, SYNC_LEADER, SYNC_FOLLOWER};
+    struct AreaTimeline
+    {
+        AreaTimeline() : start(-1), deadline(-1) {}
+        QString itemId;
+        qint64 start;
+        qint64 deadline;
+        QString nextItemId;
+        bool operator ==(const AreaTimeline &other) const;
+    };
+
+    explicit SyncService(QObject *parent = 0);
+
+    static Mode modeFromString(const QString &mode);
+    //PlaybackClockInstance by default, players of test harness run on own skewed clocks
+    void setClock(PlaybackClock * clock) {this->clock = clock;}
+    void start(Mode mode, int group);
+    void stop();
+    Mode getMode() const {return mode;}
+
+    //leader side
+    void publishCampaign(int campaignIndex, qint64 deadline);
+    void publishArea(int areaIndex, const AreaTimeline &timeline);
+    void clearTimeline();
+
+    //follower side, times are already converted to local clock
+    bool isSynchronized() const;
+    qint64 getOffset() const {return offset;}
+    qint64 getRoundTrip() const {return roundTrip;}
+    AreaTimeline getAreaTimeline(int areaIndex) const;
+
+signals:
+    void areaTimelineChanged(int areaIndex);
+    void campaignTimelineChanged(int campaignIndex, qint64 deadline);
+    void synchronizedChanged(bool synchronized);
+
+private slots:
+    void multicastReadyRead();
+    void unicastReadyRead();
+    void heartbeat();
+    void probeOffset();
+
+private:
+    enum MessageType {TIMELINE = 1, TIME_REQUEST, TIME_REPLY};
+
+    void writeHeader(QDataStream &stream, MessageType type);
+    bool readHeader(QDataStream &stream, quint8 &type);
+    void sendTimeline();
+    void processTimeline(QDataStream &stream, const QHostAddress &sender);
+    void processTimeRequest(QDataStream &stream, const QHostAddress &sender, quint16 senderPort);
+    void processTimeReply(QDataStream &stream);
+    void setSynchronized(bool value);
+    void resetRequest();
+
+    struct OffsetSample
+    {
+        qint64 offset;
+        qint64 delay;
+    };
+
+    PlaybackClock * clock;
+    QUdpSocket * multicastSocket;
+    QUdpSocket * unicastSocket;
+    QTimer * heartbeatTimer;
+    QTimer * probeTimer;
+    Mode mode;
+    quint16 port;
+    quint32 sessionId;
+
+    int campaignIndex;
+    qint64 campaignDeadline;
+    QVector<AreaTimeline> areas;
+
+    QHostAddress leaderAddress;
+    quint16 leaderPort;
+    quint32 leaderSessionId;
+    qint64 lastLeaderMessage;
+    QVector<OffsetSample> samples;
+    quint32 requestSequence;
+    qint64 requestTime;
+    bool requestPending;
+    qint64 offset;
+    qint64 roundTrip;
+    bool offsetValid;
+    bool synchronized;
+};
+
+#endif // SYNCSERVICE_H
@@ -0,0 +1,66 @@
+#ifndef TELEDSPATCH_H
+#define TELEDSPATCH_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QCryptographicHash>
+
+//magic of TeleDSPatch file made by deploy tool
+#define TELEDS_PATCH_MAGIC 0x0303CCCC
+#define TELEDS_FILE_PATCH_MAGIC 0x0202FFDD
+//part types, the same as DeltaPart in deploy tool
+#define TELEDS_PATCH_PART_SOURCE 0x0
+#define TELEDS_PATCH_PART_DATA 0x1
+#define TELEDS_PATCH_COPY_CHUNK 65536
+//created by updater if delta can not be applied, player asks for full update while it exists
+#define TELEDS_PATCH_FAILED_MARKER "update_delta_failed"
+
+//delta update: list of files with md5 of their current versions and binary patch for every changed file
+//patch is a list of parts: copy range of current file or insert data
+//file layout (QDataStream): magic, patch version, player version, total file count, update file count,
+//file names, file hashes, update count, then for every file: magic, patch hash, result hash, path, qCompress'ed patch
+//only index is loaded, patches are read one by one when applied
+class TeleDSPatchFile
+{
+public:
+    struct FileInfo
+    {
+        QString filePath;
+        QString patchHash;
+        QString resultHash;
+        qint64 offset;
+        quint32 size;
+    };
+
+    TeleDSPatchFile();
+    static bool isPatch(QString fileName);
+    bool load(QString fileName);
+    int getPatchVersion() const {return patchVersion;}
+    int getPlayerVersion() const {return playerVersion;}
+
+    //checks that files which will be patched are the same as ones patch was built from
+    bool verifySources(QString rootDir);
+    //patched files are written to temp files and checked, then all of them replace originals
+    //nothing is changed if any file fails, originals are kept in .orig until the last file is replaced
+    bool apply(QString rootDir);
+
+    //patchData is qCompress'ed list of parts, source ranges are copied by chunks
+    //patch of one file is uncompressed in memory (qCompress has no stream reader), result is streamed
+    static bool applyPatch(QIODevice * src, const QByteArray &patchData, QIODevice * out, QCryptographicHash * hash = 0);
+    static QString fileHash(QString fileName);
+
+private:
+    bool applyFile(const FileInfo &info, QString target, QString temp);
+    static QString localPath(QString rootDir, QString filePath);
+
+    QString fileName;
+    int patchVersion;
+    int playerVersion;
+    QHash<QString, QString> sourceHashes;
+    QVector<FileInfo> files;
+};
+
+#endif // TELEDSPATCH_H
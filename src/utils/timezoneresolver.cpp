@@ -0,0 +1,169 @@
+#include <QFile>
+#include <QStringList>
+#include <QDateTime>
+#include <QDebug>
+#include <math.h>
+#include <limits.h>
+#include "timezoneresolver.h"
+
+TimeZoneResolver::TimeZoneResolver()
+{
+
+}
+
+void TimeZoneResolver::load(QString fileName)
+{
+    zones.clear();
+    grid.clear();
+    QFile f(fileName);
+    if (!f.open(QFile::ReadOnly))
+    {
+        qDebug() << "TimeZoneResolver::load cannot open " + fileName;
+        return;
+    }
+    QStringList lines = QString(f.readAll()).split("\n");
+    foreach (const QString &s, lines)
+    {
+        if (s.simplified() == "" || s[0] == QChar('#'))
+            continue;
+        QStringList tokens = s.split("\t");
+        if (tokens.count() < 3)
+            continue;
+        //ISO 6709 +DDMM+DDDMM or +DDMMSS+DDDMMSS
+        QString coords = tokens[1];
+        int split = qMax(coords.indexOf('+', 1), coords.indexOf('-', 1));
+        if (split <= 0)
+            continue;
+        Zone zone;
+        zone.entry.shortName = tokens[0];
+        zone.entry.lat = parseCoordinate(coords.left(split), 2);
+        zone.entry.lon = parseCoordinate(coords.mid(split), 3);
+        zone.entry.longName = tokens[2];
+        unitVector(zone.entry.lat, zone.entry.lon, zone.x, zone.y, zone.z);
+        zone.timeZoneLoaded = false;
+        zone.offset = 0;
+        zone.validFrom = zone.validTo = 0;
+        zones.append(zone);
+    }
+    f.close();
+    qDebug() << "TimeZoneResolver::load" << zones.count() << "zones";
+}
+
+int TimeZoneResolver::findZone(double lat, double lon)
+{
+    if (zones.isEmpty())
+        return -1;
+    int row = qBound(0, int(floor((lat + 90.) * TIMEZONE_GRID_STEPS)), TIMEZONE_GRID_HEIGHT - 1);
+    int column = int(floor((lon + 180.) * TIMEZONE_GRID_STEPS)) % TIMEZONE_GRID_WIDTH;
+    if (column < 0)
+        column += TIMEZONE_GRID_WIDTH;
+    int index = row * TIMEZONE_GRID_WIDTH + column;
+    auto cell = grid.find(index);
+    if (cell == grid.end())
+        cell = grid.insert(index, cellCandidates(row, column));
+    const QVector<qint16> &candidates = cell.value();
+    if (candidates.count() == 1)
+        return candidates[0];
+
+    //the smallest angle is the biggest cosine
+    double x, y, z;
+    unitVector(lat, lon, x, y, z);
+    int found = candidates[0];
+    double best = -2.;
+    foreach (qint16 i, candidates)
+    {
+        double dot = x * zones[i].x + y * zones[i].y + z * zones[i].z;
+        if (dot > best)
+        {
+            best = dot;
+            found = i;
+        }
+    }
+    return found;
+}
+
+int TimeZoneResolver::offsetFromUtc(int zone, qint64 utcSecs)
+{
+    if (zone < 0 || zone >= zones.count())
+        return 0;
+    Zone &z = zones[zone];
+    if (utcSecs >= z.validFrom && utcSecs < z.validTo)
+        return z.offset;
+
+    if (!z.timeZoneLoaded)
+    {
+        z.timeZone = QTimeZone(z.entry.longName.toLatin1());
+        z.timeZoneLoaded = true;
+        if (!z.timeZone.isValid())
+            qDebug() << "TimeZoneResolver: unknown zone " + z.entry.longName;
+    }
+    QDateTime now = QDateTime::fromMSecsSinceEpoch(utcSecs * 1000, Qt::UTC);
+    if (!z.timeZone.isValid())
+    {
+        z.offset = 0;
+        z.validFrom = LLONG_MIN;
+        z.validTo = LLONG_MAX;
+        return 0;
+    }
+    z.offset = z.timeZone.offsetFromUtc(now);
+    z.validFrom = utcSecs;
+    z.validTo = LLONG_MAX;
+    if (z.timeZone.hasTransitions())
+    {
+        QTimeZone::OffsetData next = z.timeZone.nextTransition(now);
+        if (next.atUtc.isValid())
+            z.validTo = next.atUtc.toMSecsSinceEpoch() / 1000;
+        QTimeZone::OffsetData previous = z.timeZone.previousTransition(now.addSecs(1));
+        if (previous.atUtc.isValid())
+            z.validFrom = previous.atUtc.toMSecsSinceEpoch() / 1000;
+    }
+    return z.offset;
+}
+
+QVector<qint16> TimeZoneResolver::cellCandidates(int row, int column) const
+{
+    double x, y, z;
+    unitVector((row + 0.5) / TIMEZONE_GRID_STEPS - 90., (column + 0.5) / TIMEZONE_GRID_STEPS - 180., x, y, z);
+    //the farthest point of the cell from its center is one of corners
+    double radius = 0.;
+    for (int i = 0; i < 4; i++)
+    {
+        double cx, cy, cz;
+        unitVector(double(row + i / 2) / TIMEZONE_GRID_STEPS - 90., double(column + i % 2) / TIMEZONE_GRID_STEPS - 180., cx, cy, cz);
+        radius = qMax(radius, acos(qBound(-1., x * cx + y * cy + z * cz, 1.)));
+    }
+    QVector<double> angles(zones.count());
+    double nearest = M_PI;
+    for (int i = 0; i < zones.count(); i++)
+    {
+        angles[i] = acos(qBound(-1., x * zones[i].x + y * zones[i].y + z * zones[i].z, 1.));
+        nearest = qMin(nearest, angles[i]);
+    }
+    //any point of the cell is within nearest + radius from the zone nearest to center,
+    //and zone farther than nearest + 2 * radius from center is farther than that from every point of the cell
+    QVector<qint16> result;
+    for (int i = 0; i < zones.count(); i++)
+        if (angles[i] <= nearest + 2. * radius + TIMEZONE_GRID_EPSILON)
+            result.append(qint16(i));
+    return result;
+}
+
+void TimeZoneResolver::unitVector(double lat, double lon, double &x, double &y, double &z)
+{
+    lat = lat / 180. * M_PI;
+    lon = lon / 180. * M_PI;
+    x = cos(lat) * cos(lon);
+    y = cos(lat) * sin(lon);
+    z = sin(lat);
+}
+
+double TimeZoneResolver::parseCoordinate(const QString &text, int degreeDigits)
+{
+    //sign, degrees, minutes, optional seconds
+    double sign = text.startsWith('-') ? -1. : 1.;
+    QString digits = text.mid(1);
+    double degrees = digits.left(degreeDigits).toDouble();
+    double minutes = digits.mid(degreeDigits, 2).toDouble();
+    double seconds = digits.mid(degreeDigits + 2, 2).toDouble();
+    return sign * (degrees + minutes / 60. + seconds / 3600.);
+}
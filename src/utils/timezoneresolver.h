@@ -0,0 +1,63 @@
+#ifndef TIMEZONERESOLVER_H
+#define TIMEZONERESOLVER_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QTimeZone>
+
+#define TIMEZONE_DATABASE_FILE "/usr/share/zoneinfo/zone.tab"
+//grid cell size is 1/TIMEZONE_GRID_STEPS degree
+#define TIMEZONE_GRID_STEPS 1
+//radians, rounding margin of candidate distance bound
+#define TIMEZONE_GRID_EPSILON 1e-9
+#define TIMEZONE_GRID_WIDTH (360 * TIMEZONE_GRID_STEPS)
+#define TIMEZONE_GRID_HEIGHT (180 * TIMEZONE_GRID_STEPS)
+
+struct TimeZoneEntry{
+    QString shortName;
+    double lat;
+    double lon;
+    QString longName;
+};
+
+//time zone of gps position is zone of nearest zone.tab location
+//positions are unit vectors, so nearest location is one with max dot product (no trig per location)
+//every grid cell keeps locations which can be nearest to some point of the cell (computed when cell is asked first time),
+//exact nearest one is chosen among them, so result is the same as search through all locations
+//every zone keeps its QTimeZone and offset with utc range where it is valid (till next dst transition),
+//so offset lookup is grid index plus range check
+class TimeZoneResolver
+{
+public:
+    TimeZoneResolver();
+    void load(QString fileName = TIMEZONE_DATABASE_FILE);
+    int count() const {return zones.count();}
+    //-1 if database is empty
+    int findZone(double lat, double lon);
+    const TimeZoneEntry &getEntry(int zone) const {return zones[zone].entry;}
+    //offset in seconds, 0 for unknown zone
+    int offsetFromUtc(int zone, qint64 utcSecs);
+
+private:
+    struct Zone
+    {
+        TimeZoneEntry entry;
+        double x, y, z;
+        QTimeZone timeZone;
+        bool timeZoneLoaded;
+        int offset;
+        //offset is valid in [validFrom, validTo)
+        qint64 validFrom;
+        qint64 validTo;
+    };
+    QVector<qint16> cellCandidates(int row, int column) const;
+    static void unitVector(double lat, double lon, double &x, double &y, double &z);
+    static double parseCoordinate(const QString &text, int degreeDigits);
+
+    QVector<Zone> zones;
+    //candidate zones of cells which were asked, key is row * TIMEZONE_GRID_WIDTH + column
+    QHash<int, QVector<qint16> > grid;
+};
+
+#endif // TIMEZONERESOLVER_H
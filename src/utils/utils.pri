@@ -17,7 +17,24 @@ SOURCES += \
     $$PWD/subsmanager.cpp \
     $$PWD/skinmanager.cpp \
     $$PWD/notherfilesystem.cpp \
-    $$PWD/playlistmanager.cpp
+    $$PWD/lfsrencoder.cpp \
+    $$PWD/teledspatch.cpp \
+    $$PWD/playlistmanager.cpp \
+    $$PWD/httpcompression.cpp \
+    $$PWD/playliststreamparser.cpp \
+    $$PWD/idregistry.cpp \
+    $$PWD/syncservice.cpp \
+    $$PWD/mediaprobe.cpp \
+    $$PWD/metrics.cpp \
+    $$PWD/logger.cpp \
+    $$PWD/ziparchive.cpp \
+    $$PWD/checksum.cpp \
+    $$PWD/timezoneresolver.cpp \
+    $$PWD/brightnesscontroller.cpp \
+    $$PWD/brightnesscurve.cpp \
+    $$PWD/changeeventparser.cpp \
+    $$PWD/changechannel.cpp \
+    $$PWD/playlistindex.cpp
 HEADERS += \ 
     $$PWD/instagramrecentpostmodel.h \
     $$PWD/videoservice.h \
@@ -34,6 +51,25 @@ HEADERS += \
     $$PWD/subsmanager.h \
     $$PWD/skinmanager.h \
     $$PWD/notherfilesystem.h \
-    $$PWD/playlistmanager.h
+    $$PWD/lfsrencoder.h \
+    $$PWD/teledspatch.h \
+    $$PWD/playlistmanager.h \
+    $$PWD/httpcompression.h \
+    $$PWD/playliststreamparser.h \
+    $$PWD/idregistry.h \
+    $$PWD/syncservice.h \
+    $$PWD/mediaprobe.h \
+    $$PWD/metrics.h \
+    $$PWD/logger.h \
+    $$PWD/ziparchive.h \
+    $$PWD/checksum.h \
+    $$PWD/timezoneresolver.h \
+    $$PWD/brightnesscontroller.h \
+    $$PWD/brightnesscurve.h \
+    $$PWD/changeeventparser.h \
+    $$PWD/changechannel.h \
+    $$PWD/playlistindex.h
 FORMS   +=
 
+LIBS += -lz
+
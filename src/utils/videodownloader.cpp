@@ -1,12 +1,16 @@
 #include <QVector>
 #include <QDebug>
 #include <QFileInfo>
+#include <QDir>
 #include <QTimer>
 #include <QSslKey>
 #include <QtConcurrent/QtConcurrent>
 #include "videodownloader.h"
 #include "statisticdatabase.h"
 #include "globalstats.h"
+#include "mediaprobe.h"
+#include "metrics.h"
+#include "logger.h"
 #include "platformdefines.h"
 
 
@@ -65,6 +69,9 @@ void VideoDownloaderWorker::checkDownload()
             GlobalStatsInstance.setItemActivated(item.content_id, true);
             continue;
         }
+        //html5_zip is served from archive itself, folders unpacked by older versions are not used anymore
+        if (item.type == "html5_zip" && !item.content_id.isEmpty())
+            QDir(VIDEO_FOLDER + item.content_id).removeRecursively();
 
         QString filename = VIDEO_FOLDER + item.content_id + item.file_hash + item.file_extension;
         QString filehash;
@@ -79,7 +86,10 @@ void VideoDownloaderWorker::checkDownload()
             itemsToDownload.append(item);
         }
         else
+        {
+            probeItem(item, filename);
             GlobalStatsInstance.setItemActivated(item.content_id, true);
+        }
         itemCount++;
     }
 
@@ -156,13 +166,9 @@ void VideoDownloaderWorker::download()
                 QString currentItemId = currentItem.content_id;
                 emit fileDownloaded(currentItemIndex);
                 currentItemIndex++;
-                if (currentItem.type == "html5_zip")
-                {
-                    PlatformSpecificService.extractFile(currentItemId + currentItem.file_hash + currentItem.file_extension, currentItemId);
-                }
-                else
-                    swapper.add(VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension,
-                                VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
+                probeItem(currentItem, VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
+                swapper.add(VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension,
+                            VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
                 swapper.start();
                 QTimer::singleShot(5000, [currentItemId, currentItem]() {
                     qDebug() << "Item is ready " << currentItem.name;
@@ -188,13 +194,9 @@ void VideoDownloaderWorker::download()
                 reply = 0;
                 delete file;
                 file = 0;
-                if (currentItem.type == "html5_zip")
-                {
-                    PlatformSpecificService.extractFile(currentItemId + currentItem.file_hash + currentItem.file_extension, currentItemId);
-                }
-                else
-                    swapper.add(VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension,
-                                VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
+                probeItem(currentItem, VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
+                swapper.add(VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension,
+                            VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
                 swapper.start();
                 QTimer::singleShot(5000, [currentItemId, currentItem]() {
                     qDebug() << "Item is ready " << currentItem.name;
@@ -296,6 +298,9 @@ QString VideoDownloaderWorker::updateHash(QString fileName)
 
 QString VideoDownloaderWorker::getFileHash(QString fileName)
 {
+    static MetricHistogram * hashTime = MetricsInstance.histogram("teleds_file_hash_duration_ms", "Time of md5 calculation of content file",
+                                                                  {10, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000});
+    MetricTimer timer(hashTime);
     QFile f(fileName);
     if (f.open(QFile::ReadOnly)) {
         QCryptographicHash hash(QCryptographicHash::Md5);
@@ -312,10 +317,10 @@ QString VideoDownloaderWorker::getCacheFileHash(QString fileName)
     QFileInfo fileInfo(fileName);
 
     if (hashCache.contains(fileName)){
-        qDebug() << "md5 of " + fileName + " found in cache";
+        TLOG(LOG_DEBUG, LOG_DOWNLOAD) << "md5 of " + fileName + " found in cache";
         if (fileInfo.lastModified() > hashCache[fileName].date)
         {
-            qDebug() << "but file was updated: calculating hash";
+            TLOG(LOG_DEBUG, LOG_DOWNLOAD) << "but file was updated: calculating hash";
             return updateHash(fileName);
         }
         else
@@ -323,7 +328,7 @@ QString VideoDownloaderWorker::getCacheFileHash(QString fileName)
     }
     else
     {
-        qDebug() << "filehash  of " + fileName + " was not found in cache - calculating!";
+        TLOG(LOG_DEBUG, LOG_DOWNLOAD) << "filehash  of " + fileName + " was not found in cache - calculating!";
         return updateHash(fileName);
     }
 }
@@ -373,13 +378,10 @@ void VideoDownloaderWorker::httpFinished()
     reply = 0;
     delete file;
     file = 0;
-    if (currentItem.type == "html5_zip")
-    {
-        PlatformSpecificService.extractFile(currentItemId + currentItem.file_hash + currentItem.file_extension, currentItemId);
-    }
-    else
-        swapper.add(VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension,
-                    VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
+    probeItem(currentItem, VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
+    //html5_zip is served from archive itself, so it is swapped as any other file
+    swapper.add(VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension,
+                VIDEO_FOLDER + currentItemId + currentItem.file_hash + currentItem.file_extension + "_");
     swapper.start();
     QTimer::singleShot(5000, [currentItemId, currentItem]() {
         qDebug() << "Item is ready " << currentItem.name;
@@ -387,19 +389,29 @@ void VideoDownloaderWorker::httpFinished()
     });
 }
 
+void VideoDownloaderWorker::probeItem(const PlayerConfigAPI::Campaign::Area::Content &item, const QString &fileName)
+{
+    if (item.type != "video" && item.type != "audio")
+        return;
+    MediaInfo info = MediaProbeInstance.probe(fileName, item.file_hash);
+    if (!info.canPlay())
+        qDebug() << "probeItem:: " << item.name << " can not be decoded on this device, item will be skipped";
+    GlobalStatsInstance.setItemDecodable(item.content_id, info.canPlay());
+}
+
 void VideoDownloaderWorker::httpReadyRead()
 {
-    static int v = 0;
-    v++;
     if (restarter)
         restarter->stop();
     if (file)
     {
       //  QtConcurrent::run(writeToFileJob, file, reply);
-        file->write(reply->readAll());
+        static MetricCounter * downloadedBytes = MetricsInstance.counter("teleds_download_bytes_total", "Bytes of content received by downloader");
+        QByteArray data = reply->readAll();
+        downloadedBytes->add(data.size());
+        file->write(data);
         file->flush();
-        if (v % 10 == 0)
-            qDebug() << QDateTime::currentDateTime().time().toString("HH:mm:ss ") << "updating file status: "
+        TLOG_LIMITED(LOG_DEBUG, LOG_DOWNLOAD, 1) << "updating file status: "
                      << itemsToDownload[currentItemIndex].name << " [ " << file->size() << " ] bytes";
     }
 }
@@ -50,6 +50,8 @@ public:
     static QString getFileHash(QString fileName);
 
     QString getCacheFileHash(QString fileName);
+    //checks video/audio against device decoders and marks undecodable items in GlobalStats
+    void probeItem(const PlayerConfigAPI::Campaign::Area::Content &item, const QString &fileName);
 
     struct HashMeasure
     {
@@ -6,6 +6,7 @@
 #include <QGuiApplication>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QScreen>
 #include "videoservice.h"
 #include "singleton.h"
@@ -13,6 +14,10 @@
 #include "globalconfig.h"
 #include "platformspecific.h"
 #include "sslencoder.h"
+#include "teledspatch.h"
+#include "version.h"
+
+#define REQUEST_COMPRESSION_MIN_SIZE 1024
 
 VideoService::VideoService(QString serverURL, QObject *parent) : QObject(parent)
 {
@@ -32,6 +37,19 @@ VideoService::VideoService(QString serverURL, QObject *parent) : QObject(parent)
     connect(&resultProcessor,SIGNAL(getUpdatesResult(UpdateInfoResult)), this, SIGNAL(getUpdatesResult(UpdateInfoResult)));
 
     currentRequestExists = false;
+    currentReply = 0;
+    replyDecoderReady = false;
+
+    //request is built for every connection, token can be received after channel is started
+    channel = new ChangeChannel([this](QNetworkRequest &request) -> bool {
+        if (GlobalConfigInstance.getToken().isEmpty())
+            return false;
+        QByteArray data;
+        request = buildNetworkRequest(VideoServiceRequestFabric::subscribeChangesRequest(), data);
+        return true;
+    }, this);
+    connect(channel, SIGNAL(eventReceived(QString)), this, SLOT(channelEvent(QString)));
+    connect(channel, SIGNAL(activeChanged(bool)), this, SIGNAL(changeChannelStateChanged(bool)));
 }
 
 void VideoService::getPlayerSettings()
@@ -60,6 +78,18 @@ void VideoService::advancedInit(QByteArray data)
     executeRequest(VideoServiceRequestFabric::advancedInitRequest(data));
 }
 
+void VideoService::subscribeChanges()
+{
+    qDebug() << "VideoService::subscribeChanges";
+    channel->start();
+}
+
+void VideoService::unsubscribeChanges()
+{
+    qDebug() << "VideoService::unsubscribeChanges";
+    channel->stop();
+}
+
 void VideoService::executeRequest(VideoServiceRequest request)
 {
     if (currentRequestExists && QString(GlobalStatsInstance.getSystemData("force_request")) != "true")
@@ -83,11 +113,18 @@ bool VideoService::processReplyError(const QNetworkReply *reply, QString method)
         GlobalStatsInstance.registryConnectionError();
         return true;
     }
+    if (reply->property("bodyBroken").toBool())
+    {
+        qDebug() << method + "::reply_error: broken compressed body";
+        GlobalStatsInstance.registryConnectionError();
+        return true;
+    }
     return false;
 }
 
 void VideoService::initVideoRequestFinishedSlot(QNetworkReply *reply)
 {
+    finishReplyBody(reply);
     qDebug() << "initVideoRequestFinishedSlot";
     processReplyError(reply,"init");
     emit initVideoRequestFinished(reply);
@@ -96,6 +133,7 @@ void VideoService::initVideoRequestFinishedSlot(QNetworkReply *reply)
 
 void VideoService::getPlaylistRequestFinishedSlot(QNetworkReply *reply)
 {
+    finishReplyBody(reply);
     if (processReplyError(reply,"getPlaylist"))
         GlobalStatsInstance.registryPlaylistError();
     emit getPlaylistRequestFinished(reply);
@@ -104,6 +142,7 @@ void VideoService::getPlaylistRequestFinishedSlot(QNetworkReply *reply)
 
 void VideoService::sendStatisticEventsRequestFinishedSlot(QNetworkReply *reply)
 {
+    finishReplyBody(reply);
     processReplyError(reply,"sendStatistic:events");
     emit sendStatisticEventsRequestFinished(reply);
     nextRequest();
@@ -111,6 +150,7 @@ void VideoService::sendStatisticEventsRequestFinishedSlot(QNetworkReply *reply)
 
 void VideoService::getPlayerSettingsRequestFinishedSlot(QNetworkReply *reply)
 {
+    finishReplyBody(reply);
     processReplyError(reply,"settings");
     emit getPlayerSettingsRequestFinished(reply);
     nextRequest();
@@ -118,17 +158,16 @@ void VideoService::getPlayerSettingsRequestFinishedSlot(QNetworkReply *reply)
 
 void VideoService::getUpdatesRequestFinishedSlot(QNetworkReply *reply)
 {
+    finishReplyBody(reply);
     processReplyError(reply, "update");
     emit getUpdatesRequestFinished(reply);
     nextRequest();
 }
 
-void VideoService::performRequest(VideoServiceRequest request)
+QNetworkRequest VideoService::buildNetworkRequest(const VideoServiceRequest &request, QByteArray &data)
 {
-    qDebug() << "VideoService::performRequest" << request.name;
     QUrl url(serverURL);
     QUrlQuery query;
-    QByteArray data;
     foreach (const VideoServiceRequest::VideoServiceRequestParam& param, request.params)
         query.addQueryItem(param.key,param.value);
     url.setPath("/" + request.methodAPI);
@@ -146,10 +185,32 @@ void VideoService::performRequest(VideoServiceRequest request)
     if (request.method == "POST")
         networkRequest.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
 
+    //large bodies are gzipped unless request is already encoded
+    //one output buffer instead of HTTPBodyEncoder sink: raw body is already one array kept in currentRequest
+    //until reply, qnam needs whole upload for Content-Length and resend on redirect, gzipped copy is a few
+    //times smaller than raw one, and temporary file sink would only add flash writes
+    if (data.size() >= REQUEST_COMPRESSION_MIN_SIZE && !request.headers.contains("Content-Encoding"))
+    {
+        int originalSize = data.size();
+        data = HTTPBodyEncoder::gzip(data);
+        networkRequest.setRawHeader("Content-Encoding", "gzip");
+        qDebug() << "VideoService::request body compressed" << originalSize << "->" << data.size();
+    }
+
     foreach (const QNetworkRequest::KnownHeaders &key, request.knownHeaders.keys())
         networkRequest.setHeader(key,request.knownHeaders[key]);
     foreach (const QString &key, request.headers.keys())
         networkRequest.setRawHeader(key.toLocal8Bit(), request.headers[key].toLocal8Bit());
+    return networkRequest;
+}
+
+void VideoService::performRequest(VideoServiceRequest request)
+{
+    qDebug() << "VideoService::performRequest" << request.name;
+    QByteArray data;
+    QNetworkRequest networkRequest = buildNetworkRequest(request, data);
+    //explicit header turns off qt transparent decompression - we inflate chunks ourselves
+    networkRequest.setRawHeader("Accept-Encoding", "gzip, deflate");
 
     manager->disconnect();
 
@@ -170,9 +231,51 @@ void VideoService::performRequest(VideoServiceRequest request)
 
     //qDebug() << data;
     if (request.method == "GET")
-        manager->get(networkRequest);
+        currentReply = manager->get(networkRequest);
     else
-        manager->post(networkRequest, data);
+        currentReply = manager->post(networkRequest, data);
+    replyBody.clear();
+    replyDecoderReady = false;
+    connect(currentReply, SIGNAL(readyRead()), this, SLOT(replyReadyRead()));
+}
+
+void VideoService::replyReadyRead()
+{
+    readReplyBody(false);
+}
+
+bool VideoService::readReplyBody(bool last)
+{
+    if (!currentReply)
+        return false;
+    if (!replyDecoderReady)
+    {
+        replyDecoder.reset(currentReply->rawHeader("Content-Encoding"));
+        replyDecoderReady = true;
+    }
+    QByteArray decoded;
+    bool ok = replyDecoder.decode(currentReply->readAll(), decoded, last);
+    if (!ok)
+        qDebug() << "VideoService::broken compressed response" << currentRequest.name;
+    if (!resultProcessor.processBodyChunk(currentReply, currentRequest.name, decoded))
+        replyBody.append(decoded);
+    return ok;
+}
+
+void VideoService::finishReplyBody(QNetworkReply *reply)
+{
+    //handlers read decoded body from "body" property instead of readAll()
+    if (reply == currentReply)
+    {
+        //compressed stream must end with the reply, otherwise tail of body is lost
+        bool complete = readReplyBody(reply->error() == QNetworkReply::NoError);
+        reply->setProperty("body", replyBody);
+        if (!complete)
+            reply->setProperty("bodyBroken", true);
+        currentReply = 0;
+    }
+    replyBody.clear();
+    replyDecoderReady = false;
 }
 
 void VideoService::nextRequest()
@@ -187,6 +290,15 @@ void VideoService::nextRequest()
         currentRequestExists = false;
 }
 
+void VideoService::channelEvent(QString event)
+{
+    qDebug() << "VideoService::channel event" << event;
+    if (event == "settings" || event == "settings_changed")
+        emit settingsChanged();
+    else if (event == "playlist" || event == "playlist_changed")
+        emit playlistChanged();
+}
+
 
 VideoServiceRequest::VideoServiceRequestParam::VideoServiceRequestParam(QString key, QString value)
 {
@@ -197,13 +309,11 @@ VideoServiceRequest::VideoServiceRequestParam::VideoServiceRequestParam(QString
 VideoServiceRequest VideoServiceRequestFabric::sendEventsRequest(QString data)
 {
     VideoServiceRequest result;
-    //result.body = data.toLocal8Bit();
-    qDebug() << "original size: " << data.toLocal8Bit().count();
-    result.body = SSLEncoder::compressGZIP(data.toLocal8Bit());
-    qDebug() << "upload body size = " << result.body.count();
+    //body is gzipped by VideoService::buildNetworkRequest
+    result.body = data.toUtf8();
+    qDebug() << "original size: " << result.body.count();
     result.knownHeaders[QNetworkRequest::ContentTypeHeader] = "application/json";
     result.headers["Authorization"] = GlobalConfigInstance.getToken();
-    result.headers["Content-Encoding"] = "gzip";
     result.methodAPI = "player/event";
     result.method = "POST";
     result.name = "statistics:events";
@@ -279,5 +389,30 @@ VideoServiceRequest VideoServiceRequestFabric::getUpdateVersion(QString platform
     result.methodAPI = "app/" + platform;
     result.name = "update";
     result.method = "GET";
+    //server can answer with delta from current version, unless last delta failed
+    VideoServiceRequest::VideoServiceRequestParam versionParam;
+    versionParam.key = "version";
+    versionParam.value = QString::number(TeleDSVersion::MAJOR) + "." + QString::number(TeleDSVersion::MINOR) + "." +
+                         QString::number(TeleDSVersion::RELEASE) + "." + QString::number(TeleDSVersion::BUILD);
+    result.params.append(versionParam);
+    if (!QFile::exists(TELEDS_PATCH_FAILED_MARKER))
+    {
+        VideoServiceRequest::VideoServiceRequestParam deltaParam;
+        deltaParam.key = "delta";
+        deltaParam.value = "1";
+        result.params.append(deltaParam);
+    }
+    return result;
+}
+
+VideoServiceRequest VideoServiceRequestFabric::subscribeChangesRequest()
+{
+    VideoServiceRequest result;
+    result.headers["Authorization"] = GlobalConfigInstance.getToken();
+    result.headers["Accept"] = "text/event-stream, application/json";
+    result.headers["Cache-Control"] = "no-cache";
+    result.methodAPI = "player/subscribe";
+    result.name = "subscribe";
+    result.method = "GET";
     return result;
 }
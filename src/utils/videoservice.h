@@ -8,6 +8,8 @@
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include "videoserviceresult.h"
+#include "httpcompression.h"
+#include "changechannel.h"
 
 //http://api.teleds.com/initialization
 
@@ -45,6 +47,7 @@ public:
     static VideoServiceRequest getPlaylistRequest();
     static VideoServiceRequest getSettingsRequest();
     static VideoServiceRequest getUpdateVersion(QString platform);
+    static VideoServiceRequest subscribeChangesRequest();
 };
 //---------------------------------------------------------------------
 class VideoService : public QObject
@@ -63,6 +66,12 @@ public:
     bool processReplyError(const QNetworkReply * reply, QString method);
     QString getServerURL() {return serverURL;}
 
+    //change channel - server pushes "settings"/"playlist" events (SSE or long-poll)
+    //while it is down player should rely on sheduler timer
+    void subscribeChanges();
+    void unsubscribeChanges();
+    bool isChangeChannelActive() const {return channel->isActive();}
+
 signals:
     void initResult(InitRequestResult result);
     void getPlaylistResult(PlayerConfigAPI result);
@@ -76,6 +85,10 @@ signals:
     void getPlayerSettingsRequestFinished(QNetworkReply * reply);
     void getUpdatesRequestFinished(QNetworkReply * reply);
 
+    void settingsChanged();
+    void playlistChanged();
+    void changeChannelStateChanged(bool active);
+
 public slots:
     void initVideoRequestFinishedSlot(QNetworkReply * reply);
     void getPlaylistRequestFinishedSlot(QNetworkReply * reply);
@@ -83,10 +96,17 @@ public slots:
     void getPlayerSettingsRequestFinishedSlot(QNetworkReply * reply);
     void getUpdatesRequestFinishedSlot(QNetworkReply * reply);
 
+private slots:
+    void replyReadyRead();
+    void channelEvent(QString event);
+
 private:
 
+    QNetworkRequest buildNetworkRequest(const VideoServiceRequest &request, QByteArray &data);
     void performRequest(VideoServiceRequest request);
     void nextRequest();
+    bool readReplyBody(bool last);
+    void finishReplyBody(QNetworkReply * reply);
 
 
     QQueue<VideoServiceRequest> requests;
@@ -95,6 +115,13 @@ private:
     bool currentRequestExists;
     QString serverURL;
     VideoServiceResponseHandler resultProcessor;
+
+    QNetworkReply * currentReply;
+    HTTPBodyDecoder replyDecoder;
+    QByteArray replyBody;
+    bool replyDecoderReady;
+
+    ChangeChannel * channel;
 };
 
 
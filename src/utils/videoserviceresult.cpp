@@ -16,13 +16,53 @@
 #include "globalstats.h"
 #include "sslencoder.h"
 #include "platformspecific.h"
+#include "platformdefines.h"
+#include "playliststreamparser.h"
+#include "idregistry.h"
 
 
 
 
 VideoServiceResponseHandler::VideoServiceResponseHandler(QObject *parent) : QObject(parent)
 {
+    playlistParser = new PlaylistStreamParser();
+    playlistStreaming = false;
+}
 
+VideoServiceResponseHandler::~VideoServiceResponseHandler()
+{
+    delete playlistParser;
+}
+
+bool VideoServiceResponseHandler::processBodyChunk(QNetworkReply *reply, const QString &requestName, const QByteArray &data)
+{
+    //only successful playlist is parsed on the fly, other replies are small
+    if (requestName != "playlist" || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200)
+        return false;
+    if (!playlistStreaming)
+    {
+        playlistStreaming = true;
+        playlistParser->reset();
+        playlistCacheFile.setFileName(CONFIG_FOLDER + "playlist.json_");
+        if (!playlistCacheFile.open(QFile::WriteOnly | QFile::Truncate))
+            qDebug() << "VideoServiceResponseHandler::cant open playlist cache file";
+    }
+    playlistParser->feed(data);
+    if (playlistCacheFile.isOpen())
+        playlistCacheFile.write(data);
+    return true;
+}
+
+QByteArray VideoServiceResponseHandler::readReplyBody(QNetworkReply *reply)
+{
+    //VideoService stores already decompressed body in "body" property
+    //truncated compressed body is not given to json parser at all
+    if (reply->property("bodyBroken").toBool())
+        return QByteArray();
+    QVariant body = reply->property("body");
+    if (body.isValid())
+        return body.toByteArray();
+    return reply->readAll();
 }
 
 void VideoServiceResponseHandler::initRequestResultReply(QNetworkReply *reply)
@@ -37,12 +77,12 @@ void VideoServiceResponseHandler::initRequestResultReply(QNetworkReply *reply)
         else
             result.error_id = -1;
         result.error_text = reply->errorString();
-        qDebug() << "INIT ERROR BODY: " << reply->readAll();
+        qDebug() << "INIT ERROR BODY: " << readReplyBody(reply);
         emit initResult(result);
     }
     else
     {
-        QByteArray data = reply->readAll();
+        QByteArray data = readReplyBody(reply);
         QJsonDocument doc = QJsonDocument::fromJson(data);
         InitRequestResult result = InitRequestResult::fromJson(doc.object());
         result.error_id = 0;
@@ -64,9 +104,15 @@ void VideoServiceResponseHandler::getPlaylistResultReply(QNetworkReply *reply)
             result.error_id = -1;
 
         qDebug() << "VideoServiceResponseHandler::getPlaylistResultReply -> network eror." << result.error_id;
+        if (playlistStreaming)
+        {
+            playlistStreaming = false;
+            playlistCacheFile.close();
+            playlistCacheFile.remove();
+        }
         if (result.error_id != -1)
         {
-            QByteArray replyData = reply->readAll();
+            QByteArray replyData = readReplyBody(reply);
             QJsonDocument doc = QJsonDocument::fromJson(replyData);
             QJsonObject root = doc.object();
             result.error = root["error"].toString();
@@ -84,11 +130,32 @@ void VideoServiceResponseHandler::getPlaylistResultReply(QNetworkReply *reply)
         }
         else
             error_id = -1;
-        QByteArray replyData = reply->readAll();
-        QJsonDocument doc = QJsonDocument::fromJson(replyData);
-        QJsonObject root = doc.object();
-        result = PlayerConfigAPI::fromJson(root, error_id == 0? true:false);
-        result.error_id = error_id;
+        if (playlistStreaming)
+        {
+            playlistStreaming = false;
+            playlistCacheFile.close();
+            if (playlistParser->isValid() && !reply->property("bodyBroken").toBool())
+            {
+                result = playlistParser->result();
+                result.error_id = error_id;
+                if (error_id == 0)
+                    GlobalConfigInstance.setPlaylistFile(playlistCacheFile.fileName());
+            }
+            else
+            {
+                qDebug() << "VideoServiceResponseHandler::getPlaylistResultReply -> broken playlist" << playlistParser->errorString();
+                playlistCacheFile.remove();
+                result.error_id = -1;
+            }
+        }
+        else
+        {
+            QByteArray replyData = readReplyBody(reply);
+            QJsonDocument doc = QJsonDocument::fromJson(replyData);
+            QJsonObject root = doc.object();
+            result = PlayerConfigAPI::fromJson(root, error_id == 0? true:false);
+            result.error_id = error_id;
+        }
 
     }
     emit getPlaylistResult(result);
@@ -105,7 +172,7 @@ void VideoServiceResponseHandler::sendStatisticEventsResultReply(QNetworkReply *
             result.error_id = httpStatus.toInt();
         else
             result.error_id = -1;
-        QByteArray replyData = reply->readAll();
+        QByteArray replyData = readReplyBody(reply);
         QJsonDocument doc = QJsonDocument::fromJson(replyData);
         QJsonObject root = doc.object();
         result.status = root["error"].toString();
@@ -129,7 +196,7 @@ void VideoServiceResponseHandler::getPlayerSettingsReply(QNetworkReply *reply)
             result.error_id = httpStatus.toInt();
         else
             result.error_id = -1;
-        QByteArray replyData = reply->readAll();
+        QByteArray replyData = readReplyBody(reply);
         QJsonDocument doc = QJsonDocument::fromJson(replyData);
         QJsonObject root = doc.object();
         result.error = root["error"].toString();
@@ -146,7 +213,7 @@ void VideoServiceResponseHandler::getPlayerSettingsReply(QNetworkReply *reply)
         }
         else
             error_id = 0;
-        QByteArray replyData = reply->readAll();
+        QByteArray replyData = readReplyBody(reply);
         QJsonDocument doc = QJsonDocument::fromJson(replyData);
         QJsonObject root = doc.object();
         qDebug() << "SettingsReply Error" << error_id;
@@ -180,14 +247,14 @@ void VideoServiceResponseHandler::getUpdatesReply(QNetworkReply *reply)
             result.error_id = -1;
 
         qDebug() << "VideoServiceResponseHandler::Settings -> network eror." << result.error_id;
-        QByteArray replyData = reply->readAll();
+        QByteArray replyData = readReplyBody(reply);
         QJsonDocument doc = QJsonDocument::fromJson(replyData);
         QJsonObject root = doc.object();
         result.error_text = root["error"].toString();
     }
     else
     {
-        QByteArray replyData = reply->readAll();
+        QByteArray replyData = readReplyBody(reply);
         QJsonDocument doc = QJsonDocument::fromJson(replyData);
         QJsonObject root = doc.object();
         result = UpdateInfoResult::fromJson(root);
@@ -283,6 +350,10 @@ SettingsRequestResult SettingsRequestResult::fromJson(QJsonObject data, bool nee
 
     result.player_id = data["player_id"].toString();
     result.send_logs = data["send_logs"].toInt();
+    result.sync_mode = data["sync_mode"].toString();
+    result.sync_group = data["sync_group"].toInt();
+    result.widget_data_max_size = data["widget_data_max_size"].toInt();
+    result.widget_data_spill_size = data["widget_data_spill_size"].toInt();
     result.hash = data["hash"].toString();
 
     if (needSave)
@@ -396,6 +467,7 @@ PlayerConfigAPI::Campaign PlayerConfigAPI::Campaign::fromJson(QJsonObject json)
 {
     PlayerConfigAPI::Campaign result;
     result.campaign_id = json["campaign_id"].toString();
+    result.campaign_handle = IdRegistryInstance.intern(result.campaign_id);
     result.duration = json["duration"].toInt();
     result.start_timestamp = timeFromJson(json["start_timestamp"]);
     result.end_timestamp = timeFromJson(json["end_timestamp"]);
@@ -445,6 +517,7 @@ PlayerConfigAPI::Campaign::Area PlayerConfigAPI::Campaign::Area::fromJson(QJsonO
 {
     PlayerConfigAPI::Campaign::Area result;
     result.area_id = json["area_id"].toString();
+    result.area_handle = IdRegistryInstance.intern(result.area_id);
     result.type = json["type"].toString();
     result.screen_height = json["campaign_height"].toInt();
     result.screen_width = json["campaign_width"].toInt();
@@ -478,6 +551,9 @@ PlayerConfigAPI::Campaign::Area::Content PlayerConfigAPI::Campaign::Area::Conten
     result.campaign_id = json["campaign_id"].toString();
     result.area_id = json["area_id"].toString();
     result.content_id = json["content_id"].toString();
+    result.content_handle = IdRegistryInstance.intern(result.content_id);
+    result.area_handle = IdRegistryInstance.intern(result.area_id);
+    result.campaign_handle = IdRegistryInstance.intern(result.campaign_id);
     result.payment_type = json["payment_type"].toString();
     result.play_order = json["play_order"].toInt();
     result.play_type = json["play_type"].toString();
@@ -592,6 +668,9 @@ UpdateInfoResult UpdateInfoResult::fromJson(QJsonObject data)
     result.file_hash = data["file_hash"].toString();
     result.file_size = data["file_size"].toInt();
     result.file_url = data["file_url"].toString();
+    result.delta_url = data["delta_url"].toString();
+    result.delta_hash = data["delta_hash"].toString();
+    result.delta_size = data["delta_size"].toInt();
     result.version_build = data["version_build"].toInt();
     result.version_major = data["version_major"].toInt();
     result.version_minor = data["version_minor"].toInt();
@@ -6,6 +6,7 @@
 #include <QJsonObject>
 #include <QDateTime>
 #include <QPolygon>
+#include <QFile>
 
 struct InitRequestResult
 {
@@ -36,6 +37,10 @@ struct UpdateInfoResult
     QString file_url;
     QString file_hash;
     int file_size;
+    //optional patch against version player reported, empty if server has no delta for it
+    QString delta_url;
+    QString delta_hash;
+    int delta_size;
 
     int error_id;
     QString error_text;
@@ -99,6 +104,12 @@ struct SettingsRequestResult
     bool is_paid;
     int volume;
     int send_logs;
+    //video wall sync: "leader", "follower" or empty
+    QString sync_mode;
+    int sync_group;
+    //local widget data server limits in KB, 0 - default
+    int widget_data_max_size;
+    int widget_data_spill_size;
     QString hash;
 };
 
@@ -124,6 +135,7 @@ struct PlayerConfigAPI
         int checkDateRange() const;
         int play_order;
         QString campaign_id;
+        quint32 campaign_handle = 0;
         int duration;
         QDateTime start_timestamp;
         QDateTime end_timestamp;
@@ -135,6 +147,7 @@ struct PlayerConfigAPI
         struct Area {
             static PlayerConfigAPI::Campaign::Area fromJson(QJsonObject json);
             QString area_id;
+            quint32 area_handle = 0;
             QString type;
             int x;
             int y;
@@ -155,6 +168,10 @@ struct PlayerConfigAPI
                 QString content_id;
                 QString area_id;
                 QString campaign_id;
+                //IdRegistry handles of ids above, 0 - empty id
+                quint32 content_handle = 0;
+                quint32 area_handle = 0;
+                quint32 campaign_handle = 0;
                 int play_order;
                 QString payment_type;
                 QString play_type;
@@ -196,11 +213,18 @@ struct PlayerConfigAPI
     QVector<PlayerConfigAPI::Campaign::Area::Content> items();
 };
 
+class PlaylistStreamParser;
+
 class VideoServiceResponseHandler : public QObject
 {
     Q_OBJECT
 public:
     explicit VideoServiceResponseHandler(QObject *parent = 0);
+    ~VideoServiceResponseHandler();
+
+    //VideoService passes every decoded chunk here
+    //returns true if chunk was consumed by stream parser and should not be buffered
+    bool processBodyChunk(QNetworkReply * reply, const QString &requestName, const QByteArray &data);
 
 signals:
     void initResult(InitRequestResult result);
@@ -216,6 +240,11 @@ public slots:
     void getPlayerSettingsReply(QNetworkReply * reply);
     void getUpdatesReply(QNetworkReply * reply);
 private:
+    static QByteArray readReplyBody(QNetworkReply * reply);
+
+    PlaylistStreamParser * playlistParser;
+    QFile playlistCacheFile;
+    bool playlistStreaming;
 };
 
 #endif // VIDEOSERVICERESULT_H
@@ -0,0 +1,282 @@
+#include <QtEndian>
+#include <QDebug>
+#include <string.h>
+#include "ziparchive.h"
+
+#define ZIP_EOCD_SIGNATURE 0x06054b50
+#define ZIP_CENTRAL_SIGNATURE 0x02014b50
+#define ZIP_LOCAL_SIGNATURE 0x04034b50
+#define ZIP_EOCD_SIZE 22
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_MAX_COMMENT 65535
+#define ZIP_ZIP64_EXTRA 0x0001
+#define ZIP_FLAG_ENCRYPTED 0x0001
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+namespace {
+
+quint16 le16(const char * p) {return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(p));}
+quint32 le32(const char * p) {return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(p));}
+quint64 le64(const char * p) {return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(p));}
+
+}
+
+ZipArchive::ZipArchive() : map(0)
+{
+
+}
+
+ZipArchive::~ZipArchive()
+{
+    if (map)
+        file.unmap(map);
+}
+
+bool ZipArchive::open(QString fileName)
+{
+    file.setFileName(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        qDebug() << "ZipArchive::open cannot open " + fileName;
+        return false;
+    }
+    //without map entries are read by seek/read
+    map = file.map(0, file.size());
+    if (!readIndex())
+    {
+        qDebug() << "ZipArchive::open " + fileName + " is not valid zip";
+        entries.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ZipArchive::getEntry(const QString &name, Entry &entry) const
+{
+    auto it = entries.find(name);
+    if (it == entries.end())
+        return false;
+    entry = it.value();
+    return true;
+}
+
+QByteArray ZipArchive::read(const Entry &entry)
+{
+    QByteArray result;
+    result.reserve(int(entry.size));
+    ZipEntryReader reader(this, entry);
+    while (!reader.atEnd())
+    {
+        QByteArray chunk = reader.readChunk();
+        if (reader.hasError())
+            return QByteArray();
+        result += chunk;
+    }
+    return result;
+}
+
+const uchar *ZipArchive::rawData(qint64 offset, qint64 size) const
+{
+    if (!map || offset < 0 || size < 0 || offset + size > file.size())
+        return 0;
+    return map + offset;
+}
+
+bool ZipArchive::readRaw(qint64 offset, char *data, qint64 size)
+{
+    const uchar * p = rawData(offset, size);
+    if (p)
+    {
+        memcpy(data, p, size);
+        return true;
+    }
+    return file.seek(offset) && file.read(data, size) == size;
+}
+
+bool ZipArchive::readIndex()
+{
+    //end of central directory record is followed only by comment
+    qint64 fileSize = file.size();
+    qint64 tailSize = qMin<qint64>(fileSize, ZIP_EOCD_SIZE + ZIP_MAX_COMMENT);
+    QByteArray tail(int(tailSize), 0);
+    if (tailSize < ZIP_EOCD_SIZE || !readRaw(fileSize - tailSize, tail.data(), tailSize))
+        return false;
+    int eocd = -1;
+    for (int i = tail.size() - ZIP_EOCD_SIZE; i >= 0; i--)
+        if (le32(tail.constData() + i) == ZIP_EOCD_SIGNATURE)
+        {
+            eocd = i;
+            break;
+        }
+    if (eocd < 0)
+        return false;
+    qint64 centralSize = le32(tail.constData() + eocd + 12);
+    qint64 centralOffset = le32(tail.constData() + eocd + 16);
+    //zip64 end of central directory is not supported, html5 packages never need it
+    if (centralOffset == 0xFFFFFFFF || centralOffset + centralSize > fileSize)
+        return false;
+
+    QByteArray central(int(centralSize), 0);
+    if (!readRaw(centralOffset, central.data(), centralSize))
+        return false;
+    const char * p = central.constData();
+    const char * end = p + central.size();
+    entries.reserve(le16(tail.constData() + eocd + 10));
+    char local[ZIP_LOCAL_SIZE];
+    while (end - p >= ZIP_CENTRAL_SIZE && le32(p) == ZIP_CENTRAL_SIGNATURE)
+    {
+        quint16 flags = le16(p + 8);
+        int nameLength = le16(p + 28);
+        int extraLength = le16(p + 30);
+        int commentLength = le16(p + 32);
+        if (end - p < ZIP_CENTRAL_SIZE + nameLength + extraLength + commentLength)
+            return false;
+        Entry entry;
+        entry.method = le16(p + 10);
+        entry.crc = le32(p + 16);
+        entry.compressedSize = le32(p + 20);
+        entry.size = le32(p + 24);
+        qint64 headerOffset = le32(p + 42);
+        entry.name = QString::fromUtf8(p + ZIP_CENTRAL_SIZE, nameLength);
+
+        //zip64 extra field holds only values which are 0xFFFFFFFF in header, in fixed order
+        const char * extra = p + ZIP_CENTRAL_SIZE + nameLength;
+        const char * extraEnd = extra + extraLength;
+        while (extraEnd - extra >= 4)
+        {
+            int id = le16(extra), size = le16(extra + 2);
+            const char * value = extra + 4;
+            if (id == ZIP_ZIP64_EXTRA)
+            {
+                const char * valueEnd = qMin(value + size, extraEnd);
+                if (entry.size == 0xFFFFFFFF && valueEnd - value >= 8)
+                    entry.size = le64(value), value += 8;
+                if (entry.compressedSize == 0xFFFFFFFF && valueEnd - value >= 8)
+                    entry.compressedSize = le64(value), value += 8;
+                if (headerOffset == 0xFFFFFFFF && valueEnd - value >= 8)
+                    headerOffset = le64(value);
+                break;
+            }
+            extra = value + size;
+        }
+        p += ZIP_CENTRAL_SIZE + nameLength + extraLength + commentLength;
+
+        if (entry.name.endsWith("/"))
+            continue;
+        if ((flags & ZIP_FLAG_ENCRYPTED) || (entry.method != ZIP_METHOD_STORED && entry.method != ZIP_METHOD_DEFLATED))
+        {
+            qDebug() << "ZipArchive::readIndex unsupported entry " + entry.name;
+            continue;
+        }
+        //local header has its own name and extra field lengths
+        if (!readRaw(headerOffset, local, ZIP_LOCAL_SIZE) || le32(local) != ZIP_LOCAL_SIGNATURE)
+            return false;
+        entry.dataOffset = headerOffset + ZIP_LOCAL_SIZE + le16(local + 26) + le16(local + 28);
+        if (entry.dataOffset + entry.compressedSize > fileSize)
+            return false;
+        entries[entry.name] = entry;
+    }
+    return true;
+}
+
+ZipEntryReader::ZipEntryReader(ZipArchive *archive, const ZipArchive::Entry &entry) :
+    archive(archive), entry(entry), streamReady(false), position(0), produced(0),
+    crc(crc32(0L, Z_NULL, 0)), finished(false), error(false)
+{
+    if (entry.method == ZIP_METHOD_DEFLATED)
+    {
+        memset(&stream, 0, sizeof(stream));
+        //raw deflate, zip has no zlib header
+        streamReady = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+        error = !streamReady;
+    }
+    if (entry.size == 0 && !error)
+        finish();
+}
+
+ZipEntryReader::~ZipEntryReader()
+{
+    if (streamReady)
+        inflateEnd(&stream);
+}
+
+QByteArray ZipEntryReader::readChunk(int maxSize)
+{
+    if (finished || error)
+        return QByteArray();
+
+    QByteArray chunk;
+    bool streamEnd = false;
+    if (entry.method == ZIP_METHOD_STORED)
+    {
+        int size = int(qMin<qint64>(maxSize, entry.size - position));
+        chunk.resize(size);
+        if (!archive->readRaw(entry.dataOffset + position, chunk.data(), size))
+        {
+            error = true;
+            return QByteArray();
+        }
+        position += size;
+    }
+    else
+    {
+        chunk.resize(maxSize);
+        stream.next_out = reinterpret_cast<Bytef*>(chunk.data());
+        stream.avail_out = maxSize;
+        while (stream.avail_out > 0 && !streamEnd)
+        {
+            if (stream.avail_in == 0 && !fillInput())
+            {
+                error = true;
+                return QByteArray();
+            }
+            int ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END)
+                streamEnd = true;
+            else if (ret != Z_OK)
+            {
+                error = true;
+                return QByteArray();
+            }
+        }
+        chunk.resize(maxSize - stream.avail_out);
+    }
+    produced += chunk.size();
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(chunk.constData()), chunk.size());
+    if (produced >= entry.size || streamEnd)
+        finish();
+    return chunk;
+}
+
+bool ZipEntryReader::fillInput()
+{
+    qint64 left = entry.compressedSize - position;
+    if (left <= 0)
+        return false;
+    //mapped data is inflated in place
+    qint64 size = qMin<qint64>(left, ZIP_ARCHIVE_CHUNK);
+    const uchar * data = archive->rawData(entry.dataOffset + position, size);
+    if (!data)
+    {
+        input.resize(int(size));
+        if (!archive->readRaw(entry.dataOffset + position, input.data(), size))
+            return false;
+        data = reinterpret_cast<const uchar*>(input.constData());
+    }
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = uInt(size);
+    position += size;
+    return true;
+}
+
+void ZipEntryReader::finish()
+{
+    finished = true;
+    if (produced != entry.size || crc != entry.crc)
+    {
+        qDebug() << "ZipEntryReader: entry " + entry.name + " is corrupted";
+        error = true;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef ZIPARCHIVE_H
+#define ZIPARCHIVE_H
+
+#include <QString>
+#include <QHash>
+#include <QFile>
+#include <QByteArray>
+#include <zlib.h>
+
+#define ZIP_ARCHIVE_CHUNK 65536
+
+//read-only access to zip files without extraction
+//central directory is read once into hash of entries, file data is taken from mapped file
+//entries are inflated on demand by ZipEntryReader
+class ZipArchive
+{
+public:
+    struct Entry
+    {
+        QString name;
+        quint16 method;
+        quint32 crc;
+        qint64 compressedSize;
+        qint64 size;
+        //position of entry data after local header
+        qint64 dataOffset;
+    };
+
+    ZipArchive();
+    ~ZipArchive();
+    bool open(QString fileName);
+    QString getFileName() const {return file.fileName();}
+    int count() const {return entries.count();}
+    bool contains(const QString &name) const {return entries.contains(name);}
+    bool getEntry(const QString &name, Entry &entry) const;
+    //whole entry, use only for small files
+    QByteArray read(const Entry &entry);
+
+    //pointer to mapped data or 0 if file is not mapped
+    const uchar * rawData(qint64 offset, qint64 size) const;
+    bool readRaw(qint64 offset, char * data, qint64 size);
+
+private:
+    bool readIndex();
+
+    QFile file;
+    uchar * map;
+    QHash<QString, Entry> entries;
+};
+
+//inflates one entry by chunks, crc and size are checked after last chunk
+class ZipEntryReader
+{
+public:
+    ZipEntryReader(ZipArchive * archive, const ZipArchive::Entry &entry);
+    ~ZipEntryReader();
+    //empty at the end or on error
+    QByteArray readChunk(int maxSize = ZIP_ARCHIVE_CHUNK);
+    bool atEnd() const {return finished;}
+    bool hasError() const {return error;}
+
+private:
+    bool fillInput();
+    void finish();
+
+    ZipArchive * archive;
+    ZipArchive::Entry entry;
+    z_stream stream;
+    bool streamReady;
+    QByteArray input;
+    qint64 position;
+    qint64 produced;
+    quint32 crc;
+    bool finished;
+    bool error;
+};
+
+#endif // ZIPARCHIVE_H
@@ -4,9 +4,12 @@
 #include "statisticdatabase.h"
 #include "globalstats.h"
 #include "globalconfig.h"
-#include "sunposition.h"
+#include "idregistry.h"
+#include "playbackclock.h"
+#include "syncservice.h"
 #include "version.h"
 #include "statictext.h"
+#include "zipcontentserver.h"
 
 #include "linux/input.h"
 
@@ -27,6 +30,7 @@ TeleDSPlayer::TeleDSPlayer(QObject *parent) : QObject(parent)
     view.setSource(QUrl(QStringLiteral("qrc:/main_player.qml")));
     viewRootObject = dynamic_cast<QObject*>(view.rootObject());
     view.setResizeMode(QQuickView::SizeRootObjectToView);
+    PlaybackClockInstance.setFrameSource(&view);
     QTimer::singleShot(500,this,SLOT(bindObjects()));
     QTimer::singleShot(500,this,SLOT(invokeVersionText()));
     QTimer::singleShot(500,this,SLOT(invokeSetLicenseData()));
@@ -63,8 +67,11 @@ TeleDSPlayer::TeleDSPlayer(QObject *parent) : QObject(parent)
     });
    // show();
     isSplitScreen = false;
-    nextCampaignTimer = new QTimer(this);
-    connect(nextCampaignTimer,SIGNAL(timeout()),this, SLOT(nextCampaignEvent()));
+    campaignDeadlineId = 0;
+    playingCampaignId = -1;
+    nextCampaignStart = -1;
+    connect(&SyncServiceInstance, SIGNAL(areaTimelineChanged(int)), this, SLOT(syncAreaTimeline(int)));
+    connect(&SyncServiceInstance, SIGNAL(campaignTimelineChanged(int,qint64)), this, SLOT(syncCampaignTimeline(int,qint64)));
     checkNextVideoAfterStopTimer = new QTimer(this);
     connect(checkNextVideoAfterStopTimer, SIGNAL(timeout()), this, SLOT(nextItemEvent()));
     checkNextVideoAfterStopTimer->setProperty("activated", false);
@@ -80,9 +87,8 @@ TeleDSPlayer::~TeleDSPlayer()
 
 QString TeleDSPlayer::getFullPath(QString fileName, AbstractPlaylist * playlist)
 {
-    QString nextFile =  VIDEO_FOLDER + fileName +
-                        playlist->findItemById(fileName).file_hash +
-                        playlist->findItemById(fileName).file_extension;
+    PlayerConfigAPI::Campaign::Area::Content item = playlist->findItemById(fileName);
+    QString nextFile =  VIDEO_FOLDER + fileName + item.file_hash + item.file_extension;
     QFileInfo fileInfo(nextFile);
     return QUrl::fromLocalFile(fileInfo.absoluteFilePath()).toString();
 }
@@ -118,6 +124,7 @@ void TeleDSPlayer::updateConfig(PlayerConfigAPI &playerConfig)
     foreach (const QString &key, playlists.keys())
         playlists[key]->deleteLater();
     playlists.clear();
+    playlistIndex.clear();
     foreach (const PlayerConfigAPI::Campaign &campaign, playerConfig.campaigns)
     {
         foreach (const PlayerConfigAPI::Campaign::Area area, campaign.areas)
@@ -125,6 +132,7 @@ void TeleDSPlayer::updateConfig(PlayerConfigAPI &playerConfig)
             AbstractPlaylist* playlist = new SuperPlaylist(this);
             playlist->updatePlaylist(area);
             playlists[area.area_id] = playlist;
+            playlistIndex.addArea(area, playlist);
         }
     }
     if (config.currentCampaignId < 0)
@@ -144,6 +152,9 @@ void TeleDSPlayer::play()
         currentCampaignId = 0;
 
     qDebug() << "currentCampaignId = " << currentCampaignId << config.campaigns.count();
+    qint64 campaignStart = nextCampaignStart >= 0 ? nextCampaignStart : PlaybackClockInstance.now();
+    nextCampaignStart = -1;
+    playingCampaignId = currentCampaignId;
     int duration = config.nextCampaign();
     duration -= config.campaigns[currentCampaignId].areas.first().content.count() * 50;
     if (config.campaigns.count() > 1)
@@ -186,10 +197,17 @@ void TeleDSPlayer::play()
         }
     }
 
+    qint64 campaignDeadline = -1;
     if (config.campaigns.count() > 1) {
-        nextCampaignTimer->setInterval(duration);
-        nextCampaignTimer->start();
+        campaignDeadline = campaignStart + duration;
+        PlaybackClockInstance.cancel(campaignDeadlineId);
+        campaignDeadlineId = PlaybackClockInstance.schedule(campaignDeadline, [this, campaignDeadline]() {
+            campaignDeadlineId = 0;
+            nextCampaignStart = campaignDeadline;
+            nextCampaignEvent();
+        });
     }
+    SyncServiceInstance.publishCampaign(playingCampaignId, campaignDeadline);
     wasEverPlayed = true;
 }
 
@@ -220,13 +238,7 @@ QString TeleDSPlayer::packAreas(QString oldAreas, QString area)
 
 PlayerConfigAPI::Campaign::Area TeleDSPlayer::getAreaById(QString id)
 {
-    PlayerConfigAPI::Campaign::Area result;
-    foreach (const PlayerConfigAPI::Campaign &cmp, config.campaigns)
-        foreach (const PlayerConfigAPI::Campaign::Area &area, cmp.areas)
-            if (area.area_id == id)
-                result = area;
-
-    return result;
+    return playlistIndex.area(id);
 }
 
 bool TeleDSPlayer::isPlaying()
@@ -305,7 +317,7 @@ void TeleDSPlayer::invokeNextVideoMethodAdvanced(QString name, QString area_id)
     else if (item.type == "html5_online")
         source = item.file_url;
     else if (item.type == "html5_zip")
-        source = getFullPathZip(VIDEO_FOLDER + item.content_id + "/index.html");
+        source = ZipContentServer::contentUrl(item.content_id + item.file_hash + item.file_extension);
 
     QVariant type;
     if (item.type == "html5_zip")
@@ -316,6 +328,8 @@ void TeleDSPlayer::invokeNextVideoMethodAdvanced(QString name, QString area_id)
     QVariant skip = item.play_start;
     QVariant fillMode = item.fill_mode;
 
+    //qml can ask for the next item synchronously, so this item has to be scheduled first
+    scheduleAreaItem(area_id, name, itemPlayDuration(item));
     QMetaObject::invokeMethod(viewRootObject, "playNextItem",
                               Q_ARG(QVariant, area_id),
                               Q_ARG(QVariant, source),
@@ -428,6 +442,7 @@ void TeleDSPlayer::invokeToggleVisibility(int status)
 void TeleDSPlayer::invokeSetDelay(int delay)
 {
     qDebug() << "TeleDSPlayer::invokeSetDelay";
+    this->delay = delay;
     QMetaObject::invokeMethod(viewRootObject, "setDelay", Q_ARG(QVariant, QVariant(delay)));
 }
 
@@ -461,7 +476,9 @@ void TeleDSPlayer::invokeDownloadingView()
 void TeleDSPlayer::invokeStop()
 {
     qDebug() << "TeleDSPlayer::invokeStop";
-    nextCampaignTimer->stop();
+    PlaybackClockInstance.cancel(campaignDeadlineId);
+    campaignDeadlineId = 0;
+    resetAreaClocks();
     QMetaObject::invokeMethod(viewRootObject, "stopPlayer");
 }
 
@@ -642,7 +659,25 @@ void TeleDSPlayer::invokeSetContentPosition(float contentLeft, float contentTop,
 void TeleDSPlayer::invokeSkipCurrentItem()
 {
     qDebug() << "TeleDSPlayer::invokeSkipCurrentItem";
-    QMetaObject::invokeMethod(viewRootObject, "skipCurrentItem");
+    //skipped items end right now in every area, so deadlines of next items are counted from this moment
+    bool skipped = false;
+    if (playingCampaignId >= 0 && playingCampaignId < config.campaigns.count())
+        foreach (const PlayerConfigAPI::Campaign::Area &area, config.campaigns[playingCampaignId].areas)
+        {
+            if (!areaClocks.contains(area.area_id) || !areaClocks[area.area_id].isRunning())
+                continue;
+            areaClocks[area.area_id].endNow(&PlaybackClockInstance);
+            areaItemEnd(area.area_id);
+            skipped = true;
+        }
+    //areas are not driven by clock, qml timers end current item
+    if (!skipped)
+        QMetaObject::invokeMethod(viewRootObject, "skipCurrentItem");
+}
+
+void TeleDSPlayer::invokeFinishAreaItem(QString area_id)
+{
+    QMetaObject::invokeMethod(viewRootObject, "finishAreaItem", Q_ARG(QVariant, QVariant(area_id)));
 }
 
 void TeleDSPlayer::invokeMenuDisplayRotationSelected()
@@ -840,29 +875,18 @@ void TeleDSPlayer::playNextGeneric(QString area_id)
     }
     //call haveNext instead
     //if haveNext has none then dont play anything
-    if (playlists[area_id]->haveNext())
+    //follower plays items chosen by sync leader when it has them
+    QString nextItem = syncNextItem(area_id);
+    if (!nextItem.isEmpty() || playlists[area_id]->haveNext())
     {
-        QString nextItem = playlists[area_id]->getStoredItem();
-        invokeNextVideoMethodAdvanced(nextItem,area_id);
-        if (GlobalConfigInstance.isAutoBrightnessActive())
-        {
-            SunsetSystem sunSystem;
-
-            double minBrightness = std::min(GlobalConfigInstance.getMinBrightness(), GlobalConfigInstance.getMaxBrightness());
-            double maxBrightness = std::max(GlobalConfigInstance.getMinBrightness(), GlobalConfigInstance.getMaxBrightness());
-            double brightnessSinValue = std::min(sunSystem.getSinPercent()*4.0,1.0);
-            double brightnessValue = brightnessSinValue * (maxBrightness - minBrightness) + minBrightness;
-            brightnessValue = std::max(std::min(brightnessValue, maxBrightness), minBrightness);
-            qDebug() << "BRIGHTNESS = " << brightnessValue;
-            if (brightnessValue/100. < 0)
-                setBrightness(1.0);
-            else
-                setBrightness(brightnessValue/100.);
-        }
+        if (nextItem.isEmpty())
+            nextItem = playlists[area_id]->getStoredItem();
         else
-            setBrightness(1.0);
-        playedIds.enqueue(nextItem);
-        PlatformSpecificService.generateSystemInfo();
+            registerSyncItem(area_id, nextItem);
+        //play event is queued by advanceAreaClock when item really starts
+        invokeNextVideoMethodAdvanced(nextItem,area_id);
+        if (SyncServiceInstance.isSynchronized())
+            syncAreaTimeline(areaIndexById(area_id));
 
         qDebug() << "set next playnextgeneric::status.isPlaying=true;";
         status.isPlaying = true;
@@ -898,6 +922,12 @@ void TeleDSPlayer::bindObjects()
     QObject::connect(viewRootObject,SIGNAL(setRestoreModeTrue()),this,SLOT(setRestoreModeTrue()));
     QObject::connect(viewRootObject,SIGNAL(setRestoreModeFalse()),this, SLOT(setRestoreModeFalse()));
     QObject::connect(viewRootObject,SIGNAL(nextItem(QString)), this, SLOT(next(QString)));
+    QObject::connect(viewRootObject,SIGNAL(itemTransition(QString,bool)), this, SLOT(itemTransition(QString,bool)));
+    connect(&PlaybackClockInstance, SIGNAL(frameRendered(qint64)), this, SLOT(transitionFrameRendered(qint64)));
+    QMetaObject::invokeMethod(viewRootObject, "setExternalClock", Q_ARG(QVariant, QVariant(true)));
+    //brightness follows the sun on its own timer, not item changes
+    connect(&brightness, SIGNAL(brightnessChanged(double)), this, SLOT(setBrightness(double)));
+    brightness.start();
 }
 
 
@@ -942,27 +972,58 @@ void TeleDSPlayer::gpsUpdate(double lat, double lgt)
 
 void TeleDSPlayer::systemInfoReady(Platform::SystemInfo info)
 {
-    foreach (const QString &areaId, playlists.keys())
+    //item no area knows (yet) stays queued for a few system infos,
+    //after that its playlist is surely replaced and event is dropped
+    QQueue<PlayedItem> unmatched;
+    while (!playedIds.isEmpty())
     {
-        auto playlist = playlists[areaId];
-        if (playlist){
-            while (!playedIds.isEmpty())
+        PlayedItem played = playedIds.dequeue();
+        AbstractPlaylist * playlist = playlistIndex.playlist(played.handle);
+        if (!playlist)
+        {
+            if (++played.retries > PLAY_EVENT_MAX_RETRIES)
+                qDebug() << "No area contains such item, play event is dropped" << IdRegistryInstance.name(played.handle);
+            else
             {
-                auto item = playlists[areaId]->findItemById(playedIds.head());
-                if (item.content_id != "")
-                {
-                    DatabaseInstance.createPlayEvent(item, info);
-                    playedIds.dequeue();
-                    //break;
-                }
-                else
-                {
-                    qDebug() << "This area doesnt contain such item";
-                    break;
-                }
+                qDebug() << "No area contains such item" << IdRegistryInstance.name(played.handle);
+                unmatched.enqueue(played);
             }
+            continue;
         }
+        DatabaseInstance.createPlayEvent(playlist->findItemByHandle(played.handle), info);
     }
+    playedIds = unmatched;
+}
+
+void TeleDSPlayer::itemTransition(QString area_id, bool prerolled)
+{
+    //latency is counted from end of previous item (clock deadline, not qml timer)
+    //to the first frame rendered with new item on screen
+    PendingTransition transition;
+    transition.itemEnd = PlaybackClockInstance.now();
+    if (areaClocks.contains(area_id) && areaClocks[area_id].start >= 0)
+        transition.itemEnd = areaClocks[area_id].start;
+    transition.prerolled = prerolled;
+    if (PlaybackClockInstance.isVsyncAligned())
+        pendingTransitions[area_id] = transition;
+    else
+    {
+        //nothing is rendered lately, frame swap may never come
+        int latency = int(qMax<qint64>(0, PlaybackClockInstance.now() - transition.itemEnd));
+        GlobalStatsInstance.registryTransition(area_id, latency, prerolled);
+    }
+}
+
+void TeleDSPlayer::transitionFrameRendered(qint64 time)
+{
+    if (pendingTransitions.isEmpty())
+        return;
+    for (auto it = pendingTransitions.constBegin(); it != pendingTransitions.constEnd(); ++it)
+    {
+        int latency = int(qMax<qint64>(0, time - it.value().itemEnd));
+        GlobalStatsInstance.registryTransition(it.key(), latency, it.value().prerolled);
+    }
+    pendingTransitions.clear();
 }
 
 void TeleDSPlayer::nextCampaignEvent()
@@ -992,3 +1053,147 @@ void TeleDSPlayer::invokeShowVideo(bool isVisible)
     QVariant isVisibleArg(isVisible);
     QMetaObject::invokeMethod(viewRootObject,"showVideo",Q_ARG(QVariant, isVisibleArg));
 }
+
+int TeleDSPlayer::itemPlayDuration(const PlayerConfigAPI::Campaign::Area::Content &item)
+{
+    int duration = item.duration;
+    if (item.type == "video" || item.type == "audio")
+        duration = std::max(duration, MIN_VIDEO_DURATION);
+    return duration + delay;
+}
+
+void TeleDSPlayer::scheduleAreaItem(const QString &area_id, const QString &item, int duration)
+{
+    AreaClock &areaClock = areaClocks[area_id];
+    if (areaClock.queue(item, duration))
+    {
+        //item is preloaded by qml and will be shown at current deadline
+        publishAreaClock(area_id);
+        return;
+    }
+    //area is idle, qml starts item right now
+    areaClock.startNow(&PlaybackClockInstance);
+    advanceAreaClock(area_id);
+}
+
+void TeleDSPlayer::advanceAreaClock(const QString &area_id)
+{
+    AreaClock &areaClock = areaClocks[area_id];
+    if (!areaClock.advance(&PlaybackClockInstance, [this, area_id]() { areaItemEnd(area_id); }))
+        return;
+    //item preloaded and then replaced (sync leader chose another one) never gets here, so it has no play event
+    PlayedItem played;
+    played.handle = IdRegistryInstance.find(areaClock.currentItem);
+    played.retries = 0;
+    playedIds.enqueue(played);
+    PlatformSpecificService.generateSystemInfo();
+    publishAreaClock(area_id);
+}
+
+void TeleDSPlayer::areaItemEnd(const QString &area_id)
+{
+    invokeFinishAreaItem(area_id);
+    advanceAreaClock(area_id);
+}
+
+void TeleDSPlayer::resetAreaClocks()
+{
+    for (auto it = areaClocks.begin(); it != areaClocks.end(); ++it)
+        it.value().cancel(&PlaybackClockInstance);
+    areaClocks.clear();
+}
+
+int TeleDSPlayer::areaIndexById(const QString &area_id)
+{
+    if (playingCampaignId < 0 || playingCampaignId >= config.campaigns.count())
+        return -1;
+    const QVector<PlayerConfigAPI::Campaign::Area> &areas = config.campaigns[playingCampaignId].areas;
+    for (int i = 0; i < areas.count(); ++i)
+        if (areas[i].area_id == area_id)
+            return i;
+    return -1;
+}
+
+void TeleDSPlayer::publishAreaClock(const QString &area_id)
+{
+    if (SyncServiceInstance.getMode() != SyncService::SYNC_LEADER)
+        return;
+    const AreaClock &areaClock = areaClocks[area_id];
+    SyncService::AreaTimeline timeline;
+    timeline.itemId = areaClock.currentItem;
+    timeline.start = areaClock.start;
+    timeline.deadline = areaClock.deadline;
+    if (!areaClock.queuedItems.isEmpty())
+        timeline.nextItemId = areaClock.queuedItems.head().first;
+    SyncServiceInstance.publishArea(areaIndexById(area_id), timeline);
+}
+
+QString TeleDSPlayer::syncNextItem(const QString &area_id)
+{
+    if (!SyncServiceInstance.isSynchronized())
+        return "";
+    SyncService::AreaTimeline timeline = SyncServiceInstance.getAreaTimeline(areaIndexById(area_id));
+    QString item;
+    if (!areaClocks.contains(area_id) || !areaClocks[area_id].isRunning())
+        item = timeline.itemId;
+    else if (timeline.nextItemId != areaClocks[area_id].currentItem)
+        item = timeline.nextItemId;
+    //leader didnt choose next item yet or this player doesnt have it - own playlist is used
+    if (item.isEmpty() || playlists[area_id]->findItemById(item).content_id.isEmpty())
+        return "";
+    return item;
+}
+
+void TeleDSPlayer::syncAreaTimeline(int areaIndex)
+{
+    if (!SyncServiceInstance.isSynchronized() || !isActive)
+        return;
+    if (playingCampaignId < 0 || playingCampaignId >= config.campaigns.count() ||
+        areaIndex < 0 || areaIndex >= config.campaigns[playingCampaignId].areas.count())
+        return;
+    QString area_id = config.campaigns[playingCampaignId].areas[areaIndex].area_id;
+    SyncService::AreaTimeline timeline = SyncServiceInstance.getAreaTimeline(areaIndex);
+    if (!areaClocks.contains(area_id) || !areaClocks[area_id].isRunning() || timeline.deadline < 0)
+        return;
+
+    AreaClock &areaClock = areaClocks[area_id];
+    if (qAbs(timeline.deadline - areaClock.deadline) > SYNC_MAX_DRIFT)
+    {
+        qDebug() << "TeleDSPlayer::sync area" << area_id << "deadline moved by" << timeline.deadline - areaClock.deadline << "ms";
+        areaClock.moveDeadline(&PlaybackClockInstance, timeline.deadline, [this, area_id]() { areaItemEnd(area_id); });
+    }
+    QString nextItem = syncNextItem(area_id);
+    if (!nextItem.isEmpty() && (areaClock.queuedItems.isEmpty() || areaClock.queuedItems.head().first != nextItem))
+    {
+        //leader item replaces preloaded one in the area queue, the same way playNextGeneric preloads it
+        registerSyncItem(area_id, nextItem);
+        invokeNextVideoMethodAdvanced(nextItem, area_id);
+        status.item = nextItem;
+        GlobalStatsInstance.setCurrentItem(nextItem);
+    }
+}
+
+void TeleDSPlayer::registerSyncItem(const QString &area_id, const QString &item)
+{
+    //item chosen by leader bypassed own playlist, so its last play time is registered here
+    PlayerConfigAPI::Campaign::Area::Content content = playlists[area_id]->findItemById(item);
+    GlobalStatsInstance.itemPlayed(content.area_handle, content.content_handle,
+                                   QDateTime::currentDateTimeUtc().addSecs(GlobalStatsInstance.getUTCOffset()));
+}
+
+void TeleDSPlayer::syncCampaignTimeline(int campaignIndex, qint64 deadline)
+{
+    if (!SyncServiceInstance.isSynchronized() || !campaignDeadlineId)
+        return;
+    if (campaignIndex != playingCampaignId)
+    {
+        qDebug() << "TeleDSPlayer::sync leader plays campaign" << campaignIndex << "instead of" << playingCampaignId;
+        return;
+    }
+    PlaybackClockInstance.cancel(campaignDeadlineId);
+    campaignDeadlineId = PlaybackClockInstance.schedule(deadline, [this, deadline]() {
+        campaignDeadlineId = 0;
+        nextCampaignStart = deadline;
+        nextCampaignEvent();
+    });
+}
@@ -13,8 +13,18 @@
 #include <QQueue>
 #include <QEvent>
 #include "playlist.h"
+#include "playlistindex.h"
 #include "platformspecific.h"
 #include "spacemediamenu.h"
+#include "brightnesscontroller.h"
+#include "areaclock.h"
+
+//video items are never shown less than this time
+#define MIN_VIDEO_DURATION 5000
+//follower moves its deadline to leader one if they differ more than this
+#define SYNC_MAX_DRIFT 20
+//played item no area knows is kept for this many system infos, then its play event is dropped
+#define PLAY_EVENT_MAX_RETRIES 3
 
 struct PlaylistContentId
 {
@@ -103,6 +113,7 @@ public slots:
     void invokeSetContentPosition(float contentLeft = 0.f, float contentTop = 0.f, float contentWidth = 100.f, float contentHeight = 100.f,
                                   float widgetLeft = 0.f, float widgetTop = 0.f, float widgetWidth = 0.f, float widgetHeight = 0.f);
     void invokeSkipCurrentItem();
+    void invokeFinishAreaItem(QString area_id);
 
     //SpaceMediaMenu QML methods
     void invokeMenuDisplayRotationSelected();
@@ -143,30 +154,64 @@ public slots:
     void gpsUpdate(double lat, double lgt);
 
     void systemInfoReady(Platform::SystemInfo info);
+    void itemTransition(QString area_id, bool prerolled);
+    void transitionFrameRendered(qint64 time);
+    void syncAreaTimeline(int areaIndex);
+    void syncCampaignTimeline(int campaignIndex, qint64 deadline);
 
     void nextCampaignEvent();
     void nextItemEvent();
     void invokeSetAreaMuted(int index, bool isMuted);
 protected:
     void invokeShowVideo(bool isVisible);
+    int itemPlayDuration(const PlayerConfigAPI::Campaign::Area::Content &item);
+    void scheduleAreaItem(const QString &area_id, const QString &item, int duration);
+    void advanceAreaClock(const QString &area_id);
+    void areaItemEnd(const QString &area_id);
+    void registerSyncItem(const QString &area_id, const QString &item);
+    void resetAreaClocks();
+    int areaIndexById(const QString &area_id);
+    void publishAreaClock(const QString &area_id);
+    QString syncNextItem(const QString &area_id);
 
     QQuickView view;
     SpaceMediaMenuBackend menu;
 
     QHash<QString, AbstractPlaylist*> playlists;
+    //lookup indexes, rebuilt in updateConfig
+    PlaylistIndex playlistIndex;
+    //area id -> transition waiting for its first rendered frame
+    struct PendingTransition
+    {
+        qint64 itemEnd;
+        bool prerolled;
+    };
+    QHash<QString, PendingTransition> pendingTransitions;
     bool isPlaylistRandom;
 
     PlayerConfigAPI config;
     QObject * viewRootObject;
-    QQueue<QString> playedIds;
+    //content handles (IdRegistry) waiting for play event
+    struct PlayedItem
+    {
+        quint32 handle;
+        int retries;
+    };
+    QQueue<PlayedItem> playedIds;
 
     CurrentItemStatus status;
     int delay;
     bool isActive;
     bool isSplitScreen;
-    QTimer * nextCampaignTimer;
+    QHash<QString, AreaClock> areaClocks;
+    int campaignDeadlineId;
+    //config.currentCampaignId points to the next campaign while this one is playing
+    int playingCampaignId;
+    //deadline of campaign which just ended, next campaign starts from it
+    qint64 nextCampaignStart;
     QTimer * checkNextVideoAfterStopTimer;
     bool shouldStop;
+    BrightnessController brightness;
 };
 
 #endif // RPIVIDEOPLAYER_H
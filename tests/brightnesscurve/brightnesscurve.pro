@@ -0,0 +1,14 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_brightnesscurve
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils
+
+SOURCES += tst_brightnesscurve.cpp \
+    ../../src/utils/brightnesscurve.cpp
+
+HEADERS += ../../src/utils/brightnesscurve.h
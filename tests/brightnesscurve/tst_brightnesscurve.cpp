@@ -0,0 +1,170 @@
+#include <QtTest>
+#include <math.h>
+#include "brightnesscurve.h"
+
+//curve samples are stored as float
+#define SAMPLE_TOLERANCE 1e-6
+//0 -> 1 in BRIGHTNESS_MAX_STEP steps
+#define MAX_STEPS_TO_TARGET 20
+
+//BrightnessCurve on fixed daylight window 06:00 - 18:00: sin curve sampling per minute,
+//scaling by min/max brightness, hysteresis and step limit of BrightnessController updates
+class TestBrightnessCurve : public QObject
+{
+    Q_OBJECT
+private slots:
+    void sinPercent_data();
+    void sinPercent();
+    void sampling_data();
+    void sampling();
+    void emptyCurve();
+    void scaling_data();
+    void scaling();
+    void step_data();
+    void step();
+    void stepsConverge();
+    void build();
+};
+
+void TestBrightnessCurve::sinPercent_data()
+{
+    QTest::addColumn<QTime>("time");
+    QTest::addColumn<QTime>("sunRise");
+    QTest::addColumn<QTime>("sunSet");
+    QTest::addColumn<double>("percent");
+
+    QTest::newRow("before sunrise") << QTime(5, 59) << QTime(6, 0) << QTime(18, 0) << 0.;
+    QTest::newRow("after sunset") << QTime(18, 1) << QTime(6, 0) << QTime(18, 0) << 0.;
+    QTest::newRow("sunrise") << QTime(6, 0) << QTime(6, 0) << QTime(18, 0) << 0.;
+    QTest::newRow("midday") << QTime(12, 0) << QTime(6, 0) << QTime(18, 0) << 1.;
+    QTest::newRow("quarter") << QTime(9, 0) << QTime(6, 0) << QTime(18, 0) << sin(M_PI * 3 / 4);
+    QTest::newRow("empty window") << QTime(12, 0) << QTime(12, 0) << QTime(12, 0) << 0.;
+    QTest::newRow("polar night") << QTime(12, 0) << QTime(18, 0) << QTime(6, 0) << 0.;
+}
+
+void TestBrightnessCurve::sinPercent()
+{
+    QFETCH(QTime, time);
+    QFETCH(QTime, sunRise);
+    QFETCH(QTime, sunSet);
+    QFETCH(double, percent);
+
+    QVERIFY(qAbs(BrightnessCurve::sinPercent(time, sunRise, sunSet) - percent) < SAMPLE_TOLERANCE);
+}
+
+void TestBrightnessCurve::sampling_data()
+{
+    QTest::addColumn<QTime>("time");
+    QTest::addColumn<double>("sample");
+
+    QTest::newRow("midnight") << QTime(0, 0) << 0.;
+    QTest::newRow("sunrise") << QTime(6, 0) << 0.;
+    //full brightness is reached at quarter of sin curve
+    QTest::newRow("morning") << QTime(6, 10) << std::min(sin(M_PI / 72) * 4, 1.);
+    QTest::newRow("seconds dropped") << QTime(6, 10, 59, 999) << std::min(sin(M_PI / 72) * 4, 1.);
+    QTest::newRow("quarter") << QTime(9, 0) << 1.;
+    QTest::newRow("midday") << QTime(12, 0) << 1.;
+    QTest::newRow("evening") << QTime(17, 50) << std::min(sin(M_PI / 72) * 4, 1.);
+    QTest::newRow("sunset") << QTime(18, 0) << 0.;
+    QTest::newRow("last minute") << QTime(23, 59, 59) << 0.;
+}
+
+void TestBrightnessCurve::sampling()
+{
+    QFETCH(QTime, time);
+    QFETCH(double, sample);
+
+    BrightnessCurve curve;
+    curve.build(QTime(6, 0), QTime(18, 0));
+    QVERIFY(!curve.isEmpty());
+    QVERIFY(qAbs(curve.sample(time) - sample) < SAMPLE_TOLERANCE);
+}
+
+void TestBrightnessCurve::emptyCurve()
+{
+    BrightnessCurve curve;
+    QVERIFY(curve.isEmpty());
+    QCOMPARE(curve.sample(QTime(12, 0)), 0.);
+    //not built curve gives min brightness
+    QVERIFY(qAbs(curve.brightness(QTime(12, 0), 20, 80) - 0.2) < SAMPLE_TOLERANCE);
+}
+
+void TestBrightnessCurve::scaling_data()
+{
+    QTest::addColumn<QTime>("time");
+    QTest::addColumn<double>("minBrightness");
+    QTest::addColumn<double>("maxBrightness");
+    QTest::addColumn<double>("brightness");
+
+    QTest::newRow("night") << QTime(2, 0) << 20. << 80. << 0.2;
+    QTest::newRow("day") << QTime(12, 0) << 20. << 80. << 0.8;
+    QTest::newRow("morning") << QTime(6, 10) << 20. << 80. << (std::min(sin(M_PI / 72) * 4, 1.) * 60 + 20) / 100;
+    QTest::newRow("swapped night") << QTime(2, 0) << 80. << 20. << 0.2;
+    QTest::newRow("swapped day") << QTime(12, 0) << 80. << 20. << 0.8;
+    QTest::newRow("fixed") << QTime(6, 10) << 50. << 50. << 0.5;
+    //broken config keeps screen on full brightness
+    QTest::newRow("negative") << QTime(2, 0) << -10. << 80. << 1.;
+}
+
+void TestBrightnessCurve::scaling()
+{
+    QFETCH(QTime, time);
+    QFETCH(double, minBrightness);
+    QFETCH(double, maxBrightness);
+    QFETCH(double, brightness);
+
+    BrightnessCurve curve;
+    curve.build(QTime(6, 0), QTime(18, 0));
+    QVERIFY(qAbs(curve.brightness(time, minBrightness, maxBrightness) - brightness) < SAMPLE_TOLERANCE);
+}
+
+void TestBrightnessCurve::step_data()
+{
+    QTest::addColumn<double>("current");
+    QTest::addColumn<double>("target");
+    QTest::addColumn<double>("next");
+
+    QTest::newRow("same") << 0.5 << 0.5 << 0.5;
+    QTest::newRow("inside hysteresis up") << 0.5 << 0.51 << 0.5;
+    QTest::newRow("inside hysteresis down") << 0.5 << 0.49 << 0.5;
+    QTest::newRow("small up") << 0.5 << 0.53 << 0.53;
+    QTest::newRow("small down") << 0.5 << 0.47 << 0.47;
+    QTest::newRow("limited up") << 0.5 << 0.9 << 0.55;
+    QTest::newRow("limited down") << 0.5 << 0.1 << 0.45;
+}
+
+void TestBrightnessCurve::step()
+{
+    QFETCH(double, current);
+    QFETCH(double, target);
+    QFETCH(double, next);
+
+    QVERIFY(qAbs(BrightnessCurve::step(current, target) - next) < SAMPLE_TOLERANCE);
+}
+
+void TestBrightnessCurve::stepsConverge()
+{
+    double current = 0.;
+    int steps = 0;
+    for (double next = BrightnessCurve::step(current, 1.); next != current; next = BrightnessCurve::step(current, 1.))
+    {
+        QVERIFY(qAbs(next - current) <= BRIGHTNESS_MAX_STEP + SAMPLE_TOLERANCE);
+        current = next;
+        QVERIFY(++steps <= MAX_STEPS_TO_TARGET);
+    }
+    //stops within hysteresis from target and stays there
+    QVERIFY(qAbs(1. - current) < BRIGHTNESS_HYSTERESIS);
+    QCOMPARE(BrightnessCurve::step(current, 1.), current);
+}
+
+void TestBrightnessCurve::build()
+{
+    BrightnessCurve curve;
+    QBENCHMARK {
+        curve.build(QTime(5, 12), QTime(20, 47));
+    }
+    QVERIFY(!curve.isEmpty());
+}
+
+QTEST_MAIN(TestBrightnessCurve)
+#include "tst_brightnesscurve.moc"
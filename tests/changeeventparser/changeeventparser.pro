@@ -0,0 +1,20 @@
+QT       += core network testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_changeeventparser
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils
+
+SOURCES += tst_changeeventparser.cpp \
+    ../../src/utils/changeeventparser.cpp \
+    ../../src/utils/changechannel.cpp \
+    ../../src/utils/httpcompression.cpp
+
+HEADERS += ../../src/utils/changeeventparser.h \
+    ../../src/utils/changechannel.h \
+    ../../src/utils/httpcompression.h
+
+LIBS += -lz
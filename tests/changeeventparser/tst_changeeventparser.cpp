@@ -0,0 +1,260 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "changeeventparser.h"
+#include "changechannel.h"
+#include "httpcompression.h"
+
+//stand-in for player/subscribe: answers every connection with next status from the list (last one repeats),
+//given content type and body chunks, then closes connection
+class StandInServer : public QObject
+{
+    Q_OBJECT
+public:
+    StandInServer(QByteArray contentType, QList<QByteArray> chunks, bool gzip = false) :
+        contentType(contentType), chunks(chunks), gzip(gzip), connections(0)
+    {
+        statuses << 200;
+        connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        server.listen(QHostAddress::LocalHost);
+    }
+    QUrl url() const {return QUrl(QString("http://127.0.0.1:%1/player/subscribe").arg(server.serverPort()));}
+
+    QList<int> statuses;
+    int connections;
+    QByteArray lastRequest;
+
+private slots:
+    void newConnection()
+    {
+        QTcpSocket * socket = server.nextPendingConnection();
+        connect(socket, SIGNAL(readyRead()), this, SLOT(requestRead()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+    void requestRead()
+    {
+        QTcpSocket * socket = qobject_cast<QTcpSocket*>(sender());
+        lastRequest = socket->readAll();
+        connections++;
+        int status = statuses.count() > 1 ? statuses.takeFirst() : statuses.first();
+        if (status != 200)
+        {
+            socket->write("HTTP/1.1 " + QByteArray::number(status) + " Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            return;
+        }
+        QByteArray head = "HTTP/1.1 200 OK\r\nContent-Type: " + contentType + "\r\nConnection: close\r\n";
+        if (gzip)
+            head += "Content-Encoding: gzip\r\n";
+        socket->write(head + "\r\n");
+        socket->flush();
+
+        QList<QByteArray> body = chunks;
+        if (gzip)
+        {
+            //compressed body split at arbitrary places
+            QByteArray compressed = HTTPBodyEncoder::gzip(chunks.isEmpty() ? QByteArray() : chunks.join(QByteArray()));
+            body.clear();
+            for (int i = 0; i < compressed.size(); i += 7)
+                body.append(compressed.mid(i, 7));
+        }
+        int delay = 0;
+        foreach (const QByteArray &chunk, body)
+        {
+            delay += 20;
+            QTimer::singleShot(delay, socket, [socket, chunk]() {socket->write(chunk); socket->flush();});
+        }
+        QTimer::singleShot(delay + 20, socket, [socket]() {socket->disconnectFromHost();});
+    }
+
+private:
+    QTcpServer server;
+    QByteArray contentType;
+    QList<QByteArray> chunks;
+    bool gzip;
+};
+
+//ChangeChannel the way VideoService builds it: request is taken from builder for every connection
+struct Channel
+{
+    explicit Channel(const QUrl &url) : ready(true), channel([this, url](QNetworkRequest &request) -> bool {
+            if (!ready)
+                return false;
+            request = QNetworkRequest(url);
+            return true;
+        }),
+        events(&channel, SIGNAL(eventReceived(QString))),
+        activeChanges(&channel, SIGNAL(activeChanged(bool)))
+    {
+    }
+    QStringList eventNames() const
+    {
+        QStringList result;
+        foreach (const QList<QVariant> &args, events)
+            result.append(args.first().toString());
+        return result;
+    }
+
+    bool ready;
+    ChangeChannel channel;
+    QSignalSpy events;
+    QSignalSpy activeChanges;
+};
+
+class TestChangeEventParser : public QObject
+{
+    Q_OBJECT
+private slots:
+    void sseSplitLines();
+    void sseDataFallback();
+    void sseUnterminatedEvent();
+    void jsonPrettyPrinted();
+    void jsonSingleEvent();
+    void contentTypeMode();
+    void standInSse();
+    void standInJson();
+    void standInGzip();
+    void shortPollBackoff();
+    void fallbackAndRecovery();
+    void notConfigured();
+};
+
+void TestChangeEventParser::sseSplitLines()
+{
+    ChangeEventParser parser;
+    parser.reset(ChangeEventParser::SSE);
+    QStringList events;
+    events += parser.feed(": heartbeat\r\nevent: play");
+    QVERIFY(events.isEmpty());
+    events += parser.feed("list\r\n");
+    QVERIFY(events.isEmpty());
+    events += parser.feed("\r\nevent: settings\n\n");
+    QCOMPARE(events, QStringList() << "playlist" << "settings");
+    QVERIFY(parser.finish().isEmpty());
+}
+
+void TestChangeEventParser::sseDataFallback()
+{
+    ChangeEventParser parser;
+    parser.reset(ChangeEventParser::SSE);
+    QCOMPARE(parser.feed("data: settings_changed\n\n"), QStringList() << "settings_changed");
+}
+
+void TestChangeEventParser::sseUnterminatedEvent()
+{
+    ChangeEventParser parser;
+    parser.reset(ChangeEventParser::SSE);
+    QVERIFY(parser.feed("event: playlist").isEmpty());
+    QCOMPARE(parser.finish(), QStringList() << "playlist");
+}
+
+void TestChangeEventParser::jsonPrettyPrinted()
+{
+    //every line of long-poll body must reach json parser
+    ChangeEventParser parser;
+    parser.reset(ChangeEventParser::JSON);
+    QVERIFY(parser.feed("{\n  \"events\": [\n").isEmpty());
+    QVERIFY(parser.feed("    \"playlist\",\n    \"settings\"\n  ]\n}\n").isEmpty());
+    QCOMPARE(parser.finish(), QStringList() << "playlist" << "settings");
+}
+
+void TestChangeEventParser::jsonSingleEvent()
+{
+    ChangeEventParser parser;
+    parser.reset(ChangeEventParser::JSON);
+    parser.feed("{\"event\":\"settings\"}\n");
+    QCOMPARE(parser.finish(), QStringList() << "settings");
+}
+
+void TestChangeEventParser::contentTypeMode()
+{
+    ChangeEventParser parser;
+    parser.reset(QString("application/json; charset=utf-8"));
+    QCOMPARE(parser.getMode(), ChangeEventParser::JSON);
+    parser.reset(QString("text/event-stream"));
+    QCOMPARE(parser.getMode(), ChangeEventParser::SSE);
+}
+
+void TestChangeEventParser::standInSse()
+{
+    StandInServer server("text/event-stream", QList<QByteArray>() << ": ping\n\n" << "event: pla" << "ylist\n\nevent: settings\n\n");
+    Channel c(server.url());
+    c.channel.start();
+    //active as soon as headers come, before any event
+    QTRY_VERIFY_WITH_TIMEOUT(c.channel.isActive(), 5000);
+    QTRY_COMPARE_WITH_TIMEOUT(c.eventNames(), QStringList() << "playlist" << "settings", 5000);
+    c.channel.stop();
+    QVERIFY(!c.channel.isActive());
+}
+
+void TestChangeEventParser::standInJson()
+{
+    StandInServer server("application/json", QList<QByteArray>() << "{\n  \"events\": [\n" << "    \"playlist\"\n  ]\n}\n");
+    Channel c(server.url());
+    c.channel.start();
+    QTRY_COMPARE_WITH_TIMEOUT(c.eventNames(), QStringList() << "playlist", 5000);
+    c.channel.stop();
+}
+
+void TestChangeEventParser::standInGzip()
+{
+    //qt must not inflate body itself, channel decoder does it
+    StandInServer server("text/event-stream", QList<QByteArray>() << "event: playlist\n\n" << "event: settings\n\n", true);
+    Channel c(server.url());
+    c.channel.start();
+    QTRY_COMPARE_WITH_TIMEOUT(c.eventNames(), QStringList() << "playlist" << "settings", 5000);
+    QVERIFY(server.lastRequest.toLower().contains("accept-encoding: gzip, deflate\r\n"));
+    c.channel.stop();
+}
+
+void TestChangeEventParser::shortPollBackoff()
+{
+    //server answers every poll at once: channel stays active, but reconnects after 1s, 2s, 4s... instead of spinning
+    StandInServer server("application/json", QList<QByteArray>() << "{}");
+    Channel c(server.url());
+    c.channel.start();
+    QTest::qWait(3500);
+    QVERIFY(c.channel.isActive());
+    QVERIFY(server.connections >= 2);
+    QVERIFY(server.connections <= 4);
+    QVERIFY(c.channel.getReconnectDelay() >= 4 * CHANNEL_MIN_RECONNECT_DELAY);
+    c.channel.stop();
+}
+
+void TestChangeEventParser::fallbackAndRecovery()
+{
+    StandInServer server("text/event-stream", QList<QByteArray>() << "event: playlist\n\n");
+    server.statuses = QList<int>() << 200 << 503 << 200;
+    Channel c(server.url());
+    c.channel.start();
+    QTRY_VERIFY_WITH_TIMEOUT(c.events.count() >= 1, 5000);
+    //503 - player falls back to sheduler timer
+    QTRY_VERIFY_WITH_TIMEOUT(!c.channel.isActive(), 5000);
+    QVERIFY(server.connections >= 2);
+    //server is back
+    QTRY_VERIFY_WITH_TIMEOUT(c.channel.isActive(), 10000);
+    QTRY_VERIFY_WITH_TIMEOUT(c.events.count() >= 2, 5000);
+    QCOMPARE(c.activeChanges.count() >= 3, true);
+    QCOMPARE(c.activeChanges.at(0).first().toBool(), true);
+    QCOMPARE(c.activeChanges.at(1).first().toBool(), false);
+    QCOMPARE(c.activeChanges.at(2).first().toBool(), true);
+    c.channel.stop();
+}
+
+void TestChangeEventParser::notConfigured()
+{
+    //no token yet: nothing is sent, channel retries until builder is ready
+    StandInServer server("text/event-stream", QList<QByteArray>() << "event: settings\n\n");
+    Channel c(server.url());
+    c.ready = false;
+    c.channel.start();
+    QTest::qWait(1500);
+    QCOMPARE(server.connections, 0);
+    QVERIFY(!c.channel.isActive());
+    c.ready = true;
+    QTRY_COMPARE_WITH_TIMEOUT(c.eventNames(), QStringList() << "settings", 5000);
+    c.channel.stop();
+}
+
+QTEST_MAIN(TestChangeEventParser)
+#include "tst_changeeventparser.moc"
@@ -0,0 +1,16 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_checksum
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils
+
+SOURCES += tst_checksum.cpp \
+    ../../src/utils/checksum.cpp
+
+HEADERS += ../../src/utils/checksum.h
+
+LIBS += -lz
@@ -0,0 +1,104 @@
+#include <QtTest>
+#include <zlib.h>
+#include "checksum.h"
+
+#define BENCH_SIZE (16 * 1024 * 1024)
+
+//crc32 throughput: Checksum::crc32 against zlib and byte-at-a-time table SSLEncoder::CRC32 used before
+//zlib stays in code which links it (minizip, nfs, zip archive, logger), Checksum is for code without zlib
+class TestChecksum : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void matchesZlib_data();
+    void matchesZlib();
+    void incremental();
+    void crc32_data();
+    void crc32();
+
+private:
+    static quint32 byteTableCrc32(quint32 crc, const uchar * p, qint64 size);
+    QByteArray data;
+};
+
+void TestChecksum::initTestCase()
+{
+    qsrand(1);
+    data.resize(BENCH_SIZE);
+    for (int i = 0; i < data.size(); i++)
+        data[i] = char(qrand());
+    qDebug() << "crc32 implementation:" << Checksum::crc32Implementation();
+}
+
+void TestChecksum::matchesZlib_data()
+{
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<int>("size");
+    //unaligned heads and tails around 8-byte blocks
+    foreach (int offset, QList<int>() << 0 << 1 << 3 << 7)
+        foreach (int size, QList<int>() << 0 << 1 << 7 << 8 << 9 << 63 << 4096 << 65537)
+            QTest::newRow(QString("%1+%2").arg(offset).arg(size).toLatin1()) << offset << size;
+}
+
+void TestChecksum::matchesZlib()
+{
+    QFETCH(int, offset);
+    QFETCH(int, size);
+    const char * p = data.constData() + offset;
+    QCOMPARE(Checksum::crc32(0, p, size), quint32(::crc32(0, reinterpret_cast<const Bytef*>(p), uInt(size))));
+}
+
+void TestChecksum::incremental()
+{
+    quint32 crc = 0;
+    for (int position = 0; position < 100000; position += 777)
+        crc = Checksum::crc32(crc, data.constData() + position, qMin(777, 100000 - position));
+    QCOMPARE(crc, quint32(::crc32(0, reinterpret_cast<const Bytef*>(data.constData()), 100000)));
+    QCOMPARE(Checksum::crc32(QByteArray("123456789")), quint32(0xCBF43926));
+}
+
+void TestChecksum::crc32_data()
+{
+    QTest::addColumn<int>("implementation");
+    QTest::newRow("byte-table") << 0;
+    QTest::newRow("checksum") << 1;
+    QTest::newRow("zlib") << 2;
+}
+
+void TestChecksum::crc32()
+{
+    QFETCH(int, implementation);
+    const uchar * p = reinterpret_cast<const uchar*>(data.constData());
+    quint32 crc = 0;
+    QBENCHMARK
+    {
+        if (implementation == 0)
+            crc = byteTableCrc32(0, p, data.size());
+        else if (implementation == 1)
+            crc = Checksum::crc32(0, p, data.size());
+        else
+            crc = quint32(::crc32(0, p, uInt(data.size())));
+    }
+    QCOMPARE(crc, quint32(::crc32(0, p, uInt(data.size()))));
+}
+
+quint32 TestChecksum::byteTableCrc32(quint32 crc, const uchar *p, qint64 size)
+{
+    static quint32 table[256] = {0};
+    if (table[1] == 0)
+        for (quint32 i = 0; i < 256; i++)
+        {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    crc = ~crc;
+    for (; size > 0; size--)
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+QTEST_MAIN(TestChecksum)
+#include "tst_checksum.moc"
@@ -0,0 +1,14 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_filepatch
+TEMPLATE = app
+
+INCLUDEPATH += ../../external/teledsDeployTool
+
+SOURCES += tst_filepatch.cpp \
+    ../../external/teledsDeployTool/teledsencoder.cpp
+
+HEADERS += ../../external/teledsDeployTool/teledsencoder.h
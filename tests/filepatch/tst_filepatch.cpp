@@ -0,0 +1,234 @@
+#include <QtTest>
+#include "teledsencoder.h"
+
+//old window search is quadratic, it is compared on slices of binaries only
+#define SLICE_SIZE (128 * 1024)
+#define OLD_WINDOW 16000
+#define OLD_MIN_PART 8
+//one edit per this many bytes in "rebuilt" binary
+#define EDIT_DISTANCE 2048
+
+//TeleDSPatcher::createFilePatch on real binaries: test executable itself, its "rebuilt" copy,
+//gcc driver binaries when they are installed and any pair given by TELEDS_PATCH_SRC/TELEDS_PATCH_DEST
+//patch must restore destination exactly and must not be larger than the one from window search it replaced
+class TestFilePatch : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void roundTrip_data();
+    void roundTrip();
+    void notLargerThanWindowSearch_data();
+    void notLargerThanWindowSearch();
+    void createFilePatch_data();
+    void createFilePatch();
+
+private:
+    static QByteArray rebuild(const QByteArray &data);
+    static QVector<DeltaPart> windowSearch(QByteArray srcData, QByteArray destData, int window, int minPartSize);
+    void addBinaryRows(bool sliced);
+    QByteArray binary;
+};
+
+void TestFilePatch::initTestCase()
+{
+    binary = TeleDSPatcher::readFile(QCoreApplication::applicationFilePath());
+    QVERIFY(binary.size() > 0);
+}
+
+void TestFilePatch::roundTrip_data()
+{
+    QTest::addColumn<QByteArray>("src");
+    QTest::addColumn<QByteArray>("dest");
+    QByteArray random(100000, 0);
+    qsrand(1);
+    for (int i = 0; i < random.size(); i++)
+        random[i] = char(qrand());
+    QTest::newRow("empty") << QByteArray() << QByteArray();
+    QTest::newRow("from-empty") << QByteArray() << random;
+    QTest::newRow("to-empty") << random << QByteArray();
+    QTest::newRow("short") << QByteArray("abc") << QByteArray("abcd");
+    QTest::newRow("identical") << random << random;
+    QTest::newRow("random-edit") << random << rebuild(random);
+    QTest::newRow("moved-blocks") << random << random.mid(60000) + random.left(60000);
+    QTest::newRow("zero-runs") << QByteArray(50000, 0) + random.left(1000) << random.left(1000) + QByteArray(70000, 0);
+    addBinaryRows(false);
+}
+
+void TestFilePatch::roundTrip()
+{
+    QFETCH(QByteArray, src);
+    QFETCH(QByteArray, dest);
+    QVector<DeltaPart> patch = TeleDSPatcher::createFilePatch(src, dest);
+    QByteArray applied = TeleDSPatcher::applyPatch(src, TeleDSPatcher::serializePatch(patch));
+    QCOMPARE(applied.size(), dest.size());
+    QVERIFY(applied == dest);
+}
+
+void TestFilePatch::notLargerThanWindowSearch_data()
+{
+    QTest::addColumn<QByteArray>("src");
+    QTest::addColumn<QByteArray>("dest");
+    addBinaryRows(true);
+}
+
+void TestFilePatch::notLargerThanWindowSearch()
+{
+    QFETCH(QByteArray, src);
+    QFETCH(QByteArray, dest);
+    QVector<DeltaPart> patch = TeleDSPatcher::createFilePatch(src, dest);
+    QVector<DeltaPart> oldPatch = windowSearch(src, dest, OLD_WINDOW, OLD_MIN_PART);
+    int size = TeleDSPatcher::serializePatch(patch).size();
+    int oldSize = TeleDSPatcher::serializePatch(oldPatch).size();
+    qDebug() << "patch" << size << "bytes, window search" << oldSize << "bytes";
+    QVERIFY(size <= oldSize);
+    QVERIFY(TeleDSPatcher::applyPatch(src, TeleDSPatcher::serializePatch(oldPatch)) == dest);
+}
+
+void TestFilePatch::createFilePatch_data()
+{
+    QTest::addColumn<QByteArray>("src");
+    QTest::addColumn<QByteArray>("dest");
+    addBinaryRows(false);
+}
+
+void TestFilePatch::createFilePatch()
+{
+    QFETCH(QByteArray, src);
+    QFETCH(QByteArray, dest);
+    QVector<DeltaPart> patch;
+    QBENCHMARK
+    {
+        patch = TeleDSPatcher::createFilePatch(src, dest);
+    }
+    QByteArray serialized = TeleDSPatcher::serializePatch(patch);
+    qDebug() << dest.size() << "bytes ->" << serialized.size() << "bytes patch";
+    QVERIFY(TeleDSPatcher::applyPatch(src, serialized) == dest);
+}
+
+void TestFilePatch::addBinaryRows(bool sliced)
+{
+    QList<QPair<QByteArray, QStringList> > pairs;
+    pairs.append(qMakePair(QByteArray("self-rebuilt"), QStringList()));
+    QString gccAr = QStandardPaths::findExecutable("gcc-ar"), gccNm = QStandardPaths::findExecutable("gcc-nm");
+    if (!gccAr.isEmpty() && !gccNm.isEmpty())
+        pairs.append(qMakePair(QByteArray("gcc-ar-nm"), QStringList() << gccAr << gccNm));
+    if (qEnvironmentVariableIsSet("TELEDS_PATCH_SRC") && qEnvironmentVariableIsSet("TELEDS_PATCH_DEST"))
+        pairs.append(qMakePair(QByteArray("env"), QStringList() << qgetenv("TELEDS_PATCH_SRC") << qgetenv("TELEDS_PATCH_DEST")));
+
+    for (int i = 0; i < pairs.count(); i++)
+    {
+        QByteArray src, dest;
+        if (pairs[i].second.isEmpty())
+        {
+            src = sliced ? binary.left(SLICE_SIZE) : binary;
+            dest = rebuild(src);
+        }
+        else
+        {
+            src = TeleDSPatcher::readFile(pairs[i].second[0]);
+            dest = TeleDSPatcher::readFile(pairs[i].second[1]);
+            if (sliced)
+            {
+                src = src.left(SLICE_SIZE);
+                dest = dest.left(SLICE_SIZE);
+            }
+        }
+        QTest::newRow(pairs[i].first.constData()) << src << dest;
+    }
+}
+
+QByteArray TestFilePatch::rebuild(const QByteArray &data)
+{
+    //rebuilt binary: changed addresses, inserted and removed code
+    QByteArray result;
+    result.reserve(data.size() + data.size() / 64);
+    qsrand(2);
+    int position = 0;
+    while (position < data.size())
+    {
+        int keep = qMin(EDIT_DISTANCE / 2 + qrand() % EDIT_DISTANCE, data.size() - position);
+        result.append(data.constData() + position, keep);
+        position += keep;
+        switch (qrand() % 3)
+        {
+        case 0:
+            for (int i = 0; i < 4; i++)
+                result.append(char(qrand()));
+            position += 4;
+            break;
+        case 1:
+            for (int i = qrand() % 64; i > 0; i--)
+                result.append(char(qrand()));
+            break;
+        default:
+            position += qrand() % 64;
+        }
+    }
+    return result;
+}
+
+QVector<DeltaPart> TestFilePatch::windowSearch(QByteArray srcData, QByteArray destData, int window, int minPartSize)
+{
+    //createFilePatch before rolling hash index
+    QVector<DeltaPart> patch;
+
+    DeltaPart dataPart;
+    dataPart.type = DeltaPart::DELTA_PART_DATA;
+    dataPart.offset = 0;
+    dataPart.size = 0;
+
+    int destDataCount = destData.count();
+    int srcDataCount = srcData.count();
+    const char * src = srcData.constData();
+    const char * dest = destData.constData();
+
+    for (int destIndex = 0; destIndex < destDataCount; destIndex++)
+    {
+        int bestMatchIndex = -1, bestMatchSize = -1;
+        for (int srcIndex = std::max(0, destIndex - window); srcIndex < destDataCount && srcIndex < srcDataCount && srcIndex < destIndex + window; srcIndex++)
+        {
+            int currentMatchIndex = -1, currentMatchSize = -1;
+            for (int i = 0; i < destDataCount - destIndex && i < srcDataCount - srcIndex; i++)
+            {
+                if (dest[destIndex + i] == src[srcIndex + i])
+                {
+                    currentMatchIndex = srcIndex;
+                    currentMatchSize = i + 1;
+                }
+                else
+                    break;
+            }
+            if (currentMatchSize > minPartSize && currentMatchSize > bestMatchSize)
+            {
+                bestMatchIndex = currentMatchIndex;
+                bestMatchSize = currentMatchSize;
+            }
+        }
+
+        if (bestMatchSize > minPartSize)
+        {
+            if (dataPart.data.count())
+            {
+                patch.append(dataPart);
+                dataPart.data.clear();
+            }
+            DeltaPart matchPart;
+            matchPart.type = DeltaPart::DELTA_PART_SOURCE;
+            matchPart.offset = bestMatchIndex;
+            matchPart.size = bestMatchSize;
+            patch.append(matchPart);
+            destIndex += bestMatchSize - 1;
+        }
+        else
+            dataPart.data.append(destData[destIndex]);
+    }
+
+    if (dataPart.data.count())
+        patch.append(dataPart);
+
+    return patch;
+}
+
+QTEST_MAIN(TestFilePatch)
+#include "tst_filepatch.moc"
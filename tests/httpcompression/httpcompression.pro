@@ -0,0 +1,16 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_httpcompression
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils
+
+SOURCES += tst_httpcompression.cpp \
+    ../../src/utils/httpcompression.cpp
+
+HEADERS += ../../src/utils/httpcompression.h
+
+LIBS += -lz
@@ -0,0 +1,187 @@
+#include <QtTest>
+#include <QBuffer>
+#include <zlib.h>
+#include "httpcompression.h"
+
+//encoder output chunk is 16 KB, rows around it check chunk boundaries
+#define ENCODER_CHUNK 16384
+//sink gets input written by this many bytes, like statistics are serialized
+#define SINK_WRITE_SIZE 1000
+//decoder is fed by small pieces, like readyRead gives them
+#define DECODER_PIECE 7
+
+//HTTPBodyEncoder output must be gzip which both HTTPBodyDecoder and plain zlib read back,
+//with single buffer (HTTPBodyEncoder::gzip) and with QIODevice sink
+class TestHttpCompression : public QObject
+{
+    Q_OBJECT
+private slots:
+    void gzip_data();
+    void gzip();
+    void sink_data();
+    void sink();
+    void sinkFails();
+    void truncated();
+    void gzipBenchmark();
+
+private:
+    void addRows();
+    static QByteArray random(int size, uint seed);
+    static QByteArray json(int size);
+    static QByteArray zlibGunzip(const QByteArray &data, bool &ok);
+    static QByteArray decoderGunzip(const QByteArray &data, int piece, bool &ok);
+};
+
+void TestHttpCompression::addRows()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("level");
+    QTest::newRow("empty") << QByteArray() << HTTP_GZIP_DEFAULT_LEVEL;
+    QTest::newRow("short") << QByteArray("{\"a\":1}") << HTTP_GZIP_DEFAULT_LEVEL;
+    QTest::newRow("chunk") << json(ENCODER_CHUNK) << HTTP_GZIP_DEFAULT_LEVEL;
+    QTest::newRow("random-chunk") << random(ENCODER_CHUNK, 1) << HTTP_GZIP_DEFAULT_LEVEL;
+    QTest::newRow("random-chunk+1") << random(ENCODER_CHUNK + 1, 2) << HTTP_GZIP_DEFAULT_LEVEL;
+    QTest::newRow("random-200k") << random(200000, 3) << HTTP_GZIP_DEFAULT_LEVEL;
+    QTest::newRow("json-1m") << json(1024 * 1024) << HTTP_GZIP_DEFAULT_LEVEL;
+    QTest::newRow("json-1m-level-1") << json(1024 * 1024) << 1;
+    QTest::newRow("json-1m-level-9") << json(1024 * 1024) << 9;
+}
+
+void TestHttpCompression::gzip_data()
+{
+    addRows();
+}
+
+void TestHttpCompression::gzip()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, level);
+    QByteArray compressed = HTTPBodyEncoder::gzip(data, level);
+    QVERIFY(compressed.startsWith(QByteArray("\x1f\x8b\x08", 3)));
+
+    bool ok = false;
+    QVERIFY(zlibGunzip(compressed, ok) == data);
+    QVERIFY(ok);
+    QVERIFY(decoderGunzip(compressed, compressed.size(), ok) == data);
+    QVERIFY(ok);
+    QVERIFY(decoderGunzip(compressed, DECODER_PIECE, ok) == data);
+    QVERIFY(ok);
+}
+
+void TestHttpCompression::sink_data()
+{
+    addRows();
+}
+
+void TestHttpCompression::sink()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, level);
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    HTTPBodyEncoder encoder(level, &buffer);
+    for (int i = 0; i < data.size(); i += SINK_WRITE_SIZE)
+        encoder.write(data.mid(i, SINK_WRITE_SIZE));
+    //everything went to sink, nothing is kept in encoder
+    QVERIFY(encoder.finish().isEmpty());
+    QVERIFY(!encoder.hasError());
+    buffer.close();
+
+    bool ok = false;
+    QVERIFY(zlibGunzip(buffer.data(), ok) == data);
+    QVERIFY(ok);
+    QVERIFY(decoderGunzip(buffer.data(), DECODER_PIECE, ok) == data);
+    QVERIFY(ok);
+}
+
+void TestHttpCompression::sinkFails()
+{
+    //sink is not open, write fails and encoder reports it
+    QBuffer buffer;
+    HTTPBodyEncoder encoder(HTTP_GZIP_DEFAULT_LEVEL, &buffer);
+    encoder.write(json(100000));
+    QVERIFY(encoder.finish().isEmpty());
+    QVERIFY(encoder.hasError());
+}
+
+void TestHttpCompression::truncated()
+{
+    QByteArray compressed = HTTPBodyEncoder::gzip(json(100000));
+    HTTPBodyDecoder decoder;
+    decoder.reset("gzip");
+    QByteArray out;
+    QVERIFY(decoder.decode(compressed.left(compressed.size() / 2), out));
+    QVERIFY(!decoder.finish(out));
+    QVERIFY(decoder.hasError());
+}
+
+void TestHttpCompression::gzipBenchmark()
+{
+    QByteArray data = json(4 * 1024 * 1024);
+    QByteArray compressed;
+    QBENCHMARK
+    {
+        compressed = HTTPBodyEncoder::gzip(data);
+    }
+    QVERIFY(compressed.size() < data.size() / 4);
+}
+
+QByteArray TestHttpCompression::random(int size, uint seed)
+{
+    QByteArray result(size, 0);
+    qsrand(seed);
+    for (int i = 0; i < size; i++)
+        result[i] = char(qrand());
+    return result;
+}
+
+QByteArray TestHttpCompression::json(int size)
+{
+    //statistics payload: many similar events with changing numbers
+    QByteArray result = "[";
+    for (int i = 0; result.size() < size; i++)
+        result += "{\"area_id\":\"" + QByteArray::number(i % 4) + "\",\"content_id\":\"c" + QByteArray::number(i % 97) +
+                  "\",\"time\":" + QByteArray::number(1500000000 + i * 15) + ",\"duration\":15000},";
+    return result.left(size);
+}
+
+QByteArray TestHttpCompression::zlibGunzip(const QByteArray &data, bool &ok)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    //16 - gzip wrapper only
+    ok = inflateInit2(&stream, MAX_WBITS + 16) == Z_OK;
+    if (!ok)
+        return QByteArray();
+    QByteArray result;
+    char buffer[ENCODER_CHUNK];
+    stream.next_in = (Bytef*)data.constData();
+    stream.avail_in = uInt(data.size());
+    int status;
+    do
+    {
+        stream.next_out = (Bytef*)buffer;
+        stream.avail_out = sizeof(buffer);
+        status = inflate(&stream, Z_NO_FLUSH);
+        result.append(buffer, int(sizeof(buffer) - stream.avail_out));
+    } while (status == Z_OK);
+    //footer crc and size are checked by zlib, whole input is one gzip member
+    ok = status == Z_STREAM_END && stream.avail_in == 0;
+    inflateEnd(&stream);
+    return result;
+}
+
+QByteArray TestHttpCompression::decoderGunzip(const QByteArray &data, int piece, bool &ok)
+{
+    HTTPBodyDecoder decoder;
+    decoder.reset("gzip");
+    QByteArray result;
+    ok = decoder.isCompressed();
+    for (int i = 0; ok && i < data.size(); i += piece)
+        ok = decoder.decode(data.mid(i, piece), result);
+    ok = ok && decoder.finish(result);
+    return result;
+}
+
+QTEST_MAIN(TestHttpCompression)
+#include "tst_httpcompression.moc"
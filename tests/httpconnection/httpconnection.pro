@@ -0,0 +1,24 @@
+QT       += core network testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_httpconnection
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/httpserver
+
+SOURCES += tst_httpconnection.cpp \
+    ../../src/httpserver/http_parser.c \
+    ../../src/httpserver/qhttpconnection.cpp \
+    ../../src/httpserver/qhttprequest.cpp \
+    ../../src/httpserver/qhttpresponse.cpp \
+    ../../src/httpserver/qhttpserver.cpp
+
+HEADERS += ../../src/httpserver/http_parser.h \
+    ../../src/httpserver/qhttpconnection.h \
+    ../../src/httpserver/qhttprequest.h \
+    ../../src/httpserver/qhttpresponse.h \
+    ../../src/httpserver/qhttpserver.h \
+    ../../src/httpserver/qhttpserverapi.h \
+    ../../src/httpserver/qhttpserverfwd.h
@@ -0,0 +1,180 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "qhttpserver.h"
+#include "qhttpconnection.h"
+#include "qhttprequest.h"
+#include "qhttpresponse.h"
+
+#define RESPONSE_TIMEOUT 5000
+//headers of a typical widget data request from webview
+#define REQUEST_TEMPLATE "GET /item/%1 HTTP/1.1\r\nHost: 127.0.0.1\r\nUser-Agent: Mozilla/5.0 (Linux; Android 5.1)\r\n" \
+                         "Accept: */*\r\nAccept-Encoding: gzip, deflate\r\nIf-None-Match: \"etag-%1\"\r\nConnection: keep-alive\r\n\r\n"
+
+//QHttpConnection for every loopback socket, every request is answered with its path as body
+class EchoServer : public QObject
+{
+    Q_OBJECT
+public:
+    EchoServer()
+    {
+        connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        server.listen(QHostAddress::LocalHost);
+    }
+    bool connectClient(QTcpSocket &client)
+    {
+        client.connectToHost(server.serverAddress(), server.serverPort());
+        return client.waitForConnected(RESPONSE_TIMEOUT);
+    }
+
+    QStringList paths;
+    QList<QByteArray> etags;
+
+private slots:
+    void newConnection()
+    {
+        while (server.hasPendingConnections())
+        {
+            QHttpConnection * connection = new QHttpConnection(server.nextPendingConnection(), this);
+            connect(connection, SIGNAL(newRequest(QHttpRequest*,QHttpResponse*)), this, SLOT(newRequest(QHttpRequest*,QHttpResponse*)));
+        }
+    }
+    void newRequest(QHttpRequest * request, QHttpResponse * response)
+    {
+        QByteArray body = request->path().toLatin1();
+        paths.append(request->path());
+        etags.append(request->rawHeader("if-none-match"));
+        response->setHeader("Content-Length", QString::number(body.size()));
+        response->writeHead(200);
+        response->end(body);
+        request->deleteLater();
+    }
+
+private:
+    //QHttpServer is created only for STATUS_CODES
+    QHttpServer statusCodes;
+    QTcpServer server;
+};
+
+//client sends requests pipelined over one keep-alive connection
+class TestHttpConnection : public QObject
+{
+    Q_OBJECT
+private slots:
+    void pipelinedInOrder();
+    void rawHeaders();
+    void connectionClose();
+    void pipelined_data();
+    void pipelined();
+
+private:
+    static QByteArray requests(int first, int count);
+    QByteArray exchange(QTcpSocket &client, const QByteArray &data, int responses);
+
+    EchoServer server;
+};
+
+QByteArray TestHttpConnection::requests(int first, int count)
+{
+    QByteArray result;
+    for (int i = first; i < first + count; i++)
+        result.append(QString(REQUEST_TEMPLATE).arg(i).toLatin1());
+    return result;
+}
+
+QByteArray TestHttpConnection::exchange(QTcpSocket &client, const QByteArray &data, int responses)
+{
+    QByteArray received;
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    connect(&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+    QMetaObject::Connection connection = connect(&client, &QTcpSocket::readyRead, [&]() {
+        received.append(client.readAll());
+        if (received.count("HTTP/1.1 200 OK") >= responses)
+            loop.quit();
+    });
+    client.write(data);
+    timeout.start(RESPONSE_TIMEOUT);
+    loop.exec();
+    disconnect(connection);
+    return received;
+}
+
+void TestHttpConnection::pipelinedInOrder()
+{
+    QTcpSocket client;
+    QVERIFY(server.connectClient(client));
+    server.paths.clear();
+
+    //two batches: second one is parsed after first requests are deleted and header buffer is reused
+    for (int batch = 0; batch < 2; batch++)
+    {
+        QByteArray received = exchange(client, requests(batch * 16, 16), 16);
+        QCOMPARE(received.count("HTTP/1.1 200 OK"), 16);
+        int position = 0;
+        for (int i = batch * 16; i < batch * 16 + 16; i++)
+        {
+            QByteArray body = QString("/item/%1").arg(i).toLatin1();
+            int found = received.indexOf("\r\n\r\n" + body, position);
+            QVERIFY2(found >= 0, body.constData());
+            position = found + body.size();
+        }
+        QTest::qWait(10);
+    }
+    QCOMPARE(server.paths.count(), 32);
+    QCOMPARE(server.paths.last(), QString("/item/31"));
+    QCOMPARE(client.state(), QAbstractSocket::ConnectedState);
+}
+
+void TestHttpConnection::rawHeaders()
+{
+    QTcpSocket client;
+    QVERIFY(server.connectClient(client));
+    server.etags.clear();
+
+    //header split across reads and mixed case names
+    QByteArray request = "GET /split HTTP/1.1\r\nHoSt: 127.0.0.1\r\nIF-NONE-MATCH: \"abc\"\r\n\r\n";
+    client.write(request.left(20));
+    client.flush();
+    QTest::qWait(20);
+    QByteArray received = exchange(client, request.mid(20), 1);
+    QCOMPARE(received.count("HTTP/1.1 200 OK"), 1);
+    QCOMPARE(server.etags, QList<QByteArray>() << "\"abc\"");
+}
+
+void TestHttpConnection::connectionClose()
+{
+    QTcpSocket client;
+    QVERIFY(server.connectClient(client));
+
+    QByteArray received = exchange(client, "GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\nConnection: close\r\n\r\n", 2);
+    QCOMPARE(received.count("HTTP/1.1 200 OK"), 2);
+    QVERIFY(received.contains("Connection: close"));
+    QTRY_COMPARE_WITH_TIMEOUT(client.state(), QAbstractSocket::UnconnectedState, RESPONSE_TIMEOUT);
+}
+
+void TestHttpConnection::pipelined_data()
+{
+    QTest::addColumn<int>("depth");
+    QTest::newRow("1") << 1;
+    QTest::newRow("16") << 16;
+    QTest::newRow("64") << 64;
+}
+
+void TestHttpConnection::pipelined()
+{
+    QFETCH(int, depth);
+    QTcpSocket client;
+    QVERIFY(server.connectClient(client));
+    QByteArray batch = requests(0, depth);
+    int received = 0;
+    QBENCHMARK
+    {
+        received = exchange(client, batch, depth).count("HTTP/1.1 200 OK");
+    }
+    QCOMPARE(received, depth);
+}
+
+QTEST_MAIN(TestHttpConnection)
+#include "tst_httpconnection.moc"
@@ -0,0 +1,14 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_lfsr
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils
+
+SOURCES += tst_lfsr.cpp \
+    ../../src/utils/lfsrencoder.cpp
+
+HEADERS += ../../src/utils/lfsrencoder.h
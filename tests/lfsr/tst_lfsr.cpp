@@ -0,0 +1,153 @@
+#include <QtTest>
+#include "lfsrencoder.h"
+
+#define BENCH_SIZE (16 * 1024 * 1024)
+#define RANDOM_SEEDS 2000
+#define CHECK_SIZE 4099
+
+//LFSR::Stream table walk against bit-per-step loop it replaced
+//key stream must match bit for bit for any seed (zero, positive, negative) and any split of data
+class TestLfsr : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void matchesBitLoop_data();
+    void matchesBitLoop();
+    void randomSeeds();
+    void randomChunks();
+    void encoderRoundTrip();
+    void process_data();
+    void process();
+
+private:
+    static void bitLoop(int &seed, char * data, qint64 size);
+    static int randomSeed();
+    QByteArray data;
+};
+
+void TestLfsr::initTestCase()
+{
+    qsrand(1);
+    data.resize(BENCH_SIZE);
+    for (int i = 0; i < data.size(); i++)
+        data[i] = char(qrand());
+}
+
+void TestLfsr::matchesBitLoop_data()
+{
+    QTest::addColumn<int>("seed");
+    QTest::addColumn<int>("size");
+    //zero seed gives zero key, positive ones take up to 4 bytes of slow loop before top bit is set
+    foreach (int seed, QList<int>() << 0 << 1 << 2 << 0x55 << 0x7FFFFFFF << 0x40000000 << int(0x80000000) << -1 << int(0xDEADBEEF))
+        foreach (int size, QList<int>() << 0 << 1 << 3 << 4 << 5 << 8 << 9 << 64 << 1000)
+            QTest::newRow(QString("%1/%2").arg(quint32(seed), 8, 16, QChar('0')).arg(size).toLatin1()) << seed << size;
+}
+
+void TestLfsr::matchesBitLoop()
+{
+    QFETCH(int, seed);
+    QFETCH(int, size);
+    QByteArray expected = data.left(size), actual = data.left(size);
+    int referenceSeed = seed;
+    bitLoop(referenceSeed, expected.data(), expected.size());
+    LFSR::Stream(seed).process(actual.data(), actual.size());
+    QCOMPARE(actual, expected);
+}
+
+void TestLfsr::randomSeeds()
+{
+    for (int n = 0; n < RANDOM_SEEDS; n++)
+    {
+        int seed = randomSeed();
+        QByteArray expected = data.left(CHECK_SIZE), actual = expected;
+        int referenceSeed = seed;
+        bitLoop(referenceSeed, expected.data(), expected.size());
+        LFSR::Stream(seed).process(actual.data(), actual.size());
+        QVERIFY2(actual == expected, QByteArray::number(seed, 16).constData());
+    }
+}
+
+void TestLfsr::randomChunks()
+{
+    //stream keeps register between calls, any split gives the same result as one call
+    for (int n = 0; n < RANDOM_SEEDS / 10; n++)
+    {
+        int seed = n == 0 ? 0 : randomSeed();
+        QByteArray expected = data.left(CHECK_SIZE), actual = expected;
+        int referenceSeed = seed;
+        bitLoop(referenceSeed, expected.data(), expected.size());
+        LFSR::Stream stream(seed);
+        int position = 0;
+        while (position < actual.size())
+        {
+            int chunk = qMin(qrand() % 40, actual.size() - position);
+            stream.process(actual.data() + position, chunk);
+            position += chunk;
+        }
+        QVERIFY2(actual == expected, QByteArray::number(seed, 16).constData());
+    }
+}
+
+void TestLfsr::encoderRoundTrip()
+{
+    QByteArray encoded = data.left(CHECK_SIZE);
+    LFSR::Encoder::encode(encoded, "pass");
+    QVERIFY(encoded != data.left(CHECK_SIZE));
+    LFSR::Stream stream("pass");
+    stream.process(encoded.data(), 100);
+    stream.process(encoded.data() + 100, encoded.size() - 100);
+    QCOMPARE(encoded, data.left(CHECK_SIZE));
+}
+
+void TestLfsr::process_data()
+{
+    QTest::addColumn<bool>("table");
+    QTest::newRow("bit-loop") << false;
+    QTest::newRow("stream") << true;
+}
+
+void TestLfsr::process()
+{
+    QFETCH(bool, table);
+    QByteArray buffer = data;
+    QBENCHMARK
+    {
+        int seed = int(0xDEADBEEF);
+        if (table)
+            LFSR::Stream(seed).process(buffer.data(), buffer.size());
+        else
+            bitLoop(seed, buffer.data(), buffer.size());
+    }
+}
+
+void TestLfsr::bitLoop(int &seed, char *data, qint64 size)
+{
+    for (qint64 i = 0; i < size; ++i)
+    {
+        char currentByte = 0;
+        for (int bitIndex = 0; bitIndex < 8; ++bitIndex)
+        {
+            if (seed & 0x00000001)
+            {
+                seed = (seed ^ 0x80000057 >> 1) | 0x80000000;
+                currentByte |= (1 << bitIndex);
+            }
+            else
+                seed >>= 1;
+        }
+        data[i] = data[i] ^ currentByte;
+    }
+}
+
+int TestLfsr::randomSeed()
+{
+    //every 4th seed is positive: top bit cleared
+    quint32 seed = (quint32(qrand()) << 20) ^ (quint32(qrand()) << 10) ^ quint32(qrand());
+    if (qrand() % 4 == 0)
+        seed &= 0x7FFFFFFF;
+    return int(seed);
+}
+
+QTEST_MAIN(TestLfsr)
+#include "tst_lfsr.moc"
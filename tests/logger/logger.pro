@@ -0,0 +1,18 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_logger
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils ../../src/core
+
+SOURCES += tst_logger.cpp \
+    ../../src/utils/logger.cpp \
+    ../../src/utils/metrics.cpp
+
+HEADERS += ../../src/utils/logger.h \
+    ../../src/utils/metrics.h
+
+LIBS += -lz
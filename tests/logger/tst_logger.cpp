@@ -0,0 +1,222 @@
+#include <QtTest>
+#include <QThread>
+#include "logger.h"
+
+#define PRODUCER_COUNT 4
+#define PRODUCER_RECORDS 20000
+
+static LogRecord makeRecord(qint64 time, int level, int category, const QByteArray &message)
+{
+    LogRecord record;
+    record.time = time;
+    record.level = quint8(level);
+    record.category = quint8(category);
+    record.message = message;
+    return record;
+}
+
+//pushes numbered records, retries when ring is full so nothing is lost
+class Producer : public QThread
+{
+public:
+    Producer(LogRing * ring, int id) : ring(ring), id(id) {}
+protected:
+    void run()
+    {
+        for (int i = 0; i < PRODUCER_RECORDS; i++)
+        {
+            LogRecord record = makeRecord(i, 0, id, QByteArray::number(i));
+            while (!ring->push(record))
+                QThread::yieldCurrentThread();
+        }
+    }
+private:
+    LogRing * ring;
+    int id;
+};
+
+//ring buffer and binary file format of Logger
+class TestLogger : public QObject
+{
+    Q_OBJECT
+private slots:
+    void ringPushPop();
+    void ringFull();
+    void ringWrapAround();
+    void ringProducers();
+    void decodeRoundTrip();
+    void decodeTruncated();
+    void ringThroughput();
+    void encodeThroughput();
+
+private:
+    static QByteArray expectedLine(qint64 time, int level, int category, const QByteArray &message);
+};
+
+QByteArray TestLogger::expectedLine(qint64 time, int level, int category, const QByteArray &message)
+{
+    return QDateTime::fromMSecsSinceEpoch(time).toString("yyyy-MM-dd hh:mm:ss.zzz ").toLatin1() +
+           Logger::levelName(level).toLatin1() + " " + Logger::categoryName(category).toLatin1() + ": " + message + "\n";
+}
+
+void TestLogger::ringPushPop()
+{
+    QScopedPointer<LogRing> ring(new LogRing());
+    LogRecord record;
+    QVERIFY(!ring->pop(record));
+    QVERIFY(ring->push(makeRecord(10, LOG_INFO, LOG_PLAYER, "first")));
+    QVERIFY(ring->push(makeRecord(20, LOG_ERROR, LOG_SYNC, "second")));
+    QVERIFY(ring->pop(record));
+    QCOMPARE(record.time, qint64(10));
+    QCOMPARE(int(record.level), int(LOG_INFO));
+    QCOMPARE(int(record.category), int(LOG_PLAYER));
+    QCOMPARE(record.message, QByteArray("first"));
+    QVERIFY(ring->pop(record));
+    QCOMPARE(record.message, QByteArray("second"));
+    QVERIFY(!ring->pop(record));
+}
+
+void TestLogger::ringFull()
+{
+    QScopedPointer<LogRing> ring(new LogRing());
+    for (int i = 0; i < LOG_RING_SIZE; i++)
+        QVERIFY(ring->push(makeRecord(i, 0, 0, QByteArray::number(i))));
+    //full ring drops instead of blocking
+    QVERIFY(!ring->push(makeRecord(-1, 0, 0, "dropped")));
+    LogRecord record;
+    QVERIFY(ring->pop(record));
+    QCOMPARE(record.time, qint64(0));
+    QVERIFY(ring->push(makeRecord(LOG_RING_SIZE, 0, 0, "last")));
+    for (int i = 1; i <= LOG_RING_SIZE; i++)
+    {
+        QVERIFY(ring->pop(record));
+        QCOMPARE(record.time, qint64(i));
+    }
+    QVERIFY(!ring->pop(record));
+}
+
+void TestLogger::ringWrapAround()
+{
+    QScopedPointer<LogRing> ring(new LogRing());
+    LogRecord record;
+    //sequence numbers go around the ring many times
+    for (int i = 0; i < LOG_RING_SIZE * 5 + 7; i++)
+    {
+        QVERIFY(ring->push(makeRecord(i, 0, 0, QByteArray::number(i))));
+        if (i % 3 == 0)
+            QVERIFY(ring->push(makeRecord(-i, 0, 0, "extra")));
+        QVERIFY(ring->pop(record));
+        if (i % 3 == 0)
+            QVERIFY(ring->pop(record));
+    }
+    QVERIFY(!ring->pop(record));
+}
+
+void TestLogger::ringProducers()
+{
+    QScopedPointer<LogRing> ring(new LogRing());
+    QList<Producer*> producers;
+    for (int i = 0; i < PRODUCER_COUNT; i++)
+        producers.append(new Producer(ring.data(), i));
+    foreach (Producer * producer, producers)
+        producer->start();
+
+    //single consumer: every record arrives once and in order of its producer
+    QVector<qint64> next(PRODUCER_COUNT, 0);
+    int received = 0;
+    QElapsedTimer timer;
+    timer.start();
+    LogRecord record;
+    while (received < PRODUCER_COUNT * PRODUCER_RECORDS && timer.elapsed() < 30000)
+    {
+        if (!ring->pop(record))
+        {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        QVERIFY(record.category < PRODUCER_COUNT);
+        QCOMPARE(record.time, next[record.category]);
+        QCOMPARE(record.message, QByteArray::number(record.time));
+        next[record.category]++;
+        received++;
+    }
+    foreach (Producer * producer, producers)
+    {
+        producer->wait();
+        delete producer;
+    }
+    QCOMPARE(received, PRODUCER_COUNT * PRODUCER_RECORDS);
+    QVERIFY(!ring->pop(record));
+}
+
+void TestLogger::decodeRoundTrip()
+{
+    qint64 base = QDateTime(QDate(2024, 3, 1), QTime(12, 0)).toMSecsSinceEpoch();
+    QList<LogRecord> records;
+    records << makeRecord(base + 5, LOG_DEBUG, LOG_GENERAL, "started")
+            << makeRecord(base + 5, LOG_INFO, LOG_PLAYLIST, "same msec")
+            //clock set back by ntp
+            << makeRecord(base - 3600000, LOG_WARNING, LOG_DOWNLOAD, "clock went back")
+            << makeRecord(base + 86400000LL * 40, LOG_ERROR, LOG_SYNC, QString::fromUtf8("\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82").toUtf8())
+            << makeRecord(base + 86400000LL * 40, LOG_INFO, LOG_HTTP, QByteArray(300, 'x'))
+            << makeRecord(base + 86400000LL * 40 + 1, LOG_INFO, LOG_STATS, "");
+
+    QByteArray data = Logger::encodeHeader(base);
+    QByteArray expected;
+    qint64 previous = base;
+    foreach (const LogRecord &record, records)
+    {
+        Logger::encodeRecord(data, record, previous);
+        previous = record.time;
+        expected += expectedLine(record.time, record.level, record.category, record.message);
+    }
+    QCOMPARE(Logger::decodeFile(data), expected);
+}
+
+void TestLogger::decodeTruncated()
+{
+    qint64 base = 1000000;
+    QByteArray data = Logger::encodeHeader(base);
+    Logger::encodeRecord(data, makeRecord(base + 1, LOG_INFO, LOG_PLAYER, "complete"), base);
+    int completeSize = data.size();
+    Logger::encodeRecord(data, makeRecord(base + 2, LOG_INFO, LOG_PLAYER, "cut by power loss"), base + 1);
+    QByteArray expected = expectedLine(base + 1, LOG_INFO, LOG_PLAYER, "complete");
+    //every cut inside last record keeps only the first one
+    for (int size = completeSize; size < data.size(); size++)
+        QCOMPARE(Logger::decodeFile(data.left(size)), expected);
+    QVERIFY(Logger::decodeFile("TDL").isEmpty());
+    QVERIFY(Logger::decodeFile(QByteArray(32, 'x')).isEmpty());
+}
+
+void TestLogger::ringThroughput()
+{
+    QScopedPointer<LogRing> ring(new LogRing());
+    LogRecord record = makeRecord(0, LOG_INFO, LOG_PLAYLIST, "next item 1f0e2a7c-content playlist area-1");
+    LogRecord popped;
+    QBENCHMARK
+    {
+        for (int i = 0; i < LOG_RING_SIZE; i++)
+            ring->push(record);
+        while (ring->pop(popped))
+            ;
+    }
+}
+
+void TestLogger::encodeThroughput()
+{
+    LogRecord record = makeRecord(0, LOG_INFO, LOG_PLAYLIST, "next item 1f0e2a7c-content playlist area-1");
+    QByteArray out;
+    QBENCHMARK
+    {
+        out.clear();
+        for (int i = 0; i < 10000; i++)
+        {
+            record.time = i;
+            Logger::encodeRecord(out, record, i - 1);
+        }
+    }
+    QVERIFY(!Logger::decodeFile(Logger::encodeHeader(0) + out).isEmpty());
+}
+
+QTEST_MAIN(TestLogger)
+#include "tst_logger.moc"
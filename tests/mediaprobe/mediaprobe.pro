@@ -0,0 +1,14 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_mediaprobe
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils ../../src/core
+
+SOURCES += tst_mediaprobe.cpp \
+    ../../src/utils/mediaprobe.cpp
+
+HEADERS += ../../src/utils/mediaprobe.h
@@ -0,0 +1,114 @@
+#include <QtTest>
+#include <QTemporaryFile>
+#include <QtEndian>
+#include "mediaprobe.h"
+
+//probing a broken file must end at once, whatever box sizes say
+#define PROBE_TIME_LIMIT 1000
+
+//MediaProbe::probeFile on hand made mp4 box trees with hostile sizes
+class TestMediaProbe : public QObject
+{
+    Q_OBJECT
+private slots:
+    void largeSize_data();
+    void largeSize();
+    void nestedLargeSize();
+    void sizeToEnd();
+    void truncatedBox();
+
+private:
+    static QByteArray box(const char * type, const QByteArray &payload);
+    static QByteArray largeBox(const char * type, quint64 size);
+    static QByteArray ftyp();
+    static MediaInfo probe(const QByteArray &data, qint64 &elapsed);
+};
+
+QByteArray TestMediaProbe::box(const char *type, const QByteArray &payload)
+{
+    uchar size[4];
+    qToBigEndian<quint32>(quint32(payload.size() + 8), size);
+    return QByteArray((const char*)size, 4) + QByteArray(type, 4) + payload;
+}
+
+QByteArray TestMediaProbe::largeBox(const char *type, quint64 size)
+{
+    //size 1: real size is 64-bit field after type
+    uchar largeSize[8];
+    qToBigEndian<quint64>(size, largeSize);
+    return QByteArray("\0\0\0\1", 4) + QByteArray(type, 4) + QByteArray((const char*)largeSize, 8);
+}
+
+QByteArray TestMediaProbe::ftyp()
+{
+    return box("ftyp", QByteArray("isom\0\0\0\0", 8));
+}
+
+MediaInfo TestMediaProbe::probe(const QByteArray &data, qint64 &elapsed)
+{
+    QTemporaryFile file;
+    file.open();
+    file.write(data);
+    file.close();
+    QElapsedTimer timer;
+    timer.start();
+    MediaInfo info = MediaProbe::probeFile(file.fileName());
+    elapsed = timer.elapsed();
+    return info;
+}
+
+void TestMediaProbe::largeSize_data()
+{
+    QTest::addColumn<quint64>("size");
+    //above INT64_MAX turns negative as qint64
+    QTest::newRow("int64-max+1") << Q_UINT64_C(0x8000000000000000);
+    QTest::newRow("uint64-max") << Q_UINT64_C(0xFFFFFFFFFFFFFFFF);
+    //-16 as qint64: jumps back to ftyp, endless loop before the check was unsigned
+    QTest::newRow("back-to-ftyp") << Q_UINT64_C(0xFFFFFFFFFFFFFFF0);
+    QTest::newRow("int64-max") << Q_UINT64_C(0x7FFFFFFFFFFFFFFF);
+    QTest::newRow("past-end") << quint64(1000);
+    QTest::newRow("below-header") << quint64(8);
+}
+
+void TestMediaProbe::largeSize()
+{
+    QFETCH(quint64, size);
+    qint64 elapsed;
+    MediaInfo info = probe(ftyp() + largeBox("free", size) + box("moov", QByteArray()), elapsed);
+    QVERIFY(elapsed < PROBE_TIME_LIMIT);
+    //box tree is broken before moov - nothing is known
+    QVERIFY(info.container.isEmpty());
+    QCOMPARE(info.support, MediaInfo::UNKNOWN);
+}
+
+void TestMediaProbe::nestedLargeSize()
+{
+    qint64 elapsed;
+    QByteArray trak = largeBox("trak", Q_UINT64_C(0x8000000000000010));
+    MediaInfo info = probe(ftyp() + box("moov", trak), elapsed);
+    QVERIFY(elapsed < PROBE_TIME_LIMIT);
+    //moov itself is fine, broken trak inside is skipped
+    QCOMPARE(info.container, QString("mp4"));
+    QVERIFY(info.codec.isEmpty());
+}
+
+void TestMediaProbe::sizeToEnd()
+{
+    //size 0: box lasts till end of file
+    qint64 elapsed;
+    MediaInfo info = probe(ftyp() + QByteArray("\0\0\0\0moov", 8), elapsed);
+    QVERIFY(elapsed < PROBE_TIME_LIMIT);
+    QCOMPARE(info.container, QString("mp4"));
+}
+
+void TestMediaProbe::truncatedBox()
+{
+    qint64 elapsed;
+    QByteArray moov = box("moov", QByteArray(64, 0));
+    MediaInfo info = probe(ftyp() + moov.left(20), elapsed);
+    QVERIFY(elapsed < PROBE_TIME_LIMIT);
+    QVERIFY(info.container.isEmpty());
+}
+
+QTEST_MAIN(TestMediaProbe)
+#include "tst_mediaprobe.moc"
@@ -0,0 +1,15 @@
+QT       += core gui quick testlib
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_playbackclock
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/core
+
+SOURCES += tst_playbackclock.cpp \
+    ../../src/core/playbackclock.cpp \
+    ../../src/core/areaclock.cpp
+
+HEADERS += ../../src/core/playbackclock.h \
+    ../../src/core/areaclock.h
@@ -0,0 +1,270 @@
+#include <QtTest>
+#include <functional>
+#include "playbackclock.h"
+#include "areaclock.h"
+
+#define DAY_MSECS (24 * 3600 * 1000LL)
+//upper bound of simulated qml/load latency after each item end
+#define MAX_LOAD_LATENCY 250
+
+//clock on fake time: timer is never started, advanceTo() fires deadlines the way timer would
+class FakeClock : public PlaybackClock
+{
+public:
+    FakeClock() : fakeNow(0), armedAt(-1) {}
+    virtual qint64 now() const {return fakeNow;}
+
+    void advanceTo(qint64 target)
+    {
+        while (armedAt >= 0 && armedAt <= target)
+        {
+            fakeNow = qMax(fakeNow, armedAt);
+            processDeadlines();
+        }
+        fakeNow = qMax(fakeNow, target);
+    }
+
+    qint64 fakeNow;
+
+protected:
+    virtual void armTimer(qint64 wait) {armedAt = wait < 0 ? -1 : fakeNow + wait;}
+
+private:
+    qint64 armedAt;
+};
+
+//item chain of one area driven by AreaClock the way TeleDSPlayer does:
+//item ends, next preloaded item starts at its deadline, then qml loads and preloads the following one
+struct AreaChain
+{
+    AreaChain(FakeClock * clock, int duration) : clock(clock), duration(duration), lastFired(0), lastDeadline(0), fired(0), maxLateness(0) {}
+
+    void start(bool absolute)
+    {
+        this->absolute = absolute;
+        areaClock.queue("item", duration);
+        areaClock.startNow(clock);
+        areaClock.advance(clock, [this]() {itemEnd();});
+        areaClock.queue("item", duration);
+    }
+
+    void itemEnd()
+    {
+        maxLateness = qMax(maxLateness, clock->now() - (areaClock.deadline - PLAYBACK_TRANSITION_LEAD));
+        lastFired = clock->now();
+        lastDeadline = areaClock.deadline;
+        fired++;
+        if (absolute)
+            areaClock.advance(clock, [this]() {itemEnd();});
+        //next item is loaded after some latency, it must not move next deadlines
+        clock->fakeNow += qrand() % MAX_LOAD_LATENCY;
+        if (!absolute)
+        {
+            //relative - old QTimer::singleShot(duration) behaviour, counted from when item really started
+            areaClock.endNow(clock);
+            areaClock.advance(clock, [this]() {itemEnd();});
+        }
+        areaClock.queue("item", duration);
+    }
+
+    FakeClock * clock;
+    AreaClock areaClock;
+    int duration;
+    bool absolute;
+    qint64 lastFired;
+    qint64 lastDeadline;
+    int fired;
+    qint64 maxLateness;
+};
+
+class TestPlaybackClock : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void order();
+    void cancel();
+    void callbackReschedules();
+    void areaQueue();
+    void areaSkip();
+    void areaMoveDeadline();
+    void noDriftOverDay();
+    void areasStayAligned();
+    void relativeTimersDrift();
+};
+
+void TestPlaybackClock::init()
+{
+    qsrand(1);
+}
+
+void TestPlaybackClock::order()
+{
+    FakeClock clock;
+    QList<int> fired;
+    clock.schedule(300, [&fired]() {fired.append(3);});
+    clock.schedule(100, [&fired]() {fired.append(1);});
+    clock.schedule(200, [&fired]() {fired.append(2);});
+    clock.advanceTo(150);
+    QCOMPARE(fired, QList<int>() << 1);
+    clock.advanceTo(1000);
+    QCOMPARE(fired, QList<int>() << 1 << 2 << 3);
+}
+
+void TestPlaybackClock::cancel()
+{
+    FakeClock clock;
+    bool fired = false;
+    int id = clock.schedule(100, [&fired]() {fired = true;});
+    QVERIFY(clock.isScheduled(id));
+    clock.cancel(id);
+    QVERIFY(!clock.isScheduled(id));
+    clock.advanceTo(1000);
+    QVERIFY(!fired);
+}
+
+void TestPlaybackClock::callbackReschedules()
+{
+    //deadline added from callback in the past is fired in the same pass
+    FakeClock clock;
+    int fired = 0;
+    clock.schedule(100, [&clock, &fired]() {
+        fired++;
+        clock.schedule(50, [&fired]() {fired++;});
+    });
+    clock.advanceTo(100);
+    QCOMPARE(fired, 2);
+}
+
+void TestPlaybackClock::areaQueue()
+{
+    FakeClock clock;
+    AreaClock area;
+    int ended = 0;
+    auto onEnd = [&ended]() {ended++;};
+    clock.advanceTo(500);
+    //idle area starts first item at once
+    QVERIFY(!area.queue("a", 1000));
+    area.startNow(&clock);
+    QVERIFY(area.advance(&clock, onEnd));
+    QVERIFY(area.isRunning());
+    QCOMPARE(area.currentItem, QString("a"));
+    QCOMPARE(area.start, qint64(500));
+    QCOMPARE(area.deadline, qint64(1500));
+
+    //running area only keeps the last preloaded item
+    QVERIFY(area.queue("b", 2000));
+    QVERIFY(area.queue("c", 3000));
+    QCOMPARE(area.queuedItems.count(), 1);
+    clock.advanceTo(1500 - PLAYBACK_TRANSITION_LEAD - 1);
+    QCOMPARE(ended, 0);
+    clock.advanceTo(1500 - PLAYBACK_TRANSITION_LEAD);
+    QCOMPARE(ended, 1);
+
+    //next item starts at deadline of previous one, not when advance() is called
+    clock.advanceTo(1700);
+    QVERIFY(area.advance(&clock, onEnd));
+    QCOMPARE(area.currentItem, QString("c"));
+    QCOMPARE(area.start, qint64(1500));
+    QCOMPARE(area.deadline, qint64(4500));
+
+    //nothing preloaded: area becomes idle
+    clock.advanceTo(4500);
+    QCOMPARE(ended, 2);
+    QVERIFY(!area.advance(&clock, onEnd));
+    QVERIFY(!area.isRunning());
+    QCOMPARE(area.currentItem, QString());
+}
+
+void TestPlaybackClock::areaSkip()
+{
+    FakeClock clock;
+    AreaClock area;
+    int ended = 0;
+    auto onEnd = [&ended]() {ended++;};
+    area.queue("a", 10000);
+    area.startNow(&clock);
+    area.advance(&clock, onEnd);
+    area.queue("b", 10000);
+
+    //skipped item ends now, next one is counted from this moment
+    clock.advanceTo(3000);
+    area.endNow(&clock);
+    QVERIFY(!area.isRunning());
+    QVERIFY(area.advance(&clock, onEnd));
+    QCOMPARE(area.currentItem, QString("b"));
+    QCOMPARE(area.start, qint64(3000 + PLAYBACK_TRANSITION_LEAD));
+    QCOMPARE(area.deadline, qint64(13000 + PLAYBACK_TRANSITION_LEAD));
+    //deadline of skipped item is cancelled
+    clock.advanceTo(12999);
+    QCOMPARE(ended, 0);
+    clock.advanceTo(13000);
+    QCOMPARE(ended, 1);
+}
+
+void TestPlaybackClock::areaMoveDeadline()
+{
+    FakeClock clock;
+    AreaClock area;
+    int ended = 0;
+    auto onEnd = [&ended]() {ended++;};
+    area.queue("a", 1000);
+    area.startNow(&clock);
+    area.advance(&clock, onEnd);
+    area.queue("b", 1000);
+
+    //follower takes leader deadline, next item is chained from it
+    area.moveDeadline(&clock, 1300, onEnd);
+    QCOMPARE(area.start, qint64(0));
+    clock.advanceTo(1000);
+    QCOMPARE(ended, 0);
+    clock.advanceTo(1300 - PLAYBACK_TRANSITION_LEAD);
+    QCOMPARE(ended, 1);
+    QVERIFY(area.advance(&clock, onEnd));
+    QCOMPARE(area.start, qint64(1300));
+    QCOMPARE(area.deadline, qint64(2300));
+}
+
+void TestPlaybackClock::noDriftOverDay()
+{
+    FakeClock clock;
+    AreaChain area(&clock, 10000);
+    area.start(true);
+    clock.advanceTo(DAY_MSECS);
+    QCOMPARE(area.fired, int(DAY_MSECS / 10000));
+    //every item ended exactly at its planned time, latency never accumulated
+    QCOMPARE(area.maxLateness, qint64(0));
+    QCOMPARE(area.lastDeadline, DAY_MSECS);
+    QCOMPARE(area.lastFired, DAY_MSECS - PLAYBACK_TRANSITION_LEAD);
+}
+
+void TestPlaybackClock::areasStayAligned()
+{
+    FakeClock clock;
+    AreaChain video(&clock, 15000);
+    AreaChain ticker(&clock, 5000);
+    video.start(true);
+    ticker.start(true);
+    clock.advanceTo(DAY_MSECS);
+    QCOMPARE(video.fired, int(DAY_MSECS / 15000));
+    QCOMPARE(ticker.fired, int(DAY_MSECS / 5000));
+    //areas still switch together at the end of the day, only one load latency apart
+    QCOMPARE(video.lastDeadline, DAY_MSECS);
+    QCOMPARE(ticker.lastDeadline, DAY_MSECS);
+    QVERIFY(qAbs(video.lastFired - ticker.lastFired) < MAX_LOAD_LATENCY);
+    QVERIFY(video.maxLateness < MAX_LOAD_LATENCY);
+    QVERIFY(ticker.maxLateness < MAX_LOAD_LATENCY);
+}
+
+void TestPlaybackClock::relativeTimersDrift()
+{
+    //same load latency with relative timers: schedule falls behind, test above is sensitive to it
+    FakeClock clock;
+    AreaChain area(&clock, 10000);
+    area.start(false);
+    clock.advanceTo(DAY_MSECS);
+    QVERIFY(area.fired < int(DAY_MSECS / 10000));
+}
+
+QTEST_MAIN(TestPlaybackClock)
+#include "tst_playbackclock.moc"
@@ -0,0 +1,15 @@
+QT       += core gui network testlib
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_playlistindex
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils ../../src/core
+
+SOURCES += tst_playlistindex.cpp \
+    ../../src/utils/playlistindex.cpp \
+    ../../src/utils/idregistry.cpp
+
+HEADERS += ../../src/utils/playlistindex.h \
+    ../../src/utils/idregistry.h
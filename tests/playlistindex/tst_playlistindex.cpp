@@ -0,0 +1,168 @@
+#include <QtTest>
+#include "playlistindex.h"
+#include "idregistry.h"
+
+#define BENCH_CAMPAIGNS 8
+#define BENCH_AREAS 6
+#define BENCH_ITEMS 250
+
+//lookup microbenchmark: PlaylistIndex against scans TeleDSPlayer did before
+//getAreaById walked every campaign and area, systemInfoReady probed playlist of every area for each played item
+class TestPlaylistIndex : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void lookup();
+    void unknownIds();
+    void areaById_data();
+    void areaById();
+    void playedItem_data();
+    void playedItem();
+
+private:
+    //stand-in for playlist pointers, index only stores them
+    static AbstractPlaylist * fakePlaylist(int areaIndex) {return reinterpret_cast<AbstractPlaylist*>(quintptr(areaIndex + 1) * 16);}
+
+    PlayerConfigAPI config;
+    PlaylistIndex index;
+    //content handle -> item index per area, like SuperPlaylist::itemIndex
+    QVector<QVector<int> > areaItemIndex;
+    QStringList areaIds;
+    QVector<quint32> playedHandles;
+};
+
+void TestPlaylistIndex::initTestCase()
+{
+    for (int c = 0; c < BENCH_CAMPAIGNS; c++)
+    {
+        PlayerConfigAPI::Campaign campaign;
+        campaign.campaign_id = QString("campaign-%1").arg(c);
+        for (int a = 0; a < BENCH_AREAS; a++)
+        {
+            PlayerConfigAPI::Campaign::Area area;
+            area.area_id = QString("area-%1-%2").arg(c).arg(a);
+            area.area_handle = IdRegistryInstance.intern(area.area_id);
+            for (int i = 0; i < BENCH_ITEMS; i++)
+            {
+                PlayerConfigAPI::Campaign::Area::Content item;
+                item.content_id = QString("content-%1-%2-%3").arg(c).arg(a).arg(i);
+                item.content_handle = IdRegistryInstance.intern(item.content_id);
+                area.content.append(item);
+            }
+            campaign.areas.append(area);
+            areaIds.append(area.area_id);
+        }
+        config.campaigns.append(campaign);
+    }
+
+    index.clear();
+    int areaIndex = 0;
+    foreach (const PlayerConfigAPI::Campaign &campaign, config.campaigns)
+        foreach (const PlayerConfigAPI::Campaign::Area &area, campaign.areas)
+        {
+            index.addArea(area, fakePlaylist(areaIndex++));
+            QVector<int> itemIndex(IdRegistryInstance.count(), -1);
+            for (int i = 0; i < area.content.count(); i++)
+                itemIndex[area.content[i].content_handle] = i;
+            areaItemIndex.append(itemIndex);
+        }
+
+    //played queue spread over all areas
+    foreach (const PlayerConfigAPI::Campaign &campaign, config.campaigns)
+        foreach (const PlayerConfigAPI::Campaign::Area &area, campaign.areas)
+            for (int i = 0; i < area.content.count(); i += 25)
+                playedHandles.append(area.content[i].content_handle);
+}
+
+void TestPlaylistIndex::lookup()
+{
+    int areaIndex = 0;
+    foreach (const PlayerConfigAPI::Campaign &campaign, config.campaigns)
+        foreach (const PlayerConfigAPI::Campaign::Area &area, campaign.areas)
+        {
+            QCOMPARE(index.area(area.area_id).area_id, area.area_id);
+            QCOMPARE(index.area(area.area_id).content.count(), BENCH_ITEMS);
+            foreach (const PlayerConfigAPI::Campaign::Area::Content &item, area.content)
+                QVERIFY(index.playlist(item.content_handle) == fakePlaylist(areaIndex));
+            areaIndex++;
+        }
+}
+
+void TestPlaylistIndex::unknownIds()
+{
+    QVERIFY(index.area("missing-area").area_id.isEmpty());
+    QVERIFY(index.playlist(EMPTY_ID_HANDLE) == 0);
+    QVERIFY(index.playlist(quint32(IdRegistryInstance.count() + 100)) == 0);
+    //handle interned after index was built
+    QVERIFY(index.playlist(IdRegistryInstance.intern("content-added-later")) == 0);
+}
+
+void TestPlaylistIndex::areaById_data()
+{
+    QTest::addColumn<bool>("indexed");
+    QTest::newRow("scan") << false;
+    QTest::newRow("index") << true;
+}
+
+void TestPlaylistIndex::areaById()
+{
+    QFETCH(bool, indexed);
+    int found = 0;
+    QBENCHMARK
+    {
+        found = 0;
+        foreach (const QString &id, areaIds)
+        {
+            PlayerConfigAPI::Campaign::Area result;
+            if (indexed)
+                result = index.area(id);
+            else
+            {
+                foreach (const PlayerConfigAPI::Campaign &cmp, config.campaigns)
+                    foreach (const PlayerConfigAPI::Campaign::Area &area, cmp.areas)
+                        if (area.area_id == id)
+                            result = area;
+            }
+            if (!result.area_id.isEmpty())
+                found++;
+        }
+    }
+    QCOMPARE(found, areaIds.count());
+}
+
+void TestPlaylistIndex::playedItem_data()
+{
+    QTest::addColumn<bool>("indexed");
+    QTest::newRow("scan") << false;
+    QTest::newRow("index") << true;
+}
+
+void TestPlaylistIndex::playedItem()
+{
+    QFETCH(bool, indexed);
+    int found = 0;
+    QBENCHMARK
+    {
+        found = 0;
+        foreach (quint32 handle, playedHandles)
+        {
+            if (indexed)
+            {
+                if (index.playlist(handle))
+                    found++;
+                continue;
+            }
+            for (int a = 0; a < areaItemIndex.count(); a++)
+                if (areaItemIndex[a][handle] >= 0)
+                {
+                    found++;
+                    break;
+                }
+        }
+    }
+    QCOMPARE(found, playedHandles.count());
+}
+
+QTEST_MAIN(TestPlaylistIndex)
+#include "tst_playlistindex.moc"
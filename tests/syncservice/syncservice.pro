@@ -0,0 +1,15 @@
+QT       += core gui quick network testlib
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_syncservice
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/core ../../src/utils
+
+SOURCES += tst_syncservice.cpp \
+    ../../src/core/playbackclock.cpp \
+    ../../src/utils/syncservice.cpp
+
+HEADERS += ../../src/core/playbackclock.h \
+    ../../src/utils/syncservice.h
@@ -0,0 +1,233 @@
+#include <QtTest>
+#include <QUdpSocket>
+#include "syncservice.h"
+#include "playbackclock.h"
+
+//group far from real walls, so harness does not disturb players in the same lan
+#define TEST_SYNC_GROUP 517
+#define SYNC_TIMEOUT 10000
+//offset estimate on loopback must be within a couple of msecs
+#define OFFSET_TOLERANCE 5
+//offset reported by fake leader, far from any real skew
+#define FAKE_LEADER_OFFSET 1000000
+#define FAKE_LEADER_SESSION 0x7E57
+
+//player clock started at another moment: same rate, shifted by skew msecs
+class SkewedClock : public PlaybackClock
+{
+public:
+    explicit SkewedClock(qint64 skew) : skew(skew) {}
+    virtual qint64 now() const {return PlaybackClock::now() + skew;}
+private:
+    qint64 skew;
+};
+
+//one player of localhost video wall
+struct Player
+{
+    Player(SyncService::Mode mode, qint64 skew) : clock(skew)
+    {
+        sync.setClock(&clock);
+        sync.start(mode, TEST_SYNC_GROUP);
+    }
+    ~Player() {sync.stop();}
+
+    SkewedClock clock;
+    SyncService sync;
+};
+
+//leader written by test: multicasts timeline and answers time requests of follower by hand
+struct FakeLeader
+{
+    FakeLeader()
+    {
+        socket.bind(QHostAddress::AnyIPv4, 0);
+        socket.setSocketOption(QAbstractSocket::MulticastLoopbackOption, 1);
+    }
+
+    void sendTimeline()
+    {
+        QByteArray datagram;
+        QDataStream stream(&datagram, QIODevice::WriteOnly);
+        writeHeader(stream, 1);
+        stream << quint32(FAKE_LEADER_SESSION) << socket.localPort() << qint32(-1) << qint64(-1) << quint32(0);
+        socket.writeDatagram(datagram, QHostAddress(SYNC_MULTICAST_GROUP), SYNC_BASE_PORT + TEST_SYNC_GROUP);
+    }
+
+    //last pending request of follower
+    bool readRequest()
+    {
+        bool result = false;
+        while (socket.hasPendingDatagrams())
+        {
+            QByteArray datagram;
+            datagram.resize(int(socket.pendingDatagramSize()));
+            socket.readDatagram(datagram.data(), datagram.size(), &follower, &followerPort);
+            QDataStream stream(datagram);
+            stream.setVersion(QDataStream::Qt_5_0);
+            quint32 magic;
+            quint8 version, type;
+            stream >> magic >> version >> type >> followerSession >> sequence >> originTime;
+            result = stream.status() == QDataStream::Ok && type == 2;
+        }
+        return result;
+    }
+
+    void reply(quint32 session, quint32 sequence, qint64 originTime)
+    {
+        QByteArray datagram;
+        QDataStream stream(&datagram, QIODevice::WriteOnly);
+        writeHeader(stream, 3);
+        stream << session << sequence << originTime << originTime + FAKE_LEADER_OFFSET << originTime + FAKE_LEADER_OFFSET;
+        socket.writeDatagram(datagram, follower, followerPort);
+    }
+
+    static void writeHeader(QDataStream &stream, quint8 type)
+    {
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << quint32(SYNC_MAGIC) << quint8(SYNC_VERSION) << type;
+    }
+
+    QUdpSocket socket;
+    QHostAddress follower;
+    quint16 followerPort;
+    quint32 followerSession;
+    quint32 sequence;
+    qint64 originTime;
+};
+
+//leader and several followers in one process, every player has its own clock
+//followers must find leader offset and get leader timeline converted to their clocks
+class TestSyncService : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void followersSynchronize();
+    void timelineChanges();
+    void leaderLost();
+    void unmatchedReplies();
+};
+
+void TestSyncService::initTestCase()
+{
+    QUdpSocket probe;
+    if (!probe.bind(QHostAddress::AnyIPv4, SYNC_BASE_PORT + TEST_SYNC_GROUP, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint) ||
+        !probe.joinMulticastGroup(QHostAddress(SYNC_MULTICAST_GROUP)))
+        QSKIP("multicast is not available on this host");
+}
+
+void TestSyncService::followersSynchronize()
+{
+    Player leader(SyncService::SYNC_LEADER, 0);
+    Player ahead(SyncService::SYNC_FOLLOWER, 5000);
+    Player behind(SyncService::SYNC_FOLLOWER, -3000);
+
+    qint64 deadline = leader.clock.now() + 60000;
+    SyncService::AreaTimeline area;
+    area.itemId = "item-a";
+    area.start = leader.clock.now();
+    area.deadline = leader.clock.now() + 10000;
+    area.nextItemId = "item-b";
+    leader.sync.publishCampaign(0, deadline);
+    leader.sync.publishArea(0, area);
+
+    QTRY_VERIFY_WITH_TIMEOUT(ahead.sync.isSynchronized(), SYNC_TIMEOUT);
+    QTRY_VERIFY_WITH_TIMEOUT(behind.sync.isSynchronized(), SYNC_TIMEOUT);
+    QVERIFY(!leader.sync.isSynchronized());
+
+    //offset is leader clock minus follower clock
+    QVERIFY(qAbs(ahead.sync.getOffset() + 5000) <= OFFSET_TOLERANCE);
+    QVERIFY(qAbs(behind.sync.getOffset() - 3000) <= OFFSET_TOLERANCE);
+
+    foreach (Player * follower, QList<Player*>() << &ahead << &behind)
+    {
+        SyncService::AreaTimeline local = follower->sync.getAreaTimeline(0);
+        QCOMPARE(local.itemId, area.itemId);
+        QCOMPARE(local.nextItemId, area.nextItemId);
+        //same moment on follower clock
+        qint64 expected = area.deadline - leader.clock.now() + follower->clock.now();
+        QVERIFY(qAbs(local.deadline - expected) <= OFFSET_TOLERANCE);
+    }
+}
+
+void TestSyncService::timelineChanges()
+{
+    Player leader(SyncService::SYNC_LEADER, 0);
+    Player follower(SyncService::SYNC_FOLLOWER, 1500);
+
+    SyncService::AreaTimeline area;
+    area.itemId = "item-a";
+    area.start = leader.clock.now();
+    area.deadline = leader.clock.now() + 10000;
+    area.nextItemId = "item-b";
+    leader.sync.publishCampaign(0, leader.clock.now() + 60000);
+    leader.sync.publishArea(0, area);
+    QTRY_VERIFY_WITH_TIMEOUT(follower.sync.isSynchronized(), SYNC_TIMEOUT);
+
+    QSignalSpy areaChanged(&follower.sync, SIGNAL(areaTimelineChanged(int)));
+    QSignalSpy campaignChanged(&follower.sync, SIGNAL(campaignTimelineChanged(int,qint64)));
+    //leader switched to next item
+    area.itemId = "item-b";
+    area.start = area.deadline;
+    area.deadline += 8000;
+    area.nextItemId = "item-c";
+    leader.sync.publishArea(0, area);
+    QTRY_VERIFY_WITH_TIMEOUT(areaChanged.count() > 0, SYNC_TIMEOUT);
+    QCOMPARE(areaChanged.first().first().toInt(), 0);
+    QCOMPARE(follower.sync.getAreaTimeline(0).itemId, QString("item-b"));
+    QCOMPARE(follower.sync.getAreaTimeline(0).nextItemId, QString("item-c"));
+
+    qint64 campaignDeadline = leader.clock.now() + 30000;
+    leader.sync.publishCampaign(1, campaignDeadline);
+    QTRY_VERIFY_WITH_TIMEOUT(campaignChanged.count() > 0, SYNC_TIMEOUT);
+    QCOMPARE(campaignChanged.last().at(0).toInt(), 1);
+    qint64 expected = campaignDeadline - leader.clock.now() + follower.clock.now();
+    QVERIFY(qAbs(campaignChanged.last().at(1).toLongLong() - expected) <= OFFSET_TOLERANCE);
+}
+
+void TestSyncService::leaderLost()
+{
+    Player follower(SyncService::SYNC_FOLLOWER, 0);
+    {
+        Player leader(SyncService::SYNC_LEADER, 700);
+        leader.sync.publishCampaign(0, leader.clock.now() + 60000);
+        QTRY_VERIFY_WITH_TIMEOUT(follower.sync.isSynchronized(), SYNC_TIMEOUT);
+    }
+    //follower falls back to own playlist when leader is silent
+    QTRY_VERIFY_WITH_TIMEOUT(!follower.sync.isSynchronized(), SYNC_LEADER_TIMEOUT + SYNC_TIMEOUT);
+}
+
+void TestSyncService::unmatchedReplies()
+{
+    Player follower(SyncService::SYNC_FOLLOWER, 0);
+    FakeLeader leader;
+    leader.sendTimeline();
+    QTRY_VERIFY_WITH_TIMEOUT(leader.readRequest(), SYNC_TIMEOUT);
+
+    //foreign session, wrong sequence and wrong origin time of the pending request
+    leader.reply(leader.followerSession + 1, leader.sequence, leader.originTime);
+    leader.reply(leader.followerSession, leader.sequence + 1, leader.originTime);
+    leader.reply(leader.followerSession, leader.sequence - 1, leader.originTime);
+    leader.reply(leader.followerSession, leader.sequence, leader.originTime + 1);
+    quint32 staleSequence = leader.sequence;
+    qint64 staleOrigin = leader.originTime;
+    //next request is sent after replies above are read, they are in one socket queue
+    leader.sendTimeline();
+    QTRY_VERIFY_WITH_TIMEOUT(leader.readRequest(), SYNC_TIMEOUT);
+    QVERIFY(!follower.sync.isSynchronized());
+
+    //reply to request which is already replaced
+    QVERIFY(leader.sequence != staleSequence);
+    leader.reply(leader.followerSession, staleSequence, staleOrigin);
+    leader.sendTimeline();
+    QTRY_VERIFY_WITH_TIMEOUT(leader.readRequest(), SYNC_TIMEOUT);
+    QVERIFY(!follower.sync.isSynchronized());
+
+    leader.reply(leader.followerSession, leader.sequence, leader.originTime);
+    QTRY_VERIFY_WITH_TIMEOUT(follower.sync.isSynchronized(), SYNC_TIMEOUT);
+    QVERIFY(qAbs(follower.sync.getOffset() - FAKE_LEADER_OFFSET) <= OFFSET_TOLERANCE);
+}
+
+QTEST_MAIN(TestSyncService)
+#include "tst_syncservice.moc"
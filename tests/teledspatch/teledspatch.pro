@@ -0,0 +1,17 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_teledspatch
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils \
+    ../../external/teledsDeployTool
+
+SOURCES += tst_teledspatch.cpp \
+    ../../src/utils/teledspatch.cpp \
+    ../../external/teledsDeployTool/teledsencoder.cpp
+
+HEADERS += ../../src/utils/teledspatch.h \
+    ../../external/teledsDeployTool/teledsencoder.h
@@ -0,0 +1,216 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QDirIterator>
+//deploy tool header goes first: teledspatch.h defines magics as macros with the same names
+#include "teledsencoder.h"
+#include "teledspatch.h"
+
+#define TEST_PLAYER_VERSION 7
+#define TEST_PATCH_VERSION 12
+#define TEST_FILE_SIZE 60000
+
+//patch is built by deploy tool (TeleDSPatcher::createPatch, TeleDSPatch::serialize) from two release folders
+//and applied by updater code (TeleDSPatchFile) to a copy of the previous release
+//any failure must leave previous release as it was, without .patch or .orig files
+class TestTeleDSPatch : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+    void roundTrip();
+    void changedSource();
+    void corruptedPatch();
+    void renameFailure();
+
+private:
+    static QByteArray random(int size, uint seed);
+    static void writeFile(QString fileName, const QByteArray &data);
+    static QHash<QString, QByteArray> readDir(QString rootDir);
+    static QStringList scanDir(QString rootDir);
+    TeleDSPatch createPatch();
+    QString writePatch(TeleDSPatch &patch);
+
+    QTemporaryDir * temp;
+    QString prevDir, nextDir, deviceDir;
+};
+
+void TestTeleDSPatch::init()
+{
+    temp = new QTemporaryDir();
+    QVERIFY(temp->isValid());
+    prevDir = temp->path() + "/prev";
+    nextDir = temp->path() + "/next";
+    deviceDir = temp->path() + "/device";
+
+    QByteArray player = random(TEST_FILE_SIZE, 1);
+    QByteArray core = random(TEST_FILE_SIZE, 2);
+    writeFile(prevDir + "/bin/teleds", player);
+    writeFile(prevDir + "/lib/libcore.so", core);
+    writeFile(prevDir + "/lib/libold.so", random(1000, 3));
+    writeFile(prevDir + "/readme.txt", "version 1");
+
+    //rebuilt binary: edits and moved block, unchanged library, new file in new folder
+    QByteArray nextPlayer = player;
+    nextPlayer.replace(1000, 16, random(16, 4));
+    nextPlayer.insert(30000, random(300, 5));
+    nextPlayer = nextPlayer.mid(20000) + nextPlayer.left(20000);
+    writeFile(nextDir + "/bin/teleds", nextPlayer);
+    writeFile(nextDir + "/lib/libcore.so", core);
+    writeFile(nextDir + "/plugins/video/libnew.so", random(5000, 6));
+    writeFile(nextDir + "/readme.txt", "version 2");
+
+    foreach (const QString &name, scanDir(prevDir))
+    {
+        QFile f(prevDir + name);
+        QVERIFY(f.open(QFile::ReadOnly));
+        writeFile(deviceDir + name, f.readAll());
+    }
+}
+
+void TestTeleDSPatch::cleanup()
+{
+    delete temp;
+    temp = 0;
+}
+
+void TestTeleDSPatch::roundTrip()
+{
+    TeleDSPatch patch = createPatch();
+    QString fileName = writePatch(patch);
+
+    TeleDSPatchFile patchFile;
+    QVERIFY(TeleDSPatchFile::isPatch(fileName));
+    QVERIFY(!TeleDSPatchFile::isPatch(deviceDir + "/readme.txt"));
+    QVERIFY(patchFile.load(fileName));
+    QCOMPARE(patchFile.getPlayerVersion(), TEST_PLAYER_VERSION);
+    QCOMPARE(patchFile.getPatchVersion(), TEST_PATCH_VERSION);
+    QVERIFY(patchFile.verifySources(deviceDir));
+    QVERIFY(patchFile.apply(deviceDir));
+
+    //files which are not in the next release are left to full bundle
+    QHash<QString, QByteArray> expected = readDir(nextDir);
+    QHash<QString, QByteArray> device = readDir(deviceDir);
+    QVERIFY(device.remove("/lib/libold.so"));
+    QCOMPARE(device.keys().toSet(), expected.keys().toSet());
+    foreach (const QString &name, expected.keys())
+        QVERIFY2(device[name] == expected[name], qPrintable(name));
+    QVERIFY(QFileInfo(deviceDir + "/plugins/video/libnew.so").isExecutable());
+}
+
+void TestTeleDSPatch::changedSource()
+{
+    TeleDSPatch patch = createPatch();
+    QString fileName = writePatch(patch);
+    writeFile(deviceDir + "/lib/libcore.so", random(TEST_FILE_SIZE, 7));
+    QHash<QString, QByteArray> before = readDir(deviceDir);
+
+    TeleDSPatchFile patchFile;
+    QVERIFY(patchFile.load(fileName));
+    QVERIFY(!patchFile.verifySources(deviceDir));
+    QVERIFY(!patchFile.apply(deviceDir));
+    QCOMPARE(readDir(deviceDir), before);
+}
+
+void TestTeleDSPatch::corruptedPatch()
+{
+    TeleDSPatch patch = createPatch();
+    QString fileName = writePatch(patch);
+    QHash<QString, QByteArray> before = readDir(deviceDir);
+
+    //last bytes are compressed patch of the last file, its hash does not match then
+    QFile f(fileName);
+    QVERIFY(f.open(QFile::ReadWrite));
+    QByteArray data = f.readAll();
+    data[data.size() - 2] = char(data[data.size() - 2] ^ 0x55);
+    QVERIFY(f.seek(0));
+    QCOMPARE(f.write(data), qint64(data.size()));
+    f.close();
+
+    TeleDSPatchFile patchFile;
+    QVERIFY(patchFile.load(fileName));
+    QVERIFY(patchFile.verifySources(deviceDir));
+    QVERIFY(!patchFile.apply(deviceDir));
+    QCOMPARE(readDir(deviceDir), before);
+}
+
+void TestTeleDSPatch::renameFailure()
+{
+    //"/zz" and "/zz/file" are both built, then file "/zz" can not replace folder created for "/zz/file"
+    //files replaced before it must get originals back
+    TeleDSPatch patch = createPatch();
+    foreach (const QString &path, QStringList() << "/zz" << "/zz/file")
+    {
+        FilePatchInfo info = patch.updateFiles.first();
+        QByteArray data = random(2000, 8);
+        info.filePath = path;
+        info.patch = TeleDSPatcher::createFilePatch(QByteArray(), data);
+        info.patchHash = QString(QCryptographicHash::hash(TeleDSPatcher::serializePatch(info.patch), QCryptographicHash::Md5).toHex());
+        info.originalFileHash = QString(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+        patch.updateFiles.append(info);
+    }
+    QString fileName = writePatch(patch);
+    QHash<QString, QByteArray> before = readDir(deviceDir);
+
+    TeleDSPatchFile patchFile;
+    QVERIFY(patchFile.load(fileName));
+    QVERIFY(!patchFile.apply(deviceDir));
+    QCOMPARE(readDir(deviceDir), before);
+}
+
+QByteArray TestTeleDSPatch::random(int size, uint seed)
+{
+    QByteArray result(size, 0);
+    qsrand(seed);
+    for (int i = 0; i < size; i++)
+        result[i] = char(qrand());
+    return result;
+}
+
+void TestTeleDSPatch::writeFile(QString fileName, const QByteArray &data)
+{
+    QFileInfo(fileName).dir().mkpath(".");
+    QFile f(fileName);
+    if (f.open(QFile::WriteOnly))
+        f.write(data);
+}
+
+QHash<QString, QByteArray> TestTeleDSPatch::readDir(QString rootDir)
+{
+    QHash<QString, QByteArray> result;
+    foreach (const QString &name, scanDir(rootDir))
+        result[name] = TeleDSPatcher::readFile(rootDir + name);
+    return result;
+}
+
+QStringList TestTeleDSPatch::scanDir(QString rootDir)
+{
+    QStringList result;
+    QDirIterator it(rootDir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        result.append(it.next().mid(rootDir.length()));
+    return result;
+}
+
+TeleDSPatch TestTeleDSPatch::createPatch()
+{
+    //deploy tool passes every file of both releases
+    QStringList prevFiles, nextFiles;
+    foreach (const QString &name, scanDir(prevDir))
+        prevFiles.append(prevDir + name);
+    foreach (const QString &name, scanDir(nextDir))
+        nextFiles.append(nextDir + name);
+    return TeleDSPatcher::createPatch(prevFiles, nextFiles, prevFiles, prevDir, nextDir, TEST_PLAYER_VERSION, TEST_PATCH_VERSION);
+}
+
+QString TestTeleDSPatch::writePatch(TeleDSPatch &patch)
+{
+    QString fileName = temp->path() + "/update.patch";
+    QFile f(fileName);
+    if (f.open(QFile::WriteOnly))
+        f.write(patch.serialize());
+    return fileName;
+}
+
+QTEST_MAIN(TestTeleDSPatch)
+#include "tst_teledspatch.moc"
@@ -0,0 +1,18 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    changeeventparser \
+    playlistindex \
+    playbackclock \
+    syncservice \
+    checksum \
+    logger \
+    httpconnection \
+    lfsr \
+    filepatch \
+    mediaprobe \
+    teledspatch \
+    ziparchive \
+    httpcompression \
+    timezoneresolver \
+    brightnesscurve
@@ -0,0 +1,14 @@
+QT       += core testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_timezoneresolver
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils
+
+SOURCES += tst_timezoneresolver.cpp \
+    ../../src/utils/timezoneresolver.cpp
+
+HEADERS += ../../src/utils/timezoneresolver.h
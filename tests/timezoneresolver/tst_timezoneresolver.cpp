@@ -0,0 +1,277 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <math.h>
+#include "timezoneresolver.h"
+
+//generated locations, about as many as zone.tab has
+#define RANDOM_ZONE_COUNT 420
+#define RANDOM_POSITION_COUNT 50000
+//parsed coordinate may differ from written one by rounding to seconds
+#define COORDINATE_TOLERANCE 1e-9
+#define YEAR_SECS (365 * 24 * 3600LL)
+
+//TimeZoneResolver on zone.tab files written by test: ISO 6709 coordinates, nearest location
+//compared with search through all locations, offsets and their validity ranges compared with QTimeZone
+class TestTimeZoneResolver : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void parse_data();
+    void parse();
+    void emptyDatabase();
+    void nearestIsExact();
+    void zeroOffset_data();
+    void zeroOffset();
+    void dstTransitions_data();
+    void dstTransitions();
+    void offsetWalk_data();
+    void offsetWalk();
+    void lookup();
+
+private:
+    QString writeZoneTab(const QStringList &lines);
+    static QString iso6709(double value, int degreeDigits);
+    static int bruteNearest(const TimeZoneResolver &resolver, double lat, double lon);
+    static qint64 utc(const QString &isoTime);
+    static bool hasTimeZones();
+
+    QTemporaryDir temp;
+};
+
+void TestTimeZoneResolver::initTestCase()
+{
+    QVERIFY(temp.isValid());
+    qsrand(1);
+}
+
+void TestTimeZoneResolver::parse_data()
+{
+    QTest::addColumn<QString>("coordinates");
+    QTest::addColumn<double>("lat");
+    QTest::addColumn<double>("lon");
+    QTest::newRow("dms") << "+404251-0740023" << 40. + 42. / 60. + 51. / 3600. << -(74. + 23. / 3600.);
+    QTest::newRow("dm") << "-3352+15113" << -(33. + 52. / 60.) << 151. + 13. / 60.;
+    QTest::newRow("dm-west") << "+0519-00402" << 5. + 19. / 60. << -(4. + 2. / 60.);
+    QTest::newRow("dms-south-east") << "-7824+10654" << -(78. + 24. / 60.) << 106. + 54. / 60.;
+    QTest::newRow("dms-zero") << "+513030-0000731" << 51. + 30. / 60. + 30. / 3600. << -(7. / 60. + 31. / 3600.);
+}
+
+void TestTimeZoneResolver::parse()
+{
+    QFETCH(QString, coordinates);
+    QFETCH(double, lat);
+    QFETCH(double, lon);
+    TimeZoneResolver resolver;
+    resolver.load(writeZoneTab(QStringList() << "# comment line" << "" << "XX\tbroken" << "XX\t" + coordinates + "\tTest/Zone\tcomment"));
+    QCOMPARE(resolver.count(), 1);
+    QCOMPARE(resolver.getEntry(0).shortName, QString("XX"));
+    QCOMPARE(resolver.getEntry(0).longName, QString("Test/Zone"));
+    QVERIFY(qAbs(resolver.getEntry(0).lat - lat) < COORDINATE_TOLERANCE);
+    QVERIFY(qAbs(resolver.getEntry(0).lon - lon) < COORDINATE_TOLERANCE);
+}
+
+void TestTimeZoneResolver::emptyDatabase()
+{
+    TimeZoneResolver resolver;
+    resolver.load(temp.path() + "/missing.tab");
+    QCOMPARE(resolver.count(), 0);
+    QCOMPARE(resolver.findZone(55.75, 37.62), -1);
+    QCOMPARE(resolver.offsetFromUtc(-1, 0), 0);
+}
+
+void TestTimeZoneResolver::nearestIsExact()
+{
+    //many locations, so most cells have several candidates and boundaries cross cells everywhere
+    QStringList lines;
+    for (int i = 0; i < RANDOM_ZONE_COUNT; i++)
+    {
+        double lat = qrand() % (180 * 3600) / 3600. - 90.;
+        double lon = qrand() % (360 * 3600) / 3600. - 180.;
+        lines.append("XX\t" + iso6709(lat, 2) + iso6709(lon, 3) + "\tZone/" + QString::number(i));
+    }
+    TimeZoneResolver resolver;
+    resolver.load(writeZoneTab(lines));
+    QCOMPARE(resolver.count(), RANDOM_ZONE_COUNT);
+
+    for (int i = 0; i < RANDOM_POSITION_COUNT; i++)
+    {
+        double lat = qrand() / double(RAND_MAX) * 180. - 90.;
+        double lon = qrand() / double(RAND_MAX) * 360. - 180.;
+        //every third position is right at cell border
+        if (i % 3 == 0)
+            lat = floor(lat) + (i % 2 ? 1e-9 : -1e-9);
+        if (i % 3 == 1)
+            lon = floor(lon) + (i % 2 ? 1e-9 : -1e-9);
+        lat = qBound(-90., lat, 90.);
+        int expected = bruteNearest(resolver, lat, lon);
+        int found = resolver.findZone(lat, lon);
+        if (found != expected)
+            QFAIL(qPrintable(QString("position %1 %2: zone %3 instead of %4").arg(lat, 0, 'f', 9).arg(lon, 0, 'f', 9).arg(found).arg(expected)));
+    }
+    //poles and date line
+    QCOMPARE(resolver.findZone(90., 0.), bruteNearest(resolver, 90., 0.));
+    QCOMPARE(resolver.findZone(-90., 0.), bruteNearest(resolver, -90., 0.));
+    QCOMPARE(resolver.findZone(10., 180.), bruteNearest(resolver, 10., 180.));
+    QCOMPARE(resolver.findZone(10., -180.), bruteNearest(resolver, 10., -180.));
+}
+
+void TestTimeZoneResolver::zeroOffset_data()
+{
+    QTest::addColumn<QString>("zone");
+    QTest::addColumn<QString>("time");
+    QTest::addColumn<int>("offset");
+    QTest::newRow("abidjan-winter") << "Africa/Abidjan" << "2021-01-15T12:00:00" << 0;
+    QTest::newRow("abidjan-summer") << "Africa/Abidjan" << "2021-07-15T12:00:00" << 0;
+    QTest::newRow("reykjavik") << "Atlantic/Reykjavik" << "2021-07-15T12:00:00" << 0;
+    QTest::newRow("london-winter") << "Europe/London" << "2021-01-15T12:00:00" << 0;
+    QTest::newRow("london-summer") << "Europe/London" << "2021-07-15T12:00:00" << 3600;
+    QTest::newRow("unknown-zone") << "Nowhere/Unknown" << "2021-07-15T12:00:00" << 0;
+}
+
+void TestTimeZoneResolver::zeroOffset()
+{
+    QFETCH(QString, zone);
+    QFETCH(QString, time);
+    QFETCH(int, offset);
+    if (!hasTimeZones())
+        QSKIP("time zone database is not available");
+    TimeZoneResolver resolver;
+    resolver.load(writeZoneTab(QStringList() << "XX\t+0519-00402\t" + zone));
+    qint64 t = utc(time);
+    //zero offset is cached and valid like any other one, repeated and nearby lookups give the same
+    QCOMPARE(resolver.offsetFromUtc(0, t), offset);
+    QCOMPARE(resolver.offsetFromUtc(0, t), offset);
+    QCOMPARE(resolver.offsetFromUtc(0, t + 3600), offset);
+    QCOMPARE(resolver.offsetFromUtc(0, t - 3600), offset);
+}
+
+void TestTimeZoneResolver::dstTransitions_data()
+{
+    QTest::addColumn<QString>("zone");
+    QTest::addColumn<QString>("transition");
+    QTest::addColumn<int>("before");
+    QTest::addColumn<int>("after");
+    QTest::newRow("berlin-spring") << "Europe/Berlin" << "2021-03-28T01:00:00" << 3600 << 7200;
+    QTest::newRow("berlin-autumn") << "Europe/Berlin" << "2021-10-31T01:00:00" << 7200 << 3600;
+    QTest::newRow("london-spring") << "Europe/London" << "2021-03-28T01:00:00" << 0 << 3600;
+    QTest::newRow("london-autumn") << "Europe/London" << "2021-10-31T01:00:00" << 3600 << 0;
+    QTest::newRow("new-york-spring") << "America/New_York" << "2021-03-14T07:00:00" << -18000 << -14400;
+    QTest::newRow("sydney-autumn") << "Australia/Sydney" << "2021-04-03T16:00:00" << 39600 << 36000;
+}
+
+void TestTimeZoneResolver::dstTransitions()
+{
+    QFETCH(QString, zone);
+    QFETCH(QString, transition);
+    QFETCH(int, before);
+    QFETCH(int, after);
+    if (!hasTimeZones())
+        QSKIP("time zone database is not available");
+    TimeZoneResolver resolver;
+    resolver.load(writeZoneTab(QStringList() << "XX\t+5230+01322\t" + zone));
+    qint64 t = utc(transition);
+    //range of cached offset ends exactly at transition, in both directions
+    QCOMPARE(resolver.offsetFromUtc(0, t - 1), before);
+    QCOMPARE(resolver.offsetFromUtc(0, t), after);
+    QCOMPARE(resolver.offsetFromUtc(0, t - 1), before);
+    QCOMPARE(resolver.offsetFromUtc(0, t - 24 * 3600), before);
+    QCOMPARE(resolver.offsetFromUtc(0, t + 24 * 3600), after);
+    QCOMPARE(resolver.offsetFromUtc(0, t), after);
+}
+
+void TestTimeZoneResolver::offsetWalk_data()
+{
+    QTest::addColumn<QString>("zone");
+    QTest::newRow("berlin") << "Europe/Berlin";
+    QTest::newRow("london") << "Europe/London";
+    QTest::newRow("new-york") << "America/New_York";
+    QTest::newRow("sydney") << "Australia/Sydney";
+    QTest::newRow("abidjan") << "Africa/Abidjan";
+}
+
+void TestTimeZoneResolver::offsetWalk()
+{
+    QFETCH(QString, zone);
+    if (!hasTimeZones())
+        QSKIP("time zone database is not available");
+    TimeZoneResolver resolver;
+    resolver.load(writeZoneTab(QStringList() << "XX\t+5230+01322\t" + zone));
+    QTimeZone timeZone(zone.toLatin1());
+    QVERIFY(timeZone.isValid());
+    //hour steps over two years forward, then back, every cached range must agree with QTimeZone
+    qint64 start = utc("2020-01-01T00:30:00");
+    for (qint64 t = start; t < start + 2 * YEAR_SECS; t += 3600)
+        QCOMPARE(resolver.offsetFromUtc(0, t), timeZone.offsetFromUtc(QDateTime::fromMSecsSinceEpoch(t * 1000, Qt::UTC)));
+    for (qint64 t = start + 2 * YEAR_SECS; t >= start; t -= 3600)
+        QCOMPARE(resolver.offsetFromUtc(0, t), timeZone.offsetFromUtc(QDateTime::fromMSecsSinceEpoch(t * 1000, Qt::UTC)));
+}
+
+void TestTimeZoneResolver::lookup()
+{
+    QStringList lines;
+    for (int i = 0; i < RANDOM_ZONE_COUNT; i++)
+        lines.append("XX\t" + iso6709(qrand() % 170 - 85, 2) + iso6709(qrand() % 360 - 180, 3) + "\tEurope/Berlin");
+    TimeZoneResolver resolver;
+    resolver.load(writeZoneTab(lines));
+    qint64 t = utc("2021-06-01T00:00:00");
+    //device position does not change, offset is asked every minute
+    int offset = 0;
+    QBENCHMARK
+    {
+        offset = resolver.offsetFromUtc(resolver.findZone(52.52, 13.40), t);
+        t += 60;
+    }
+    Q_UNUSED(offset);
+}
+
+QString TestTimeZoneResolver::writeZoneTab(const QStringList &lines)
+{
+    static int index = 0;
+    QString fileName = temp.path() + QString("/zone%1.tab").arg(index++);
+    QFile f(fileName);
+    if (f.open(QFile::WriteOnly))
+        f.write(lines.join("\n").toUtf8() + "\n");
+    return fileName;
+}
+
+QString TestTimeZoneResolver::iso6709(double value, int degreeDigits)
+{
+    //+DDMMSS / +DDDMMSS
+    int seconds = int(qRound(qAbs(value) * 3600.));
+    return QString(value < 0 ? "-" : "+") + QString("%1").arg(seconds / 3600, degreeDigits, 10, QChar('0')) +
+           QString("%1").arg(seconds / 60 % 60, 2, 10, QChar('0')) + QString("%1").arg(seconds % 60, 2, 10, QChar('0'));
+}
+
+int TestTimeZoneResolver::bruteNearest(const TimeZoneResolver &resolver, double lat, double lon)
+{
+    double la = lat / 180. * M_PI, lo = lon / 180. * M_PI;
+    int found = -1;
+    double best = -2.;
+    for (int i = 0; i < resolver.count(); i++)
+    {
+        double zla = resolver.getEntry(i).lat / 180. * M_PI, zlo = resolver.getEntry(i).lon / 180. * M_PI;
+        double dot = cos(la) * cos(lo) * cos(zla) * cos(zlo) + cos(la) * sin(lo) * cos(zla) * sin(zlo) + sin(la) * sin(zla);
+        if (dot > best)
+        {
+            best = dot;
+            found = i;
+        }
+    }
+    return found;
+}
+
+qint64 TestTimeZoneResolver::utc(const QString &isoTime)
+{
+    QDateTime time = QDateTime::fromString(isoTime, Qt::ISODate);
+    time.setTimeSpec(Qt::UTC);
+    return time.toMSecsSinceEpoch() / 1000;
+}
+
+bool TestTimeZoneResolver::hasTimeZones()
+{
+    return QTimeZone("Europe/Berlin").isValid();
+}
+
+QTEST_MAIN(TestTimeZoneResolver)
+#include "tst_timezoneresolver.moc"
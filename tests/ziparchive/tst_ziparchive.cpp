@@ -0,0 +1,457 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <zlib.h>
+#include "ziparchive.h"
+#include "zipcontentserver.h"
+#include "qhttpserver.h"
+#include "qhttpconnection.h"
+
+#define RESPONSE_TIMEOUT 5000
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+//bigger than ZIP_CONTENT_CACHE_ENTRY_SIZE, so server streams it by ZipEntrySender
+#define BIG_ENTRY_SIZE (300 * 1024)
+
+//builds zip files byte by byte, so every header field can be set the way other zip tools do
+class ZipWriter
+{
+public:
+    struct Options
+    {
+        Options() : method(ZIP_METHOD_DEFLATED), flags(0), zip64(false) {}
+        quint16 method;
+        quint16 flags;
+        //sizes in central header are 0xFFFFFFFF and real ones are in zip64 extra field
+        bool zip64;
+        QByteArray localExtra;
+    };
+
+    void add(const QString &name, const QByteArray &content, const Options &options = Options())
+    {
+        QByteArray nameData = name.toUtf8();
+        QByteArray stored = options.method == ZIP_METHOD_DEFLATED ? deflateRaw(content) : content;
+        quint32 crc = quint32(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(content.constData()), content.size()));
+        quint32 localOffset = quint32(data.size());
+
+        QDataStream local(&data, QIODevice::Append);
+        local.setByteOrder(QDataStream::LittleEndian);
+        local << quint32(0x04034b50) << quint16(20) << options.flags << options.method << quint16(0) << quint16(0);
+        local << crc << quint32(stored.size()) << quint32(content.size());
+        local << quint16(nameData.size()) << quint16(options.localExtra.size());
+        local.writeRawData(nameData.constData(), nameData.size());
+        local.writeRawData(options.localExtra.constData(), options.localExtra.size());
+        local.writeRawData(stored.constData(), stored.size());
+
+        QByteArray extra;
+        if (options.zip64)
+        {
+            QDataStream e(&extra, QIODevice::WriteOnly);
+            e.setByteOrder(QDataStream::LittleEndian);
+            e << quint16(0x0001) << quint16(16) << quint64(content.size()) << quint64(stored.size());
+        }
+        QDataStream c(&central, QIODevice::Append);
+        c.setByteOrder(QDataStream::LittleEndian);
+        c << quint32(0x02014b50) << quint16(20) << quint16(20) << options.flags << options.method << quint16(0) << quint16(0);
+        c << crc << (options.zip64 ? quint32(0xFFFFFFFF) : quint32(stored.size())) << (options.zip64 ? quint32(0xFFFFFFFF) : quint32(content.size()));
+        c << quint16(nameData.size()) << quint16(extra.size()) << quint16(0) << quint16(0) << quint16(0) << quint32(0) << localOffset;
+        c.writeRawData(nameData.constData(), nameData.size());
+        c.writeRawData(extra.constData(), extra.size());
+        count++;
+    }
+
+    QByteArray finish(const QByteArray &comment = QByteArray())
+    {
+        QByteArray result = data + central;
+        QDataStream e(&result, QIODevice::Append);
+        e.setByteOrder(QDataStream::LittleEndian);
+        e << quint32(0x06054b50) << quint16(0) << quint16(0) << quint16(count) << quint16(count);
+        e << quint32(central.size()) << quint32(data.size()) << quint16(comment.size());
+        e.writeRawData(comment.constData(), comment.size());
+        return result;
+    }
+
+    ZipWriter() : count(0) {}
+
+    static QByteArray deflateRaw(const QByteArray &content)
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        QByteArray result(int(deflateBound(&stream, uLong(content.size()))), 0);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.constData()));
+        stream.avail_in = uInt(content.size());
+        stream.next_out = reinterpret_cast<Bytef*>(result.data());
+        stream.avail_out = uInt(result.size());
+        deflate(&stream, Z_FINISH);
+        result.resize(int(stream.total_out));
+        deflateEnd(&stream);
+        return result;
+    }
+
+    QByteArray data;
+    QByteArray central;
+    int count;
+};
+
+//QHttpConnection for every loopback socket, every request gets entry "big.bin" of archive through ZipEntrySender
+class EntryServer : public QObject
+{
+    Q_OBJECT
+public:
+    EntryServer()
+    {
+        connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        server.listen(QHostAddress::LocalHost);
+    }
+    bool connectClient(QTcpSocket &client)
+    {
+        client.connectToHost(server.serverAddress(), server.serverPort());
+        return client.waitForConnected(RESPONSE_TIMEOUT);
+    }
+
+    QSharedPointer<ZipArchive> archive;
+
+private slots:
+    void newConnection()
+    {
+        while (server.hasPendingConnections())
+        {
+            QHttpConnection * connection = new QHttpConnection(server.nextPendingConnection(), this);
+            connect(connection, SIGNAL(newRequest(QHttpRequest*,QHttpResponse*)), this, SLOT(newRequest(QHttpRequest*,QHttpResponse*)));
+        }
+    }
+    void newRequest(QHttpRequest * request, QHttpResponse * response)
+    {
+        ZipArchive::Entry entry;
+        archive->getEntry("big.bin", entry);
+        response->setHeader("Content-Length", QString::number(entry.size));
+        response->writeHead(200);
+        new ZipEntrySender(response, archive, entry);
+        request->deleteLater();
+    }
+
+private:
+    //QHttpServer is created only for STATUS_CODES
+    QHttpServer statusCodes;
+    QTcpServer server;
+};
+
+//ZipArchive index of archives written the way zip tools do it, broken archives and entries,
+//ZipEntrySender has to close connection instead of finishing response with broken entry
+class TestZipArchive : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void index();
+    void zip64Sizes();
+    void invalid_data();
+    void invalid();
+    void chunks_data();
+    void chunks();
+    void corruptEntry_data();
+    void corruptEntry();
+    void senderComplete();
+    void senderAbortsCorrupt();
+
+private:
+    static QByteArray random(int size, uint seed);
+    static QByteArray text(int size);
+    QString writeFile(const QByteArray &data);
+    QByteArray fetch(QTcpSocket &client, int &contentLength);
+
+    QTemporaryDir temp;
+};
+
+void TestZipArchive::init()
+{
+    QVERIFY(temp.isValid());
+}
+
+void TestZipArchive::index()
+{
+    ZipWriter writer;
+    ZipWriter::Options stored, deflated, localExtra, encrypted, bzip2;
+    stored.method = ZIP_METHOD_STORED;
+    //local header extra field differs from central one, data starts after local one
+    localExtra.localExtra = QByteArray("\x55\x54\x05\x00\x01\x00\x00\x00\x00", 9);
+    encrypted.flags = 0x0001;
+    bzip2.method = 12;
+    writer.add("index.html", text(5000), deflated);
+    writer.add("img/", QByteArray(), stored);
+    writer.add("img/logo.png", random(3000, 1), stored);
+    writer.add("js/app.js", text(70000), localExtra);
+    writer.add("empty.txt", QByteArray(), stored);
+    writer.add("secret.txt", text(100), encrypted);
+    writer.add("packed.bin", text(100), bzip2);
+    writer.add(QString::fromUtf8("data/\xd0\xba\xd0\xb0\xd1\x80\xd1\x82\xd0\xb0.json"), text(200), deflated);
+
+    ZipArchive archive;
+    //archive comment is between end of central directory record and end of file
+    QVERIFY(archive.open(writeFile(writer.finish("made by test"))));
+    //folders, encrypted entries and unsupported methods are not in index
+    QCOMPARE(archive.count(), 5);
+    QVERIFY(!archive.contains("img/"));
+    QVERIFY(!archive.contains("secret.txt"));
+    QVERIFY(!archive.contains("packed.bin"));
+
+    ZipArchive::Entry entry;
+    QVERIFY(!archive.getEntry("missing.html", entry));
+    QVERIFY(archive.getEntry("index.html", entry));
+    QCOMPARE(entry.method, quint16(ZIP_METHOD_DEFLATED));
+    QCOMPARE(entry.size, qint64(5000));
+    QVERIFY(entry.compressedSize < entry.size);
+    QCOMPARE(archive.read(entry), text(5000));
+    QVERIFY(archive.getEntry("img/logo.png", entry));
+    QCOMPARE(entry.method, quint16(ZIP_METHOD_STORED));
+    QCOMPARE(archive.read(entry), random(3000, 1));
+    QVERIFY(archive.getEntry("js/app.js", entry));
+    QCOMPARE(archive.read(entry), text(70000));
+    QVERIFY(archive.getEntry("empty.txt", entry));
+    QCOMPARE(archive.read(entry), QByteArray());
+    QVERIFY(archive.getEntry(QString::fromUtf8("data/\xd0\xba\xd0\xb0\xd1\x80\xd1\x82\xd0\xb0.json"), entry));
+    QCOMPARE(archive.read(entry), text(200));
+}
+
+void TestZipArchive::zip64Sizes()
+{
+    ZipWriter writer;
+    ZipWriter::Options zip64;
+    zip64.zip64 = true;
+    writer.add("a.txt", text(1000), zip64);
+    writer.add("b.txt", text(2000));
+    ZipArchive archive;
+    QVERIFY(archive.open(writeFile(writer.finish())));
+    ZipArchive::Entry entry;
+    QVERIFY(archive.getEntry("a.txt", entry));
+    QCOMPARE(entry.size, qint64(1000));
+    QCOMPARE(archive.read(entry), text(1000));
+    QVERIFY(archive.getEntry("b.txt", entry));
+    QCOMPARE(archive.read(entry), text(2000));
+}
+
+void TestZipArchive::invalid_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    ZipWriter writer;
+    writer.add("index.html", text(5000));
+    writer.add("app.js", text(3000));
+    QByteArray good = writer.finish();
+    int centralOffset = writer.data.size();
+
+    //fields of end of central directory record: size at 12, offset at 16
+    int eocd = good.size() - 22;
+    QByteArray centralPastEnd = good;
+    centralPastEnd[eocd + 13] = char(centralPastEnd[eocd + 13] + 1);
+    QByteArray offsetPastEnd = good;
+    offsetPastEnd[eocd + 17] = char(0x7F);
+    QByteArray brokenLocal = good;
+    brokenLocal[0] = 'X';
+    //compressed size of second entry (after 46 byte header and name of first one) goes past central directory
+    QByteArray sizePastEnd = good;
+    sizePastEnd.replace(centralOffset + 46 + 10 + 20, 4, QByteArray("\xFF\xFF\xFF\x0F", 4));
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("random") << random(10000, 2);
+    QTest::newRow("eocd-only-part") << good.right(10);
+    QTest::newRow("central-size-past-end") << centralPastEnd;
+    QTest::newRow("central-offset-past-end") << offsetPastEnd;
+    QTest::newRow("broken-local-header") << brokenLocal;
+    QTest::newRow("size-past-end") << sizePastEnd;
+}
+
+void TestZipArchive::invalid()
+{
+    QFETCH(QByteArray, data);
+    ZipArchive archive;
+    QVERIFY(!archive.open(writeFile(data)));
+    QCOMPARE(archive.count(), 0);
+}
+
+void TestZipArchive::chunks_data()
+{
+    QTest::addColumn<int>("method");
+    QTest::addColumn<int>("chunkSize");
+    QTest::newRow("stored-1000") << ZIP_METHOD_STORED << 1000;
+    QTest::newRow("stored-default") << ZIP_METHOD_STORED << ZIP_ARCHIVE_CHUNK;
+    QTest::newRow("deflated-1000") << ZIP_METHOD_DEFLATED << 1000;
+    QTest::newRow("deflated-default") << ZIP_METHOD_DEFLATED << ZIP_ARCHIVE_CHUNK;
+}
+
+void TestZipArchive::chunks()
+{
+    QFETCH(int, method);
+    QFETCH(int, chunkSize);
+    QByteArray content = text(BIG_ENTRY_SIZE / 2) + random(BIG_ENTRY_SIZE / 2, 3);
+    ZipWriter writer;
+    ZipWriter::Options options;
+    options.method = quint16(method);
+    writer.add("big.bin", content, options);
+    ZipArchive archive;
+    QVERIFY(archive.open(writeFile(writer.finish())));
+    ZipArchive::Entry entry;
+    QVERIFY(archive.getEntry("big.bin", entry));
+
+    ZipEntryReader reader(&archive, entry);
+    QByteArray result;
+    int reads = 0;
+    while (!reader.atEnd() && reads++ < content.size())
+    {
+        QByteArray chunk = reader.readChunk(chunkSize);
+        QVERIFY(!reader.hasError());
+        QVERIFY(chunk.size() <= chunkSize);
+        result += chunk;
+    }
+    QCOMPARE(result.size(), content.size());
+    QVERIFY(result == content);
+    QVERIFY(reader.readChunk(chunkSize).isEmpty());
+}
+
+void TestZipArchive::corruptEntry_data()
+{
+    QTest::addColumn<int>("method");
+    QTest::addColumn<bool>("corruptCrc");
+    QTest::newRow("stored-data") << ZIP_METHOD_STORED << false;
+    QTest::newRow("deflated-data") << ZIP_METHOD_DEFLATED << false;
+    QTest::newRow("stored-crc") << ZIP_METHOD_STORED << true;
+    QTest::newRow("deflated-crc") << ZIP_METHOD_DEFLATED << true;
+}
+
+void TestZipArchive::corruptEntry()
+{
+    QFETCH(int, method);
+    QFETCH(bool, corruptCrc);
+    QByteArray content = text(BIG_ENTRY_SIZE);
+    ZipWriter writer;
+    ZipWriter::Options options;
+    options.method = quint16(method);
+    writer.add("big.bin", content, options);
+    QByteArray data = writer.finish();
+    if (corruptCrc)
+        //crc in central header, local one is not read
+        data[writer.data.size() + 16] = char(data[writer.data.size() + 16] ^ 0x01);
+    else
+        //last byte of entry data
+        data[writer.data.size() - 1] = char(data[writer.data.size() - 1] ^ 0x01);
+
+    ZipArchive archive;
+    QVERIFY(archive.open(writeFile(data)));
+    ZipArchive::Entry entry;
+    QVERIFY(archive.getEntry("big.bin", entry));
+    QCOMPARE(archive.read(entry), QByteArray());
+
+    //error is known when the last chunk is read, before it is handed out
+    ZipEntryReader reader(&archive, entry);
+    int reads = 0;
+    while (!reader.atEnd() && !reader.hasError() && reads++ < content.size())
+        reader.readChunk();
+    QVERIFY(reader.hasError());
+    QVERIFY(reader.readChunk().isEmpty());
+}
+
+void TestZipArchive::senderComplete()
+{
+    QByteArray content = random(BIG_ENTRY_SIZE, 4);
+    ZipWriter writer;
+    writer.add("big.bin", content);
+    EntryServer server;
+    server.archive = QSharedPointer<ZipArchive>(new ZipArchive());
+    QVERIFY(server.archive->open(writeFile(writer.finish())));
+
+    QTcpSocket client;
+    QVERIFY(server.connectClient(client));
+    int contentLength = -1;
+    QByteArray body = fetch(client, contentLength);
+    QCOMPARE(contentLength, content.size());
+    QVERIFY(body == content);
+    //keep-alive connection is still usable
+    QCOMPARE(client.state(), QAbstractSocket::ConnectedState);
+}
+
+void TestZipArchive::senderAbortsCorrupt()
+{
+    QByteArray content = random(BIG_ENTRY_SIZE, 5);
+    ZipWriter writer;
+    ZipWriter::Options stored;
+    stored.method = ZIP_METHOD_STORED;
+    writer.add("big.bin", content, stored);
+    QByteArray data = writer.finish();
+    data[writer.data.size() - 1] = char(data[writer.data.size() - 1] ^ 0x01);
+    EntryServer server;
+    server.archive = QSharedPointer<ZipArchive>(new ZipArchive());
+    QVERIFY(server.archive->open(writeFile(data)));
+
+    QTcpSocket client;
+    QVERIFY(server.connectClient(client));
+    int contentLength = -1;
+    QByteArray body = fetch(client, contentLength);
+    QCOMPARE(contentLength, content.size());
+    //whole chunks before the broken one are sent, then connection is closed
+    QVERIFY(body.size() < contentLength);
+    QCOMPARE(body.size() % ZIP_ARCHIVE_CHUNK, 0);
+    QVERIFY(body == content.left(body.size()));
+    QTRY_COMPARE_WITH_TIMEOUT(client.state(), QAbstractSocket::UnconnectedState, RESPONSE_TIMEOUT);
+}
+
+QByteArray TestZipArchive::random(int size, uint seed)
+{
+    QByteArray result(size, 0);
+    qsrand(seed);
+    for (int i = 0; i < size; i++)
+        result[i] = char(qrand());
+    return result;
+}
+
+QByteArray TestZipArchive::text(int size)
+{
+    QByteArray line = "<div class=\"item\">widget content line</div>\n";
+    QByteArray result;
+    while (result.size() < size)
+        result += line + QByteArray::number(result.size());
+    return result.left(size);
+}
+
+QString TestZipArchive::writeFile(const QByteArray &data)
+{
+    static int index = 0;
+    QString fileName = temp.path() + QString("/archive%1.zip").arg(index++);
+    QFile f(fileName);
+    if (f.open(QFile::WriteOnly))
+        f.write(data);
+    return fileName;
+}
+
+QByteArray TestZipArchive::fetch(QTcpSocket &client, int &contentLength)
+{
+    //body is read until content length is reached or connection is closed
+    QByteArray received;
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    connect(&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+    auto check = [&]() {
+        received.append(client.readAll());
+        int headerEnd = received.indexOf("\r\n\r\n");
+        if (headerEnd < 0)
+            return;
+        QRegularExpressionMatch match = QRegularExpression("Content-Length: (\\d+)").match(QString::fromLatin1(received.left(headerEnd)));
+        contentLength = match.hasMatch() ? match.captured(1).toInt() : -1;
+        if (received.size() - headerEnd - 4 >= contentLength)
+            loop.quit();
+    };
+    QMetaObject::Connection readConnection = connect(&client, &QTcpSocket::readyRead, check);
+    QMetaObject::Connection closeConnection = connect(&client, &QTcpSocket::disconnected, &loop, &QEventLoop::quit);
+    client.write("GET /zip/archive.zip/big.bin HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+    timeout.start(RESPONSE_TIMEOUT);
+    loop.exec();
+    disconnect(readConnection);
+    disconnect(closeConnection);
+    received.append(client.readAll());
+    int headerEnd = received.indexOf("\r\n\r\n");
+    return headerEnd < 0 ? QByteArray() : received.mid(headerEnd + 4);
+}
+
+QTEST_MAIN(TestZipArchive)
+#include "tst_ziparchive.moc"
@@ -0,0 +1,34 @@
+QT       += core network testlib
+QT       -= gui
+CONFIG   += c++11 console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_ziparchive
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/utils \
+    ../../src/core \
+    ../../src/httpserver
+
+SOURCES += tst_ziparchive.cpp \
+    ../../src/utils/ziparchive.cpp \
+    ../../src/core/zipcontentserver.cpp \
+    ../../src/core/widgetdatastore.cpp \
+    ../../src/httpserver/http_parser.c \
+    ../../src/httpserver/qhttpconnection.cpp \
+    ../../src/httpserver/qhttprequest.cpp \
+    ../../src/httpserver/qhttpresponse.cpp \
+    ../../src/httpserver/qhttpserver.cpp
+
+HEADERS += ../../src/utils/ziparchive.h \
+    ../../src/core/zipcontentserver.h \
+    ../../src/core/widgetdatastore.h \
+    ../../src/httpserver/http_parser.h \
+    ../../src/httpserver/qhttpconnection.h \
+    ../../src/httpserver/qhttprequest.h \
+    ../../src/httpserver/qhttpresponse.h \
+    ../../src/httpserver/qhttpserver.h \
+    ../../src/httpserver/qhttpserverapi.h \
+    ../../src/httpserver/qhttpserverfwd.h
+
+LIBS += -lz